@@ -0,0 +1,142 @@
+/*
+ * Portable performance counters (see perfcount.h).
+ */
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "perfcount.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} perfcount_events[PERFCOUNT_NUM] = {
+	{ 0, 0 },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+};
+
+static int
+perfcount_open_event(unsigned i, int group_fd)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof attr);
+	attr.size = sizeof attr;
+	attr.type = perfcount_events[i].type;
+	attr.config = perfcount_events[i].config;
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+static uint64_t
+perfcount_ns(void)
+{
+	struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_RAW
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+unsigned
+perfcount_open(perfcount *pc)
+{
+	unsigned i;
+
+	for (i = 0; i < PERFCOUNT_NUM; i ++) {
+		pc->fd[i] = -1;
+	}
+	pc->nopen = 0;
+#ifdef __linux__
+	for (i = 1; i < PERFCOUNT_NUM; i ++) {
+		int fd;
+
+		fd = perfcount_open_event(i,
+			pc->nopen == 0 ? -1 : pc->fd[pc->order[0]]);
+		if (fd >= 0) {
+			pc->fd[i] = fd;
+			pc->order[pc->nopen ++] = i;
+		}
+	}
+#endif
+	return pc->nopen;
+}
+
+void
+perfcount_close(perfcount *pc)
+{
+	unsigned i;
+
+	for (i = 0; i < PERFCOUNT_NUM; i ++) {
+		if (pc->fd[i] >= 0) {
+			close(pc->fd[i]);
+			pc->fd[i] = -1;
+		}
+	}
+	pc->nopen = 0;
+}
+
+int
+perfcount_available(const perfcount *pc, unsigned i)
+{
+	return i == PERFCOUNT_NS || (i < PERFCOUNT_NUM && pc->fd[i] >= 0);
+}
+
+void
+perfcount_read(const perfcount *pc, perfcount_sample *s)
+{
+	memset(s, 0, sizeof *s);
+#ifdef __linux__
+	if (pc->nopen > 0) {
+		uint64_t buf[1 + PERFCOUNT_NUM];
+		ssize_t len;
+		unsigned u;
+
+		len = read(pc->fd[pc->order[0]], buf, sizeof buf);
+		if (len >= (ssize_t)sizeof(uint64_t)) {
+			for (u = 0; u < pc->nopen && u < buf[0]; u ++) {
+				s->v[pc->order[u]] = buf[1 + u];
+			}
+		}
+	}
+#else
+	(void)pc;
+#endif
+	s->v[PERFCOUNT_NS] = perfcount_ns();
+}
+
+void
+perfcount_diff(perfcount_sample *d,
+	const perfcount_sample *start, const perfcount_sample *stop)
+{
+	unsigned i;
+
+	for (i = 0; i < PERFCOUNT_NUM; i ++) {
+		d->v[i] = stop->v[i] - start->v[i];
+	}
+}
+
+const char *
+perfcount_name(unsigned i)
+{
+	static const char *const names[PERFCOUNT_NUM] = {
+		"ns", "cycles", "instructions", "branch_misses", "cache_misses"
+	};
+
+	return i < PERFCOUNT_NUM ? names[i] : "";
+}
@@ -0,0 +1,67 @@
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+/*
+ * Portable performance counters for the benchmark driver (speed_perf.c).
+ *
+ * On Linux, CPU cycles, retired instructions, branch misses and cache
+ * misses are read from a perf_event_open() counter group (user-space
+ * only). Counters that the kernel or the CPU does not provide (e.g. no
+ * PMU in a virtual machine, or perf_event_paranoid too high) are marked
+ * as unavailable. Wall-clock time (clock_gettime(), nanoseconds) is
+ * always measured, so that the driver works on any POSIX system.
+ */
+
+#include <stdint.h>
+
+#define PERFCOUNT_NS            0
+#define PERFCOUNT_CYCLES        1
+#define PERFCOUNT_INSTRUCTIONS  2
+#define PERFCOUNT_BRANCH_MISSES 3
+#define PERFCOUNT_CACHE_MISSES  4
+#define PERFCOUNT_NUM           5
+
+/*
+ * fd[i] is the descriptor of counter i (-1 if not available). The
+ * first opened counter leads the group; order[] lists the counters in
+ * the order in which a group read returns them.
+ */
+typedef struct {
+	int fd[PERFCOUNT_NUM];
+	unsigned order[PERFCOUNT_NUM];
+	unsigned nopen;
+} perfcount;
+
+typedef struct {
+	uint64_t v[PERFCOUNT_NUM];
+} perfcount_sample;
+
+/*
+ * Open the counters. Returned value is the number of hardware counters
+ * that could be opened (0 if only wall-clock time is available).
+ */
+unsigned perfcount_open(perfcount *pc);
+
+void perfcount_close(perfcount *pc);
+
+/*
+ * Returned value is 1 if counter i is measured, 0 otherwise.
+ */
+int perfcount_available(const perfcount *pc, unsigned i);
+
+/*
+ * Read all counters at once; the difference between two snapshots
+ * gives the cost of the code in between (perfcount_diff()). Counters
+ * which are not available read as 0.
+ */
+void perfcount_read(const perfcount *pc, perfcount_sample *s);
+
+void perfcount_diff(perfcount_sample *d,
+	const perfcount_sample *start, const perfcount_sample *stop);
+
+/*
+ * Name of counter i, as used in the reports ("ns", "cycles"...).
+ */
+const char *perfcount_name(unsigned i);
+
+#endif
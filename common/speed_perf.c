@@ -0,0 +1,386 @@
+/*
+ * Benchmark driver shared by the implementations (neon/, ref-avx2/).
+ *
+ * This code uses only the external API (falcon.h of the implementation
+ * it is compiled with) and the counters of perfcount.h: on Linux,
+ * cycles, instructions, branch misses and cache misses are read with
+ * perf_event_open(), and wall-clock time is always measured. Each
+ * operation is run 'iterations' times (a tenth of that for key pair
+ * generation), one call per sample, and the median, 90th and 99th
+ * percentiles of every counter are reported.
+ *
+ * Results are printed as a markdown table (as in the benchmark_*.md
+ * files) and written in JSON to the file given with -j.
+ *
+ * Usage: speed_perf [-n iterations] [-l logn] [-j file.json]
+ *
+ * If FALCON_LOGN is defined at compile time (neon/), only that degree
+ * is supported; otherwise logn 9 and 10 are benchmarked by default.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "falcon.h"
+#include "perfcount.h"
+
+#ifndef BENCH_IMPL
+#define BENCH_IMPL   "falcon"
+#endif
+
+#define BENCH_MAX_RESULTS   16
+
+typedef struct {
+	unsigned logn;
+	shake256_context rng;
+	uint8_t *tmp;
+	size_t tmp_len;
+	uint8_t *pk;
+	uint8_t *sk;
+	uint8_t *esk;
+	uint8_t *sig;
+	size_t sig_len;
+} bench_context;
+
+typedef int (*bench_fun)(bench_context *bc);
+
+typedef struct {
+	const char *op;
+	unsigned logn;
+	unsigned long iterations;
+	uint64_t median[PERFCOUNT_NUM];
+	uint64_t p90[PERFCOUNT_NUM];
+	uint64_t p99[PERFCOUNT_NUM];
+} bench_result;
+
+static perfcount counters;
+static bench_result results[BENCH_MAX_RESULTS];
+static size_t num_results;
+
+static void *
+xmalloc(size_t len)
+{
+	void *buf;
+
+	buf = malloc(len);
+	if (buf == NULL) {
+		fprintf(stderr, "memory allocation error\n");
+		exit(EXIT_FAILURE);
+	}
+	return buf;
+}
+
+static inline size_t
+maxsz(size_t a, size_t b)
+{
+	return a > b ? a : b;
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+	uint64_t x, y;
+
+	x = *(const uint64_t *)a;
+	y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Nearest-rank percentile of a sorted array.
+ */
+static uint64_t
+percentile(const uint64_t *v, unsigned long num, unsigned p)
+{
+	unsigned long k;
+
+	k = (num * p + 99) / 100;
+	return v[k == 0 ? 0 : k - 1];
+}
+
+static int
+bench_keygen(bench_context *bc)
+{
+	return falcon_keygen_make(&bc->rng, bc->logn,
+		bc->sk, FALCON_PRIVKEY_SIZE(bc->logn),
+		bc->pk, FALCON_PUBKEY_SIZE(bc->logn),
+		bc->tmp, bc->tmp_len);
+}
+
+static int
+bench_expand(bench_context *bc)
+{
+	return falcon_expand_privkey(
+		bc->esk, FALCON_EXPANDEDKEY_SIZE(bc->logn),
+		bc->sk, FALCON_PRIVKEY_SIZE(bc->logn),
+		bc->tmp, bc->tmp_len);
+}
+
+static int
+bench_sign_dyn(bench_context *bc)
+{
+	bc->sig_len = FALCON_SIG_COMPRESSED_MAXSIZE(bc->logn);
+	return falcon_sign_dyn(&bc->rng,
+		bc->sig, &bc->sig_len, FALCON_SIG_COMPRESSED,
+		bc->sk, FALCON_PRIVKEY_SIZE(bc->logn),
+		"data", 4, bc->tmp, bc->tmp_len);
+}
+
+static int
+bench_sign_tree(bench_context *bc)
+{
+	bc->sig_len = FALCON_SIG_COMPRESSED_MAXSIZE(bc->logn);
+	return falcon_sign_tree(&bc->rng,
+		bc->sig, &bc->sig_len, FALCON_SIG_COMPRESSED,
+		bc->esk, "data", 4, bc->tmp, bc->tmp_len);
+}
+
+static int
+bench_verify(bench_context *bc)
+{
+	return falcon_verify(bc->sig, bc->sig_len, FALCON_SIG_COMPRESSED,
+		bc->pk, FALCON_PUBKEY_SIZE(bc->logn),
+		"data", 4, bc->tmp, bc->tmp_len);
+}
+
+/*
+ * Run one operation 'num' times (after a few warm-up calls) and record
+ * the percentiles of all counters. samples[] has room for num values
+ * per counter.
+ */
+static void
+run_bench(const char *op, bench_fun bf, bench_context *bc,
+	unsigned long num, uint64_t *samples)
+{
+	bench_result *res;
+	unsigned long k;
+	unsigned i;
+	int r;
+
+	for (k = 0; k < 3; k ++) {
+		r = bf(bc);
+		if (r != 0) {
+			fprintf(stderr, "%s failed: %d\n", op, r);
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (k = 0; k < num; k ++) {
+		perfcount_sample start, stop, d;
+
+		perfcount_read(&counters, &start);
+		r = bf(bc);
+		perfcount_read(&counters, &stop);
+		if (r != 0) {
+			fprintf(stderr, "%s failed: %d\n", op, r);
+			exit(EXIT_FAILURE);
+		}
+		perfcount_diff(&d, &start, &stop);
+		for (i = 0; i < PERFCOUNT_NUM; i ++) {
+			samples[i * num + k] = d.v[i];
+		}
+	}
+
+	if (num_results == BENCH_MAX_RESULTS) {
+		fprintf(stderr, "too many results\n");
+		exit(EXIT_FAILURE);
+	}
+	res = &results[num_results ++];
+	res->op = op;
+	res->logn = bc->logn;
+	res->iterations = num;
+	for (i = 0; i < PERFCOUNT_NUM; i ++) {
+		uint64_t *v;
+
+		v = samples + i * num;
+		qsort(v, num, sizeof *v, cmp_u64);
+		res->median[i] = percentile(v, num, 50);
+		res->p90[i] = percentile(v, num, 90);
+		res->p99[i] = percentile(v, num, 99);
+	}
+	for (i = 0; i < PERFCOUNT_NUM; i ++) {
+		if (!perfcount_available(&counters, i)) {
+			continue;
+		}
+		printf("| %-10s | %4u | %-13s | %12llu | %12llu | %12llu |\n",
+			op, bc->logn, perfcount_name(i),
+			(unsigned long long)res->median[i],
+			(unsigned long long)res->p90[i],
+			(unsigned long long)res->p99[i]);
+	}
+	fflush(stdout);
+}
+
+static void
+bench_degree(unsigned logn, unsigned long iterations)
+{
+	bench_context bc;
+	uint64_t *samples;
+	unsigned long kg_iterations;
+	size_t len;
+
+	bc.logn = logn;
+	if (shake256_init_prng_from_system(&bc.rng) != 0) {
+		fprintf(stderr, "random seeding failed\n");
+		exit(EXIT_FAILURE);
+	}
+	len = FALCON_TMPSIZE_KEYGEN(logn);
+	len = maxsz(len, FALCON_TMPSIZE_SIGNDYN(logn));
+	len = maxsz(len, FALCON_TMPSIZE_SIGNTREE(logn));
+	len = maxsz(len, FALCON_TMPSIZE_EXPANDPRIV(logn));
+	len = maxsz(len, FALCON_TMPSIZE_VERIFY(logn));
+	bc.tmp = xmalloc(len);
+	bc.tmp_len = len;
+	bc.pk = xmalloc(FALCON_PUBKEY_SIZE(logn));
+	bc.sk = xmalloc(FALCON_PRIVKEY_SIZE(logn));
+	bc.esk = xmalloc(FALCON_EXPANDEDKEY_SIZE(logn));
+	bc.sig = xmalloc(FALCON_SIG_COMPRESSED_MAXSIZE(logn));
+	bc.sig_len = 0;
+	samples = xmalloc(PERFCOUNT_NUM * iterations * sizeof *samples);
+
+	kg_iterations = iterations / 10;
+	if (kg_iterations == 0) {
+		kg_iterations = 1;
+	}
+	run_bench("keygen", &bench_keygen, &bc, kg_iterations, samples);
+	run_bench("expand", &bench_expand, &bc, iterations, samples);
+	run_bench("sign_dyn", &bench_sign_dyn, &bc, iterations, samples);
+	run_bench("sign_tree", &bench_sign_tree, &bc, iterations, samples);
+	run_bench("verify", &bench_verify, &bc, iterations, samples);
+
+	free(samples);
+	free(bc.tmp);
+	free(bc.pk);
+	free(bc.sk);
+	free(bc.esk);
+	free(bc.sig);
+}
+
+static void
+write_json(const char *fname)
+{
+	FILE *f;
+	size_t u;
+	unsigned i;
+	int first;
+
+	f = fopen(fname, "w");
+	if (f == NULL) {
+		perror(fname);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(f, "{\n  \"implementation\": \"%s\",\n", BENCH_IMPL);
+	fprintf(f, "  \"counters\": [");
+	first = 1;
+	for (i = 0; i < PERFCOUNT_NUM; i ++) {
+		if (perfcount_available(&counters, i)) {
+			fprintf(f, "%s\"%s\"", first ? "" : ", ",
+				perfcount_name(i));
+			first = 0;
+		}
+	}
+	fprintf(f, "],\n  \"results\": [\n");
+	for (u = 0; u < num_results; u ++) {
+		const bench_result *res;
+
+		res = &results[u];
+		fprintf(f, "    {\"op\": \"%s\", \"logn\": %u, "
+			"\"iterations\": %lu",
+			res->op, res->logn, res->iterations);
+		for (i = 0; i < PERFCOUNT_NUM; i ++) {
+			if (!perfcount_available(&counters, i)) {
+				continue;
+			}
+			fprintf(f, ",\n     \"%s\": {\"median\": %llu, "
+				"\"p90\": %llu, \"p99\": %llu}",
+				perfcount_name(i),
+				(unsigned long long)res->median[i],
+				(unsigned long long)res->p90[i],
+				(unsigned long long)res->p99[i]);
+		}
+		fprintf(f, "}%s\n", u + 1 < num_results ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+	if (fclose(f) != 0) {
+		perror(fname);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-n iterations] [-l logn] [-j file.json]\n", name);
+	exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned long iterations;
+	unsigned logn, i;
+	const char *json;
+	int a;
+
+	iterations = 1000;
+	logn = 0;
+	json = NULL;
+	for (a = 1; a < argc; a ++) {
+		if (a + 1 == argc) {
+			usage(argv[0]);
+		}
+		if (strcmp(argv[a], "-n") == 0) {
+			iterations = strtoul(argv[++ a], NULL, 0);
+			if (iterations == 0) {
+				usage(argv[0]);
+			}
+		} else if (strcmp(argv[a], "-l") == 0) {
+			logn = (unsigned)strtoul(argv[++ a], NULL, 0);
+		} else if (strcmp(argv[a], "-j") == 0) {
+			json = argv[++ a];
+		} else {
+			usage(argv[0]);
+		}
+	}
+#ifdef FALCON_LOGN
+	if (logn != 0 && logn != FALCON_LOGN) {
+		fprintf(stderr, "this build only supports logn = %u\n",
+			(unsigned)FALCON_LOGN);
+		return EXIT_FAILURE;
+	}
+	logn = FALCON_LOGN;
+#endif
+	if (logn > 10) {
+		usage(argv[0]);
+	}
+
+	if (perfcount_open(&counters) == 0) {
+		printf("# %s: hardware counters unavailable,"
+			" using clock_gettime()\n", BENCH_IMPL);
+	} else {
+		printf("# %s: perf_event counters:", BENCH_IMPL);
+		for (i = 1; i < PERFCOUNT_NUM; i ++) {
+			if (perfcount_available(&counters, i)) {
+				printf(" %s", perfcount_name(i));
+			}
+		}
+		printf("\n");
+	}
+	printf("\n| Function   | logn | counter       |"
+		"       median |          p90 |          p99 |\n");
+	printf("|:-----------|-----:|:--------------|"
+		"-------------:|-------------:|-------------:|\n");
+	if (logn != 0) {
+		bench_degree(logn, iterations);
+	} else {
+		bench_degree(9, iterations);
+		bench_degree(10, iterations);
+	}
+	printf("\n");
+	perfcount_close(&counters);
+
+	if (json != NULL) {
+		write_json(json);
+	}
+	return 0;
+}
@@ -428,6 +428,134 @@ void test_compute_bnorm(fpr *restrict fa, fpr *restrict fb, char *string)
     printf("| %8s | %8u | %8lld\n", string, FALCON_LOGN, fft);
 }
 
+void test_prng_refill(char *string)
+{
+#if BENCH_CYCLES == 0
+    struct timespec start, stop;
+#else
+    long long start, stop;
+#endif
+    long long fft;
+    unsigned ntests = ITERATIONS;
+    inner_shake256_context sc;
+    prng p;
+
+    inner_shake256_init(&sc);
+    inner_shake256_inject(&sc, (const uint8_t *)"bench", 5);
+    inner_shake256_flip(&sc);
+    Zf(prng_init)(&p, &sc);
+
+    /* =================================== */
+    for (unsigned i = 0; i < ntests; i++)
+    {
+        TIME(start);
+        Zf(prng_refill)(&p);
+        TIME(stop);
+
+        times[i] = stop - start;
+    }
+    qsort(times, ITERATIONS, sizeof(uint64_t), cmp_uint64_t);
+    fft = times[ITERATIONS >> 1];
+
+    // 512 bytes (8 ChaCha20 blocks) per call
+    printf("| %8s | %8u | %8lld\n", string, FALCON_LOGN, fft);
+}
+
+#define COMP_BENCH_SIGS 64
+
+void test_comp_codec(int decode, char *string)
+{
+#if BENCH_CYCLES == 0
+    struct timespec start, stop;
+#else
+    long long start, stop;
+#endif
+    long long fft;
+    unsigned ntests = ITERATIONS;
+    static int16_t x[COMP_BENCH_SIGS * FALCON_N], y[FALCON_N];
+    static uint8_t sig[COMP_BENCH_SIGS][2 * FALCON_N];
+    size_t sig_len[COMP_BENCH_SIGS];
+    size_t n = FALCON_N;
+
+    // Signature-like coefficients: approximately Gaussian (sum of 12
+    // uniform values), with the standard deviation of signatures.
+    // Calls cycle through distinct signatures, so that the branch
+    // predictor cannot learn a single input.
+    for (size_t i = 0; i < COMP_BENCH_SIGS * n; i++)
+    {
+        int t = 0;
+
+        for (int j = 0; j < 12; j++)
+        {
+            t += rand() % 1001;
+        }
+        x[i] = (int16_t)(((t - 6000) * (FALCON_LOGN == 9 ? 165 : 168)) / 1000);
+    }
+    for (unsigned k = 0; k < COMP_BENCH_SIGS; k++)
+    {
+        sig_len[k] = Zf(comp_encode)(sig[k], sizeof sig[k], x + k * n);
+    }
+
+    /* =================================== */
+    for (unsigned i = 0; i < ntests; i++)
+    {
+        unsigned k = i % COMP_BENCH_SIGS;
+
+        TIME(start);
+        if (decode)
+        {
+            Zf(comp_decode)(y, sig[k], sig_len[k]);
+        }
+        else
+        {
+            Zf(comp_encode)(sig[k], sizeof sig[k], x + k * n);
+        }
+        TIME(stop);
+
+        times[i] = stop - start;
+    }
+    qsort(times, ntests, sizeof(uint64_t), cmp_uint64_t);
+    fft = times[ntests >> 1];
+
+    printf("| %8s | %8u | %8lld\n", string, FALCON_LOGN, fft);
+}
+
+void test_keygen_kernel(unsigned kernel, size_t len, unsigned logn, char *string)
+{
+#if BENCH_CYCLES == 0
+    struct timespec start, stop;
+#else
+    long long start, stop;
+#endif
+    long long fft;
+    unsigned ntests = 1000;
+    static uint32_t data[3 * 16 * FALCON_N];
+    size_t n = (size_t)1 << logn;
+
+    for (size_t i = 0; i < 3 * len * n; i++)
+    {
+        data[i] = (uint32_t)rand() & 0x7FFFFFFF;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        data[2 * len * n + i] = (uint32_t)(rand() % 2001 - 1000);
+    }
+
+    /* =================================== */
+    for (unsigned i = 0; i < ntests; i++)
+    {
+        TIME(start);
+        Zf(keygen_bench_kernel)(kernel, data, len, logn);
+        TIME(stop);
+
+        times[i] = stop - start;
+    }
+    qsort(times, ntests, sizeof(uint64_t), cmp_uint64_t);
+    fft = times[ntests >> 1];
+
+    printf("| %8s | %8u | %8lld\n", string, logn, fft);
+}
+
 int main()
 {
     fpr f[FALCON_N], fa[FALCON_N], fb[FALCON_N], fc[FALCON_N], tmp[FALCON_N] = {0};
@@ -513,6 +641,21 @@ int main()
     }
     print_header();
     test_compute_bnorm(fa, fb, "compute_bnorm");
+    print_header();
+    test_prng_refill("prng_refill");
+
+    // Compressed signature encoding and decoding
+    print_header();
+    test_comp_codec(0, "comp_encode");
+    test_comp_codec(1, "comp_decode");
+
+    // NTRU solver big-integer kernels, 8-word integers
+    print_header();
+    test_keygen_kernel(FALCON_KG_BENCH_REBUILD_CRT, 8, FALCON_LOGN, "zint_rebuild_CRT");
+    test_keygen_kernel(FALCON_KG_BENCH_MOD_SMALL, 8, FALCON_LOGN, "zint_mod_small_signed");
+    test_keygen_kernel(FALCON_KG_BENCH_POLY_SUB_SCALED, 8, 5, "poly_sub_scaled");
+    // extended GCD at the deepest level (zint_co_reduce, zint_co_reduce_mod_x2)
+    test_keygen_kernel(FALCON_KG_BENCH_BEZOUT, FALCON_LOGN == 9 ? 106 : 209, 2, "zint_bezout");
     
 
     return 0;
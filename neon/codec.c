@@ -29,22 +29,38 @@
  * @author   Thomas Pornin <thomas.pornin@nccgroup.com>
  */
 
+#include <arm_neon.h>
 #include "inner.h"
 #include "config.h"
 #include "poly.h"
 
+/*
+ * Public key coefficients are packed over 14 bits each, big-endian, so
+ * that 8 coefficients use exactly 14 bytes. The NEON loops handle one
+ * such group at a time: on encoding, pairs and then pairs of pairs are
+ * merged with shift-and-insert, and the two 56-bit groups are put in
+ * big-endian order with a table lookup; on decoding, the three bytes
+ * that hold each coefficient are gathered into a 32-bit word with a
+ * table lookup, then shifted into place. Each group reads or writes 16
+ * bytes, so the vector loops stop one group before the end and the last
+ * coefficients use the generic code.
+ */
+
 /* see inner.h */
 size_t
 Zf(modq_encode)(
 	void *out, size_t max_out_len,
 	const uint16_t *x, unsigned logn)
 {
-	size_t n, out_len, u;
+	static const uint8_t idx_be[16] = {
+		6, 5, 4, 3, 2, 1, 0, 14, 13, 12, 11, 10, 9, 8, 255, 255
+	};
+	size_t n, out_len, u, v;
 	uint8_t *buf;
 	uint32_t acc;
 	int acc_len;
 
-    n = 1 << logn;
+	n = (size_t)1 << logn;
 	out_len = ((n * 14) + 7) >> 3;
 	if (out == NULL) {
 		return out_len;
@@ -52,25 +68,61 @@ Zf(modq_encode)(
 	if (out_len > max_out_len) {
 		return 0;
 	}
-	
-	for (u = 0; u < n; u ++) {
+
+	u = 0;
+	if (n >= 8) {
+		uint16x8_t bad;
+
+		bad = vdupq_n_u16(0);
+		for (u = 0; u < n; u += 8) {
+			bad = vorrq_u16(bad, vqsubq_u16(vld1q_u16(x + u),
+				vdupq_n_u16(FALCON_Q - 1)));
+		}
+		if (vmaxvq_u16(bad) != 0) {
+			return 0;
+		}
+	}
+	for (; u < n; u ++) {
 		if (x[u] >= FALCON_Q) {
 			return 0;
 		}
 	}
 	buf = out;
+	u = 0;
+	v = 0;
+	if (n > 8) {
+		uint8x16_t idx;
+
+		idx = vld1q_u8(idx_be);
+		for (; u + 8 < n; u += 8, v += 14) {
+			uint32x4_t a;
+			uint64x2_t b;
+
+			/*
+			 * 32-bit lanes: x[2i] << 14 | x[2i+1]; 64-bit lanes:
+			 * the two 28-bit values merged into 56 bits (upper
+			 * bits are garbage and are not stored).
+			 */
+			a = vreinterpretq_u32_u16(vld1q_u16(x + u));
+			a = vsliq_n_u32(vshrq_n_u32(a, 16), a, 14);
+			b = vreinterpretq_u64_u32(a);
+			b = vsliq_n_u64(vshrq_n_u64(b, 32), b, 28);
+			vst1q_u8(buf + v,
+				vqtbl1q_u8(vreinterpretq_u8_u64(b), idx));
+		}
+	}
 	acc = 0;
 	acc_len = 0;
-	for (u = 0; u < n; u ++) {
+	for (; u < n; u ++) {
 		acc = (acc << 14) | x[u];
 		acc_len += 14;
 		while (acc_len >= 8) {
 			acc_len -= 8;
-			*buf ++ = (uint8_t)(acc >> acc_len);
+			buf[v ++] = (uint8_t)(acc >> acc_len);
 		}
 	}
 	if (acc_len > 0) {
-		*buf = (uint8_t)(acc << (8 - acc_len));
+		buf[v] = (uint8_t)(acc << (8 - acc_len));
 	}
 	return out_len;
 }
@@ -79,20 +131,62 @@ Zf(modq_encode)(
 size_t
 Zf(modq_decode)(uint16_t *x, const void *in, size_t max_in_len, unsigned logn)
 {
+	static const uint8_t idx_lo[16] = {
+		2, 1, 0, 255, 3, 2, 1, 255, 5, 4, 3, 255, 7, 6, 5, 255
+	};
+	static const uint8_t idx_hi[16] = {
+		9, 8, 7, 255, 10, 9, 8, 255, 12, 11, 10, 255, 14, 13, 12, 255
+	};
+	static const int32_t shr[4] = { -10, -4, -6, -8 };
 	size_t n, in_len, u;
 	const uint8_t *buf;
 	uint32_t acc;
 	int acc_len;
 
-    n = 1 << logn;
+	n = (size_t)1 << logn;
 	in_len = ((n * 14) + 7) >> 3;
 	if (in_len > max_in_len) {
 		return 0;
 	}
 	buf = in;
+	u = 0;
+	if (n > 8) {
+		uint8x16_t ilo, ihi;
+		int32x4_t sh;
+		uint32x4_t m14;
+		uint16x8_t bad;
+
+		/*
+		 * Coefficient i of a 14-byte group starts at bit 14*i:
+		 * its three bytes are put (big-endian) in a 32-bit word,
+		 * which is then shifted right by 10, 4, 6 or 8 bits.
+		 */
+		ilo = vld1q_u8(idx_lo);
+		ihi = vld1q_u8(idx_hi);
+		sh = vld1q_s32(shr);
+		m14 = vdupq_n_u32(0x3FFF);
+		bad = vdupq_n_u16(0);
+		for (; u + 8 < n; u += 8, buf += 14) {
+			uint8x16_t bv;
+			uint32x4_t lo, hi;
+			uint16x8_t w;
+
+			bv = vld1q_u8(buf);
+			lo = vreinterpretq_u32_u8(vqtbl1q_u8(bv, ilo));
+			hi = vreinterpretq_u32_u8(vqtbl1q_u8(bv, ihi));
+			lo = vandq_u32(vshlq_u32(lo, sh), m14);
+			hi = vandq_u32(vshlq_u32(hi, sh), m14);
+			w = vcombine_u16(vmovn_u32(lo), vmovn_u32(hi));
+			bad = vorrq_u16(bad,
+				vqsubq_u16(w, vdupq_n_u16(FALCON_Q - 1)));
+			vst1q_u16(x + u, w);
+		}
+		if (vmaxvq_u16(bad) != 0) {
+			return 0;
+		}
+	}
 	acc = 0;
 	acc_len = 0;
-	u = 0;
 	while (u < n) {
 		acc = (acc << 8) | (*buf ++);
 		acc_len += 8;
@@ -101,7 +195,7 @@ Zf(modq_decode)(uint16_t *x, const void *in, size_t max_in_len, unsigned logn)
 
 			acc_len -= 14;
 			w = (acc >> acc_len) & 0x3FFF;
-			if (w >= 12289) {
+			if (w >= FALCON_Q) {
 				return 0;
 			}
 			x[u ++] = (uint16_t)w;
@@ -158,6 +252,53 @@ Zf(trim_i16_encode)(
 	return out_len;
 }
 
+/*
+ * Fixed-width values (trim_i16_decode() and trim_i8_decode()): a group
+ * of 8 values of 'bits' bits uses exactly 'bits' bytes. When each value
+ * of a group fits in two consecutive bytes (bits <= 10, 12 or 16), the
+ * NEON code decodes a group at a time: a table lookup puts the two
+ * bytes that hold value j in 16-bit lane j, a shift left by the bit
+ * offset of the value moves it to the top of the lane, and an
+ * arithmetic shift right sign-extends it. The lookup indices and shift
+ * counts depend only on 'bits'. Each group reads 16 bytes, so the
+ * vector loop stops before the last 16 input bytes, and the generic
+ * code decodes the remaining values.
+ */
+
+#define TRIM_SIMD_BITS(bits)   ((bits) <= 10 || (bits) == 12 || (bits) == 16)
+
+static void
+trim_setup(uint8x16_t *idx, int16x8_t *shl, unsigned bits)
+{
+	uint8_t ib[16];
+	int16_t sb[8];
+	unsigned j;
+
+	for (j = 0; j < 8; j ++) {
+		unsigned b;
+
+		b = (j * bits) >> 3;
+		ib[2 * j] = (uint8_t)(b + 1);
+		ib[2 * j + 1] = (uint8_t)b;
+		sb[j] = (int16_t)((j * bits) & 7);
+	}
+	*idx = vld1q_u8(ib);
+	*shl = vld1q_s16(sb);
+}
+
+/*
+ * Decode the 8 values of the group that starts at buf.
+ */
+static inline int16x8_t
+trim_decode8(const uint8_t *buf,
+	uint8x16_t idx, int16x8_t shl, int16x8_t shr)
+{
+	int16x8_t w;
+
+	w = vreinterpretq_s16_u8(vqtbl1q_u8(vld1q_u8(buf), idx));
+	return vshlq_s16(vshlq_s16(w, shl), shr);
+}
+
 /* see inner.h */
 size_t
 Zf(trim_i16_decode)(
@@ -177,6 +318,33 @@ Zf(trim_i16_decode)(
 	}
 	buf = in;
 	u = 0;
+	if (TRIM_SIMD_BITS(bits)) {
+		uint8x16_t idx;
+		int16x8_t shl, shr, forb;
+		uint16x8_t bad;
+		size_t v;
+
+		trim_setup(&idx, &shl, bits);
+		shr = vdupq_n_s16((int16_t)bits - 16);
+		forb = vdupq_n_s16((int16_t)-(1 << (bits - 1)));
+		bad = vdupq_n_u16(0);
+		for (v = 0; u + 8 <= n && v + 16 <= in_len;
+			u += 8, v += bits)
+		{
+			int16x8_t w;
+
+			w = trim_decode8(buf + v, idx, shl, shr);
+			bad = vorrq_u16(bad, vceqq_s16(w, forb));
+			vst1q_s16(x + u, w);
+		}
+		if (vmaxvq_u16(bad) != 0) {
+			/*
+			 * The -2^(bits-1) value is forbidden.
+			 */
+			return 0;
+		}
+		buf += v;
+	}
 	acc = 0;
 	acc_len = 0;
 	mask1 = ((uint32_t)1 << bits) - 1;
@@ -269,6 +437,33 @@ Zf(trim_i8_decode)(int8_t *x, unsigned bits,
 	}
 	buf = in;
 	u = 0;
+	if (bits <= 8) {
+		uint8x16_t idx;
+		int16x8_t shl, shr, forb;
+		uint16x8_t bad;
+		size_t v;
+
+		trim_setup(&idx, &shl, bits);
+		shr = vdupq_n_s16((int16_t)bits - 16);
+		forb = vdupq_n_s16((int16_t)-(1 << (bits - 1)));
+		bad = vdupq_n_u16(0);
+		for (v = 0; u + 8 <= FALCON_N && v + 16 <= in_len;
+			u += 8, v += bits)
+		{
+			int16x8_t w;
+
+			w = trim_decode8(buf + v, idx, shl, shr);
+			bad = vorrq_u16(bad, vceqq_s16(w, forb));
+			vst1_s8(x + u, vmovn_s16(w));
+		}
+		if (vmaxvq_u16(bad) != 0) {
+			/*
+			 * The -2^(bits-1) value is forbidden.
+			 */
+			return 0;
+		}
+		buf += v;
+	}
 	acc = 0;
 	acc_len = 0;
 	mask1 = ((uint32_t)1 << bits) - 1;
@@ -300,13 +495,42 @@ Zf(trim_i8_decode)(int8_t *x, unsigned bits,
 	return in_len;
 }
 
+/*
+ * Signatures use a Golomb-Rice-like code: for each coefficient, the
+ * sign bit and the low 7 bits of the absolute value, then the high
+ * bits (absolute value >> 7) in unary: that many zeros, then a one.
+ *
+ * The encoder computes the code words of 8 coefficients at a time with
+ * NEON, then packs them into a 64-bit accumulator, 32 bits at a time.
+ * The decoder reads code words from a 64-bit bit buffer (refilled a
+ * whole word at a time when possible) and finds the unary part with a
+ * count-leading-zeros; it stores the raw fields, and a final NEON pass
+ * rebuilds the signed values 8 at a time.
+ */
+
+/*
+ * Load 8 bytes as a big-endian 64-bit integer.
+ */
+static inline uint64_t
+dec64be(const uint8_t *buf)
+{
+	return ((uint64_t)buf[0] << 56)
+		| ((uint64_t)buf[1] << 48)
+		| ((uint64_t)buf[2] << 40)
+		| ((uint64_t)buf[3] << 32)
+		| ((uint64_t)buf[4] << 24)
+		| ((uint64_t)buf[5] << 16)
+		| ((uint64_t)buf[6] << 8)
+		| (uint64_t)buf[7];
+}
+
 /* see inner.h */
 size_t
 Zf(comp_encode)(void *out, size_t max_out_len, const int16_t *x)
 {
 	uint8_t *buf;
 	size_t u, v;
-	uint32_t acc;
+	uint64_t acc;
 	unsigned acc_len;
 
 	buf = out;
@@ -314,72 +538,81 @@ Zf(comp_encode)(void *out, size_t max_out_len, const int16_t *x)
 	/*
 	 * Make sure that all values are within the -2047..+2047 range.
 	 */
-    if (ZfN(poly_check_bound_int16)(x, -2047, 2047))
-    {
-        return 0;
-    }
+	if (ZfN(poly_check_bound_int16)(x, -2047, 2047)) {
+		return 0;
+	}
 
 	acc = 0;
 	acc_len = 0;
 	v = 0;
-	for (u = 0; u < FALCON_N; u ++) {
-		int t;
-		unsigned w;
+	for (u = 0; u < FALCON_N; u += 8) {
+		int16x8_t xv;
+		uint16x8_t av, hv, lv;
+		uint32x4_t c0, c1;
+		uint32_t cw[8];
+		uint16_t cl[8];
+		int j;
 
 		/*
-		 * Get sign and absolute value of next integer; push the
-		 * sign bit.
+		 * Code word of value x with absolute value a = h*128 + l:
+		 * ((sign << 7) | l) << (h + 1) | 1, over h + 9 bits (at
+		 * most 24 bits since h <= 15).
 		 */
-		acc <<= 1;
-		t = x[u];
-		if (t < 0) {
-			t = -t;
-			acc |= 1;
-		}
-		w = (unsigned)t;
+		xv = vld1q_s16(&x[u]);
+		av = vreinterpretq_u16_s16(vabsq_s16(xv));
+		hv = vshrq_n_u16(av, 7);
+		lv = vsliq_n_u16(av,
+			vshrq_n_u16(vreinterpretq_u16_s16(xv), 15), 7);
+		hv = vaddq_u16(hv, vdupq_n_u16(1));
+		c0 = vshlq_u32(vmovl_u16(vget_low_u16(lv)),
+			vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(hv))));
+		c1 = vshlq_u32(vmovl_u16(vget_high_u16(lv)),
+			vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(hv))));
+		c0 = vorrq_u32(c0, vdupq_n_u32(1));
+		c1 = vorrq_u32(c1, vdupq_n_u32(1));
+		vst1q_u32(cw, c0);
+		vst1q_u32(cw + 4, c1);
+		vst1q_u16(cl, vaddq_u16(hv, vdupq_n_u16(8)));
 
 		/*
-		 * Push the low 7 bits of the absolute value.
+		 * acc_len is at most 31 before each word is added, so
+		 * the accumulator never holds more than 55 pending bits.
 		 */
-		acc <<= 7;
-		acc |= w & 127u;
-		w >>= 7;
-
-		/*
-		 * We pushed exactly 8 bits.
-		 */
-		acc_len += 8;
-
-		/*
-		 * Push as many zeros as necessary, then a one. Since the
-		 * absolute value is at most 2047, w can only range up to
-		 * 15 at this point, thus we will add at most 16 bits
-		 * here. With the 8 bits above and possibly up to 7 bits
-		 * from previous iterations, we may go up to 31 bits, which
-		 * will fit in the accumulator, which is an uint32_t.
-		 */
-		acc <<= (w + 1);
-		acc |= 1;
-		acc_len += w + 1;
-
-		/*
-		 * Produce all full bytes.
-		 */
-		while (acc_len >= 8) {
-			acc_len -= 8;
-			if (buf != NULL) {
-				if (v >= max_out_len) {
-					return 0;
+		for (j = 0; j < 8; j ++) {
+			acc = (acc << cl[j]) | cw[j];
+			acc_len += cl[j];
+			if (acc_len >= 32) {
+				uint32_t w;
+
+				acc_len -= 32;
+				if (buf != NULL) {
+					if (max_out_len - v < 4) {
+						return 0;
+					}
+					w = (uint32_t)(acc >> acc_len);
+					buf[v] = (uint8_t)(w >> 24);
+					buf[v + 1] = (uint8_t)(w >> 16);
+					buf[v + 2] = (uint8_t)(w >> 8);
+					buf[v + 3] = (uint8_t)w;
 				}
-				buf[v] = (uint8_t)(acc >> acc_len);
+				v += 4;
 			}
-			v ++;
 		}
 	}
 
 	/*
 	 * Flush remaining bits (if any).
 	 */
+	while (acc_len >= 8) {
+		acc_len -= 8;
+		if (buf != NULL) {
+			if (v >= max_out_len) {
+				return 0;
+			}
+			buf[v] = (uint8_t)(acc >> acc_len);
+		}
+		v ++;
+	}
 	if (acc_len > 0) {
 		if (buf != NULL) {
 			if (v >= max_out_len) {
@@ -399,63 +632,84 @@ Zf(comp_decode)(int16_t *x, const void *in, size_t max_in_len)
 {
 	const uint8_t *buf;
 	size_t u, v;
-	uint32_t acc;
+	uint64_t acc;
 	unsigned acc_len;
+	uint16x8_t neg0;
 
+	/*
+	 * acc holds the next bits of input in its top acc_len bits; bits
+	 * below are either zero or the following input bits, so a
+	 * leading-zero count that stays within acc_len is exact.
+	 */
 	buf = in;
 	acc = 0;
 	acc_len = 0;
 	v = 0;
 	for (u = 0; u < FALCON_N; u ++) {
-		unsigned b, s, m;
-
-		/*
-		 * Get next eight bits: sign and low seven bits of the
-		 * absolute value.
-		 */
-		if (v >= max_in_len) {
-			return 0;
-		}
-		acc = (acc << 8) | (uint32_t)buf[v ++];
-		b = acc >> acc_len;
-		s = b & 128;
-		m = b & 127;
+		unsigned b, k;
 
 		/*
-		 * Get next bits until a 1 is reached.
+		 * A code word is at most 24 bits.
 		 */
-		for (;;) {
-			if (acc_len == 0) {
-				if (v >= max_in_len) {
-					return 0;
+		if (acc_len < 24) {
+			if (max_in_len - v >= 8) {
+				acc |= dec64be(buf + v) >> acc_len;
+				v += (63 - acc_len) >> 3;
+				acc_len |= 56;
+			} else {
+				while (acc_len <= 56 && v < max_in_len) {
+					acc |= (uint64_t)buf[v ++] << (56 - acc_len);
+					acc_len += 8;
 				}
-				acc = (acc << 8) | (uint32_t)buf[v ++];
-				acc_len = 8;
-			}
-			acc_len --;
-			if (((acc >> acc_len) & 1) != 0) {
-				break;
-			}
-			m += 128;
-			if (m > 2047) {
-				return 0;
 			}
 		}
 
 		/*
-		 * "-0" is forbidden.
+		 * Sign and low seven bits, then count the zeros before the
+		 * next one: the value is too large (more than 2047) if
+		 * there are 16 or more, and the input is truncated if the
+		 * one is not within the available bits.
 		 */
-		if (s && m == 0) {
+		b = (unsigned)(acc >> 56);
+		acc <<= 8;
+		if (acc == 0) {
 			return 0;
 		}
+		k = (unsigned)__builtin_clzll(acc);
+		if (k >= 16 || k + 9 > acc_len) {
+			return 0;
+		}
+		acc <<= k + 1;
+		acc_len -= k + 9;
+		x[u] = (int16_t)(b | (k << 8));
+	}
 
-		x[u] = (int16_t)(s ? -(int)m : (int)m);
+	/*
+	 * Whole bytes read ahead are not part of the signature. Unused
+	 * bits in the last byte must be zero.
+	 */
+	v -= acc_len >> 3;
+	acc_len &= 7;
+	if (acc_len != 0 && (acc >> (64 - acc_len)) != 0) {
+		return 0;
 	}
 
 	/*
-	 * Unused bits in the last byte must be zero.
+	 * Each x[u] holds sign (bit 7), low bits (0 to 6) and high bits
+	 * (8 to 11) of the absolute value. "-0" is forbidden.
 	 */
-	if ((acc & ((1u << acc_len) - 1u)) != 0) {
+	neg0 = vdupq_n_u16(0);
+	for (u = 0; u < FALCON_N; u += 8) {
+		uint16x8_t w, m, s;
+
+		w = vreinterpretq_u16_s16(vld1q_s16(&x[u]));
+		m = vsliq_n_u16(w, vshrq_n_u16(w, 8), 7);
+		s = vtstq_u16(w, vdupq_n_u16(0x80));
+		neg0 = vorrq_u16(neg0, vceqq_u16(w, vdupq_n_u16(0x80)));
+		m = vsubq_u16(veorq_u16(m, s), s);
+		vst1q_s16(&x[u], vreinterpretq_s16_u16(m));
+	}
+	if (vmaxvq_u16(neg0) != 0) {
 		return 0;
 	}
 
@@ -33,6 +33,34 @@
 #include "macrous.h"
 #include "macrofx4.h"
 
+/*
+ * Shuffle indices that pack the accepted 16-bit samples among four
+ * lanes to the front (bit i of the row index is set if lane i is kept),
+ * and the matching number of kept lanes. Index 0x80 yields a zero.
+ */
+static const uint8_t hash_pack_idx[16][8] = {
+    { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    {    0,    1, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    {    2,    3, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    {    0,    1,    2,    3, 0x80, 0x80, 0x80, 0x80 },
+    {    4,    5, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    {    0,    1,    4,    5, 0x80, 0x80, 0x80, 0x80 },
+    {    2,    3,    4,    5, 0x80, 0x80, 0x80, 0x80 },
+    {    0,    1,    2,    3,    4,    5, 0x80, 0x80 },
+    {    6,    7, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    {    0,    1,    6,    7, 0x80, 0x80, 0x80, 0x80 },
+    {    2,    3,    6,    7, 0x80, 0x80, 0x80, 0x80 },
+    {    0,    1,    2,    3,    6,    7, 0x80, 0x80 },
+    {    4,    5,    6,    7, 0x80, 0x80, 0x80, 0x80 },
+    {    0,    1,    4,    5,    6,    7, 0x80, 0x80 },
+    {    2,    3,    4,    5,    6,    7, 0x80, 0x80 },
+    {    0,    1,    2,    3,    4,    5,    6,    7 },
+};
+
+static const uint8_t hash_pack_cnt[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
 /* see inner.h */
 void Zf(hash_to_point_vartime)(
     inner_shake256_context *sc,
@@ -47,25 +75,158 @@ void Zf(hash_to_point_vartime)(
      * the public key, but knows the nonce (without knowledge of the
      * nonce, the hashed output cannot be matched against potential
      * plaintexts).
+     *
+     * SHAKE output is extracted in chunks of up to one full block,
+     * and 8 samples are processed at once: byte swap, rejection of
+     * values >= 5*q, reduction mod q and packing of the kept values.
+     * Each 2-byte sample yields at most one output value, so chunks
+     * of at most 2*n bytes never extract more than the per-sample
+     * code would: output and final context state are unchanged.
      */
-    size_t n;
+    // Total SIMD registers: 8
+    uint16x8_t neon_w, neon_m;                                  // 2
+    uint16x8_t neon_q, neon_2q, neon_4q, neon_5q, neon_bits;    // 5
+    uint8x16_t neon_t;                                          // 1
+    uint8_t buf[136];
+    size_t n, len, u;
+    unsigned bits, lo, hi;
+
+    neon_q = vdupq_n_u16(FALCON_Q);
+    neon_2q = vdupq_n_u16(2 * FALCON_Q);
+    neon_4q = vdupq_n_u16(4 * FALCON_Q);
+    neon_5q = vdupq_n_u16(5 * FALCON_Q);
+    neon_bits = vcombine_u16(vcreate_u16(0x0008000400020001),
+                             vcreate_u16(0x0080004000200010));
 
     n = (size_t)1 << logn;
     while (n > 0)
     {
-        uint8_t buf[2];
-        uint32_t w;
+        len = (sc->dptr == 136) ? 136 : 136 - (size_t)sc->dptr;
+        if (len > 2 * n)
+        {
+            len = 2 * n;
+        }
+        len &= ~(size_t)1;
+        if (len == 0)
+        {
+            /*
+             * Only one byte left in the current block.
+             */
+            len = 2;
+        }
+        inner_shake256_extract(sc, buf, len);
+
+        for (u = 0; u + 16 <= len; u += 16)
+        {
+            neon_w = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(buf + u)));
+            neon_m = vcltq_u16(neon_w, neon_5q);
+            neon_w = vsubq_u16(neon_w, vandq_u16(vcgeq_u16(neon_w, neon_4q), neon_4q));
+            neon_w = vsubq_u16(neon_w, vandq_u16(vcgeq_u16(neon_w, neon_2q), neon_2q));
+            neon_w = vsubq_u16(neon_w, vandq_u16(vcgeq_u16(neon_w, neon_q), neon_q));
+
+            bits = vaddvq_u16(vandq_u16(neon_m, neon_bits));
+            lo = bits & 0x0F;
+            hi = bits >> 4;
+
+            /*
+             * n >= 8 here, so both 4-lane stores stay within x[].
+             */
+            neon_t = vreinterpretq_u8_u16(neon_w);
+            vst1_u8((uint8_t *)x, vqtbl1_u8(neon_t, vld1_u8(hash_pack_idx[lo])));
+            x += hash_pack_cnt[lo];
+            vst1_u8((uint8_t *)x, vqtbl1_u8(neon_t,
+                    vadd_u8(vld1_u8(hash_pack_idx[hi]), vdup_n_u8(8))));
+            x += hash_pack_cnt[hi];
+            n -= hash_pack_cnt[lo] + hash_pack_cnt[hi];
+        }
+
+        for (; u < len; u += 2)
+        {
+            uint32_t w;
+
+            w = ((unsigned)buf[u] << 8) | (unsigned)buf[u + 1];
+            if (w < 5 * FALCON_Q)
+            {
+                while (w >= FALCON_Q)
+                {
+                    w -= FALCON_Q;
+                }
+                *x++ = (uint16_t)w;
+                n--;
+            }
+        }
+    }
+}
+
+/* see inner.h */
+void Zf(hash_to_point_x2)(
+    inner_shake256_context *sc0, inner_shake256_context *sc1,
+    uint16_t *x0, uint16_t *x1, unsigned logn)
+{
+    inner_shake256x2_context sc2;
+    inner_shake256_context *sc[2];
+    uint16_t *x[2];
+    uint8_t buf[2][136];
+    size_t n, cnt[2];
+    unsigned done, i, u;
+
+    /*
+     * The two instances stay in lockstep only if both start on a
+     * block boundary, which is the case for freshly flipped contexts.
+     */
+    if (sc0->dptr != 136 || sc1->dptr != 136)
+    {
+        Zf(hash_to_point_vartime)(sc0, x0, logn);
+        Zf(hash_to_point_vartime)(sc1, x1, logn);
+        return;
+    }
+
+    sc[0] = sc0;
+    sc[1] = sc1;
+    x[0] = x0;
+    x[1] = x1;
+    Zf(i_shake256x2_set)(&sc2, 0, sc0);
+    Zf(i_shake256x2_set)(&sc2, 1, sc1);
 
-        inner_shake256_extract(sc, (void *)buf, sizeof buf);
-        w = ((unsigned)buf[0] << 8) | (unsigned)buf[1];
-        if (w < 5 * FALCON_Q)
+    n = (size_t)1 << logn;
+    cnt[0] = 0;
+    cnt[1] = 0;
+    done = 0;
+    while (done != 3)
+    {
+        Zf(i_shake256x2_squeeze)(&sc2, buf[0], buf[1]);
+        for (i = 0; i < 2; i++)
         {
-            while (w >= FALCON_Q)
+            if ((done >> i) & 1)
+            {
+                continue;
+            }
+            u = 0;
+            while (u < 136 && cnt[i] < n)
             {
-                w -= FALCON_Q;
+                uint32_t w;
+
+                w = ((unsigned)buf[i][u] << 8) | (unsigned)buf[i][u + 1];
+                u += 2;
+                if (w < 5 * FALCON_Q)
+                {
+                    while (w >= FALCON_Q)
+                    {
+                        w -= FALCON_Q;
+                    }
+                    x[i][cnt[i]++] = (uint16_t)w;
+                }
+            }
+            if (cnt[i] == n)
+            {
+                /*
+                 * Leave the context exactly where the scalar code
+                 * would have stopped.
+                 */
+                Zf(i_shake256x2_get)(&sc2, i, sc[i]);
+                sc[i]->dptr = u;
+                done |= 1u << i;
             }
-            *x++ = (uint16_t)w;
-            n--;
         }
     }
 }
@@ -399,6 +560,12 @@ int ZfN(is_short)(const int16_t *s1, const int16_t *s2)
     return s <= l2bound[FALCON_LOGN];
 }
 
+/* see inner.h */
+int ZfN(is_short_sqnorm)(uint32_t sqn)
+{
+    return sqn <= l2bound[FALCON_LOGN];
+}
+
 int ZfN(is_short_tmp)(int16_t *s1tmp, int16_t *s2tmp,
                       const int16_t *hm, const fpr *t0,
                       const fpr *t1)
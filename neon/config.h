@@ -74,4 +74,91 @@
  */
 #define FALCON_KG_CHACHA20 0
 
+/*
+ * By default, falcon_keygen_make_mt() uses POSIX threads
+ * FALCON_KG_THREADS: set to 0 to always generate keys on the calling thread
+ */
+#ifndef FALCON_KG_THREADS
+#define FALCON_KG_THREADS 1
+#endif
+
+/*
+ * By default, the expanded-key cache expands keys on background threads
+ * FALCON_KC_THREADS: set to 0 to always expand keys on the signing thread
+ */
+#ifndef FALCON_KC_THREADS
+#define FALCON_KC_THREADS 1
+#endif
+
+/*
+ * By default, expanded-key stores are mapped with POSIX mmap()
+ * FALCON_EKS_MMAP: set to 0 to read stores into memory with stdio
+ */
+#ifndef FALCON_EKS_MMAP
+#define FALCON_EKS_MMAP 1
+#endif
+
+/*
+ * By default, ffSampling leaves call Zf(sampler) once per coefficient,
+ * which keeps the PRNG order of the reference code (NIST KAT vectors)
+ * FALCON_SAMPLER_X2: set to 1 to sample leaf pairs with Zf(sampler_x2)
+ */
+#ifndef FALCON_SAMPLER_X2
+#define FALCON_SAMPLER_X2 0
+#endif
+
+/*
+ * By default, no sign-time statistics are collected
+ * FALCON_STATS: set to 1 to maintain the per-thread counters returned
+ * by falcon_stats_get()
+ */
+#ifndef FALCON_STATS
+#define FALCON_STATS 0
+#endif
+
+/*
+ * By default, signing and verification phases are not traced
+ * FALCON_TRACE: set to 1 to record the duration of each phase in a
+ * per-thread ring buffer read with falcon_trace_read(); the buffer keeps
+ * the last FALCON_TRACE_SIZE events
+ */
+#ifndef FALCON_TRACE
+#define FALCON_TRACE 0
+#endif
+
+#ifndef FALCON_TRACE_SIZE
+#define FALCON_TRACE_SIZE 1024
+#endif
+
+/*
+ * By default, Zf(get_seed)() (and thus shake256_init_prng_from_system()
+ * and falcon_ctx_new()) reads the seed from getentropy() on Linux with
+ * glibc 2.25+, FreeBSD 12+ and OpenBSD, then from /dev/urandom on
+ * Unix-like systems; with neither source, it fails
+ * FALCON_RAND_GETENTROPY, FALCON_RAND_URANDOM: set to 0 or 1 to force
+ */
+#ifndef FALCON_RAND_GETENTROPY
+#if (defined __linux__ && defined __GLIBC__ \
+	&& (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 25))) \
+	|| (defined __FreeBSD__ && __FreeBSD__ >= 12) \
+	|| defined __OpenBSD__
+#define FALCON_RAND_GETENTROPY 1
+#else
+#define FALCON_RAND_GETENTROPY 0
+#endif
+#endif
+
+#ifndef FALCON_RAND_URANDOM
+#if defined __ANDROID__ \
+	|| defined __FreeBSD__ \
+	|| defined __NetBSD__ \
+	|| defined __OpenBSD__ \
+	|| defined __linux__ \
+	|| (defined __APPLE__ && defined __MACH__)
+#define FALCON_RAND_URANDOM 1
+#else
+#define FALCON_RAND_URANDOM 0
+#endif
+#endif
+
 #endif
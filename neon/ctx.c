@@ -0,0 +1,195 @@
+/*
+ * Operation context (see falcon_ctx_new() in falcon.h).
+ *
+ * A context owns the random source, the message hashing context and a
+ * single temporary buffer (the arena), allocated once, 64-byte aligned,
+ * and large enough for every operation at the context degree; the
+ * _ALIGNED sizes are used so that signing and verification also keep
+ * their temporary values on cache lines. Each operation then calls the
+ * plain API with the arena as tmp[], and performs no allocation. The
+ * sampler state is not stored here: Zf(sign_tree)() and Zf(sign_dyn)()
+ * keep it on the stack for the duration of a signature.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "falcon.h"
+
+struct falcon_ctx_ {
+	unsigned logn;
+	shake256_context rng;
+	shake256_context hd;
+	uint8_t *tmp;
+	size_t tmp_len;
+	void *alloc;
+};
+
+/*
+ * Clear a buffer that is about to be released. The writes go through a
+ * volatile pointer so that the compiler cannot elide them as dead
+ * stores before free().
+ */
+static void
+ctx_wipe(void *buf, size_t len)
+{
+	volatile uint8_t *p;
+
+	p = buf;
+	while (len -- > 0) {
+		*p ++ = 0;
+	}
+}
+
+static inline size_t
+ctx_max(size_t a, size_t b)
+{
+	return a > b ? a : b;
+}
+
+/* see falcon.h */
+falcon_ctx *
+falcon_ctx_new(unsigned logn)
+{
+	falcon_ctx *ctx;
+	size_t len;
+
+	if (logn < 1 || logn > 10) {
+		return NULL;
+	}
+	ctx = malloc(sizeof *ctx);
+	if (ctx == NULL) {
+		return NULL;
+	}
+	memset(ctx, 0, sizeof *ctx);
+	ctx->logn = logn;
+	if (shake256_init_prng_from_system(&ctx->rng) != 0) {
+		free(ctx);
+		return NULL;
+	}
+
+	len = FALCON_TMPSIZE_KEYGEN(logn);
+	len = ctx_max(len, FALCON_TMPSIZE_MAKEPUB(logn));
+	len = ctx_max(len, FALCON_TMPSIZE_SIGNDYN(logn));
+	len = ctx_max(len, FALCON_TMPSIZE_SIGNTREE_ALIGNED(logn));
+	len = ctx_max(len, FALCON_TMPSIZE_EXPANDPRIV(logn));
+	len = ctx_max(len, FALCON_TMPSIZE_VERIFY_ALIGNED(logn));
+	len = (len + 63) & ~(size_t)63;
+	ctx->alloc = malloc(len + 63);
+	if (ctx->alloc == NULL) {
+		free(ctx);
+		return NULL;
+	}
+	ctx->tmp = (uint8_t *)ctx->alloc
+		+ ((64 - ((uintptr_t)ctx->alloc & 63)) & 63);
+	ctx->tmp_len = len;
+	return ctx;
+}
+
+/* see falcon.h */
+void
+falcon_ctx_free(falcon_ctx *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+	ctx_wipe(ctx->tmp, ctx->tmp_len);
+	ctx_wipe(&ctx->rng, sizeof ctx->rng);
+	ctx_wipe(&ctx->hd, sizeof ctx->hd);
+	free(ctx->alloc);
+	free(ctx);
+}
+
+/* see falcon.h */
+void
+falcon_ctx_seed(falcon_ctx *ctx, const void *seed, size_t seed_len)
+{
+	shake256_init_prng_from_seed(&ctx->rng, seed, seed_len);
+}
+
+/* see falcon.h */
+int
+falcon_ctx_keygen(falcon_ctx *ctx,
+	void *privkey, size_t privkey_len,
+	void *pubkey, size_t pubkey_len)
+{
+	return falcon_keygen_make(&ctx->rng, ctx->logn,
+		privkey, privkey_len, pubkey, pubkey_len,
+		ctx->tmp, ctx->tmp_len);
+}
+
+/* see falcon.h */
+int
+falcon_ctx_make_public(falcon_ctx *ctx,
+	void *pubkey, size_t pubkey_len,
+	const void *privkey, size_t privkey_len)
+{
+	return falcon_make_public(pubkey, pubkey_len,
+		privkey, privkey_len, ctx->tmp, ctx->tmp_len);
+}
+
+/* see falcon.h */
+int
+falcon_ctx_expand_privkey(falcon_ctx *ctx,
+	void *expanded_key, size_t expanded_key_len,
+	const void *privkey, size_t privkey_len)
+{
+	return falcon_expand_privkey(expanded_key, expanded_key_len,
+		privkey, privkey_len, ctx->tmp, ctx->tmp_len);
+}
+
+/* see falcon.h */
+int
+falcon_ctx_sign_dyn(falcon_ctx *ctx,
+	void *sig, size_t *sig_len, int sig_type,
+	const void *privkey, size_t privkey_len,
+	const void *data, size_t data_len)
+{
+	uint8_t nonce[40];
+	int r;
+
+	r = falcon_sign_start(&ctx->rng, nonce, &ctx->hd);
+	if (r != 0) {
+		return r;
+	}
+	shake256_inject(&ctx->hd, data, data_len);
+	return falcon_sign_dyn_finish(&ctx->rng, sig, sig_len, sig_type,
+		privkey, privkey_len, &ctx->hd, nonce,
+		ctx->tmp, ctx->tmp_len);
+}
+
+/* see falcon.h */
+int
+falcon_ctx_sign_tree(falcon_ctx *ctx,
+	void *sig, size_t *sig_len, int sig_type,
+	const void *expanded_key,
+	const void *data, size_t data_len)
+{
+	uint8_t nonce[40];
+	int r;
+
+	r = falcon_sign_start(&ctx->rng, nonce, &ctx->hd);
+	if (r != 0) {
+		return r;
+	}
+	shake256_inject(&ctx->hd, data, data_len);
+	return falcon_sign_tree_finish(&ctx->rng, sig, sig_len, sig_type,
+		expanded_key, &ctx->hd, nonce, ctx->tmp, ctx->tmp_len);
+}
+
+/* see falcon.h */
+int
+falcon_ctx_verify(falcon_ctx *ctx,
+	const void *sig, size_t sig_len, int sig_type,
+	const void *pubkey, size_t pubkey_len,
+	const void *data, size_t data_len)
+{
+	int r;
+
+	r = falcon_verify_start(&ctx->hd, sig, sig_len);
+	if (r < 0) {
+		return r;
+	}
+	shake256_inject(&ctx->hd, data, data_len);
+	return falcon_verify_finish(sig, sig_len, sig_type,
+		pubkey, pubkey_len, &ctx->hd, ctx->tmp, ctx->tmp_len);
+}
@@ -0,0 +1,567 @@
+/*
+ * Expanded-key store (see falcon_expkey_store_open() in falcon.h).
+ *
+ * File format (all integers are little-endian):
+ *
+ *   header (64 bytes)
+ *     0   magic "FNEKSTOR"
+ *     8   format version (32 bits, EKS_VERSION)
+ *    12   logn (32 bits)
+ *    16   number of keys (64 bits)
+ *    24   entry stride in bytes (64 bits)
+ *    32   reserved (16 bytes, zero)
+ *    48   checksum of bytes 0..47 and of the index (16 bytes)
+ *
+ *   index (64 bytes per key, sorted by key identifier)
+ *     0   key identifier: SHAKE256 of the encoded private key (32 bytes)
+ *    32   checksum of the expanded key (16 bytes)
+ *    48   offset of the entry in the file (64 bits)
+ *    56   reserved (8 bytes, zero)
+ *
+ *   entries (stride bytes each, 64-byte aligned)
+ *     0   zero (63 bytes)
+ *    63   logn
+ *    64   fpr payload of the expanded key
+ *
+ * An expanded key (as consumed by falcon_sign_tree()) is one header
+ * byte, then the fpr payload at the next 8-byte boundary. Each entry
+ * places that header byte just before a 64-byte boundary, so that the
+ * expanded key can be used in place from the mapping (which is page
+ * aligned): the payload needs no re-alignment and starts on a cache
+ * line. Checksums are the first 16 bytes of SHAKE256 over the covered
+ * bytes; the payload checksum covers the header byte and the payload.
+ *
+ * The fpr payload is stored in the native format: a store may only be
+ * used by the same implementation (and endianness) that wrote it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "falcon.h"
+#include "inner.h"
+
+#if FALCON_EKS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define EKS_VERSION      1
+#define EKS_HEADER_LEN   64
+#define EKS_INDEX_LEN    64
+#define EKS_SUM_LEN      16
+
+static const uint8_t eks_magic[8] = {
+	'F', 'N', 'E', 'K', 'S', 'T', 'O', 'R'
+};
+
+struct falcon_expkey_store_ {
+	unsigned logn;
+	size_t count;
+	const uint8_t *base;
+	size_t len;
+	const uint8_t *index;
+	void *alloc;
+};
+
+static inline void
+eks_enc32le(uint8_t *buf, uint32_t x)
+{
+	int i;
+
+	for (i = 0; i < 4; i ++) {
+		buf[i] = (uint8_t)(x >> (8 * i));
+	}
+}
+
+static inline void
+eks_enc64le(uint8_t *buf, uint64_t x)
+{
+	int i;
+
+	for (i = 0; i < 8; i ++) {
+		buf[i] = (uint8_t)(x >> (8 * i));
+	}
+}
+
+static inline uint32_t
+eks_dec32le(const uint8_t *buf)
+{
+	return (uint32_t)buf[0]
+		| ((uint32_t)buf[1] << 8)
+		| ((uint32_t)buf[2] << 16)
+		| ((uint32_t)buf[3] << 24);
+}
+
+static inline uint64_t
+eks_dec64le(const uint8_t *buf)
+{
+	return (uint64_t)eks_dec32le(buf)
+		| ((uint64_t)eks_dec32le(buf + 4) << 32);
+}
+
+/*
+ * Size of the fpr payload of an expanded key.
+ */
+static inline size_t
+eks_payload_len(unsigned logn)
+{
+	return FALCON_EXPANDEDKEY_SIZE(logn) - 8;
+}
+
+/*
+ * Distance between two entries: the 64-byte preamble, then the payload
+ * rounded up to a multiple of 64 bytes.
+ */
+static inline size_t
+eks_stride(unsigned logn)
+{
+	return 64 + ((eks_payload_len(logn) + 63) & ~(size_t)63);
+}
+
+/*
+ * Checksum over one or two buffers (b2 may be NULL).
+ */
+static void
+eks_sum(uint8_t *sum, const void *b1, size_t l1, const void *b2, size_t l2)
+{
+	shake256_context sc;
+
+	shake256_init(&sc);
+	shake256_inject(&sc, b1, l1);
+	if (b2 != NULL) {
+		shake256_inject(&sc, b2, l2);
+	}
+	shake256_flip(&sc);
+	shake256_extract(&sc, sum, EKS_SUM_LEN);
+}
+
+static void
+eks_key_id(uint8_t *id, const void *privkey, size_t privkey_len)
+{
+	shake256_context sc;
+
+	shake256_init(&sc);
+	shake256_inject(&sc, privkey, privkey_len);
+	shake256_flip(&sc);
+	shake256_extract(&sc, id, 32);
+}
+
+static int
+eks_cmp_index(const void *a, const void *b)
+{
+	return memcmp(a, b, 32);
+}
+
+/* see falcon.h */
+int
+falcon_expkey_store_write(const char *path,
+	const void *const *privkey, size_t privkey_len, size_t count,
+	void *tmp, size_t tmp_len)
+{
+	unsigned logn;
+	size_t u, stride, plen, data_off, path_len;
+	uint8_t header[EKS_HEADER_LEN], pad[64];
+	uint8_t *index, *ek, *etmp;
+	char *tpath;
+	FILE *f;
+	int r;
+
+	if (count == 0 || privkey_len == 0) {
+		return FALCON_ERR_BADARG;
+	}
+	logn = ((const uint8_t *)privkey[0])[0] & 0x0F;
+	if (logn < 1 || logn > 10
+		|| privkey_len != FALCON_PRIVKEY_SIZE(logn))
+	{
+		return FALCON_ERR_FORMAT;
+	}
+	for (u = 0; u < count; u ++) {
+		if (((const uint8_t *)privkey[u])[0] != 0x50 + logn) {
+			return FALCON_ERR_FORMAT;
+		}
+	}
+	if (tmp_len < FALCON_TMPSIZE_EXPKEY_STORE(logn)) {
+		return FALCON_ERR_SIZE;
+	}
+	if (count > (SIZE_MAX - EKS_HEADER_LEN)
+		/ (EKS_INDEX_LEN + eks_stride(logn)))
+	{
+		return FALCON_ERR_BADARG;
+	}
+	stride = eks_stride(logn);
+	plen = eks_payload_len(logn);
+	data_off = EKS_HEADER_LEN + count * EKS_INDEX_LEN;
+
+	/*
+	 * The expanded key is computed with its payload on an 8-byte
+	 * boundary, i.e. with the header byte at 7 mod 8; the expansion
+	 * temporaries follow.
+	 */
+	ek = (uint8_t *)tmp + ((8 - ((uintptr_t)tmp & 7)) & 7) + 7;
+	etmp = ek + 1 + plen;
+
+	/*
+	 * Build the index with the key identifiers (and the source
+	 * position of each key, temporarily in the offset field), and
+	 * sort it.
+	 */
+	index = malloc(count * EKS_INDEX_LEN);
+	if (index == NULL) {
+		return FALCON_ERR_INTERNAL;
+	}
+	memset(index, 0, count * EKS_INDEX_LEN);
+	for (u = 0; u < count; u ++) {
+		uint8_t *e;
+
+		e = index + u * EKS_INDEX_LEN;
+		eks_key_id(e, privkey[u], privkey_len);
+		eks_enc64le(e + 48, u);
+	}
+	qsort(index, count, EKS_INDEX_LEN, eks_cmp_index);
+	for (u = 1; u < count; u ++) {
+		if (memcmp(index + (u - 1) * EKS_INDEX_LEN,
+			index + u * EKS_INDEX_LEN, 32) == 0)
+		{
+			free(index);
+			return FALCON_ERR_BADARG;
+		}
+	}
+
+	/*
+	 * The store is written to a temporary file, then renamed over
+	 * the target: processes that already mapped the previous
+	 * version keep it, and new ones see a complete file.
+	 */
+	path_len = strlen(path);
+	tpath = malloc(path_len + 5);
+	if (tpath == NULL) {
+		free(index);
+		return FALCON_ERR_INTERNAL;
+	}
+	memcpy(tpath, path, path_len);
+	memcpy(tpath + path_len, ".tmp", 5);
+	f = fopen(tpath, "wb");
+	if (f == NULL) {
+		free(tpath);
+		free(index);
+		return FALCON_ERR_IO;
+	}
+
+	r = FALCON_ERR_IO;
+	memset(pad, 0, sizeof pad);
+	if (fseek(f, (long)data_off, SEEK_SET) != 0) {
+		goto exit_write;
+	}
+	for (u = 0; u < count; u ++) {
+		uint8_t *e;
+		size_t src;
+		int er;
+
+		e = index + u * EKS_INDEX_LEN;
+		src = (size_t)eks_dec64le(e + 48);
+		er = falcon_expand_privkey(ek, 1 + plen + 7,
+			privkey[src], privkey_len,
+			etmp, FALCON_TMPSIZE_EXPANDPRIV(logn));
+		if (er != 0) {
+			r = er;
+			goto exit_write;
+		}
+		eks_sum(e + 32, ek, 1 + plen, NULL, 0);
+		eks_enc64le(e + 48, data_off + u * stride);
+		pad[63] = (uint8_t)logn;
+		if (fwrite(pad, 1, 64, f) != 64
+			|| fwrite(ek + 1, 1, plen, f) != plen)
+		{
+			goto exit_write;
+		}
+		pad[63] = 0;
+		if (stride - 64 > plen
+			&& fwrite(pad, 1, stride - 64 - plen, f)
+				!= stride - 64 - plen)
+		{
+			goto exit_write;
+		}
+	}
+
+	memset(header, 0, sizeof header);
+	memcpy(header, eks_magic, sizeof eks_magic);
+	eks_enc32le(header + 8, EKS_VERSION);
+	eks_enc32le(header + 12, logn);
+	eks_enc64le(header + 16, count);
+	eks_enc64le(header + 24, stride);
+	eks_sum(header + 48, header, 48, index, count * EKS_INDEX_LEN);
+	if (fseek(f, 0, SEEK_SET) != 0
+		|| fwrite(header, 1, sizeof header, f) != sizeof header
+		|| fwrite(index, EKS_INDEX_LEN, count, f) != count)
+	{
+		goto exit_write;
+	}
+	r = 0;
+
+exit_write:
+	if (fclose(f) != 0 && r == 0) {
+		r = FALCON_ERR_IO;
+	}
+	if (r == 0 && rename(tpath, path) != 0) {
+		r = FALCON_ERR_IO;
+	}
+	if (r != 0) {
+		remove(tpath);
+	}
+	free(tpath);
+	free(index);
+	return r;
+}
+
+/*
+ * Map (or, with FALCON_EKS_MMAP=0, read) the whole file. The returned
+ * buffer is at least 64-byte aligned.
+ */
+static int
+eks_load(falcon_expkey_store *st, const char *path)
+{
+#if FALCON_EKS_MMAP
+	int fd;
+	struct stat sb;
+	void *p;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return FALCON_ERR_IO;
+	}
+	if (fstat(fd, &sb) != 0) {
+		close(fd);
+		return FALCON_ERR_IO;
+	}
+	if (sb.st_size < EKS_HEADER_LEN) {
+		close(fd);
+		return FALCON_ERR_FORMAT;
+	}
+	st->len = (size_t)sb.st_size;
+	p = mmap(NULL, st->len, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		return FALCON_ERR_IO;
+	}
+	st->base = p;
+	return 0;
+#else
+	FILE *f;
+	long len;
+	uint8_t *buf;
+
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		return FALCON_ERR_IO;
+	}
+	if (fseek(f, 0, SEEK_END) != 0 || (len = ftell(f)) < 0
+		|| fseek(f, 0, SEEK_SET) != 0)
+	{
+		fclose(f);
+		return FALCON_ERR_IO;
+	}
+	if (len < EKS_HEADER_LEN) {
+		fclose(f);
+		return FALCON_ERR_FORMAT;
+	}
+	st->len = (size_t)len;
+	st->alloc = malloc(st->len + 63);
+	if (st->alloc == NULL) {
+		fclose(f);
+		return FALCON_ERR_INTERNAL;
+	}
+	buf = (uint8_t *)st->alloc
+		+ ((64 - ((uintptr_t)st->alloc & 63)) & 63);
+	if (fread(buf, 1, st->len, f) != st->len) {
+		fclose(f);
+		free(st->alloc);
+		st->alloc = NULL;
+		return FALCON_ERR_IO;
+	}
+	fclose(f);
+	st->base = buf;
+	return 0;
+#endif
+}
+
+static void
+eks_unload(falcon_expkey_store *st)
+{
+#if FALCON_EKS_MMAP
+	munmap((void *)st->base, st->len);
+#else
+	free(st->alloc);
+#endif
+}
+
+/*
+ * Check the header and the index; with verify != 0, also check all
+ * entries.
+ */
+static int
+eks_check(falcon_expkey_store *st, int verify)
+{
+	const uint8_t *hd;
+	uint8_t sum[EKS_SUM_LEN];
+	uint64_t count, stride, data_off;
+	size_t u, plen;
+	unsigned logn;
+
+	hd = st->base;
+	if (memcmp(hd, eks_magic, sizeof eks_magic) != 0
+		|| eks_dec32le(hd + 8) != EKS_VERSION)
+	{
+		return FALCON_ERR_FORMAT;
+	}
+	logn = eks_dec32le(hd + 12);
+	if (logn < 1 || logn > 10) {
+		return FALCON_ERR_FORMAT;
+	}
+	count = eks_dec64le(hd + 16);
+	stride = eks_dec64le(hd + 24);
+	if (stride != eks_stride(logn) || count == 0
+		|| count > (st->len - EKS_HEADER_LEN)
+			/ (EKS_INDEX_LEN + stride))
+	{
+		return FALCON_ERR_FORMAT;
+	}
+	data_off = EKS_HEADER_LEN + count * EKS_INDEX_LEN;
+	if (st->len != data_off + count * stride) {
+		return FALCON_ERR_FORMAT;
+	}
+	st->logn = logn;
+	st->count = (size_t)count;
+	st->index = hd + EKS_HEADER_LEN;
+	eks_sum(sum, hd, 48, st->index, st->count * EKS_INDEX_LEN);
+	if (memcmp(sum, hd + 48, EKS_SUM_LEN) != 0) {
+		return FALCON_ERR_FORMAT;
+	}
+
+	plen = eks_payload_len(logn);
+	for (u = 0; u < st->count; u ++) {
+		const uint8_t *e;
+		uint64_t off;
+
+		e = st->index + u * EKS_INDEX_LEN;
+		off = eks_dec64le(e + 48);
+		if (off < data_off || off > st->len - stride
+			|| (off - data_off) % stride != 0)
+		{
+			return FALCON_ERR_FORMAT;
+		}
+		if (u > 0 && memcmp(e - EKS_INDEX_LEN, e, 32) >= 0) {
+			return FALCON_ERR_FORMAT;
+		}
+		if (verify) {
+			const uint8_t *ek;
+
+			ek = st->base + off + 63;
+			eks_sum(sum, ek, 1 + plen, NULL, 0);
+			if (ek[0] != logn
+				|| memcmp(sum, e + 32, EKS_SUM_LEN) != 0)
+			{
+				return FALCON_ERR_FORMAT;
+			}
+		}
+	}
+	return 0;
+}
+
+/* see falcon.h */
+int
+falcon_expkey_store_open(falcon_expkey_store **store,
+	const char *path, unsigned flags)
+{
+	falcon_expkey_store *st;
+	int r;
+
+	*store = NULL;
+	st = malloc(sizeof *st);
+	if (st == NULL) {
+		return FALCON_ERR_INTERNAL;
+	}
+	memset(st, 0, sizeof *st);
+	r = eks_load(st, path);
+	if (r != 0) {
+		free(st);
+		return r;
+	}
+	r = eks_check(st, (flags & FALCON_EXPKEY_STORE_VERIFY) != 0);
+	if (r != 0) {
+		eks_unload(st);
+		free(st);
+		return r;
+	}
+	*store = st;
+	return 0;
+}
+
+/* see falcon.h */
+void
+falcon_expkey_store_close(falcon_expkey_store *store)
+{
+	if (store == NULL) {
+		return;
+	}
+	eks_unload(store);
+	free(store);
+}
+
+/* see falcon.h */
+size_t
+falcon_expkey_store_count(const falcon_expkey_store *store)
+{
+	return store->count;
+}
+
+/* see falcon.h */
+const void *
+falcon_expkey_store_get(const falcon_expkey_store *store, size_t idx)
+{
+	const uint8_t *ek;
+
+	if (idx >= store->count) {
+		return NULL;
+	}
+	ek = store->base
+		+ eks_dec64le(store->index + idx * EKS_INDEX_LEN + 48) + 63;
+	if (ek[0] != store->logn) {
+		return NULL;
+	}
+	return ek;
+}
+
+/* see falcon.h */
+const void *
+falcon_expkey_store_find(const falcon_expkey_store *store,
+	const void *privkey, size_t privkey_len)
+{
+	uint8_t id[32];
+	size_t lo, hi;
+
+	if (privkey_len != FALCON_PRIVKEY_SIZE(store->logn)) {
+		return NULL;
+	}
+	eks_key_id(id, privkey, privkey_len);
+	lo = 0;
+	hi = store->count;
+	while (lo < hi) {
+		size_t mid;
+		int c;
+
+		mid = lo + ((hi - lo) >> 1);
+		c = memcmp(id, store->index + mid * EKS_INDEX_LEN, 32);
+		if (c == 0) {
+			return falcon_expkey_store_get(store, mid);
+		}
+		if (c < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return NULL;
+}
@@ -29,6 +29,8 @@
  * @author   Thomas Pornin <thomas.pornin@nccgroup.com>
  */
 
+#include <stdlib.h>
+
 #include "falcon.h"
 #include "inner.h"
 
@@ -123,21 +125,118 @@ align_fpr(void *tmp)
         return (fpr *)atmp;
 }
 
-/* see falcon.h */
-int
-falcon_keygen_make(
-        shake256_context *rng,
-        unsigned logn,
+/*
+ * Align to a cache line (64 bytes), for the aligned layout of expanded
+ * keys and for temporary buffers large enough to allow it.
+ */
+static inline uint8_t *
+align_cl(void *tmp)
+{
+        uint8_t *atmp;
+        unsigned off;
+
+        atmp = tmp;
+        off = (uintptr_t)atmp & 63u;
+        if (off != 0) {
+                atmp += 64u - off;
+        }
+        return atmp;
+}
+
+/*
+ * Expanded key header byte: logn in the low nibble, and the layout in
+ * the high nibble. EK_COMPACT marks a compact expanded key, EK_SEMI a
+ * semi-expanded key (EK_GRAM: with the Gram matrix); with EK_ALIGNED,
+ * the fpr payload starts on the first 64-byte boundary after the
+ * header byte (otherwise, on the first 8-byte boundary).
+ */
+#define EK_COMPACT   0x10
+#define EK_ALIGNED   0x20
+#define EK_SEMI      0x40
+#define EK_GRAM      0x80
+
+static inline const fpr *
+expkey_payload(const void *expanded_key, unsigned layout)
+{
+        uint8_t *p;
+
+        p = (uint8_t *)expanded_key + 1;
+        if (layout & EK_ALIGNED) {
+                return (const fpr *)align_cl(p);
+        }
+        return align_fpr(p);
+}
+
+/*
+ * Encode a private key (f, g, F) into sk[], which has size
+ * FALCON_PRIVKEY_SIZE(logn).
+ */
+static int
+encode_privkey(uint8_t *sk, unsigned logn,
+        const int8_t *f, const int8_t *g, const int8_t *F)
+{
+        size_t u, v, sk_len;
+
+        sk_len = FALCON_PRIVKEY_SIZE(logn);
+        sk[0] = 0x50 + logn;
+        u = 1;
+        v = Zf(trim_i8_encode)(sk + u, sk_len - u, f, Zf(max_fg_bits)[logn]);
+        if (v == 0) {
+                return FALCON_ERR_INTERNAL;
+        }
+        u += v;
+        v = Zf(trim_i8_encode)(sk + u, sk_len - u, g, Zf(max_fg_bits)[logn]);
+        if (v == 0) {
+                return FALCON_ERR_INTERNAL;
+        }
+        u += v;
+        v = Zf(trim_i8_encode)(sk + u, sk_len - u, F, Zf(max_FG_bits)[logn]);
+        if (v == 0) {
+                return FALCON_ERR_INTERNAL;
+        }
+        u += v;
+        if (u != sk_len) {
+                return FALCON_ERR_INTERNAL;
+        }
+        return 0;
+}
+
+/*
+ * Encode a public key h into pk[], which has size FALCON_PUBKEY_SIZE(logn).
+ */
+static int
+encode_pubkey(uint8_t *pk, unsigned logn, const uint16_t *h)
+{
+        size_t pk_len;
+
+        pk_len = FALCON_PUBKEY_SIZE(logn);
+        pk[0] = 0x00 + logn;
+        if (Zf(modq_encode)(pk + 1, pk_len - 1, h, logn) != pk_len - 1) {
+                return FALCON_ERR_INTERNAL;
+        }
+        return 0;
+}
+
+/*
+ * Shared code for falcon_keygen_make(), falcon_keygen_make_mt() and
+ * falcon_keygen_make_pool(). If nthreads is 0, the key generator runs
+ * with the provided worker pool (single-threaded if pool is NULL);
+ * otherwise, tmp[] must have size FALCON_TMPSIZE_KEYGEN_MT(logn, nthreads)
+ * and nthreads threads are started for this key pair only.
+ */
+static int
+keygen_make(shake256_context *rng, unsigned logn,
         void *privkey, size_t privkey_len,
         void *pubkey, size_t pubkey_len,
-        void *tmp, size_t tmp_len)
+        void *tmp, size_t tmp_len, unsigned nthreads,
+        Zf(keygen_pool) *pool)
 {
         int8_t *f, *g, *F;
         uint16_t *h;
         uint8_t *atmp;
-        size_t n, u, v, sk_len, pk_len;
-        uint8_t *sk, *pk;
+        size_t n;
         unsigned oldcw;
+        int r;
 
         /*
          * Check parameters.
@@ -147,7 +246,9 @@ falcon_keygen_make(
         }
         if (privkey_len < FALCON_PRIVKEY_SIZE(logn)
                 || (pubkey != NULL && pubkey_len < FALCON_PUBKEY_SIZE(logn))
-                || tmp_len < FALCON_TMPSIZE_KEYGEN(logn))
+                || tmp_len < (nthreads == 0
+                        ? FALCON_TMPSIZE_KEYGEN(logn)
+                        : FALCON_TMPSIZE_KEYGEN_MT(logn, nthreads)))
         {
                 return FALCON_ERR_SIZE;
         }
@@ -161,34 +262,30 @@ falcon_keygen_make(
         F = g + n;
         atmp = align_u64(F + n);
         oldcw = set_fpu_cw(2);
-        Zf(keygen)((inner_shake256_context *)rng,
-                f, g, F, NULL, NULL, logn, atmp);
+        if (nthreads == 0) {
+                Zf(keygen_pooled)((inner_shake256_context *)rng,
+                        f, g, F, NULL, NULL, logn, atmp, pool);
+        } else {
+                uint8_t *scratch;
+
+                /*
+                 * Per-thread scratch areas follow the single-threaded
+                 * buffer, aligned for 32-bit words.
+                 */
+                scratch = (uint8_t *)tmp + FALCON_TMPSIZE_KEYGEN(logn);
+                scratch += (4u - ((uintptr_t)scratch & 3u)) & 3u;
+                Zf(keygen_mt)((inner_shake256_context *)rng,
+                        f, g, F, NULL, NULL, logn, atmp,
+                        nthreads, (uint32_t *)scratch);
+        }
         set_fpu_cw(oldcw);
 
         /*
          * Encode private key.
          */
-        sk = privkey;
-        sk_len = FALCON_PRIVKEY_SIZE(logn);
-        sk[0] = 0x50 + logn;
-        u = 1;
-        v = Zf(trim_i8_encode)(sk + u, sk_len - u, f, Zf(max_fg_bits)[logn]);
-        if (v == 0) {
-                return FALCON_ERR_INTERNAL;
-        }
-        u += v;
-        v = Zf(trim_i8_encode)(sk + u, sk_len - u, g, Zf(max_fg_bits)[logn]);
-        if (v == 0) {
-                return FALCON_ERR_INTERNAL;
-        }
-        u += v;
-        v = Zf(trim_i8_encode)(sk + u, sk_len - u, F, Zf(max_FG_bits)[logn]);
-        if (v == 0) {
-                return FALCON_ERR_INTERNAL;
-        }
-        u += v;
-        if (u != sk_len) {
-                return FALCON_ERR_INTERNAL;
+        r = encode_privkey(privkey, logn, f, g, F);
+        if (r != 0) {
+                return r;
         }
 
         /*
@@ -200,18 +297,176 @@ falcon_keygen_make(
                 if (!Zf(compute_public)( (int16_t *) h, f, g, (int16_t *) atmp)) {
                         return FALCON_ERR_INTERNAL;
                 }
-                pk = pubkey;
-                pk_len = FALCON_PUBKEY_SIZE(logn);
-                pk[0] = 0x00 + logn;
-                v = Zf(modq_encode)(pk + 1, pk_len - 1, h, logn);
-                if (v != pk_len - 1) {
-                        return FALCON_ERR_INTERNAL;
+                r = encode_pubkey(pubkey, logn, h);
+                if (r != 0) {
+                        return r;
                 }
         }
 
         return 0;
 }
 
+/* see falcon.h */
+int
+falcon_keygen_make(
+        shake256_context *rng,
+        unsigned logn,
+        void *privkey, size_t privkey_len,
+        void *pubkey, size_t pubkey_len,
+        void *tmp, size_t tmp_len)
+{
+        return keygen_make(rng, logn, privkey, privkey_len,
+                pubkey, pubkey_len, tmp, tmp_len, 0, NULL);
+}
+
+/* see falcon.h */
+int
+falcon_keygen_make_mt(
+        shake256_context *rng,
+        unsigned logn,
+        void *privkey, size_t privkey_len,
+        void *pubkey, size_t pubkey_len,
+        void *tmp, size_t tmp_len,
+        unsigned nthreads)
+{
+        if (nthreads == 0) {
+                return FALCON_ERR_BADARG;
+        }
+        return keygen_make(rng, logn, privkey, privkey_len,
+                pubkey, pubkey_len, tmp, tmp_len, nthreads, NULL);
+}
+
+/*
+ * A key generation pool: the inner worker pool is NULL if no extra
+ * thread is used (single thread requested, or threads unavailable).
+ */
+struct falcon_keygen_pool_ {
+        unsigned logn;
+        Zf(keygen_pool) *workers;
+};
+
+/* see falcon.h */
+falcon_keygen_pool *
+falcon_keygen_pool_new(unsigned logn, unsigned nthreads)
+{
+        falcon_keygen_pool *pool;
+
+        if (logn < 1 || logn > 10 || nthreads == 0) {
+                return NULL;
+        }
+        pool = malloc(sizeof *pool);
+        if (pool == NULL) {
+                return NULL;
+        }
+        pool->logn = logn;
+        pool->workers = Zf(keygen_pool_new)(logn, nthreads);
+        return pool;
+}
+
+/* see falcon.h */
+void
+falcon_keygen_pool_free(falcon_keygen_pool *pool)
+{
+        if (pool != NULL) {
+                Zf(keygen_pool_free)(pool->workers);
+                free(pool);
+        }
+}
+
+/* see falcon.h */
+int
+falcon_keygen_make_pool(
+        falcon_keygen_pool *pool,
+        shake256_context *rng,
+        unsigned logn,
+        void *privkey, size_t privkey_len,
+        void *pubkey, size_t pubkey_len,
+        void *tmp, size_t tmp_len)
+{
+        if (logn > pool->logn) {
+                return FALCON_ERR_BADARG;
+        }
+        return keygen_make(rng, logn, privkey, privkey_len,
+                pubkey, pubkey_len, tmp, tmp_len, 0, pool->workers);
+}
+
+/*
+ * Context for keygen_many_emit(): encoding buffers and user callback.
+ */
+typedef struct {
+        unsigned logn;
+        uint8_t *sk, *pk;
+        falcon_keygen_callback cb;
+        void *cb_ctx;
+} keygen_many_context;
+
+/*
+ * Zf(keygen_many)() callback: encode the key pair and pass it to the
+ * user callback. Calls are serialized, so the encoding buffers are
+ * shared.
+ */
+static int
+keygen_many_emit(void *ctx, size_t index,
+        const int8_t *f, const int8_t *g, const int8_t *F, const int8_t *G,
+        const uint16_t *h)
+{
+        keygen_many_context *kc;
+        int r;
+
+        (void)G;
+        kc = ctx;
+        r = encode_privkey(kc->sk, kc->logn, f, g, F);
+        if (r != 0) {
+                return r;
+        }
+        r = encode_pubkey(kc->pk, kc->logn, h);
+        if (r != 0) {
+                return r;
+        }
+        return kc->cb(kc->cb_ctx, index,
+                kc->sk, FALCON_PRIVKEY_SIZE(kc->logn),
+                kc->pk, FALCON_PUBKEY_SIZE(kc->logn));
+}
+
+/* see falcon.h */
+int
+falcon_keygen_many(
+        shake256_context *rng,
+        unsigned logn,
+        size_t count,
+        unsigned nthreads,
+        falcon_keygen_callback cb, void *cb_ctx,
+        void *tmp, size_t tmp_len)
+{
+        keygen_many_context kc;
+        uint8_t *atmp;
+        unsigned oldcw;
+        int r;
+
+        if (logn < 1 || logn > 10 || nthreads == 0 || cb == NULL) {
+                return FALCON_ERR_BADARG;
+        }
+        if (tmp_len < FALCON_TMPSIZE_KEYGEN_MANY(logn, nthreads)) {
+                return FALCON_ERR_SIZE;
+        }
+
+        /*
+         * Per-thread areas come first (64-bit aligned), followed by
+         * the encoding buffers.
+         */
+        atmp = align_u64(tmp);
+        kc.logn = logn;
+        kc.sk = atmp + (size_t)nthreads * FALCON_KEYGEN_MANY_TEMP(logn);
+        kc.pk = kc.sk + FALCON_PRIVKEY_SIZE(logn);
+        kc.cb = cb;
+        kc.cb_ctx = cb_ctx;
+        oldcw = set_fpu_cw(2);
+        r = Zf(keygen_many)((inner_shake256_context *)rng, logn,
+                count, nthreads, &keygen_many_emit, &kc, atmp);
+        set_fpu_cw(oldcw);
+        return r;
+}
+
 /* see falcon.h */
 int
 falcon_make_public(
@@ -381,6 +636,8 @@ falcon_sign_dyn_finish(shake256_context *rng,
         /*
          * Decode private key elements, and complete private key.
          */
+        FALCON_TRACE_BEGIN();
+        FALCON_TRACE_ENTER();
         n = (size_t)1 << logn;
         f = (int8_t *)tmp;
         g = f + n;
@@ -414,6 +671,7 @@ falcon_sign_dyn_finish(shake256_context *rng,
         if (!Zf(complete_private)(G, f, g, F, atmp)) {
                 return FALCON_ERR_FORMAT;
         }
+        FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_KEY);
 
         /*
          * Hash message to a point.
@@ -432,6 +690,7 @@ falcon_sign_dyn_finish(shake256_context *rng,
                  * we overwrite the hash output with the signature (in order
                  * to save some RAM).
                  */
+                FALCON_TRACE_ENTER();
                 *(inner_shake256_context *)hash_data = sav_hash_data;
                 if (sig_type == FALCON_SIG_CT) {
                         Zf(hash_to_point_ct)(
@@ -442,10 +701,12 @@ falcon_sign_dyn_finish(shake256_context *rng,
                                 (inner_shake256_context *)hash_data,
                                 hm, logn);
                 }
+                FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_HASH);
                 oldcw = set_fpu_cw(2);
                 Zf(sign_dyn)(sv, (inner_shake256_context *)rng,
                         f, g, F, G, hm, atmp);
                 set_fpu_cw(oldcw);
+                FALCON_TRACE_ENTER();
                 es = sig;
                 es_len = *sig_len;
                 memcpy(es + 1, nonce, 40);
@@ -457,6 +718,7 @@ falcon_sign_dyn_finish(shake256_context *rng,
                         es[0] = 0x30 + logn;
                         v = Zf(comp_encode)(es + u, es_len - u, sv);
                         if (v == 0) {
+                                FALCON_STAT_ADD(comp_overflows, 1);
                                 return FALCON_ERR_SIZE;
                         }
                         break;
@@ -468,6 +730,8 @@ falcon_sign_dyn_finish(shake256_context *rng,
                                 /*
                                  * Signature does not fit, loop.
                                  */
+                                FALCON_STAT_ADD(comp_overflows, 1);
+                                FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_ENCODE);
                                 continue;
                         }
                         if (u + v < tu) {
@@ -484,17 +748,24 @@ falcon_sign_dyn_finish(shake256_context *rng,
                         }
                         break;
                 }
+                FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_ENCODE);
+                FALCON_TRACE_LEAVE(TRACE_SIGN_DYN);
                 *sig_len = u + v;
                 return 0;
         }
 }
 
-/* see falcon.h */
-int
-falcon_expand_privkey(void *expanded_key, size_t expanded_key_len,
+/*
+ * Common code for falcon_expand_privkey() and its variants; layout is
+ * a combination of EK_COMPACT or EK_SEMI (possibly with EK_GRAM), and
+ * EK_ALIGNED.
+ */
+static int
+expand_privkey_inner(void *expanded_key, size_t expanded_key_len,
         const void *privkey, size_t privkey_len,
-        void *tmp, size_t tmp_len)
+        void *tmp, size_t tmp_len, unsigned layout)
 {
+        size_t ek_len;
         unsigned logn;
         const uint8_t *sk;
         int8_t *f, *g, *F, *G;
@@ -521,7 +792,19 @@ falcon_expand_privkey(void *expanded_key, size_t expanded_key_len,
         if (privkey_len != FALCON_PRIVKEY_SIZE(logn)) {
                 return FALCON_ERR_FORMAT;
         }
-        if (expanded_key_len < FALCON_EXPANDEDKEY_SIZE(logn)
+        if (layout & EK_COMPACT) {
+                ek_len = FALCON_EXPANDEDKEY_COMPACT_SIZE(logn);
+        } else if (layout & EK_SEMI) {
+                ek_len = (layout & EK_GRAM)
+                        ? FALCON_EXPANDEDKEY_SEMI_GRAM_SIZE(logn)
+                        : FALCON_EXPANDEDKEY_SEMI_SIZE(logn);
+        } else {
+                ek_len = FALCON_EXPANDEDKEY_SIZE(logn);
+        }
+        if (layout & EK_ALIGNED) {
+                ek_len += 56;
+        }
+        if (expanded_key_len < ek_len
                 || tmp_len < FALCON_TMPSIZE_EXPANDPRIV(logn))
         {
                 return FALCON_ERR_SIZE;
@@ -562,23 +845,84 @@ falcon_expand_privkey(void *expanded_key, size_t expanded_key_len,
         /*
          * Expand private key.
          */
-        *(uint8_t *)expanded_key = logn;
-        expkey = align_fpr((uint8_t *)expanded_key + 1);
+        *(uint8_t *)expanded_key = layout + logn;
+        expkey = (fpr *)expkey_payload(expanded_key, layout);
         oldcw = set_fpu_cw(2);
-        Zf(expand_privkey)(expkey, f, g, F, G, atmp);
+        if (layout & EK_COMPACT) {
+                Zf(expand_privkey_compact)(expkey, f, g, F, G, atmp);
+        } else if (layout & EK_SEMI) {
+                Zf(expand_privkey_semi)(expkey, f, g, F, G,
+                        (layout & EK_GRAM) != 0);
+        } else {
+                Zf(expand_privkey)(expkey, f, g, F, G, atmp);
+        }
         set_fpu_cw(oldcw);
         return 0;
 }
 
 /* see falcon.h */
 int
-falcon_sign_tree_finish(shake256_context *rng,
+falcon_expand_privkey(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len)
+{
+        return expand_privkey_inner(expanded_key, expanded_key_len,
+                privkey, privkey_len, tmp, tmp_len, 0);
+}
+
+/* see falcon.h */
+int
+falcon_expand_privkey_compact(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len)
+{
+        return expand_privkey_inner(expanded_key, expanded_key_len,
+                privkey, privkey_len, tmp, tmp_len, EK_COMPACT);
+}
+
+/* see falcon.h */
+int
+falcon_expand_privkey_aligned(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len)
+{
+        return expand_privkey_inner(expanded_key, expanded_key_len,
+                privkey, privkey_len, tmp, tmp_len, EK_ALIGNED);
+}
+
+/* see falcon.h */
+int
+falcon_expand_privkey_semi(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len)
+{
+        return expand_privkey_inner(expanded_key, expanded_key_len,
+                privkey, privkey_len, tmp, tmp_len, EK_SEMI);
+}
+
+/* see falcon.h */
+int
+falcon_expand_privkey_semi_gram(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len)
+{
+        return expand_privkey_inner(expanded_key, expanded_key_len,
+                privkey, privkey_len, tmp, tmp_len, EK_SEMI | EK_GRAM);
+}
+
+/*
+ * Common code for falcon_sign_tree_finish(),
+ * falcon_sign_tree_compact_finish() and falcon_sign_semi_finish(); kind
+ * is the expected key layout (0, EK_COMPACT or EK_SEMI).
+ */
+static int
+sign_tree_finish_inner(shake256_context *rng,
         void *sig, size_t *sig_len, int sig_type,
         const void *expanded_key,
         shake256_context *hash_data, const void *nonce,
-        void *tmp, size_t tmp_len)
+        void *tmp, size_t tmp_len, unsigned kind)
 {
-        unsigned logn;
+        unsigned hb, logn, extra;
         uint8_t *es;
         const fpr *expkey;
         uint16_t *hm;
@@ -592,18 +936,26 @@ falcon_sign_tree_finish(shake256_context *rng,
          * Get degree from private key header byte, and check
          * parameters.
          */
-        logn = *(const uint8_t *)expanded_key;
+        hb = *(const uint8_t *)expanded_key;
+        extra = (kind == EK_SEMI) ? EK_GRAM : 0;
+        if ((hb & ~(unsigned)(EK_ALIGNED | extra | 0x0F)) != kind) {
+                return FALCON_ERR_FORMAT;
+        }
+        logn = hb & 0x0F;
         if (logn < 1 || logn > 10) {
                 return FALCON_ERR_FORMAT;
         }
-        if (tmp_len < FALCON_TMPSIZE_SIGNTREE(logn)) {
+        if (tmp_len < ((kind == EK_SEMI)
+                ? FALCON_TMPSIZE_SIGNDYN(logn)
+                : FALCON_TMPSIZE_SIGNTREE(logn)))
+        {
                 return FALCON_ERR_SIZE;
         }
         es_len = *sig_len;
         if (es_len < 41) {
                 return FALCON_ERR_SIZE;
         }
-        expkey = (const fpr *)align_fpr((uint8_t *)expanded_key + 1);
+        expkey = expkey_payload(expanded_key, hb & 0xF0);
         switch (sig_type) {
         case FALCON_SIG_COMPRESSED:
                 break;
@@ -622,9 +974,17 @@ falcon_sign_tree_finish(shake256_context *rng,
         }
 
         n = (size_t)1 << logn;
-        hm = (uint16_t *)align_u16(tmp);
+        if (tmp_len >= ((kind == EK_SEMI)
+                ? FALCON_TMPSIZE_SIGNDYN(logn) + 64
+                : FALCON_TMPSIZE_SIGNTREE_ALIGNED(logn)))
+        {
+                hm = (uint16_t *)align_cl(tmp);
+        } else {
+                hm = (uint16_t *)align_u16(tmp);
+        }
         sv = (int16_t *)hm;
         atmp = align_u64(sv + n);
+        FALCON_TRACE_BEGIN();
 
         /*
          * Hash message to a point.
@@ -643,6 +1003,7 @@ falcon_sign_tree_finish(shake256_context *rng,
                  * we overwrite the hash output with the signature (in order
                  * to save some RAM).
                  */
+                FALCON_TRACE_ENTER();
                 *(inner_shake256_context *)hash_data = sav_hash_data;
                 if (sig_type == FALCON_SIG_CT) {
                         Zf(hash_to_point_ct)(
@@ -653,10 +1014,22 @@ falcon_sign_tree_finish(shake256_context *rng,
                                 (inner_shake256_context *)hash_data,
                                 hm, logn);
                 }
+                FALCON_TRACE_LEAVE(kind == EK_SEMI
+                        ? TRACE_SIGN_SEMI_HASH : TRACE_SIGN_TREE_HASH);
                 oldcw = set_fpu_cw(2);
-                Zf(sign_tree)(sv, (inner_shake256_context *)rng,
-                        expkey, hm, atmp);
+                if (kind == EK_COMPACT) {
+                        Zf(sign_tree_compact)(sv,
+                                (inner_shake256_context *)rng,
+                                expkey, hm, atmp);
+                } else if (kind == EK_SEMI) {
+                        Zf(sign_semi)(sv, (inner_shake256_context *)rng,
+                                expkey, (hb & EK_GRAM) != 0, hm, atmp);
+                } else {
+                        Zf(sign_tree)(sv, (inner_shake256_context *)rng,
+                                expkey, hm, atmp);
+                }
                 set_fpu_cw(oldcw);
+                FALCON_TRACE_ENTER();
                 es = sig;
                 es_len = *sig_len;
                 memcpy(es + 1, nonce, 40);
@@ -668,6 +1041,7 @@ falcon_sign_tree_finish(shake256_context *rng,
                         es[0] = 0x30 + logn;
                         v = Zf(comp_encode)(es + u, es_len - u, sv);
                         if (v == 0) {
+                                FALCON_STAT_ADD(comp_overflows, 1);
                                 return FALCON_ERR_SIZE;
                         }
                         break;
@@ -679,6 +1053,10 @@ falcon_sign_tree_finish(shake256_context *rng,
                                 /*
                                  * Signature does not fit, loop.
                                  */
+                                FALCON_STAT_ADD(comp_overflows, 1);
+                                FALCON_TRACE_LEAVE(kind == EK_SEMI
+                                        ? TRACE_SIGN_SEMI_ENCODE
+                                        : TRACE_SIGN_TREE_ENCODE);
                                 continue;
                         }
                         if (u + v < tu) {
@@ -695,6 +1073,10 @@ falcon_sign_tree_finish(shake256_context *rng,
                         }
                         break;
                 }
+                FALCON_TRACE_LEAVE(kind == EK_SEMI
+                        ? TRACE_SIGN_SEMI_ENCODE : TRACE_SIGN_TREE_ENCODE);
+                FALCON_TRACE_LEAVE(kind == EK_SEMI
+                        ? TRACE_SIGN_SEMI : TRACE_SIGN_TREE);
                 *sig_len = u + v;
                 return 0;
         }
@@ -702,13 +1084,49 @@ falcon_sign_tree_finish(shake256_context *rng,
 
 /* see falcon.h */
 int
-falcon_sign_dyn(shake256_context *rng,
+falcon_sign_tree_finish(shake256_context *rng,
         void *sig, size_t *sig_len, int sig_type,
-        const void *privkey, size_t privkey_len,
-        const void *data, size_t data_len,
+        const void *expanded_key,
+        shake256_context *hash_data, const void *nonce,
         void *tmp, size_t tmp_len)
 {
-        shake256_context hd;
+        return sign_tree_finish_inner(rng, sig, sig_len, sig_type,
+                expanded_key, hash_data, nonce, tmp, tmp_len, 0);
+}
+
+/* see falcon.h */
+int
+falcon_sign_tree_compact_finish(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        shake256_context *hash_data, const void *nonce,
+        void *tmp, size_t tmp_len)
+{
+        return sign_tree_finish_inner(rng, sig, sig_len, sig_type,
+                expanded_key, hash_data, nonce, tmp, tmp_len, EK_COMPACT);
+}
+
+/* see falcon.h */
+int
+falcon_sign_semi_finish(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        shake256_context *hash_data, const void *nonce,
+        void *tmp, size_t tmp_len)
+{
+        return sign_tree_finish_inner(rng, sig, sig_len, sig_type,
+                expanded_key, hash_data, nonce, tmp, tmp_len, EK_SEMI);
+}
+
+/* see falcon.h */
+int
+falcon_sign_dyn(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *privkey, size_t privkey_len,
+        const void *data, size_t data_len,
+        void *tmp, size_t tmp_len)
+{
+        shake256_context hd;
         uint8_t nonce[40];
         int r;
 
@@ -744,52 +1162,72 @@ falcon_sign_tree(shake256_context *rng,
 
 /* see falcon.h */
 int
-falcon_verify_start(shake256_context *hash_data,
-        const void *sig, size_t sig_len)
+falcon_sign_tree_compact(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        const void *data, size_t data_len,
+        void *tmp, size_t tmp_len)
 {
-        if (sig_len < 41) {
-                return FALCON_ERR_FORMAT;
+        shake256_context hd;
+        uint8_t nonce[40];
+        int r;
+
+        r = falcon_sign_start(rng, nonce, &hd);
+        if (r != 0) {
+                return r;
         }
-        shake256_init(hash_data);
-        shake256_inject(hash_data, (const uint8_t *)sig + 1, 40);
-        return 0;
+        shake256_inject(&hd, data, data_len);
+        return falcon_sign_tree_compact_finish(rng, sig, sig_len, sig_type,
+                expanded_key, &hd, nonce, tmp, tmp_len);
 }
 
 /* see falcon.h */
 int
-falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
-        const void *pubkey, size_t pubkey_len,
-        shake256_context *hash_data,
+falcon_sign_semi(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        const void *data, size_t data_len,
         void *tmp, size_t tmp_len)
 {
-        unsigned logn;
-        uint8_t *atmp;
-        const uint8_t *pk, *es;
-        size_t u, v, n;
-        uint16_t *h, *hm;
-        int16_t *sv;
-        int ct;
+        shake256_context hd;
+        uint8_t nonce[40];
+        int r;
 
-        /*
-         * Get Falcon degree from public key; verify consistency with
-         * signature value, and check parameters.
-         */
-        if (sig_len < 41 || pubkey_len == 0) {
-                return FALCON_ERR_FORMAT;
-        }
-        es = sig;
-        pk = pubkey;
-        if ((pk[0] & 0xF0) != 0x00) {
-                return FALCON_ERR_FORMAT;
+        r = falcon_sign_start(rng, nonce, &hd);
+        if (r != 0) {
+                return r;
         }
-        logn = pk[0] & 0x0F;
-        if (logn < 1 || logn > 10) {
+        shake256_inject(&hd, data, data_len);
+        return falcon_sign_semi_finish(rng, sig, sig_len, sig_type,
+                expanded_key, &hd, nonce, tmp, tmp_len);
+}
+
+/* see falcon.h */
+int
+falcon_verify_start(shake256_context *hash_data,
+        const void *sig, size_t sig_len)
+{
+        if (sig_len < 41) {
                 return FALCON_ERR_FORMAT;
         }
+        shake256_init(hash_data);
+        shake256_inject(hash_data, (const uint8_t *)sig + 1, 40);
+        return 0;
+}
+
+/*
+ * Check the signature header byte and length against the expected
+ * degree and requested format. On success, *ct is set to 1 if the
+ * signature uses the CT format, 0 otherwise.
+ */
+static int
+verify_check_sig(const uint8_t *es, size_t sig_len, int sig_type,
+        unsigned logn, int *ct)
+{
         if ((es[0] & 0x0F) != logn) {
                 return FALCON_ERR_BADSIG;
         }
-        ct = 0;
+        *ct = 0;
         switch (sig_type) {
         case 0:
                 switch (es[0] & 0xF0) {
@@ -799,7 +1237,7 @@ falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
                         if (sig_len != FALCON_SIG_CT_SIZE(logn)) {
                                 return FALCON_ERR_FORMAT;
                         }
-                        ct = 1;
+                        *ct = 1;
                         break;
                 default:
                         return FALCON_ERR_BADSIG;
@@ -825,32 +1263,23 @@ falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
                 if (sig_len != FALCON_SIG_CT_SIZE(logn)) {
                         return FALCON_ERR_FORMAT;
                 }
-                ct = 1;
+                *ct = 1;
                 break;
         default:
                 return FALCON_ERR_BADARG;
         }
-        if (pubkey_len != FALCON_PUBKEY_SIZE(logn)) {
-                return FALCON_ERR_FORMAT;
-        }
-        if (tmp_len < FALCON_TMPSIZE_VERIFY(logn)) {
-                return FALCON_ERR_SIZE;
-        }
-
-        n = (size_t)1 << logn;
-        h = (uint16_t *)align_u16(tmp);
-        hm = h + n;
-        sv = (int16_t *)(hm + n);
-        atmp = (uint8_t *)(sv + n);
+        return 0;
+}
 
-        /*
-         * Decode public key.
-         */
-        if (Zf(modq_decode)(h, pk + 1, pubkey_len - 1, logn)
-                != pubkey_len - 1)
-        {
-                return FALCON_ERR_FORMAT;
-        }
+/*
+ * Decode the signature value into sv[]. The header must have been
+ * checked with verify_check_sig().
+ */
+static int
+verify_decode_value(int16_t *sv, const uint8_t *es, size_t sig_len,
+        int sig_type, unsigned logn, int ct)
+{
+        size_t u, v;
 
         /*
          * Decode signature value.
@@ -883,10 +1312,33 @@ falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
                         return FALCON_ERR_FORMAT;
                 }
         }
+        return 0;
+}
+
+/*
+ * Decode the signature value into sv[], then hash the message to the
+ * point hm[]. The header must have been checked with verify_check_sig().
+ * atmp[] receives temporary values for the CT hash-to-point.
+ */
+static int
+verify_decode_sig(int16_t *sv, uint16_t *hm,
+        const uint8_t *es, size_t sig_len, int sig_type,
+        unsigned logn, int ct,
+        shake256_context *hash_data, uint8_t *atmp)
+{
+        int r;
+
+        FALCON_TRACE_ENTER();
+        r = verify_decode_value(sv, es, sig_len, sig_type, logn, ct);
+        FALCON_TRACE_LEAVE(TRACE_VERIFY_DECODE);
+        if (r != 0) {
+                return r;
+        }
 
         /*
          * Hash message to point.
          */
+        FALCON_TRACE_ENTER();
         shake256_flip(hash_data);
         if (ct) {
                 Zf(hash_to_point_ct)(
@@ -895,11 +1347,91 @@ falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
                 Zf(hash_to_point_vartime)(
                         (inner_shake256_context *)hash_data, hm, logn);
         }
+        FALCON_TRACE_LEAVE(TRACE_VERIFY_HASH);
+        return 0;
+}
+
+/* see falcon.h */
+int
+falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
+        const void *pubkey, size_t pubkey_len,
+        shake256_context *hash_data,
+        void *tmp, size_t tmp_len)
+{
+        unsigned logn;
+        uint8_t *atmp;
+        const uint8_t *pk, *es;
+        size_t n;
+        uint16_t *h, *hm;
+        int16_t *sv;
+        int ct, r;
+
+        /*
+         * Get Falcon degree from public key; verify consistency with
+         * signature value, and check parameters.
+         */
+        if (sig_len < 41 || pubkey_len == 0) {
+                return FALCON_ERR_FORMAT;
+        }
+        es = sig;
+        pk = pubkey;
+        if ((pk[0] & 0xF0) != 0x00) {
+                return FALCON_ERR_FORMAT;
+        }
+        logn = pk[0] & 0x0F;
+        if (logn < 1 || logn > 10) {
+                return FALCON_ERR_FORMAT;
+        }
+        r = verify_check_sig(es, sig_len, sig_type, logn, &ct);
+        if (r != 0) {
+                return r;
+        }
+        if (pubkey_len != FALCON_PUBKEY_SIZE(logn)) {
+                return FALCON_ERR_FORMAT;
+        }
+        if (tmp_len < FALCON_TMPSIZE_VERIFY(logn)) {
+                return FALCON_ERR_SIZE;
+        }
+
+        n = (size_t)1 << logn;
+        if (tmp_len >= FALCON_TMPSIZE_VERIFY_ALIGNED(logn)) {
+                h = (uint16_t *)align_cl(tmp);
+        } else {
+                h = (uint16_t *)align_u16(tmp);
+        }
+        hm = h + n;
+        sv = (int16_t *)(hm + n);
+        atmp = (uint8_t *)(sv + n);
+
+        /*
+         * Decode public key.
+         */
+        FALCON_TRACE_BEGIN();
+        FALCON_TRACE_ENTER();
+        if (Zf(modq_decode)(h, pk + 1, pubkey_len - 1, logn)
+                != pubkey_len - 1)
+        {
+                return FALCON_ERR_FORMAT;
+        }
+        FALCON_TRACE_LEAVE(TRACE_VERIFY_PUBKEY);
+
+        /*
+         * Decode signature value and hash message to point.
+         */
+        r = verify_decode_sig(sv, hm, es, sig_len, sig_type, logn, ct,
+                hash_data, atmp);
+        if (r != 0) {
+                return r;
+        }
 
         /*
          * Verify signature.
          */
-        if (!Zf(verify_raw)( (int16_t *) hm, sv, (int16_t *) h, (int16_t *) atmp)) {
+        FALCON_TRACE_ENTER();
+        r = Zf(verify_raw)( (int16_t *) hm, sv, (int16_t *) h, (int16_t *) atmp);
+        FALCON_TRACE_LEAVE(TRACE_VERIFY_RAW);
+        FALCON_TRACE_LEAVE(TRACE_VERIFY);
+        if (!r) {
                 return FALCON_ERR_BADSIG;
         }
         return 0;
@@ -923,3 +1455,386 @@ falcon_verify(const void *sig, size_t sig_len, int sig_type,
         return falcon_verify_finish(sig, sig_len, sig_type,
                 pubkey, pubkey_len, &hd, tmp, tmp_len);
 }
+
+/*
+ * Offset (in bytes) of the NTT polynomial within a prepared public key.
+ */
+#define PREPARED_PUBKEY_OFF   64
+
+/* see falcon.h */
+int
+falcon_pubkey_prepare(void *prepared_key, size_t prepared_key_len,
+        const void *pubkey, size_t pubkey_len)
+{
+        unsigned logn;
+        const uint8_t *pk;
+        uint8_t *ppk;
+        uint16_t *h;
+
+        if (pubkey_len == 0) {
+                return FALCON_ERR_FORMAT;
+        }
+        pk = pubkey;
+        if ((pk[0] & 0xF0) != 0x00) {
+                return FALCON_ERR_FORMAT;
+        }
+        logn = pk[0] & 0x0F;
+        if (logn < 1 || logn > 10) {
+                return FALCON_ERR_FORMAT;
+        }
+        if (pubkey_len != FALCON_PUBKEY_SIZE(logn)) {
+                return FALCON_ERR_FORMAT;
+        }
+        if (prepared_key_len < FALCON_PREPARED_PUBKEY_SIZE(logn)) {
+                return FALCON_ERR_SIZE;
+        }
+        if (((uintptr_t)prepared_key & 1u) != 0) {
+                return FALCON_ERR_BADARG;
+        }
+
+        /*
+         * Decode the public key directly into its final place, then
+         * convert it in place to NTT representation.
+         */
+        ppk = prepared_key;
+        h = (uint16_t *)(ppk + PREPARED_PUBKEY_OFF);
+        if (Zf(modq_decode)(h, pk + 1, pubkey_len - 1, logn)
+                != pubkey_len - 1)
+        {
+                return FALCON_ERR_FORMAT;
+        }
+        Zf(to_ntt)((int16_t *)h);
+        memset(ppk, 0, PREPARED_PUBKEY_OFF);
+        ppk[0] = (uint8_t)logn;
+        return 0;
+}
+
+/* see falcon.h */
+int
+falcon_verify_prepared_finish(const void *sig, size_t sig_len,
+        int sig_type, const void *prepared_key,
+        shake256_context *hash_data,
+        void *tmp, size_t tmp_len)
+{
+        unsigned logn;
+        uint8_t *atmp;
+        const uint8_t *ppk, *es;
+        size_t n;
+        const int16_t *h;
+        uint16_t *hm;
+        int16_t *sv;
+        int ct, r;
+
+        if (sig_len < 41) {
+                return FALCON_ERR_FORMAT;
+        }
+        es = sig;
+        ppk = prepared_key;
+        logn = ppk[0];
+        if (logn < 1 || logn > 10) {
+                return FALCON_ERR_FORMAT;
+        }
+        r = verify_check_sig(es, sig_len, sig_type, logn, &ct);
+        if (r != 0) {
+                return r;
+        }
+        if (tmp_len < FALCON_TMPSIZE_VERIFY_PREPARED(logn)) {
+                return FALCON_ERR_SIZE;
+        }
+
+        n = (size_t)1 << logn;
+        h = (const int16_t *)(ppk + PREPARED_PUBKEY_OFF);
+        hm = (uint16_t *)align_u16(tmp);
+        sv = (int16_t *)(hm + n);
+        atmp = (uint8_t *)(sv + n);
+
+        r = verify_decode_sig(sv, hm, es, sig_len, sig_type, logn, ct,
+                hash_data, atmp);
+        if (r != 0) {
+                return r;
+        }
+
+        if (!Zf(verify_raw_ntt)((int16_t *)hm, sv, h, (int16_t *)atmp)) {
+                return FALCON_ERR_BADSIG;
+        }
+        return 0;
+}
+
+/* see falcon.h */
+int
+falcon_verify_prepared(const void *sig, size_t sig_len, int sig_type,
+        const void *prepared_key,
+        const void *data, size_t data_len,
+        void *tmp, size_t tmp_len)
+{
+        shake256_context hd;
+        int r;
+
+        r = falcon_verify_start(&hd, sig, sig_len);
+        if (r < 0) {
+                return r;
+        }
+        shake256_inject(&hd, data, data_len);
+        return falcon_verify_prepared_finish(sig, sig_len, sig_type,
+                prepared_key, &hd, tmp, tmp_len);
+}
+
+/*
+ * Decode one item of a batch verification: the public key goes into
+ * h[] and the signature value into sv[]; the message is absorbed into
+ * hd, which is left flipped and ready for hash-to-point. *ct is set to
+ * 1 for a constant-time signature.
+ */
+static int
+verify_batch_decode(uint16_t *h, int16_t *sv, shake256_context *hd, int *ct,
+        unsigned logn, const void *sig, size_t sig_len, int sig_type,
+        const void *pubkey, size_t pubkey_len,
+        const void *data, size_t data_len)
+{
+        const uint8_t *pk, *es;
+        int r;
+
+        if (sig_len < 41 || pubkey_len != FALCON_PUBKEY_SIZE(logn)) {
+                return FALCON_ERR_FORMAT;
+        }
+        es = sig;
+        pk = pubkey;
+        if (pk[0] != logn) {
+                return FALCON_ERR_FORMAT;
+        }
+        r = verify_check_sig(es, sig_len, sig_type, logn, ct);
+        if (r != 0) {
+                return r;
+        }
+        if (Zf(modq_decode)(h, pk + 1, pubkey_len - 1, logn)
+                != pubkey_len - 1)
+        {
+                return FALCON_ERR_FORMAT;
+        }
+        r = verify_decode_value(sv, es, sig_len, sig_type, logn, *ct);
+        if (r != 0) {
+                return r;
+        }
+        r = falcon_verify_start(hd, sig, sig_len);
+        if (r < 0) {
+                return r;
+        }
+        shake256_inject(hd, data, data_len);
+        shake256_flip(hd);
+        return 0;
+}
+
+/* see falcon.h */
+int
+falcon_verify_batch(unsigned logn, uint8_t *results, size_t count,
+        const void *const *sig, const size_t *sig_len, int sig_type,
+        const void *const *pubkey, const size_t *pubkey_len,
+        const void *const *data, const size_t *data_len,
+        void *tmp, size_t tmp_len)
+{
+        int16_t *h[FALCON_VERIFY_BATCH_LANES];
+        int16_t *hm[FALCON_VERIFY_BATCH_LANES];
+        const int16_t *sv[FALCON_VERIFY_BATCH_LANES];
+        shake256_context hd[FALCON_VERIFY_BATCH_LANES];
+        int ct[FALCON_VERIFY_BATCH_LANES];
+        size_t idx[FALCON_VERIFY_BATCH_LANES];
+        int16_t *base, *tt;
+        size_t n, u;
+        unsigned k, j, pending;
+        uint32_t ok;
+        int num;
+
+        if (logn < 1 || logn > 10) {
+                return FALCON_ERR_BADARG;
+        }
+        if (sig_type < 0 || sig_type > FALCON_SIG_CT) {
+                return FALCON_ERR_BADARG;
+        }
+        if (tmp_len < FALCON_TMPSIZE_VERIFY_BATCH(logn)) {
+                return FALCON_ERR_SIZE;
+        }
+
+        /*
+         * Buffers are laid out per kind (all h, then all hm, then all
+         * sv, then all tt); tt[] gives each lane its own scratch area
+         * for the constant-time hash-to-point.
+         */
+        n = (size_t)1 << logn;
+        base = (int16_t *)align_u16(tmp);
+        tt = base + 3 * FALCON_VERIFY_BATCH_LANES * n;
+        memset(results, 0, (count + 7) >> 3);
+        num = 0;
+        u = 0;
+        while (u < count) {
+                /*
+                 * Fill a group with items that decode correctly;
+                 * malformed items are just left marked as invalid.
+                 */
+                k = 0;
+                while (k < FALCON_VERIFY_BATCH_LANES && u < count) {
+                        int16_t *lh, *lsv;
+
+                        lh = base + k * n;
+                        lsv = lh + 2 * FALCON_VERIFY_BATCH_LANES * n;
+                        if (verify_batch_decode((uint16_t *)lh, lsv,
+                                &hd[k], &ct[k], logn,
+                                sig[u], sig_len[u], sig_type,
+                                pubkey[u], pubkey_len[u],
+                                data[u], data_len[u]) == 0)
+                        {
+                                h[k] = lh;
+                                hm[k] = lh + FALCON_VERIFY_BATCH_LANES * n;
+                                sv[k] = lsv;
+                                idx[k] = u;
+                                k ++;
+                        }
+                        u ++;
+                }
+                if (k == 0) {
+                        break;
+                }
+
+                /*
+                 * Hash messages to points. Variable-time lanes are
+                 * paired and squeezed two at a time.
+                 */
+                pending = k;
+                for (j = 0; j < k; j ++) {
+                        if (ct[j]) {
+                                Zf(hash_to_point_ct)(
+                                        (inner_shake256_context *)&hd[j],
+                                        (uint16_t *)hm[j], logn,
+                                        (uint8_t *)(tt + j * n));
+                        } else if (pending == k) {
+                                pending = j;
+                        } else {
+                                Zf(hash_to_point_x2)(
+                                        (inner_shake256_context *)&hd[pending],
+                                        (inner_shake256_context *)&hd[j],
+                                        (uint16_t *)hm[pending],
+                                        (uint16_t *)hm[j], logn);
+                                pending = k;
+                        }
+                }
+                if (pending != k) {
+                        Zf(hash_to_point_vartime)(
+                                (inner_shake256_context *)&hd[pending],
+                                (uint16_t *)hm[pending], logn);
+                }
+
+                ok = Zf(verify_raw_batch)(hm, sv, h, tt, k);
+                for (j = 0; j < k; j ++) {
+                        if ((ok >> j) & 1) {
+                                results[idx[j] >> 3] |=
+                                        (uint8_t)(1u << (idx[j] & 7));
+                                num ++;
+                        }
+                }
+        }
+        return num;
+}
+
+/* see falcon.h */
+int
+falcon_stats_get(falcon_stats *st)
+{
+#if FALCON_STATS
+        st->sign_calls = Zf(stats).sign_calls;
+        st->sign_restarts = Zf(stats).sign_restarts;
+        st->sampler_calls = Zf(stats).sampler_calls;
+        st->sampler_iterations = Zf(stats).sampler_iterations;
+        st->prng_refills = Zf(stats).prng_refills;
+        st->prng_bytes = Zf(stats).prng_bytes;
+        st->comp_overflows = Zf(stats).comp_overflows;
+        return 1;
+#else
+        memset(st, 0, sizeof *st);
+        return 0;
+#endif
+}
+
+/* see falcon.h */
+void
+falcon_stats_reset(void)
+{
+#if FALCON_STATS
+        memset(&Zf(stats), 0, sizeof Zf(stats));
+#endif
+}
+
+/*
+ * Names of the traced phases, indexed by TRACE_* identifier (inner.h).
+ */
+static const char *const trace_phase_names[TRACE_NUM_PHASES] = {
+        "sign_dyn",
+        "sign_dyn;key_decode",
+        "sign_dyn;hash_to_point",
+        "sign_dyn;basis_fft",
+        "sign_dyn;gram",
+        "sign_dyn;target",
+        "sign_dyn;ffsampling",
+        "sign_dyn;basis_rebuild",
+        "sign_dyn;lattice_point",
+        "sign_dyn;ifft",
+        "sign_dyn;norm_check",
+        "sign_dyn;encode",
+        "sign_tree",
+        "sign_tree;hash_to_point",
+        "sign_tree;target",
+        "sign_tree;ffsampling",
+        "sign_tree;lattice_point",
+        "sign_tree;ifft",
+        "sign_tree;norm_check",
+        "sign_tree;encode",
+        "verify",
+        "verify;pubkey_decode",
+        "verify;sig_decode",
+        "verify;hash_to_point",
+        "verify;verify_raw",
+        "sign_semi",
+        "sign_semi;hash_to_point",
+        "sign_semi;gram",
+        "sign_semi;target",
+        "sign_semi;ffsampling",
+        "sign_semi;lattice_point",
+        "sign_semi;ifft",
+        "sign_semi;norm_check",
+        "sign_semi;encode"
+};
+
+/* see falcon.h */
+size_t
+falcon_trace_read(falcon_trace_event *ev, size_t max)
+{
+#if FALCON_TRACE
+        trace_context *tc;
+        size_t u, num, off;
+
+        tc = &Zf(trace);
+        num = tc->count < max ? tc->count : max;
+        off = (tc->head + FALCON_TRACE_SIZE - tc->count) % FALCON_TRACE_SIZE;
+        for (u = 0; u < num; u ++) {
+                const trace_event *te;
+
+                te = &tc->ev[(off + u) % FALCON_TRACE_SIZE];
+                ev[u].phase = te->phase;
+                ev[u].ticks = te->ticks;
+        }
+        tc->count -= num;
+        return num;
+#else
+        (void)ev;
+        (void)max;
+        return 0;
+#endif
+}
+
+/* see falcon.h */
+const char *
+falcon_trace_phase_name(unsigned phase)
+{
+        if (phase >= TRACE_NUM_PHASES) {
+                return NULL;
+        }
+        return trace_phase_names[phase];
+}
@@ -252,6 +252,11 @@ extern "C" {
  */
 #define FALCON_ERR_INTERNAL   -6
 
+/*
+ * FALCON_ERR_IO is returned when reading or writing a file fails.
+ */
+#define FALCON_ERR_IO         -7
+
 /* ==================================================================== */
 /*
  * Signature formats.
@@ -349,6 +354,21 @@ extern "C" {
 #define FALCON_TMPSIZE_KEYGEN(logn) \
         (((logn) <= 3 ? 272u : (28u << (logn))) + (3u << (logn)) + 7)
 
+/*
+ * Temporary buffer size for multi-threaded key pair generation with
+ * nthreads threads (see falcon_keygen_make_mt()).
+ */
+#define FALCON_TMPSIZE_KEYGEN_MT(logn, nthreads) \
+        (FALCON_TMPSIZE_KEYGEN(logn) + (size_t)(nthreads) * (20u << (logn)) + 3)
+
+/*
+ * Temporary buffer size for bulk key pair generation with nthreads
+ * threads (see falcon_keygen_many()).
+ */
+#define FALCON_TMPSIZE_KEYGEN_MANY(logn, nthreads) \
+        ((size_t)(nthreads) * (((logn) <= 3 ? 352u : (38u << (logn))) + 512u) \
+        + FALCON_PRIVKEY_SIZE(logn) + FALCON_PUBKEY_SIZE(logn) + 7)
+
 /*
  * Temporary buffer size for computing the pubic key from the private key.
  */
@@ -380,12 +400,96 @@ extern "C" {
 #define FALCON_EXPANDEDKEY_SIZE(logn) \
         (((8u * (logn) + 40) << (logn)) + 8)
 
+/*
+ * Size of a compact expanded private key (see
+ * falcon_expand_privkey_compact()).
+ */
+#define FALCON_EXPANDEDKEY_COMPACT_SIZE(logn) \
+        (((8u * (logn) + 12) << (logn)) + 8)
+
+/*
+ * Size of an expanded private key with the 64-byte aligned layout (see
+ * falcon_expand_privkey_aligned()).
+ */
+#define FALCON_EXPANDEDKEY_ALIGNED_SIZE(logn) \
+        (FALCON_EXPANDEDKEY_SIZE(logn) + 56)
+
+/*
+ * Size of a semi-expanded private key, without or with the Gram matrix
+ * (see falcon_expand_privkey_semi() and falcon_expand_privkey_semi_gram()).
+ */
+#define FALCON_EXPANDEDKEY_SEMI_SIZE(logn) \
+        ((32u << (logn)) + 8)
+#define FALCON_EXPANDEDKEY_SEMI_GRAM_SIZE(logn) \
+        ((56u << (logn)) + 8)
+
 /*
  * Temporary buffer size for verifying a signature.
  */
 #define FALCON_TMPSIZE_VERIFY(logn) \
         ((8u << (logn)) + 1)
 
+/*
+ * With a temporary buffer of at least these sizes, falcon_sign_tree()
+ * and falcon_verify() (and their streamed variants) place their
+ * temporary values on 64-byte boundaries.
+ */
+#define FALCON_TMPSIZE_SIGNTREE_ALIGNED(logn) \
+        (FALCON_TMPSIZE_SIGNTREE(logn) + 64)
+#define FALCON_TMPSIZE_VERIFY_ALIGNED(logn) \
+        (FALCON_TMPSIZE_VERIFY(logn) + 64)
+
+/*
+ * Memory used by each entry of an expanded-key cache (see
+ * falcon_keycache_new()): the expanded key, a copy of the private key
+ * and bookkeeping.
+ */
+#define FALCON_KEYCACHE_ENTRY_SIZE(logn) \
+        (FALCON_EXPANDEDKEY_SIZE(logn) + FALCON_PRIVKEY_SIZE(logn) + 64u)
+
+/*
+ * Temporary buffer size for signing through an expanded-key cache
+ * (see falcon_keycache_sign()).
+ */
+#define FALCON_TMPSIZE_KEYCACHE(logn) \
+        FALCON_TMPSIZE_SIGNDYN(logn)
+
+/*
+ * Temporary buffer size for writing an expanded-key store (see
+ * falcon_expkey_store_write()).
+ */
+#define FALCON_TMPSIZE_EXPKEY_STORE(logn) \
+        (FALCON_EXPANDEDKEY_SIZE(logn) + FALCON_TMPSIZE_EXPANDPRIV(logn) + 8)
+
+/*
+ * Size of a prepared public key (see falcon_pubkey_prepare()).
+ */
+#define FALCON_PREPARED_PUBKEY_SIZE(logn) \
+        ((2u << (logn)) + 64)
+
+/*
+ * Temporary buffer size for verifying a signature against a prepared
+ * public key.
+ */
+#define FALCON_TMPSIZE_VERIFY_PREPARED(logn) \
+        ((6u << (logn)) + 1)
+
+/*
+ * Number of signatures that falcon_verify_batch() decodes and hashes
+ * as one group. The lattice check of each signature in a group is
+ * still run on its own.
+ */
+#define FALCON_VERIFY_BATCH_LANES   4
+
+/*
+ * Temporary buffer size for falcon_verify_batch(): room for the
+ * decoded key, hashed message, signature and hash-to-point scratch of
+ * each signature in a group. It does not depend on the number of
+ * signatures in the batch.
+ */
+#define FALCON_TMPSIZE_VERIFY_BATCH(logn) \
+        (((8u * FALCON_VERIFY_BATCH_LANES) << (logn)) + 1)
+
 /* ==================================================================== */
 /*
  * SHAKE256.
@@ -498,6 +602,127 @@ int falcon_keygen_make(
         void *pubkey, size_t pubkey_len,
         void *tmp, size_t tmp_len);
 
+/*
+ * Generate a new keypair, using nthreads threads (the calling thread
+ * being one of them) for the NTRU equation solving. The per-prime
+ * modular computations and the CRT reconstructions are split between
+ * the threads; for a given state of *rng, the generated key pair is
+ * exactly the one falcon_keygen_make() would produce, whatever the
+ * value of nthreads.
+ *
+ * Threads are started when the function is called and stopped before it
+ * returns; to generate several key pairs, a pool (see
+ * falcon_keygen_pool_new()) avoids that cost on every call. At most 64
+ * threads are used; if threads cannot be created (or the library was
+ * compiled with FALCON_KG_THREADS=0), the key pair is generated on the
+ * calling thread only.
+ *
+ * The tmp[] buffer size tmp_len MUST be at least
+ * FALCON_TMPSIZE_KEYGEN_MT(logn, nthreads) bytes. nthreads must not be 0.
+ * Other parameters and the returned value are as in falcon_keygen_make().
+ */
+int falcon_keygen_make_mt(
+        shake256_context *rng,
+        unsigned logn,
+        void *privkey, size_t privkey_len,
+        void *pubkey, size_t pubkey_len,
+        void *tmp, size_t tmp_len,
+        unsigned nthreads);
+
+/*
+ * Key generation worker pool: nthreads-1 threads (the thread calling
+ * falcon_keygen_make_pool() being the other one) and their scratch
+ * areas, kept from falcon_keygen_pool_new() to falcon_keygen_pool_free()
+ * and reused by every key pair generated with the pool. A pool may be
+ * used by only one thread at a time.
+ */
+
+typedef struct falcon_keygen_pool_ falcon_keygen_pool;
+
+/*
+ * Create a pool for key pairs of degree up to 2^logn, with nthreads
+ * threads (at most 64, the calling thread included). If extra threads
+ * cannot be created (or the library was compiled with
+ * FALCON_KG_THREADS=0), the pool is still returned and key pairs are
+ * generated on the calling thread only.
+ *
+ * Returned value: the new pool, or NULL if logn is not supported, if
+ * nthreads is 0, or on allocation failure.
+ */
+falcon_keygen_pool *falcon_keygen_pool_new(unsigned logn, unsigned nthreads);
+
+/*
+ * Release a pool and stop its threads. No other call on the pool may be
+ * in progress.
+ */
+void falcon_keygen_pool_free(falcon_keygen_pool *pool);
+
+/*
+ * Generate a new keypair with the threads of a pool. For a given state
+ * of *rng, the key pair is the one falcon_keygen_make() would produce.
+ * logn must not exceed the degree of the pool (FALCON_ERR_BADARG).
+ *
+ * The tmp[] buffer size tmp_len MUST be at least
+ * FALCON_TMPSIZE_KEYGEN(logn) bytes (per-thread areas belong to the
+ * pool). Other parameters and the returned value are as in
+ * falcon_keygen_make().
+ */
+int falcon_keygen_make_pool(
+        falcon_keygen_pool *pool,
+        shake256_context *rng,
+        unsigned logn,
+        void *privkey, size_t privkey_len,
+        void *pubkey, size_t pubkey_len,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Callback for falcon_keygen_many(): receives key pair number 'index'
+ * (from 0 to count-1), encoded as with falcon_keygen_make(). The
+ * buffers are only valid for the duration of the call. Returning a
+ * nonzero value stops the generation; positive values should be used,
+ * so as not to be confused with error codes.
+ */
+typedef int (*falcon_keygen_callback)(void *cb_ctx, size_t index,
+        const void *privkey, size_t privkey_len,
+        const void *pubkey, size_t pubkey_len);
+
+/*
+ * Generate 'count' key pairs, for provisioning many keys at once. Key
+ * pairs are passed to cb() as soon as they are ready; calls to cb() are
+ * serialized (never concurrent) but key pairs may arrive out of index
+ * order.
+ *
+ * Key pair i is the one falcon_keygen_make() returns for an RNG
+ * initialized with shake256_init_prng_from_seed() over the i-th 48-byte
+ * seed extracted from *rng; thus, the output does not depend on nthreads.
+ * With nthreads > 1, the calling thread and nthreads-1 extra threads (at
+ * most 64 in total) generate keys concurrently: (f,g) candidates are
+ * sampled and filtered (norm and invertibility checks, public key
+ * computation) ahead of the NTRU solver, and surviving candidates are
+ * queued to whichever thread becomes available for solving. If threads
+ * cannot be created, keys are generated on the calling thread only.
+ *
+ * On each thread, keys are taken two at a time when possible: their
+ * candidates are sampled side by side in SIMD lanes (SHAKE256 and the
+ * Gaussian sampler), the norm of (g,-f) being accumulated on the fly.
+ * The orthogonalized norm, the public key and the NTRU solver still run
+ * one key at a time, so most of the speedup comes from the threads.
+ *
+ * The tmp[] buffer size tmp_len MUST be at least
+ * FALCON_TMPSIZE_KEYGEN_MANY(logn, nthreads) bytes. nthreads must not
+ * be 0.
+ *
+ * Returned value: 0 on success, the first nonzero value returned by
+ * cb(), or a negative error code.
+ */
+int falcon_keygen_many(
+        shake256_context *rng,
+        unsigned logn,
+        size_t count,
+        unsigned nthreads,
+        falcon_keygen_callback cb, void *cb_ctx,
+        void *tmp, size_t tmp_len);
+
 /*
  * Recompute the public key from the private key.
  *
@@ -623,6 +848,127 @@ int falcon_sign_tree(shake256_context *rng,
         const void *data, size_t data_len,
         void *tmp, size_t tmp_len);
 
+/*
+ * Expand a private key into the compact layout. This is the same as
+ * falcon_expand_privkey(), except that the output has size
+ * FALCON_EXPANDEDKEY_COMPACT_SIZE(logn) bytes instead of
+ * FALCON_EXPANDEDKEY_SIZE(logn): it keeps the LDL tree, but not the
+ * B0 matrix in FFT representation; only the small polynomials f, g, F
+ * and G are kept (one byte per coefficient), and the B0 matrix is
+ * recomputed by each signature generation. This saves 28 bytes per
+ * coefficient (about 25% of the expanded key), for a few extra FFTs
+ * per signature.
+ *
+ * A compact expanded key can be used only with
+ * falcon_sign_tree_compact() and falcon_sign_tree_compact_finish();
+ * the alignment rules are the same as for expanded keys.
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_EXPANDPRIV(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_expand_privkey_compact(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Expand a private key with the 64-byte aligned layout. This is the
+ * same as falcon_expand_privkey(), except that the floating-point
+ * values in the expanded key start on the first 64-byte boundary after
+ * the header byte, so that vector loads never straddle cache lines;
+ * in particular, if expanded_key[] is 64-byte aligned, the header byte
+ * is followed by 63 bytes of padding. The expanded_key[] buffer must
+ * have size at least FALCON_EXPANDEDKEY_ALIGNED_SIZE(logn) bytes. The
+ * expanded key is used with falcon_sign_tree(), as usual; it may be
+ * moved in RAM only if its address modulo 64 is unchanged.
+ *
+ * For the same private key and rng state, signatures are identical
+ * with both layouts. A temporary buffer of at least
+ * FALCON_TMPSIZE_SIGNTREE_ALIGNED(logn) bytes (instead of
+ * FALCON_TMPSIZE_SIGNTREE(logn)) also aligns the temporary values.
+ *
+ * The speed gain of this layout is UNMEASURED on AArch64 hardware (it
+ * was only run under emulation, where it is within noise); the speed
+ * program prints a comparison table (st/st64, vv/vv64) to check it on
+ * the target core before relying on it.
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_EXPANDPRIV(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_expand_privkey_aligned(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Sign data with a compact expanded key (as generated by
+ * falcon_expand_privkey_compact()). Parameters are the same as for
+ * falcon_sign_tree(). For the same private key and the same rng
+ * state, the signature is identical to the one that
+ * falcon_sign_tree() computes with the full expanded key.
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_SIGNTREE(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_sign_tree_compact(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        const void *data, size_t data_len,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Expand a private key into the semi-expanded layout. This is an
+ * intermediate between falcon_sign_dyn() and falcon_sign_tree(): the
+ * output keeps the B0 matrix in FFT representation (as in a full
+ * expanded key), but not the LDL tree, which is recomputed by each
+ * signature generation. Compared with falcon_sign_dyn(), this saves
+ * the eight FFTs that rebuild the B0 matrix (twice) for each
+ * signature; the expanded_key[] buffer must have size at least
+ * FALCON_EXPANDEDKEY_SEMI_SIZE(logn) bytes, i.e. 32 bytes per
+ * coefficient instead of 8*logn+40 for a full expanded key.
+ *
+ * falcon_expand_privkey_semi_gram() also stores the Gram matrix of
+ * B0 (three more polynomials, FALCON_EXPANDEDKEY_SEMI_GRAM_SIZE(logn)
+ * bytes), which saves its computation for each signature.
+ *
+ * A semi-expanded key can be used only with falcon_sign_semi() and
+ * falcon_sign_semi_finish(); the alignment rules are the same as for
+ * expanded keys.
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_EXPANDPRIV(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_expand_privkey_semi(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len);
+int falcon_expand_privkey_semi_gram(void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Sign data with a semi-expanded key (as generated by
+ * falcon_expand_privkey_semi() or falcon_expand_privkey_semi_gram()).
+ * Parameters are the same as for falcon_sign_tree(). For the same
+ * private key and the same rng state, the signature is identical to
+ * the one that falcon_sign_dyn() computes.
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_SIGNDYN(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_sign_semi(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        const void *data, size_t data_len,
+        void *tmp, size_t tmp_len);
+
 /* ==================================================================== */
 /*
  * Signature generation, streamed API.
@@ -735,6 +1081,37 @@ int falcon_sign_tree_finish(shake256_context *rng,
         shake256_context *hash_data, const void *nonce,
         void *tmp, size_t tmp_len);
 
+/*
+ * Same as falcon_sign_tree_finish(), with a compact expanded key (as
+ * generated by falcon_expand_privkey_compact()).
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_SIGNTREE(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_sign_tree_compact_finish(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        shake256_context *hash_data, const void *nonce,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Same as falcon_sign_tree_finish(), with a semi-expanded key (as
+ * generated by falcon_expand_privkey_semi() or
+ * falcon_expand_privkey_semi_gram()).
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_SIGNDYN(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_sign_semi_finish(shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        shake256_context *hash_data, const void *nonce,
+        void *tmp, size_t tmp_len);
+
 /* ==================================================================== */
 /*
  * Signature verification.
@@ -802,6 +1179,464 @@ int falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
         shake256_context *hash_data,
         void *tmp, size_t tmp_len);
 
+/*
+ * Prepare a public key for repeated verification.
+ *
+ * The encoded public key pubkey[] (of length pubkey_len bytes) is
+ * decoded once, and its NTT representation is written into the
+ * prepared_key[] buffer, of size prepared_key_len bytes (at least
+ * FALCON_PREPARED_PUBKEY_SIZE(logn)). A prepared key can then be
+ * used with falcon_verify_prepared() and falcon_verify_prepared_finish()
+ * any number of times; each verification saves the public key decoding
+ * and one forward NTT, compared with falcon_verify().
+ *
+ * Layout of a prepared key (offsets in bytes from prepared_key):
+ *
+ *   0        header byte: logn (1 to 10)
+ *   1..63    reserved, set to zero
+ *   64       2^logn signed 16-bit values (native byte order): the
+ *            public key h in NTT representation, in the internal
+ *            coefficient order of the NTT implementation
+ *
+ * The header occupies a full 64-byte block so that the polynomial
+ * starts on a cache-line boundary whenever the buffer itself does.
+ * FALCON_PREPARED_PUBKEY_SIZE(logn) is a multiple of 64 for logn >= 5,
+ * so a table of prepared keys allocated at a 64-byte aligned address
+ * keeps all its entries cache-line aligned. The buffer MUST be at
+ * least 2-byte aligned (FALCON_ERR_BADARG is returned otherwise), and
+ * must not be moved to an address with a different alignment modulo 2.
+ *
+ * Like expanded private keys, prepared keys are not portable: they
+ * must be recomputed from the encoded public key on every platform.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_pubkey_prepare(void *prepared_key, size_t prepared_key_len,
+        const void *pubkey, size_t pubkey_len);
+
+/*
+ * Verify the signature sig[] (of length sig_len bytes) with regards to
+ * the provided prepared public key (obtained with falcon_pubkey_prepare())
+ * and the message data[] (of length data_len bytes). This function
+ * is otherwise identical to falcon_verify().
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_VERIFY_PREPARED(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_verify_prepared(const void *sig, size_t sig_len, int sig_type,
+        const void *prepared_key,
+        const void *data, size_t data_len,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Finish a streamed signature verification against a prepared public
+ * key. The SHAKE256 context *hash_data must have been initialized with
+ * falcon_verify_start() and must have received the message; this
+ * function is otherwise identical to falcon_verify_finish().
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_VERIFY_PREPARED(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_verify_prepared_finish(const void *sig, size_t sig_len,
+        int sig_type, const void *prepared_key,
+        shake256_context *hash_data,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Verify a batch of count signatures. Item i consists of the signature
+ * sig[i] (of length sig_len[i] bytes), the encoded public key pubkey[i]
+ * (of length pubkey_len[i] bytes) and the signed data data[i] (of
+ * length data_len[i] bytes). All items MUST use the degree 2^logn; an
+ * item whose key or signature is for another degree is reported as
+ * invalid. The sig_type parameter is applied to all signatures, with
+ * the same meaning as in falcon_verify().
+ *
+ * Signatures are processed by groups of FALCON_VERIFY_BATCH_LANES:
+ * all items of a group are decoded and hashed first (variable-time
+ * hashes two at a time, with the two-way SHAKE256), then the lattice
+ * check of each item is run in turn; the NTT and pointwise kernels are
+ * the single-signature ones. Results are identical to calling
+ * falcon_verify() on each item.
+ *
+ * The per-item outcome is written in the results[] bitmap, which must
+ * have room for (count + 7) / 8 bytes: bit (i & 7) of results[i >> 3]
+ * is set to 1 if item i is a valid signature, 0 otherwise (whether
+ * the signature is incorrect or an element could not be decoded).
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_VERIFY_BATCH(logn) bytes.
+ *
+ * Returned value: the number of valid signatures (0 to count), or a
+ * negative error code if a parameter is invalid (unsupported logn or
+ * sig_type, or tmp[] too small); in the latter case results[] is left
+ * untouched.
+ */
+int falcon_verify_batch(unsigned logn, uint8_t *results, size_t count,
+        const void *const *sig, const size_t *sig_len, int sig_type,
+        const void *const *pubkey, const size_t *pubkey_len,
+        const void *const *data, const size_t *data_len,
+        void *tmp, size_t tmp_len);
+
+/* ==================================================================== */
+/*
+ * Operation contexts.
+ *
+ * A context owns everything that an operation needs besides its inputs
+ * and outputs: a SHAKE256 random source (seeded from the OS at
+ * creation), a SHAKE256 context for message hashing, and a temporary
+ * buffer, allocated once, 64-byte aligned and large enough for all
+ * operations at the context degree. The falcon_ctx_*() functions
+ * below are the same as the functions of the same name without the
+ * "ctx_" part (with the context random source as rng and the context
+ * buffer as tmp[]), and never allocate memory.
+ *
+ * A context may be used by only one thread at a time; a typical use is
+ * one context per thread, reused for all operations of that thread.
+ */
+
+typedef struct falcon_ctx_ falcon_ctx;
+
+/*
+ * Create a context for degree 2^logn.
+ *
+ * Returned value: the new context, or NULL if logn is not supported,
+ * if the OS random source fails, or on allocation failure.
+ */
+falcon_ctx *falcon_ctx_new(unsigned logn);
+
+/*
+ * Release a context (its temporary buffer and SHAKE256 states are
+ * cleared first).
+ */
+void falcon_ctx_free(falcon_ctx *ctx);
+
+/*
+ * Reseed the random source of a context from an explicit seed (see
+ * shake256_init_prng_from_seed()), e.g. for reproducible tests.
+ */
+void falcon_ctx_seed(falcon_ctx *ctx, const void *seed, size_t seed_len);
+
+int falcon_ctx_keygen(falcon_ctx *ctx,
+        void *privkey, size_t privkey_len,
+        void *pubkey, size_t pubkey_len);
+
+int falcon_ctx_make_public(falcon_ctx *ctx,
+        void *pubkey, size_t pubkey_len,
+        const void *privkey, size_t privkey_len);
+
+int falcon_ctx_expand_privkey(falcon_ctx *ctx,
+        void *expanded_key, size_t expanded_key_len,
+        const void *privkey, size_t privkey_len);
+
+int falcon_ctx_sign_dyn(falcon_ctx *ctx,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *privkey, size_t privkey_len,
+        const void *data, size_t data_len);
+
+int falcon_ctx_sign_tree(falcon_ctx *ctx,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *expanded_key,
+        const void *data, size_t data_len);
+
+int falcon_ctx_verify(falcon_ctx *ctx,
+        const void *sig, size_t sig_len, int sig_type,
+        const void *pubkey, size_t pubkey_len,
+        const void *data, size_t data_len);
+
+/* ==================================================================== */
+/*
+ * Expanded-key cache.
+ *
+ * falcon_sign_tree() is much faster than falcon_sign_dyn(), but needs
+ * an expanded key, which is large (FALCON_EXPANDEDKEY_SIZE(logn) bytes)
+ * and costs about as much to compute as a few signatures. A signer that
+ * handles many private keys can use a cache that keeps the expanded keys
+ * of the recently used private keys within a memory budget, and signs
+ * with falcon_sign_tree() when the key is in the cache, and with
+ * falcon_sign_dyn() otherwise.
+ *
+ * Cached keys are identified by a SHAKE256 hash of the private key. The
+ * cache is set-associative (8 entries per set) with CLOCK eviction:
+ * each use of an entry marks it, and an entry is replaced only after
+ * the clock hand has gone past it once unmarked. Entries in use by a
+ * signature are never replaced.
+ *
+ * falcon_keycache_sign() may be called from several threads at once.
+ * When the key is cached, the call takes no lock (an atomic pin of the
+ * entry, then falcon_sign_tree()). On a miss, an entry is reserved for
+ * the key under a lock; the key is then expanded by a background
+ * thread and the signature is computed with falcon_sign_dyn() in the
+ * meantime. With no background thread (nworkers == 0, or if the library
+ * was compiled with FALCON_KC_THREADS=0), the key is expanded by the
+ * calling thread, which then signs with it.
+ */
+
+typedef struct falcon_keycache_ falcon_keycache;
+
+/*
+ * Cache counters (see falcon_keycache_get_stats()).
+ */
+typedef struct {
+        uint64_t hits;          /* signatures with a cached expanded key */
+        uint64_t misses;        /* key not (yet) in the cache */
+        uint64_t expansions;    /* keys expanded into the cache */
+        uint64_t evictions;     /* expanded keys replaced by other keys */
+} falcon_keycache_stats;
+
+/*
+ * Create a cache for private keys of degree 2^logn. The cache holds
+ * max_bytes / FALCON_KEYCACHE_ENTRY_SIZE(logn) entries; nworkers
+ * background threads expand keys after misses (0 for synchronous
+ * expansion).
+ *
+ * Returned value: the new cache, or NULL if logn is not supported, if
+ * max_bytes is too small for a single entry, or on allocation failure.
+ */
+falcon_keycache *falcon_keycache_new(unsigned logn,
+        size_t max_bytes, unsigned nworkers);
+
+/*
+ * Release a cache and stop its background threads. No other call on
+ * the cache may be in progress.
+ */
+void falcon_keycache_free(falcon_keycache *kc);
+
+/*
+ * Sign data[] with the private key privkey[], as falcon_sign_dyn()
+ * would, using (and filling) the expanded-key cache. The private key
+ * must have the degree of the cache. Other parameters are as in
+ * falcon_sign_dyn(); the tmp[] buffer size tmp_len MUST be at least
+ * FALCON_TMPSIZE_KEYCACHE(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code.
+ */
+int falcon_keycache_sign(falcon_keycache *kc, shake256_context *rng,
+        void *sig, size_t *sig_len, int sig_type,
+        const void *privkey, size_t privkey_len,
+        const void *data, size_t data_len,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Wait until all pending key expansions are done (e.g. after loading
+ * the most used keys at startup).
+ */
+void falcon_keycache_wait(falcon_keycache *kc);
+
+/*
+ * Get the counters of a cache (since its creation).
+ */
+void falcon_keycache_get_stats(falcon_keycache *kc,
+        falcon_keycache_stats *stats);
+
+/* ==================================================================== */
+/*
+ * Expanded-key store.
+ *
+ * An expanded-key store is a file that holds the expanded keys of a set
+ * of private keys (of the same degree), so that processes need not
+ * re-run falcon_expand_privkey() for each key when they start. The file
+ * is mapped read-only: the expanded keys are used in place, without
+ * copy, and processes that open the same store share its pages through
+ * the page cache. Each expanded key in the store has its fpr payload on
+ * a 64-byte boundary.
+ *
+ * The file has a versioned header and an index of the keys, sorted by
+ * key identifier (the SHAKE256 hash of the encoded private key), with
+ * a checksum of each expanded key; a checksum of the header and index
+ * is checked when the store is opened. Expanded keys have a format
+ * specific to this implementation, and so does the store: a store can
+ * be opened only by the same implementation, on the same architecture,
+ * as the one that wrote it.
+ *
+ * If the library is compiled with FALCON_EKS_MMAP=0, the store is read
+ * into memory instead of being mapped.
+ */
+
+typedef struct falcon_expkey_store_ falcon_expkey_store;
+
+/*
+ * Flag for falcon_expkey_store_open(): also check the checksum of every
+ * expanded key (this reads the whole file).
+ */
+#define FALCON_EXPKEY_STORE_VERIFY   1
+
+/*
+ * Expand the count private keys privkey[0..count-1] (each of length
+ * privkey_len bytes, all with the same degree) and write them as a
+ * store in the file 'path'. The file is written under a temporary name
+ * (path with ".tmp" appended), then renamed, so that it atomically
+ * replaces any previous store; processes that have the previous store
+ * open keep using it.
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_EXPKEY_STORE(logn) bytes.
+ *
+ * Returned value: 0 on success, or a negative error code
+ * (FALCON_ERR_BADARG if count is 0 or a key appears twice).
+ */
+int falcon_expkey_store_write(const char *path,
+        const void *const *privkey, size_t privkey_len, size_t count,
+        void *tmp, size_t tmp_len);
+
+/*
+ * Open the store in file 'path'. flags is 0 or
+ * FALCON_EXPKEY_STORE_VERIFY. On success, *store is set to the new
+ * store handle; otherwise, it is set to NULL.
+ *
+ * Returned value: 0 on success, or a negative error code
+ * (FALCON_ERR_IO if the file cannot be read or mapped,
+ * FALCON_ERR_FORMAT if it is not a valid store).
+ */
+int falcon_expkey_store_open(falcon_expkey_store **store,
+        const char *path, unsigned flags);
+
+/*
+ * Close a store. The pointers obtained from the store become invalid.
+ */
+void falcon_expkey_store_close(falcon_expkey_store *store);
+
+/*
+ * Get the number of keys in a store.
+ */
+size_t falcon_expkey_store_count(const falcon_expkey_store *store);
+
+/*
+ * Get the expanded key at position idx in the store (keys are sorted by
+ * identifier, not in the order given to falcon_expkey_store_write()).
+ * The returned pointer can be used directly with falcon_sign_tree() and
+ * falcon_sign_tree_finish(), as long as the store is open.
+ *
+ * Returned value: the expanded key, or NULL if idx is out of range.
+ */
+const void *falcon_expkey_store_get(const falcon_expkey_store *store,
+        size_t idx);
+
+/*
+ * Look up the expanded key of the private key privkey[] (of length
+ * privkey_len bytes), by binary search in the index.
+ *
+ * Returned value: the expanded key, or NULL if the key is not in the
+ * store.
+ */
+const void *falcon_expkey_store_find(const falcon_expkey_store *store,
+        const void *privkey, size_t privkey_len);
+
+/* ==================================================================== */
+/*
+ * Sign-time statistics.
+ *
+ * When the library is compiled with FALCON_STATS=1 (see config.h), the
+ * signing code updates a set of counters, kept separately for each
+ * thread, so that they can be read without locking and correlated
+ * with the latency of individual calls. When FALCON_STATS is 0 (the
+ * default), nothing is counted and the counters read as zero.
+ */
+
+typedef struct {
+        /*
+         * Number of signing passes (one per signature, plus one per
+         * retry when a PADDED signature did not fit).
+         */
+        uint64_t sign_calls;
+
+        /*
+         * Number of times a sampled vector was rejected as too long
+         * and sampling was restarted.
+         */
+        uint64_t sign_restarts;
+
+        /*
+         * Number of sampled integers, and total number of iterations
+         * of the sampler rejection loop (sampler_iterations divided by
+         * sampler_calls is the average number of iterations per call).
+         */
+        uint64_t sampler_calls;
+        uint64_t sampler_iterations;
+
+        /*
+         * Number of PRNG buffer refills (including the initial fill
+         * for each signing attempt), and number of PRNG bytes used.
+         */
+        uint64_t prng_refills;
+        uint64_t prng_bytes;
+
+        /*
+         * Number of times a signature did not fit in the COMPRESSED
+         * or PADDED format.
+         */
+        uint64_t comp_overflows;
+} falcon_stats;
+
+/*
+ * Copy the counters of the calling thread into *st.
+ *
+ * Returned value: 1 if the library was compiled with FALCON_STATS, 0
+ * otherwise (all counters are then set to zero).
+ */
+int falcon_stats_get(falcon_stats *st);
+
+/*
+ * Reset the counters of the calling thread to zero.
+ */
+void falcon_stats_reset(void);
+
+/* ==================================================================== */
+/*
+ * Phase tracing.
+ *
+ * When the library is compiled with FALCON_TRACE=1 (see config.h), the
+ * signing and verification functions time each of their phases (hash
+ * to point, basis FFT, Gram matrix, fast Fourier sampling, inverse FFT,
+ * encoding...) and append one event per phase to a ring buffer kept
+ * separately for each thread; the buffer holds the last
+ * FALCON_TRACE_SIZE events. Each whole operation is also recorded as
+ * an event, so that the time spent outside of any phase can be
+ * deduced. Calls that fail with an error are not fully recorded.
+ *
+ * Durations are in ticks: CPU cycles when the library is compiled for
+ * cycle benchmarks (BENCH_CYCLES=1, non-M1 cores, with the cycle
+ * counter made readable from user space), generic timer ticks on other
+ * ARM cores, and nanoseconds on other hosts.
+ *
+ * When FALCON_TRACE is 0 (the default), nothing is recorded and
+ * falcon_trace_read() always returns 0.
+ */
+
+typedef struct {
+        /*
+         * Phase identifier; see falcon_trace_phase_name().
+         */
+        unsigned phase;
+
+        /*
+         * Duration of the phase, in ticks.
+         */
+        uint64_t ticks;
+} falcon_trace_event;
+
+/*
+ * Move up to max of the recorded events of the calling thread into
+ * ev[], oldest first; these events are removed from the buffer.
+ *
+ * Returned value: number of events written into ev[].
+ */
+size_t falcon_trace_read(falcon_trace_event *ev, size_t max);
+
+/*
+ * Get the name of a phase, as a stack of frames separated by ';'
+ * (e.g. "sign_dyn;ffsampling"), which is the format used by flame
+ * graph tools for folded stacks. An operation name without ';' is the
+ * parent of the phases that start with that name. Phase identifiers
+ * are consecutive, starting at 0.
+ *
+ * Returned value: the phase name, or NULL if phase is out of range.
+ */
+const char *falcon_trace_phase_name(unsigned phase);
+
 /* ==================================================================== */
 
 #ifdef __cplusplus
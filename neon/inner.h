@@ -205,6 +205,26 @@ void Zf(i_shake256_flip)(
 void Zf(i_shake256_extract)(
 	inner_shake256_context *sc, uint8_t *out, size_t len);
 
+/*
+ * Two SHAKE256 instances processed in parallel with NEON. Only the
+ * squeeze phase is supported: each instance is absorbed and flipped
+ * with the scalar functions above, then moved into the two-lane
+ * context with i_shake256x2_set(). Each call to i_shake256x2_squeeze()
+ * runs the permutation on both instances and outputs one full block
+ * (136 bytes) per instance; i_shake256x2_get() copies an instance
+ * state back (the caller sets the dptr field).
+ */
+typedef struct {
+	uint64_t A[50];
+} inner_shake256x2_context;
+
+void Zf(i_shake256x2_set)(inner_shake256x2_context *sc2, unsigned lane,
+	const inner_shake256_context *sc);
+void Zf(i_shake256x2_get)(const inner_shake256x2_context *sc2, unsigned lane,
+	inner_shake256_context *sc);
+void Zf(i_shake256x2_squeeze)(inner_shake256x2_context *sc2,
+	uint8_t *out0, uint8_t *out1);
+
 /*
  */
 
@@ -290,6 +310,15 @@ extern const uint8_t Zf(max_sig_bits)[];
 void Zf(hash_to_point_vartime)(inner_shake256_context *sc,
 	uint16_t *x, unsigned logn);
 
+/*
+ * Two-lane version of hash_to_point_vartime(): the two contexts (must
+ * be already flipped) are squeezed in parallel. Output and final context
+ * states are identical to two calls to hash_to_point_vartime().
+ */
+void Zf(hash_to_point_x2)(inner_shake256_context *sc0,
+	inner_shake256_context *sc1,
+	uint16_t *x0, uint16_t *x1, unsigned logn);
+
 /*
  * From a SHAKE256 context (must be already flipped), produce a new
  * point. The temporary buffer (tmp) must have room for 2*2^logn bytes.
@@ -309,6 +338,12 @@ void Zf(hash_to_point_ct)(inner_shake256_context *sc,
  */
 int ZfN(is_short)(const int16_t *s1, const int16_t *s2);
 
+/*
+ * Same as is_short(), for a squared norm computed elsewhere (sum of the
+ * saturated squared norms of both halves).
+ */
+int ZfN(is_short_sqnorm)(uint32_t sqn);
+
 /*
  * Tell whether a given vector (2N coordinates, in two halves) is
  * acceptable as a signature. Instead of the first half s1, this
@@ -351,6 +386,27 @@ void Zf(to_ntt_monty)(int16_t *h);
 int Zf(verify_raw)(const int16_t *c0, const int16_t *s2,
 	               int16_t *h, int16_t *tmp);
 
+/*
+ * Same as verify_raw(), except that h[] has already been converted
+ * with to_ntt() and is left unmodified. This is the entry point used
+ * for prepared public keys (see falcon_pubkey_prepare()).
+ *
+ * tmp[] must have 16-bit alignment.
+ */
+int Zf(verify_raw_ntt)(const int16_t *c0, const int16_t *s2,
+	               const int16_t *h, int16_t *tmp);
+
+/*
+ * Batched form of verify_raw(), for count signatures (1 to 32). Lane i
+ * uses c0[i], s2[i] and h[i]; h[i] is converted to NTT in place. This
+ * is a batch interface only: the lanes are processed in sequence.
+ *
+ * tmp[] must have room for 2^logn elements, with 16-bit alignment.
+ * Returned value has bit i set if signature i is valid.
+ */
+uint32_t Zf(verify_raw_batch)(int16_t *const *c0, const int16_t *const *s2,
+	                      int16_t *const *h, int16_t *tmp, unsigned count);
+
 /*
  * Compute the public key h[], given the private key elements f[] and
  * g[]. This computes h = g/f mod phi mod q, where phi is the polynomial
@@ -521,6 +577,139 @@ int Zf(verify_recover)(int16_t *h, const int16_t *c0,
  */
 #include "fpr.h"
 
+/* ==================================================================== */
+/*
+ * Sign-time counters (FALCON_STATS).
+ *
+ * With FALCON_STATS, Zf(stats) holds the counters of the current thread
+ * (see falcon_stats_get() in falcon.h) and FALCON_STAT_ADD() increments
+ * one of them; otherwise, FALCON_STAT_ADD() compiles to nothing.
+ */
+
+#if FALCON_STATS || FALCON_TRACE
+#if defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L
+#define FALCON_TLS   _Thread_local
+#else
+#define FALCON_TLS   __thread
+#endif
+#endif
+
+#if FALCON_STATS
+typedef struct {
+	uint64_t sign_calls;
+	uint64_t sign_restarts;
+	uint64_t sampler_calls;
+	uint64_t sampler_iterations;
+	uint64_t prng_refills;
+	uint64_t prng_bytes;
+	uint64_t comp_overflows;
+} stats_context;
+
+extern FALCON_TLS stats_context Zf(stats);
+
+#define FALCON_STAT_ADD(name, n)   ((void)(Zf(stats).name += (uint64_t)(n)))
+#else
+#define FALCON_STAT_ADD(name, n)   ((void)0)
+#endif
+
+/* ==================================================================== */
+/*
+ * Phase tracing (FALCON_TRACE).
+ *
+ * FALCON_TRACE_ENTER() starts timing a phase; FALCON_TRACE_LEAVE(id)
+ * ends the most recently started phase and appends (id, elapsed ticks)
+ * to the ring buffer of the current thread. Phases nest. A whole
+ * operation is started with FALCON_TRACE_BEGIN() instead, which also
+ * drops the phases left open by an earlier operation that returned on
+ * an error. Without FALCON_TRACE, these macros compile to nothing.
+ *
+ * Ticks are read from PMCCNTR_EL0 (CPU cycles) when BENCH_CYCLES is set
+ * on a non-M1 core, from the generic timer CNTVCT_EL0 otherwise, and
+ * from the monotonic clock (nanoseconds) on non-ARM hosts.
+ *
+ * Each phase identifier has a name (see falcon_trace_phase_name()) in
+ * "operation;phase" form; the operation identifiers account for the
+ * whole call, including the time not covered by any phase.
+ * sign_tree_compact is traced as sign_tree.
+ */
+
+#define TRACE_SIGN_DYN              0
+#define TRACE_SIGN_DYN_KEY          1
+#define TRACE_SIGN_DYN_HASH         2
+#define TRACE_SIGN_DYN_BASIS        3
+#define TRACE_SIGN_DYN_GRAM         4
+#define TRACE_SIGN_DYN_TARGET       5
+#define TRACE_SIGN_DYN_FFSAMP       6
+#define TRACE_SIGN_DYN_REBUILD      7
+#define TRACE_SIGN_DYN_LATTICE      8
+#define TRACE_SIGN_DYN_IFFT         9
+#define TRACE_SIGN_DYN_NORM        10
+#define TRACE_SIGN_DYN_ENCODE      11
+#define TRACE_SIGN_TREE            12
+#define TRACE_SIGN_TREE_HASH       13
+#define TRACE_SIGN_TREE_TARGET     14
+#define TRACE_SIGN_TREE_FFSAMP     15
+#define TRACE_SIGN_TREE_LATTICE    16
+#define TRACE_SIGN_TREE_IFFT       17
+#define TRACE_SIGN_TREE_NORM       18
+#define TRACE_SIGN_TREE_ENCODE     19
+#define TRACE_VERIFY               20
+#define TRACE_VERIFY_PUBKEY        21
+#define TRACE_VERIFY_DECODE        22
+#define TRACE_VERIFY_HASH          23
+#define TRACE_VERIFY_RAW           24
+#define TRACE_SIGN_SEMI            25
+#define TRACE_SIGN_SEMI_HASH       26
+#define TRACE_SIGN_SEMI_GRAM       27
+#define TRACE_SIGN_SEMI_TARGET     28
+#define TRACE_SIGN_SEMI_FFSAMP     29
+#define TRACE_SIGN_SEMI_LATTICE    30
+#define TRACE_SIGN_SEMI_IFFT       31
+#define TRACE_SIGN_SEMI_NORM       32
+#define TRACE_SIGN_SEMI_ENCODE     33
+#define TRACE_NUM_PHASES           34
+
+#if FALCON_TRACE
+#define TRACE_MAX_DEPTH   4
+
+typedef struct {
+	uint32_t phase;
+	uint64_t ticks;
+} trace_event;
+
+typedef struct {
+	trace_event ev[FALCON_TRACE_SIZE];
+	size_t head, count;
+	uint64_t start[TRACE_MAX_DEPTH];
+	unsigned depth;
+} trace_context;
+
+extern FALCON_TLS trace_context Zf(trace);
+
+/*
+ * Read the current tick counter.
+ */
+uint64_t Zf(trace_ticks)(void);
+
+/*
+ * Start a phase; if reset is non-zero, open phases are dropped first.
+ */
+void Zf(trace_enter)(int reset);
+
+/*
+ * End the innermost open phase and record it with the given identifier.
+ */
+void Zf(trace_leave)(unsigned phase);
+
+#define FALCON_TRACE_BEGIN()      Zf(trace_enter)(1)
+#define FALCON_TRACE_ENTER()      Zf(trace_enter)(0)
+#define FALCON_TRACE_LEAVE(id)    Zf(trace_leave)(id)
+#else
+#define FALCON_TRACE_BEGIN()      ((void)0)
+#define FALCON_TRACE_ENTER()      ((void)0)
+#define FALCON_TRACE_LEAVE(id)    ((void)0)
+#endif
+
 /* ==================================================================== */
 /*
  * RNG (rng.c).
@@ -595,6 +784,7 @@ prng_get_u64(prng *p)
 		u = 0;
 	}
 	p->ptr = u + 8;
+	FALCON_STAT_ADD(prng_bytes, 8);
 
 	/*
 	 * On systems that use little-endian encoding and allow
@@ -619,6 +809,7 @@ prng_get_u8(prng *p)
 	unsigned v;
 
 	v = p->buf.d[p->ptr ++];
+	FALCON_STAT_ADD(prng_bytes, 1);
 	if (p->ptr == sizeof p->buf.d) {
 		Zf(prng_refill)(p);
 	}
@@ -696,7 +887,7 @@ void ZfN(poly_mul_add_fft)(fpr *c, const fpr *a, const fpr *restrict b, const fp
  * overlap. This function works only in FFT representation.
  */
 // void ZfN(poly_muladj_fft)(fpr *restrict a, const fpr *restrict b, unsigned logn);
-void ZfN(poly_muladj_fft)(fpr *d, fpr *a, const fpr *restrict b, unsigned logn);
+void ZfN(poly_muladj_fft)(fpr *d, const fpr *a, const fpr *restrict b, unsigned logn);
 void ZfN(poly_muladj_add_fft)(fpr *c, fpr *d,
                               const fpr *a, const fpr *restrict b, unsigned logn);
 /*
@@ -840,6 +1031,99 @@ void Zf(keygen)(inner_shake256_context *rng,
 	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
 	unsigned logn, uint8_t *tmp);
 
+/*
+ * Same as Zf(keygen)(), but the NTRU solver splits its per-prime
+ * computations and CRT reconstructions between nthreads threads (the
+ * caller being one of them; at most FALCON_KG_MAX_THREADS are used).
+ * The generated key is the same as with Zf(keygen)() for the same RNG
+ * state. scratch[] must hold nthreads * FALCON_KEYGEN_MT_SCRATCH(logn)
+ * words. If threads are disabled (FALCON_KG_THREADS is 0) or cannot be
+ * created, this runs on the calling thread only.
+ */
+#define FALCON_KG_MAX_THREADS          64
+#define FALCON_KEYGEN_MT_SCRATCH(logn)   ((size_t)5 << (logn))
+
+void Zf(keygen_mt)(inner_shake256_context *rng,
+	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
+	unsigned logn, uint8_t *tmp, unsigned nthreads, uint32_t *scratch);
+
+/*
+ * Persistent worker threads for the NTRU solver: a pool created by
+ * Zf(keygen_pool_new)() keeps nthreads-1 threads (the caller of
+ * Zf(keygen_pooled)() being the other one) and their scratch areas, for
+ * degrees up to 2^logn, until Zf(keygen_pool_free)() is called. Only
+ * one key generation may use a given pool at any time.
+ *
+ * Zf(keygen_pool_new)() returns NULL if nthreads is lower than 2, if
+ * threads are disabled (FALCON_KG_THREADS is 0) or cannot be created,
+ * or on allocation failure. Zf(keygen_pooled)() accepts a NULL pool
+ * and then behaves as Zf(keygen)(); otherwise, it generates the same
+ * key as Zf(keygen_mt)() without starting or stopping any thread.
+ */
+typedef struct Zf(keygen_pool_) Zf(keygen_pool);
+
+Zf(keygen_pool) *Zf(keygen_pool_new)(unsigned logn, unsigned nthreads);
+
+void Zf(keygen_pool_free)(Zf(keygen_pool) *pool);
+
+void Zf(keygen_pooled)(inner_shake256_context *rng,
+	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
+	unsigned logn, uint8_t *tmp, Zf(keygen_pool) *pool);
+
+/*
+ * Callback for Zf(keygen_many)(): receives key number 'index' (f, g, F,
+ * G and the public key h). A nonzero returned value stops generation.
+ */
+typedef int (*Zf(keygen_emit))(void *ctx, size_t index,
+	const int8_t *f, const int8_t *g, const int8_t *F, const int8_t *G,
+	const uint16_t *h);
+
+/*
+ * Generate 'count' key pairs and pass them to emit(). Key i is generated
+ * as with Zf(keygen)() over a SHAKE256 context initialized (init and
+ * inject, as in shake256_init_prng_from_seed()) with the i-th 48-byte
+ * block extracted from rng, whatever the number of threads. With
+ * nthreads > 1, the caller and nthreads-1 extra threads each run both
+ * the candidate filtering and the NTRU solving, filtered candidates
+ * being queued to the solvers; calls to emit() are serialized, but keys
+ * may be emitted out of order. Candidates of two keys are sampled
+ * together in NEON lanes when possible (the keys are unchanged).
+ *
+ * tmp[] must have 64-bit alignment and hold nthreads times
+ * FALCON_KEYGEN_MANY_TEMP(logn) bytes (at most FALCON_KG_MAX_THREADS
+ * threads are used). Returned value is 0, or the first nonzero value
+ * returned by emit().
+ * This function uses floating-point rounding (see set_fpu_cw()).
+ */
+#define FALCON_KEYGEN_MANY_TEMP(logn) \
+	(((logn) <= 3 ? 352u : (38u << (logn))) + 512u)
+
+int Zf(keygen_many)(inner_shake256_context *rng, unsigned logn,
+	size_t count, unsigned nthreads,
+	Zf(keygen_emit) emit, void *ctx, uint8_t *tmp);
+
+/*
+ * Run one of the big-integer kernels of the NTRU solver once, on
+ * 2^logn integers of 'len' words each (len must not exceed the number
+ * of small primes); this is used by the benchmark code. data[] must
+ * hold 3*len*2^logn words:
+ *
+ *   FALCON_KG_BENCH_REBUILD_CRT      zint_rebuild_CRT() over data[]
+ *   FALCON_KG_BENCH_MOD_SMALL        zint_mod_small_signed() for len
+ *                                    primes, with the 4-lane kernels
+ *   FALCON_KG_BENCH_POLY_SUB_SCALED  poly_sub_scaled(); the third
+ *                                    block of data[] holds k (int32_t)
+ *   FALCON_KG_BENCH_BEZOUT           zint_bezout() on one pair of
+ *                                    integers (logn must be at least 2)
+ */
+#define FALCON_KG_BENCH_REBUILD_CRT       0
+#define FALCON_KG_BENCH_MOD_SMALL         1
+#define FALCON_KG_BENCH_POLY_SUB_SCALED   2
+#define FALCON_KG_BENCH_BEZOUT            3
+
+void Zf(keygen_bench_kernel)(unsigned kernel, uint32_t *data, size_t len,
+	unsigned logn);
+
 /* ==================================================================== */
 /*
  * Signature generation.
@@ -878,6 +1162,63 @@ void Zf(sign_tree)(int16_t *sig, inner_shake256_context *rng,
 	const fpr *restrict expanded_key,
 	const uint16_t *hm, uint8_t *tmp);
 
+/*
+ * Expand a private key into a compact expanded key: the LDL tree (as
+ * in Zf(expand_privkey)()), followed by f, g, F and G (one byte per
+ * coefficient). The total size is (8*logn+12)*2^logn bytes.
+ *
+ * The tmp[] array must have room for at least 48*2^logn bytes.
+ *
+ * tmp[] must have 64-bit alignment.
+ * This function uses floating-point rounding (see set_fpu_cw()).
+ */
+void Zf(expand_privkey_compact)(fpr *restrict expanded_key,
+	const int8_t *f, const int8_t *g, const int8_t *F, const int8_t *G,
+	uint8_t *restrict tmp);
+
+/*
+ * Same as Zf(sign_tree)(), with a compact expanded key (as generated
+ * by Zf(expand_privkey_compact)()). The B0 matrix is recomputed on the
+ * fly; for the same rng state, the signature is identical to the one
+ * produced by Zf(sign_tree)() with the full expanded key.
+ *
+ * The minimal size (in bytes) of tmp[] is 48*2^logn bytes.
+ *
+ * tmp[] must have 64-bit alignment.
+ * This function uses floating-point rounding (see set_fpu_cw()).
+ */
+void Zf(sign_tree_compact)(int16_t *sig, inner_shake256_context *rng,
+	const fpr *restrict expanded_key,
+	const uint16_t *hm, uint8_t *tmp);
+
+/*
+ * Expand a private key into a semi-expanded key: the B0 matrix in FFT
+ * representation (as in Zf(expand_privkey)()) and, if gram is non-zero,
+ * the Gram matrix (g00, g01 and g11), but no LDL tree. The total size
+ * is 32*2^logn bytes, or 56*2^logn bytes with the Gram matrix.
+ *
+ * This function uses floating-point rounding (see set_fpu_cw()).
+ */
+void Zf(expand_privkey_semi)(fpr *restrict expanded_key,
+	const int8_t *f, const int8_t *g, const int8_t *F, const int8_t *G,
+	int gram);
+
+/*
+ * Same as Zf(sign_dyn)(), with a semi-expanded key (as generated by
+ * Zf(expand_privkey_semi)(), with the same gram flag). The LDL tree is
+ * computed on the fly, but the B0 matrix is not recomputed (nor the
+ * Gram matrix, if present); for the same rng state, the signature is
+ * identical to the one produced by Zf(sign_dyn)().
+ *
+ * The minimal size (in bytes) of tmp[] is 72*2^logn bytes.
+ *
+ * tmp[] must have 64-bit alignment.
+ * This function uses floating-point rounding (see set_fpu_cw()).
+ */
+void Zf(sign_semi)(int16_t *sig, inner_shake256_context *rng,
+	const fpr *restrict expanded_key, int gram,
+	const uint16_t *hm, uint8_t *tmp);
+
 /*
  * Compute a signature over the provided hashed message (hm); the
  * signature value is one short vector. This function uses a raw
@@ -917,6 +1258,11 @@ void Zf(sign_dyn)(int16_t *sig, inner_shake256_context *rng,
  * returns an integer sampled along a half-Gaussian with standard
  * deviation sigma0 = 1.8205 (center is 0, returned value is
  * nonnegative).
+ *
+ * sampler_x2() samples two integers at once, with centers mu[0] and
+ * mu[1] and the same isigma, and writes them (as fpr values) into z[0]
+ * and z[1]. The distribution is the same as with sampler(), but the
+ * PRNG is consumed in a different order (see sampler.c).
  */
 
 typedef struct {
@@ -926,6 +1272,8 @@ typedef struct {
 
 int Zf(sampler)(void *ctx, fpr mu, fpr isigma);
 
+void Zf(sampler_x2)(void *ctx, fpr *z, const fpr *mu, fpr isigma);
+
 int ZfN(gaussian0_sampler)(prng *p);
 
 /* ==================================================================== */
@@ -0,0 +1,547 @@
+/*
+ * Expanded-key cache (see falcon_keycache_new() in falcon.h).
+ *
+ * Entries are grouped in sets of up to KC_WAYS entries; a private key
+ * (identified by the SHAKE256 hash of its encoding) may only be stored
+ * in the set selected by its hash. Each entry has:
+ *
+ *   tag      first 64 bits of the hash (with the low bit forced to 1),
+ *            or 0 if the entry was never used
+ *   state    phase (KC_EMPTY, KC_LOADING or KC_READY) in the low two
+ *            bits, and the number of signers using the entry above
+ *   ref      CLOCK reference bit, set on each use
+ *
+ * Readers never take a lock: they look for the tag in the set, pin
+ * the entry with a compare-and-swap on its state (only possible while
+ * it is KC_READY), then check the full hash, which cannot change while
+ * the entry is pinned. Writers (the miss path) pick a victim under a
+ * spinlock, held only while an entry is chosen and filled: the clock
+ * hand of the set skips pinned and loading entries, clears reference
+ * bits, and takes the first unreferenced entry, whose state is switched
+ * from (KC_READY, no pin) to KC_LOADING with a compare-and-swap, so
+ * that no new reader may pin it. The entry then receives the new hash
+ * and a copy of the private key, and is expanded either by a background
+ * thread (through a job queue protected by a mutex) or by the caller;
+ * publishing KC_READY (release) makes the expanded key visible to
+ * readers.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "falcon.h"
+#include "inner.h"
+
+#if FALCON_KC_THREADS
+#include <pthread.h>
+#endif
+
+#define KC_WAYS          8
+#define KC_MAX_WORKERS   64
+
+#define KC_EMPTY         0u
+#define KC_LOADING       1u
+#define KC_READY         2u
+#define KC_PHASE         3u
+#define KC_PIN           4u
+
+typedef struct {
+	uint64_t tag;
+	uint32_t state;
+	uint32_t ref;
+	uint8_t digest[32];
+} kc_entry;
+
+struct falcon_keycache_ {
+	unsigned logn;
+	size_t num_entries, num_sets, ways;
+	size_t ek_len, sk_len;
+	kc_entry *entries;
+	uint8_t *ekeys;
+	uint8_t *skeys;
+	size_t *hands;
+	unsigned char wlock;
+	uint64_t hits, misses, expansions, evictions;
+#if FALCON_KC_THREADS
+	pthread_mutex_t lock;
+	pthread_cond_t cv_job, cv_idle;
+	uint32_t *queue;
+	size_t q_head, q_len;
+	unsigned busy, started;
+	int quit;
+	unsigned nworkers;
+	pthread_t workers[KC_MAX_WORKERS];
+	uint8_t *wtmp;
+#endif
+};
+
+static inline uint8_t *
+kc_ekey(falcon_keycache *kc, size_t idx)
+{
+	return kc->ekeys + idx * kc->ek_len;
+}
+
+static inline uint8_t *
+kc_skey(falcon_keycache *kc, size_t idx)
+{
+	return kc->skeys + idx * kc->sk_len;
+}
+
+static inline void
+kc_count(uint64_t *ctr)
+{
+	__atomic_fetch_add(ctr, 1, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t
+kc_dec64le(const uint8_t *buf)
+{
+	uint64_t x;
+	int i;
+
+	x = 0;
+	for (i = 7; i >= 0; i --) {
+		x = (x << 8) | buf[i];
+	}
+	return x;
+}
+
+static inline void
+kc_lock(falcon_keycache *kc)
+{
+	while (__atomic_test_and_set(&kc->wlock, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(&kc->wlock, __ATOMIC_RELAXED)) {
+			continue;
+		}
+	}
+}
+
+static inline void
+kc_unlock(falcon_keycache *kc)
+{
+	__atomic_clear(&kc->wlock, __ATOMIC_RELEASE);
+}
+
+/*
+ * Pin the cached entry for the provided hash. Returned value is the
+ * entry index, or -1 if the key is not in the cache (or not expanded
+ * yet).
+ */
+static long
+kc_pin(falcon_keycache *kc, size_t set, uint64_t tag, const uint8_t *digest)
+{
+	size_t w;
+
+	for (w = 0; w < kc->ways; w ++) {
+		size_t idx;
+		kc_entry *e;
+		uint32_t st;
+
+		idx = set * kc->ways + w;
+		e = &kc->entries[idx];
+		if (__atomic_load_n(&e->tag, __ATOMIC_RELAXED) != tag) {
+			continue;
+		}
+		st = __atomic_load_n(&e->state, __ATOMIC_RELAXED);
+		while ((st & KC_PHASE) == KC_READY) {
+			if (__atomic_compare_exchange_n(&e->state, &st,
+				st + KC_PIN, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			{
+				if (memcmp(e->digest, digest, 32) == 0) {
+					__atomic_store_n(&e->ref, 1,
+						__ATOMIC_RELAXED);
+					return (long)idx;
+				}
+				__atomic_fetch_sub(&e->state, KC_PIN,
+					__ATOMIC_RELEASE);
+				break;
+			}
+		}
+	}
+	return -1;
+}
+
+static inline void
+kc_unpin(falcon_keycache *kc, long idx)
+{
+	__atomic_fetch_sub(&kc->entries[idx].state, KC_PIN, __ATOMIC_RELEASE);
+}
+
+/*
+ * Reserve an entry for a new key (caller holds the spinlock).
+ * Returned value is the entry index (now KC_LOADING), or -1 if the key
+ * is already being loaded or no entry of the set can be replaced.
+ */
+static long
+kc_reserve(falcon_keycache *kc, size_t set, uint64_t tag,
+	const uint8_t *digest, const void *privkey)
+{
+	kc_entry *base;
+	size_t w, i;
+
+	/*
+	 * Under the spinlock, other threads may only change the state and
+	 * tag of entries (pins, end of expansion); hashes are stable.
+	 */
+	base = &kc->entries[set * kc->ways];
+	for (w = 0; w < kc->ways; w ++) {
+		kc_entry *e;
+		uint32_t st;
+
+		e = &base[w];
+		st = __atomic_load_n(&e->state, __ATOMIC_ACQUIRE);
+		if ((st & KC_PHASE) != KC_EMPTY
+			&& __atomic_load_n(&e->tag, __ATOMIC_RELAXED) == tag
+			&& memcmp(e->digest, digest, 32) == 0)
+		{
+			return -1;
+		}
+	}
+
+	for (i = 0; i < 2 * kc->ways; i ++) {
+		kc_entry *e;
+		uint32_t st;
+		size_t idx;
+
+		w = kc->hands[set];
+		kc->hands[set] = (w + 1 == kc->ways) ? 0 : w + 1;
+		idx = set * kc->ways + w;
+		e = &base[w];
+		st = __atomic_load_n(&e->state, __ATOMIC_ACQUIRE);
+		if (st == KC_EMPTY) {
+			__atomic_store_n(&e->state, KC_LOADING, __ATOMIC_RELAXED);
+		} else if (st == KC_READY) {
+			if (__atomic_load_n(&e->ref, __ATOMIC_RELAXED)) {
+				__atomic_store_n(&e->ref, 0, __ATOMIC_RELAXED);
+				continue;
+			}
+			if (!__atomic_compare_exchange_n(&e->state, &st,
+				KC_LOADING, 0, __ATOMIC_ACQUIRE,
+				__ATOMIC_RELAXED))
+			{
+				continue;
+			}
+			kc_count(&kc->evictions);
+		} else {
+			/*
+			 * Pinned or loading.
+			 */
+			continue;
+		}
+		memcpy(e->digest, digest, 32);
+		memcpy(kc_skey(kc, idx), privkey, kc->sk_len);
+		__atomic_store_n(&e->ref, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&e->tag, tag, __ATOMIC_RELAXED);
+		return (long)idx;
+	}
+	return -1;
+}
+
+/*
+ * Expand the private key of a KC_LOADING entry. On success, the entry
+ * becomes KC_READY with 'pins' pins; on error, it is emptied.
+ */
+static int
+kc_expand(falcon_keycache *kc, long idx, uint32_t pins,
+	void *tmp, size_t tmp_len)
+{
+	kc_entry *e;
+	int r;
+
+	e = &kc->entries[idx];
+	r = falcon_expand_privkey(kc_ekey(kc, idx), kc->ek_len,
+		kc_skey(kc, idx), kc->sk_len, tmp, tmp_len);
+	if (r != 0) {
+		__atomic_store_n(&e->tag, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&e->state, KC_EMPTY, __ATOMIC_RELEASE);
+		return r;
+	}
+	kc_count(&kc->expansions);
+	__atomic_store_n(&e->state, KC_READY + pins * KC_PIN, __ATOMIC_RELEASE);
+	return 0;
+}
+
+#if FALCON_KC_THREADS
+
+static void *
+kc_worker_main(void *arg)
+{
+	falcon_keycache *kc;
+	size_t tmp_len;
+	uint8_t *tmp;
+	unsigned id;
+
+	kc = arg;
+	tmp_len = FALCON_TMPSIZE_EXPANDPRIV(kc->logn);
+	pthread_mutex_lock(&kc->lock);
+	id = kc->started ++;
+	tmp = kc->wtmp + (size_t)id * tmp_len;
+	for (;;) {
+		uint32_t idx;
+
+		while (kc->q_len == 0 && !kc->quit) {
+			pthread_cond_wait(&kc->cv_job, &kc->lock);
+		}
+		if (kc->q_len == 0) {
+			break;
+		}
+		idx = kc->queue[kc->q_head];
+		kc->q_head = (kc->q_head + 1 == kc->num_entries)
+			? 0 : kc->q_head + 1;
+		kc->q_len --;
+		kc->busy ++;
+		pthread_mutex_unlock(&kc->lock);
+		kc_expand(kc, (long)idx, 0, tmp, tmp_len);
+		pthread_mutex_lock(&kc->lock);
+		if (-- kc->busy == 0 && kc->q_len == 0) {
+			pthread_cond_broadcast(&kc->cv_idle);
+		}
+	}
+	pthread_mutex_unlock(&kc->lock);
+	return NULL;
+}
+
+#endif
+
+/* see falcon.h */
+falcon_keycache *
+falcon_keycache_new(unsigned logn, size_t max_bytes, unsigned nworkers)
+{
+	falcon_keycache *kc;
+	size_t num;
+
+	if (logn < 1 || logn > 10) {
+		return NULL;
+	}
+	num = max_bytes / FALCON_KEYCACHE_ENTRY_SIZE(logn);
+	if (num == 0) {
+		return NULL;
+	}
+	kc = calloc(1, sizeof *kc);
+	if (kc == NULL) {
+		return NULL;
+	}
+	kc->logn = logn;
+	kc->ways = num < KC_WAYS ? num : KC_WAYS;
+	kc->num_sets = num / kc->ways;
+	kc->num_entries = kc->num_sets * kc->ways;
+	kc->ek_len = FALCON_EXPANDEDKEY_SIZE(logn);
+	kc->sk_len = FALCON_PRIVKEY_SIZE(logn);
+	kc->entries = calloc(kc->num_entries, sizeof *kc->entries);
+	kc->hands = calloc(kc->num_sets, sizeof *kc->hands);
+	kc->ekeys = malloc(kc->num_entries * kc->ek_len);
+	kc->skeys = malloc(kc->num_entries * kc->sk_len);
+	if (kc->entries == NULL || kc->hands == NULL
+		|| kc->ekeys == NULL || kc->skeys == NULL)
+	{
+		falcon_keycache_free(kc);
+		return NULL;
+	}
+
+#if FALCON_KC_THREADS
+	if (nworkers > KC_MAX_WORKERS) {
+		nworkers = KC_MAX_WORKERS;
+	}
+	if (nworkers > 0) {
+		unsigned u;
+
+		kc->queue = malloc(kc->num_entries * sizeof *kc->queue);
+		kc->wtmp = malloc(
+			(size_t)nworkers * FALCON_TMPSIZE_EXPANDPRIV(logn));
+		/*
+		 * On error, the primitives initialized so far are
+		 * destroyed here: falcon_keycache_free() only shuts down
+		 * the worker threads (and their lock and conditions) if
+		 * some were started.
+		 */
+		if (kc->queue == NULL || kc->wtmp == NULL
+			|| pthread_mutex_init(&kc->lock, NULL) != 0)
+		{
+			falcon_keycache_free(kc);
+			return NULL;
+		}
+		if (pthread_cond_init(&kc->cv_job, NULL) != 0) {
+			pthread_mutex_destroy(&kc->lock);
+			falcon_keycache_free(kc);
+			return NULL;
+		}
+		if (pthread_cond_init(&kc->cv_idle, NULL) != 0) {
+			pthread_cond_destroy(&kc->cv_job);
+			pthread_mutex_destroy(&kc->lock);
+			falcon_keycache_free(kc);
+			return NULL;
+		}
+
+		/*
+		 * If a thread cannot be created, the cache works with
+		 * the threads that could; with none, keys are expanded
+		 * synchronously.
+		 */
+		for (u = 0; u < nworkers; u ++) {
+			if (pthread_create(&kc->workers[u], NULL,
+				kc_worker_main, kc) != 0)
+			{
+				break;
+			}
+		}
+		kc->nworkers = u;
+		if (u == 0) {
+			pthread_cond_destroy(&kc->cv_idle);
+			pthread_cond_destroy(&kc->cv_job);
+			pthread_mutex_destroy(&kc->lock);
+			free(kc->queue);
+			free(kc->wtmp);
+			kc->queue = NULL;
+			kc->wtmp = NULL;
+		}
+	}
+#else
+	(void)nworkers;
+#endif
+	return kc;
+}
+
+/* see falcon.h */
+void
+falcon_keycache_free(falcon_keycache *kc)
+{
+	if (kc == NULL) {
+		return;
+	}
+#if FALCON_KC_THREADS
+	if (kc->nworkers > 0) {
+		unsigned u;
+
+		pthread_mutex_lock(&kc->lock);
+		kc->quit = 1;
+		pthread_cond_broadcast(&kc->cv_job);
+		pthread_mutex_unlock(&kc->lock);
+		for (u = 0; u < kc->nworkers; u ++) {
+			pthread_join(kc->workers[u], NULL);
+		}
+		pthread_cond_destroy(&kc->cv_idle);
+		pthread_cond_destroy(&kc->cv_job);
+		pthread_mutex_destroy(&kc->lock);
+	}
+	free(kc->queue);
+	free(kc->wtmp);
+#endif
+	free(kc->entries);
+	free(kc->hands);
+	free(kc->ekeys);
+	free(kc->skeys);
+	free(kc);
+}
+
+/* see falcon.h */
+int
+falcon_keycache_sign(falcon_keycache *kc, shake256_context *rng,
+	void *sig, size_t *sig_len, int sig_type,
+	const void *privkey, size_t privkey_len,
+	const void *data, size_t data_len,
+	void *tmp, size_t tmp_len)
+{
+	shake256_context hc;
+	uint8_t digest[32];
+	uint64_t tag;
+	size_t set;
+	long idx;
+	int r;
+
+	if (privkey_len < kc->sk_len || privkey_len < 1) {
+		return FALCON_ERR_FORMAT;
+	}
+	if (((const uint8_t *)privkey)[0] != (0x50 + kc->logn)) {
+		return FALCON_ERR_FORMAT;
+	}
+	if (tmp_len < FALCON_TMPSIZE_KEYCACHE(kc->logn)) {
+		return FALCON_ERR_SIZE;
+	}
+
+	shake256_init(&hc);
+	shake256_inject(&hc, privkey, kc->sk_len);
+	shake256_flip(&hc);
+	shake256_extract(&hc, digest, sizeof digest);
+	tag = kc_dec64le(digest) | 1;
+	set = (size_t)(kc_dec64le(digest + 8) % kc->num_sets);
+
+	/*
+	 * Hit: sign with the cached expanded key.
+	 */
+	idx = kc_pin(kc, set, tag, digest);
+	if (idx >= 0) {
+		kc_count(&kc->hits);
+		r = falcon_sign_tree(rng, sig, sig_len, sig_type,
+			kc_ekey(kc, idx), data, data_len, tmp, tmp_len);
+		kc_unpin(kc, idx);
+		return r;
+	}
+	kc_count(&kc->misses);
+
+	kc_lock(kc);
+	idx = kc_reserve(kc, set, tag, digest, privkey);
+	kc_unlock(kc);
+#if FALCON_KC_THREADS
+	if (kc->nworkers > 0) {
+		if (idx >= 0) {
+			size_t q;
+
+			pthread_mutex_lock(&kc->lock);
+			q = kc->q_head + kc->q_len;
+			if (q >= kc->num_entries) {
+				q -= kc->num_entries;
+			}
+			kc->queue[q] = (uint32_t)idx;
+			kc->q_len ++;
+			pthread_cond_signal(&kc->cv_job);
+			pthread_mutex_unlock(&kc->lock);
+		}
+		return falcon_sign_dyn(rng, sig, sig_len, sig_type,
+			privkey, privkey_len, data, data_len, tmp, tmp_len);
+	}
+#endif
+
+	/*
+	 * Synchronous mode: expand the key in the reserved entry, and
+	 * sign with it (the entry is published already pinned).
+	 */
+	if (idx < 0) {
+		return falcon_sign_dyn(rng, sig, sig_len, sig_type,
+			privkey, privkey_len, data, data_len, tmp, tmp_len);
+	}
+	r = kc_expand(kc, idx, 1, tmp, tmp_len);
+	if (r != 0) {
+		return r;
+	}
+	r = falcon_sign_tree(rng, sig, sig_len, sig_type,
+		kc_ekey(kc, idx), data, data_len, tmp, tmp_len);
+	kc_unpin(kc, idx);
+	return r;
+}
+
+/* see falcon.h */
+void
+falcon_keycache_wait(falcon_keycache *kc)
+{
+#if FALCON_KC_THREADS
+	if (kc->nworkers == 0) {
+		return;
+	}
+	pthread_mutex_lock(&kc->lock);
+	while (kc->q_len != 0 || kc->busy != 0) {
+		pthread_cond_wait(&kc->cv_idle, &kc->lock);
+	}
+	pthread_mutex_unlock(&kc->lock);
+#else
+	(void)kc;
+#endif
+}
+
+/* see falcon.h */
+void
+falcon_keycache_get_stats(falcon_keycache *kc, falcon_keycache_stats *stats)
+{
+	stats->hits = __atomic_load_n(&kc->hits, __ATOMIC_RELAXED);
+	stats->misses = __atomic_load_n(&kc->misses, __ATOMIC_RELAXED);
+	stats->expansions = __atomic_load_n(&kc->expansions, __ATOMIC_RELAXED);
+	stats->evictions = __atomic_load_n(&kc->evictions, __ATOMIC_RELAXED);
+}
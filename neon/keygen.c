@@ -29,9 +29,15 @@
  * @author   Thomas Pornin <thomas.pornin@nccgroup.com>
  */
 
+#include <arm_neon.h>
 #include "inner.h"
+#include "config.h"
 #include "util.h"
 
+#if FALCON_KG_THREADS
+#include <pthread.h>
+#endif
+
 #define MKN(logn)   ((size_t)1 << (logn))
 
 /* ==================================================================== */
@@ -925,6 +931,50 @@ static const uint16_t REV10[] = {
 	 255,  767,  511, 1023
 };
 
+/*
+ * NEON versions of modp_montymul(), modp_add() and modp_sub(), on four
+ * values at once. The Montgomery reduction uses the same 31-bit
+ * formulation as the scalar code (full 64-bit products with vmull), so
+ * the results are identical, not just congruent.
+ */
+static inline uint32x4_t
+modp_montymul_x4(uint32x4_t a, uint32x4_t b, uint32x4_t p, uint32x4_t p0i)
+{
+	uint64x2_t zl, zh;
+	uint32x4_t m, t;
+
+	zl = vmull_u32(vget_low_u32(a), vget_low_u32(b));
+	zh = vmull_high_u32(a, b);
+
+	/*
+	 * (z * p0i) mod 2^31 only depends on the low 31 bits of z.
+	 */
+	m = vandq_u32(vmulq_u32(vmulq_u32(a, b), p0i),
+		vdupq_n_u32(0x7FFFFFFF));
+	zl = vmlal_u32(zl, vget_low_u32(m), vget_low_u32(p));
+	zh = vmlal_high_u32(zh, m, p);
+	t = vcombine_u32(vshrn_n_u64(zl, 31), vshrn_n_u64(zh, 31));
+	return vminq_u32(t, vsubq_u32(t, p));
+}
+
+static inline uint32x4_t
+modp_add_x4(uint32x4_t a, uint32x4_t b, uint32x4_t p)
+{
+	uint32x4_t d;
+
+	d = vaddq_u32(a, b);
+	return vminq_u32(d, vsubq_u32(d, p));
+}
+
+static inline uint32x4_t
+modp_sub_x4(uint32x4_t a, uint32x4_t b, uint32x4_t p)
+{
+	uint32x4_t d;
+
+	d = vsubq_u32(a, b);
+	return vminq_u32(d, vaddq_u32(d, p));
+}
+
 /*
  * Compute the roots for NTT and inverse NTT (binary case). Input
  * parameter g is a primitive 2048-th root of 1 modulo p (i.e. g^1024 =
@@ -945,6 +995,8 @@ modp_mkgm2(uint32_t *restrict gm, uint32_t *restrict igm, unsigned logn,
 	size_t u, n;
 	unsigned k;
 	uint32_t ig, x1, x2, R2;
+	uint32_t w1[4], w2[4];
+	uint32x4_t vx1, vx2, vg4, vig4, vp, vp0i;
 
 	n = (size_t)1 << logn;
 
@@ -961,20 +1013,203 @@ modp_mkgm2(uint32_t *restrict gm, uint32_t *restrict igm, unsigned logn,
 	ig = modp_div(R2, g, p, p0i, modp_R(p));
 	k = 10 - logn;
 	x1 = x2 = modp_R(p);
-	for (u = 0; u < n; u ++) {
-		size_t v;
+	if (n < 4) {
+		for (u = 0; u < n; u ++) {
+			size_t v;
+
+			v = REV10[u << k];
+			gm[v] = x1;
+			igm[v] = x2;
+			x1 = modp_montymul(x1, g, p, p0i);
+			x2 = modp_montymul(x2, ig, p, p0i);
+		}
+		return;
+	}
 
-		v = REV10[u << k];
-		gm[v] = x1;
-		igm[v] = x2;
+	/*
+	 * Four consecutive powers per step; each lane is multiplied by
+	 * g^4 (or 1/g^4). Only the bit-reversed scatter remains scalar.
+	 */
+	for (u = 0; u < 4; u ++) {
+		w1[u] = x1;
+		w2[u] = x2;
 		x1 = modp_montymul(x1, g, p, p0i);
 		x2 = modp_montymul(x2, ig, p, p0i);
 	}
+	vp = vdupq_n_u32(p);
+	vp0i = vdupq_n_u32(p0i);
+	vx1 = vld1q_u32(w1);
+	vx2 = vld1q_u32(w2);
+	vg4 = vdupq_n_u32(modp_montymul(w1[2], w1[2], p, p0i));
+	vig4 = vdupq_n_u32(modp_montymul(w2[2], w2[2], p, p0i));
+	for (u = 0; u < n; u += 4) {
+		vst1q_u32(w1, vx1);
+		vst1q_u32(w2, vx2);
+		gm[REV10[(u + 0) << k]] = w1[0];
+		gm[REV10[(u + 1) << k]] = w1[1];
+		gm[REV10[(u + 2) << k]] = w1[2];
+		gm[REV10[(u + 3) << k]] = w1[3];
+		igm[REV10[(u + 0) << k]] = w2[0];
+		igm[REV10[(u + 1) << k]] = w2[1];
+		igm[REV10[(u + 2) << k]] = w2[2];
+		igm[REV10[(u + 3) << k]] = w2[3];
+		vx1 = modp_montymul_x4(vx1, vg4, vp, vp0i);
+		vx2 = modp_montymul_x4(vx2, vig4, vp, vp0i);
+	}
+}
+
+/*
+ * NTT over a polynomial with consecutive elements (binary case), four
+ * butterflies at a time. The last two layers (half-size 2 and 1) work
+ * on de-interleaved groups obtained with vld4q/vld2q. logn >= 4.
+ */
+static void
+modp_NTT2_x4(uint32_t *a, const uint32_t *gm, unsigned logn,
+	uint32_t p, uint32_t p0i)
+{
+	size_t t, m, n, u, v;
+	uint32x4_t vp, vp0i, s, x, y;
+	uint32x4x4_t w4;
+	uint32x4x2_t w2;
+
+	vp = vdupq_n_u32(p);
+	vp0i = vdupq_n_u32(p0i);
+	n = (size_t)1 << logn;
+	t = n;
+	for (m = 1; m < n; m <<= 1) {
+		size_t ht;
+
+		ht = t >> 1;
+		if (ht >= 4) {
+			size_t v1;
+
+			for (u = 0, v1 = 0; u < m; u ++, v1 += t) {
+				uint32_t *r1, *r2;
+
+				s = vdupq_n_u32(gm[m + u]);
+				r1 = a + v1;
+				r2 = r1 + ht;
+				for (v = 0; v < ht; v += 4) {
+					x = vld1q_u32(r1 + v);
+					y = modp_montymul_x4(vld1q_u32(r2 + v),
+						s, vp, vp0i);
+					vst1q_u32(r1 + v, modp_add_x4(x, y, vp));
+					vst1q_u32(r2 + v, modp_sub_x4(x, y, vp));
+				}
+			}
+		} else if (ht == 2) {
+			for (u = 0; u < m; u += 4) {
+				w4 = vld4q_u32(a + (u << 2));
+				s = vld1q_u32(gm + m + u);
+				x = modp_montymul_x4(w4.val[2], s, vp, vp0i);
+				y = modp_montymul_x4(w4.val[3], s, vp, vp0i);
+				w4.val[2] = modp_sub_x4(w4.val[0], x, vp);
+				w4.val[0] = modp_add_x4(w4.val[0], x, vp);
+				w4.val[3] = modp_sub_x4(w4.val[1], y, vp);
+				w4.val[1] = modp_add_x4(w4.val[1], y, vp);
+				vst4q_u32(a + (u << 2), w4);
+			}
+		} else {
+			for (u = 0; u < m; u += 4) {
+				w2 = vld2q_u32(a + (u << 1));
+				s = vld1q_u32(gm + m + u);
+				y = modp_montymul_x4(w2.val[1], s, vp, vp0i);
+				w2.val[1] = modp_sub_x4(w2.val[0], y, vp);
+				w2.val[0] = modp_add_x4(w2.val[0], y, vp);
+				vst2q_u32(a + (u << 1), w2);
+			}
+		}
+		t = ht;
+	}
+}
+
+/*
+ * Inverse NTT over a polynomial with consecutive elements (binary
+ * case), including the final division by n. logn >= 4.
+ */
+static void
+modp_iNTT2_x4(uint32_t *a, const uint32_t *igm, unsigned logn,
+	uint32_t p, uint32_t p0i)
+{
+	size_t t, m, n, u, v;
+	uint32x4_t vp, vp0i, s, x, y, ni;
+	uint32x4x4_t w4;
+	uint32x4x2_t w2;
+
+	vp = vdupq_n_u32(p);
+	vp0i = vdupq_n_u32(p0i);
+	n = (size_t)1 << logn;
+	t = 1;
+	for (m = n; m > 1; m >>= 1) {
+		size_t hm, dt;
+
+		hm = m >> 1;
+		dt = t << 1;
+		if (t == 1) {
+			for (u = 0; u < hm; u += 4) {
+				w2 = vld2q_u32(a + (u << 1));
+				s = vld1q_u32(igm + hm + u);
+				x = w2.val[0];
+				y = w2.val[1];
+				w2.val[0] = modp_add_x4(x, y, vp);
+				w2.val[1] = modp_montymul_x4(
+					modp_sub_x4(x, y, vp), s, vp, vp0i);
+				vst2q_u32(a + (u << 1), w2);
+			}
+		} else if (t == 2) {
+			for (u = 0; u < hm; u += 4) {
+				w4 = vld4q_u32(a + (u << 2));
+				s = vld1q_u32(igm + hm + u);
+				x = w4.val[0];
+				y = w4.val[2];
+				w4.val[0] = modp_add_x4(x, y, vp);
+				w4.val[2] = modp_montymul_x4(
+					modp_sub_x4(x, y, vp), s, vp, vp0i);
+				x = w4.val[1];
+				y = w4.val[3];
+				w4.val[1] = modp_add_x4(x, y, vp);
+				w4.val[3] = modp_montymul_x4(
+					modp_sub_x4(x, y, vp), s, vp, vp0i);
+				vst4q_u32(a + (u << 2), w4);
+			}
+		} else {
+			size_t v1;
+
+			for (u = 0, v1 = 0; u < hm; u ++, v1 += dt) {
+				uint32_t *r1, *r2;
+
+				s = vdupq_n_u32(igm[hm + u]);
+				r1 = a + v1;
+				r2 = r1 + t;
+				for (v = 0; v < t; v += 4) {
+					x = vld1q_u32(r1 + v);
+					y = vld1q_u32(r2 + v);
+					vst1q_u32(r1 + v, modp_add_x4(x, y, vp));
+					vst1q_u32(r2 + v, modp_montymul_x4(
+						modp_sub_x4(x, y, vp), s, vp, vp0i));
+				}
+			}
+		}
+		t = dt;
+	}
+
+	/*
+	 * We need 1/n in Montgomery representation, i.e. R/n. Since
+	 * 1 <= logn <= 10, R/n is an integer; morever, R/n <= 2^30 < p,
+	 * thus a simple shift will do.
+	 */
+	ni = vdupq_n_u32((uint32_t)1 << (31 - logn));
+	for (u = 0; u < n; u += 4) {
+		vst1q_u32(a + u, modp_montymul_x4(vld1q_u32(a + u), ni, vp, vp0i));
+	}
 }
 
 /*
  * Compute the NTT over a polynomial (binary case). Polynomial elements
  * are a[0], a[stride], a[2 * stride]...
+ *
+ * For logn >= 4 this uses the NEON code; strided polynomials (RNS
+ * layout) are first gathered into a contiguous buffer.
  */
 static void
 modp_NTT2_ext(uint32_t *a, size_t stride, const uint32_t *gm, unsigned logn,
@@ -986,6 +1221,23 @@ modp_NTT2_ext(uint32_t *a, size_t stride, const uint32_t *gm, unsigned logn,
 		return;
 	}
 	n = (size_t)1 << logn;
+	if (logn >= 4) {
+		uint32_t buf[1024];
+		size_t u;
+
+		if (stride == 1) {
+			modp_NTT2_x4(a, gm, logn, p, p0i);
+			return;
+		}
+		for (u = 0; u < n; u ++) {
+			buf[u] = a[u * stride];
+		}
+		modp_NTT2_x4(buf, gm, logn, p, p0i);
+		for (u = 0; u < n; u ++) {
+			a[u * stride] = buf[u];
+		}
+		return;
+	}
 	t = n;
 	for (m = 1; m < n; m <<= 1) {
 		size_t ht, u, v1;
@@ -1027,6 +1279,23 @@ modp_iNTT2_ext(uint32_t *a, size_t stride, const uint32_t *igm, unsigned logn,
 		return;
 	}
 	n = (size_t)1 << logn;
+	if (logn >= 4) {
+		uint32_t buf[1024];
+		size_t u;
+
+		if (stride == 1) {
+			modp_iNTT2_x4(a, igm, logn, p, p0i);
+			return;
+		}
+		for (u = 0; u < n; u ++) {
+			buf[u] = a[u * stride];
+		}
+		modp_iNTT2_x4(buf, igm, logn, p, p0i);
+		for (u = 0; u < n; u ++) {
+			a[u * stride] = buf[u];
+		}
+		return;
+	}
 	t = 1;
 	for (m = n; m > 1; m >>= 1) {
 		size_t hm, dt, u, v1;
@@ -1264,6 +1533,147 @@ zint_add_mul_small(uint32_t *restrict x,
 	x[len] = cc;
 }
 
+/*
+ * Four-lane versions of the routines above. Lane j works on the
+ * integer that starts at d + j*dstride (respectively x + j*xstride),
+ * i.e. four consecutive coefficients of a polynomial in the layouts
+ * used by the NTRU solver. Results are identical to those of the
+ * scalar functions.
+ */
+static inline uint32x4_t
+zint_load_x4(const uint32_t *d, size_t dstride)
+{
+	uint32x4_t w;
+
+	w = vdupq_n_u32(d[0]);
+	w = vld1q_lane_u32(d + dstride, w, 1);
+	w = vld1q_lane_u32(d + 2 * dstride, w, 2);
+	w = vld1q_lane_u32(d + 3 * dstride, w, 3);
+	return w;
+}
+
+static inline void
+zint_store_x4(uint32_t *d, size_t dstride, uint32x4_t w)
+{
+	vst1q_lane_u32(d, w, 0);
+	vst1q_lane_u32(d + dstride, w, 1);
+	vst1q_lane_u32(d + 2 * dstride, w, 2);
+	vst1q_lane_u32(d + 3 * dstride, w, 3);
+}
+
+static uint32x4_t
+zint_mod_small_unsigned_x4(const uint32_t *d, size_t dstride, size_t dlen,
+	uint32_t p, uint32_t p0i, uint32_t R2)
+{
+	uint32x4_t x, vp, vp0i, vR2;
+	size_t u;
+
+	vp = vdupq_n_u32(p);
+	vp0i = vdupq_n_u32(p0i);
+	vR2 = vdupq_n_u32(R2);
+	x = vdupq_n_u32(0);
+	u = dlen;
+	while (u -- > 0) {
+		uint32x4_t w;
+
+		x = modp_montymul_x4(x, vR2, vp, vp0i);
+		w = zint_load_x4(d + u, dstride);
+		w = vminq_u32(w, vsubq_u32(w, vp));
+		x = modp_add_x4(x, w, vp);
+	}
+	return x;
+}
+
+static uint32x4_t
+zint_mod_small_signed_x4(const uint32_t *d, size_t dstride, size_t dlen,
+	uint32_t p, uint32_t p0i, uint32_t R2, uint32_t Rx)
+{
+	uint32x4_t z, w;
+
+	if (dlen == 0) {
+		return vdupq_n_u32(0);
+	}
+	z = zint_mod_small_unsigned_x4(d, dstride, dlen, p, p0i, R2);
+	w = zint_load_x4(d + dlen - 1, dstride);
+	w = vreinterpretq_u32_s32(
+		vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(w, 1)), 31));
+	return modp_sub_x4(z, vandq_u32(w, vdupq_n_u32(Rx)), vdupq_n_u32(p));
+}
+
+static void
+zint_add_mul_small_x4(uint32_t *restrict x, size_t xstride,
+	const uint32_t *restrict y, size_t len, uint32x4_t s)
+{
+	size_t u;
+	uint64x2_t cl, ch;
+
+	cl = vdupq_n_u64(0);
+	ch = vdupq_n_u64(0);
+	for (u = 0; u < len; u ++) {
+		uint32x4_t xw;
+		uint32x2_t yw;
+		uint64x2_t zl, zh;
+
+		xw = zint_load_x4(x + u, xstride);
+		yw = vdup_n_u32(y[u]);
+		zl = vmlal_u32(vaddw_u32(cl, vget_low_u32(xw)),
+			yw, vget_low_u32(s));
+		zh = vmlal_u32(vaddw_high_u32(ch, xw),
+			yw, vget_high_u32(s));
+		xw = vcombine_u32(vmovn_u64(zl), vmovn_u64(zh));
+		zint_store_x4(x + u, xstride,
+			vandq_u32(xw, vdupq_n_u32(0x7FFFFFFF)));
+		cl = vshrq_n_u64(zl, 31);
+		ch = vshrq_n_u64(zh, 31);
+	}
+	zint_store_x4(x + len, xstride,
+		vcombine_u32(vmovn_u64(cl), vmovn_u64(ch)));
+}
+
+/*
+ * Compute d mod p for 'num' signed integers of dlen words each. Source
+ * integers start at d, d + dstride, d + 2*dstride...; results go to
+ * x[0], x[xstride], x[2*xstride]... (see zint_mod_small_signed()).
+ */
+static void
+zint_mod_small_signed_many(uint32_t *x, size_t xstride,
+	const uint32_t *d, size_t dstride, size_t dlen, size_t num,
+	uint32_t p, uint32_t p0i, uint32_t R2, uint32_t Rx)
+{
+	size_t v;
+
+	for (v = 0; v + 4 <= num;
+		v += 4, x += 4 * xstride, d += 4 * dstride)
+	{
+		zint_store_x4(x, xstride, zint_mod_small_signed_x4(
+			d, dstride, dlen, p, p0i, R2, Rx));
+	}
+	for (; v < num; v ++, x += xstride, d += dstride) {
+		*x = zint_mod_small_signed(d, dlen, p, p0i, R2, Rx);
+	}
+}
+
+/*
+ * One step of zint_rebuild_CRT() (injection of word u, for prime p)
+ * for four integers, which start at x, x + xstride, x + 2*xstride and
+ * x + 3*xstride. tmp[] contains the product of the first u primes.
+ */
+static void
+zint_rebuild_CRT_x4(uint32_t *restrict x, size_t xstride, size_t u,
+	const uint32_t *restrict tmp,
+	uint32_t p, uint32_t p0i, uint32_t s, uint32_t R2)
+{
+	uint32x4_t vp, vp0i, xp, xq, xr;
+
+	vp = vdupq_n_u32(p);
+	vp0i = vdupq_n_u32(p0i);
+	xp = zint_load_x4(x + u, xstride);
+	xq = zint_mod_small_unsigned_x4(x, xstride, u, p, p0i, R2);
+	xr = modp_montymul_x4(vdupq_n_u32(s),
+		modp_sub_x4(xp, xq, vp), vp, vp0i);
+	zint_add_mul_small_x4(x, xstride, tmp, u, xr);
+}
+
 /*
  * Normalize a modular integer around 0: if x > p/2, then x is replaced
  * with x - p (signed encoding with two's complement); otherwise, x is
@@ -1316,6 +1726,276 @@ zint_norm_zero(uint32_t *restrict x, const uint32_t *restrict p, size_t len)
 	zint_sub(x, p, len, r >> 31);
 }
 
+/* ==================================================================== */
+/*
+ * Worker threads for the NTRU solver (see Zf(keygen_mt)() and
+ * Zf(keygen_pool_new)()).
+ *
+ * kg_run() runs a job over indices 0 to count-1. Index i is always
+ * processed by thread (i mod nthreads), the caller acting as thread 0,
+ * and each thread has its own scratch area of scratch_len words. Jobs
+ * write to disjoint output slots, so the results do not depend on the
+ * number of threads or on scheduling. Without a pool, the job runs on
+ * the caller with the provided scratch area.
+ */
+typedef void (*kg_job)(void *ctx, size_t idx, uint32_t *scratch);
+
+typedef Zf(keygen_pool) kg_pool;
+
+#if FALCON_KG_THREADS
+
+typedef struct {
+	kg_pool *pool;
+	unsigned id;
+	pthread_t th;
+} kg_worker;
+
+struct Zf(keygen_pool_) {
+	unsigned nthreads;
+	uint32_t *scratch;
+	size_t scratch_len;
+	pthread_mutex_t lock;
+	pthread_cond_t cv_start, cv_done;
+	unsigned long gen;
+	unsigned busy;
+	int quit;
+	kg_job job;
+	void *ctx;
+	size_t count;
+	kg_worker w[FALCON_KG_MAX_THREADS];
+};
+
+static void
+kg_pool_slice(kg_pool *pool, unsigned id)
+{
+	size_t i;
+
+	for (i = id; i < pool->count; i += pool->nthreads) {
+		pool->job(pool->ctx, i,
+			pool->scratch + (size_t)id * pool->scratch_len);
+	}
+}
+
+static void *
+kg_worker_main(void *arg)
+{
+	kg_worker *w;
+	kg_pool *pool;
+	unsigned long seen;
+
+	w = arg;
+	pool = w->pool;
+	seen = 0;
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (pool->gen == seen && !pool->quit) {
+			pthread_cond_wait(&pool->cv_start, &pool->lock);
+		}
+		if (pool->gen == seen) {
+			break;
+		}
+		seen = pool->gen;
+		pthread_mutex_unlock(&pool->lock);
+		kg_pool_slice(pool, w->id);
+		pthread_mutex_lock(&pool->lock);
+		if (-- pool->busy == 0) {
+			pthread_cond_signal(&pool->cv_done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/*
+ * Start nthreads-1 worker threads. If some threads cannot be created,
+ * the pool runs with fewer threads (results are unaffected). Returned
+ * value is 0 if no extra thread could be started (pool not usable).
+ */
+static int
+kg_pool_init(kg_pool *pool, unsigned nthreads,
+	uint32_t *scratch, size_t scratch_len)
+{
+	unsigned u;
+
+	if (nthreads > FALCON_KG_MAX_THREADS) {
+		nthreads = FALCON_KG_MAX_THREADS;
+	}
+	if (nthreads < 2) {
+		return 0;
+	}
+	pool->scratch = scratch;
+	pool->scratch_len = scratch_len;
+	pool->gen = 0;
+	pool->busy = 0;
+	pool->quit = 0;
+	pool->count = 0;
+	if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+		return 0;
+	}
+	if (pthread_cond_init(&pool->cv_start, NULL) != 0) {
+		pthread_mutex_destroy(&pool->lock);
+		return 0;
+	}
+	if (pthread_cond_init(&pool->cv_done, NULL) != 0) {
+		pthread_cond_destroy(&pool->cv_start);
+		pthread_mutex_destroy(&pool->lock);
+		return 0;
+	}
+	for (u = 1; u < nthreads; u ++) {
+		pool->w[u].pool = pool;
+		pool->w[u].id = u;
+		if (pthread_create(&pool->w[u].th, NULL,
+			kg_worker_main, &pool->w[u]) != 0)
+		{
+			break;
+		}
+	}
+	pool->nthreads = u;
+	if (u < 2) {
+		pthread_cond_destroy(&pool->cv_done);
+		pthread_cond_destroy(&pool->cv_start);
+		pthread_mutex_destroy(&pool->lock);
+		return 0;
+	}
+	return 1;
+}
+
+static void
+kg_pool_close(kg_pool *pool)
+{
+	unsigned u;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->cv_start);
+	pthread_mutex_unlock(&pool->lock);
+	for (u = 1; u < pool->nthreads; u ++) {
+		pthread_join(pool->w[u].th, NULL);
+	}
+	pthread_cond_destroy(&pool->cv_done);
+	pthread_cond_destroy(&pool->cv_start);
+	pthread_mutex_destroy(&pool->lock);
+}
+
+#endif
+
+static void
+kg_run(kg_pool *pool, kg_job job, void *ctx, size_t count,
+	uint32_t *scratch)
+{
+	size_t i;
+
+#if FALCON_KG_THREADS
+	if (pool != NULL && count > 1) {
+		pthread_mutex_lock(&pool->lock);
+		pool->job = job;
+		pool->ctx = ctx;
+		pool->count = count;
+		pool->busy = pool->nthreads - 1;
+		pool->gen ++;
+		pthread_cond_broadcast(&pool->cv_start);
+		pthread_mutex_unlock(&pool->lock);
+		kg_pool_slice(pool, 0);
+		pthread_mutex_lock(&pool->lock);
+		while (pool->busy != 0) {
+			pthread_cond_wait(&pool->cv_done, &pool->lock);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		return;
+	}
+#else
+	(void)pool;
+#endif
+	for (i = 0; i < count; i ++) {
+		job(ctx, i, scratch);
+	}
+}
+
+/*
+ * Number of threads in a pool (1 if there is no pool).
+ */
+static inline unsigned
+kg_nthreads(const kg_pool *pool)
+{
+#if FALCON_KG_THREADS
+	return pool == NULL ? 1 : pool->nthreads;
+#else
+	(void)pool;
+	return 1;
+#endif
+}
+
+/*
+ * Inject word u (prime p) into 'num' integers starting at x, with
+ * stride xstride (see zint_rebuild_CRT()). tmp[] contains the product
+ * of the first u primes.
+ */
+static void
+zint_rebuild_CRT_step(uint32_t *restrict x, size_t xstride, size_t num,
+	size_t u, const uint32_t *restrict tmp,
+	uint32_t p, uint32_t p0i, uint32_t s, uint32_t R2)
+{
+	size_t v;
+
+	v = 0;
+	for (; v + 4 <= num; v += 4, x += 4 * xstride) {
+		zint_rebuild_CRT_x4(x, xstride, u, tmp, p, p0i, s, R2);
+	}
+	for (; v < num; v ++, x += xstride) {
+		uint32_t xp, xq, xr;
+		/*
+		 * xp = the integer x modulo the prime p for this
+		 *      iteration
+		 * xq = (x mod q) mod p
+		 */
+		xp = x[u];
+		xq = zint_mod_small_unsigned(x, u, p, p0i, R2);
+
+		/*
+		 * New value is (x mod q) + q * (s * (xp - xq) mod p)
+		 */
+		xr = modp_montymul(s, modp_sub(xp, xq, p), p, p0i);
+		zint_add_mul_small(x, tmp, u, xr);
+	}
+}
+
+/*
+ * Threaded zint_rebuild_CRT(): each job handles a chunk of 'chunk'
+ * consecutive integers (the last chunk may be shorter).
+ */
+typedef struct {
+	uint32_t *xx;
+	size_t xlen, xstride, num, chunk, u;
+	const uint32_t *tmp;
+	uint32_t p, p0i, s, R2;
+} zint_rebuild_CRT_ctx;
+
+static void
+zint_rebuild_CRT_job(void *ctx, size_t idx, uint32_t *scratch)
+{
+	zint_rebuild_CRT_ctx *cc;
+	size_t v, num;
+
+	(void)scratch;
+	cc = ctx;
+	v = idx * cc->chunk;
+	num = cc->num - v;
+	if (num > cc->chunk) {
+		num = cc->chunk;
+	}
+	if (cc->u == 0) {
+		uint32_t *x;
+
+		x = cc->xx + v * cc->xstride;
+		for (; num > 0; num --, x += cc->xstride) {
+			zint_norm_zero(x, cc->tmp, cc->xlen);
+		}
+		return;
+	}
+	zint_rebuild_CRT_step(cc->xx + v * cc->xstride, cc->xstride, num,
+		cc->u, cc->tmp, cc->p, cc->p0i, cc->s, cc->R2);
+}
+
 /*
  * Rebuild integers from their RNS representation. There are 'num'
  * integers, and each consists in 'xlen' words. 'xx' points at that
@@ -1329,14 +2009,25 @@ zint_norm_zero(uint32_t *restrict x, const uint32_t *restrict p, size_t len)
  * If "normalize_signed" is non-zero, then the returned value is
  * normalized to the -m/2..m/2 interval (where m is the product of all
  * small prime moduli); two's complement is used for negative values.
+ *
+ * If pool is not NULL, the integers are split between its threads.
  */
 static void
 zint_rebuild_CRT(uint32_t *restrict xx, size_t xlen, size_t xstride,
 	size_t num, const small_prime *primes, int normalize_signed,
-	uint32_t *restrict tmp)
+	uint32_t *restrict tmp, kg_pool *pool)
 {
-	size_t u;
+	size_t u, nt;
 	uint32_t *x;
+	zint_rebuild_CRT_ctx cc;
+
+	nt = kg_nthreads(pool);
+	cc.xx = xx;
+	cc.xlen = xlen;
+	cc.xstride = xstride;
+	cc.num = num;
+	cc.chunk = ((num + nt - 1) / nt + 3) & ~(size_t)3;
+	cc.tmp = tmp;
 
 	tmp[0] = primes[0].p;
 	for (u = 1; u < xlen; u ++) {
@@ -1350,28 +2041,23 @@ zint_rebuild_CRT(uint32_t *restrict xx, size_t xlen, size_t xstride,
 		 * We call 'q' the product of all previous primes.
 		 */
 		uint32_t p, p0i, s, R2;
-		size_t v;
 
 		p = primes[u].p;
 		s = primes[u].s;
 		p0i = modp_ninv31(p);
 		R2 = modp_R2(p, p0i);
 
-		for (v = 0, x = xx; v < num; v ++, x += xstride) {
-			uint32_t xp, xq, xr;
-			/*
-			 * xp = the integer x modulo the prime p for this
-			 *      iteration
-			 * xq = (x mod q) mod p
-			 */
-			xp = x[u];
-			xq = zint_mod_small_unsigned(x, u, p, p0i, R2);
-
-			/*
-			 * New value is (x mod q) + q * (s * (xp - xq) mod p)
-			 */
-			xr = modp_montymul(s, modp_sub(xp, xq, p), p, p0i);
-			zint_add_mul_small(x, tmp, u, xr);
+		if (nt > 1 && num > cc.chunk) {
+			cc.u = u;
+			cc.p = p;
+			cc.p0i = p0i;
+			cc.s = s;
+			cc.R2 = R2;
+			kg_run(pool, zint_rebuild_CRT_job, &cc,
+				(num + cc.chunk - 1) / cc.chunk, NULL);
+		} else {
+			zint_rebuild_CRT_step(xx, xstride, num,
+				u, tmp, p, p0i, s, R2);
 		}
 
 		/*
@@ -1384,8 +2070,14 @@ zint_rebuild_CRT(uint32_t *restrict xx, size_t xlen, size_t xstride,
 	 * Normalize the reconstructed values around 0.
 	 */
 	if (normalize_signed) {
-		for (u = 0, x = xx; u < num; u ++, x += xstride) {
-			zint_norm_zero(x, tmp, xlen);
+		if (nt > 1 && num > cc.chunk) {
+			cc.u = 0;
+			kg_run(pool, zint_rebuild_CRT_job, &cc,
+				(num + cc.chunk - 1) / cc.chunk, NULL);
+		} else {
+			for (u = 0, x = xx; u < num; u ++, x += xstride) {
+				zint_norm_zero(x, tmp, xlen);
+			}
 		}
 	}
 }
@@ -1418,7 +2110,71 @@ zint_negate(uint32_t *a, size_t len, uint32_t ctl)
 }
 
 /*
- * Replace a with (a*xa+b*xb)/(2^31) and b with (a*ya+b*yb)/(2^31).
+ * The linear combinations of zint_co_reduce() and zint_co_reduce_mod_x2()
+ * run with their two carry chains (new a and new b) in the two 64-bit
+ * lanes of a vector: lane 0 accumulates the a*xa + b*xb terms, lane 1
+ * the a*ya + b*yb terms. The factors are signed and may be equal to
+ * 2^31, which does not fit in a 32-bit lane; thus, each factor f is
+ * split into the low (lo) and high (hi) words of its 64-bit two's
+ * complement encoding, and for a word w:
+ *   w*f = w*lo + ((w*hi) mod 2^32)*2^32  mod 2^64
+ * which is the value that the 64-bit scalar multiplication yields.
+ */
+typedef struct {
+	uint32x2_t lo, hi;
+} zint_cofactor;
+
+static inline zint_cofactor
+zint_cofactor_set(int64_t f0, int64_t f1)
+{
+	zint_cofactor c;
+
+	c.lo = vset_lane_u32((uint32_t)f1, vdup_n_u32((uint32_t)f0), 1);
+	c.hi = vset_lane_u32((uint32_t)((uint64_t)f1 >> 32),
+		vdup_n_u32((uint32_t)((uint64_t)f0 >> 32)), 1);
+	return c;
+}
+
+/*
+ * Return w[0]*c0 + w[1]*c1 (lane i uses factors c0[i] and c1[i]),
+ * modulo 2^64.
+ */
+static inline uint64x2_t
+zint_co_mul_x2(uint32x2_t w, zint_cofactor c0, zint_cofactor c1)
+{
+	uint64x2_t z;
+	uint32x2_t h;
+
+	z = vmull_lane_u32(c0.lo, w, 0);
+	z = vmlal_lane_u32(z, c1.lo, w, 1);
+	h = vmul_lane_u32(c0.hi, w, 0);
+	h = vmla_lane_u32(h, c1.hi, w, 1);
+	return vaddq_u64(z, vshll_n_u32(h, 32));
+}
+
+static inline uint32x2_t
+zint_load_x2(const uint32_t *a, const uint32_t *b)
+{
+	return vld1_lane_u32(b, vld1_dup_u32(a), 1);
+}
+
+/*
+ * Store the low 31 bits of both lanes of z into *a and *b, and return
+ * the carries (z >> 31, signed).
+ */
+static inline int64x2_t
+zint_store_carry_x2(uint32_t *a, uint32_t *b, uint64x2_t z)
+{
+	uint32x2_t w;
+
+	w = vand_u32(vmovn_u64(z), vdup_n_u32(0x7FFFFFFF));
+	vst1_lane_u32(a, w, 0);
+	vst1_lane_u32(b, w, 1);
+	return vshrq_n_s64(vreinterpretq_s64_u64(z), 31);
+}
+
+/*
+ * Replace a with (a*xa+b*xb)/(2^31) and b with (a*ya+b*yb)/(2^31).
  * The low bits are dropped (the caller should compute the coefficients
  * such that these dropped bits are all zeros). If either or both
  * yields a negative value, then the value is negated.
@@ -1436,26 +2192,23 @@ zint_co_reduce(uint32_t *a, uint32_t *b, size_t len,
 	int64_t xa, int64_t xb, int64_t ya, int64_t yb)
 {
 	size_t u;
+	zint_cofactor cx, cy;
+	uint64x2_t z;
+	int64x2_t cc;
 	int64_t cca, ccb;
 	uint32_t nega, negb;
 
-	cca = 0;
-	ccb = 0;
-	for (u = 0; u < len; u ++) {
-		uint32_t wa, wb;
-		uint64_t za, zb;
-
-		wa = a[u];
-		wb = b[u];
-		za = wa * (uint64_t)xa + wb * (uint64_t)xb + (uint64_t)cca;
-		zb = wa * (uint64_t)ya + wb * (uint64_t)yb + (uint64_t)ccb;
-		if (u > 0) {
-			a[u - 1] = (uint32_t)za & 0x7FFFFFFF;
-			b[u - 1] = (uint32_t)zb & 0x7FFFFFFF;
-		}
-		cca = *(int64_t *)&za >> 31;
-		ccb = *(int64_t *)&zb >> 31;
+	cx = zint_cofactor_set(xa, ya);
+	cy = zint_cofactor_set(xb, yb);
+	z = zint_co_mul_x2(zint_load_x2(a, b), cx, cy);
+	cc = vshrq_n_s64(vreinterpretq_s64_u64(z), 31);
+	for (u = 1; u < len; u ++) {
+		z = zint_co_mul_x2(zint_load_x2(a + u, b + u), cx, cy);
+		z = vaddq_u64(z, vreinterpretq_u64_s64(cc));
+		cc = zint_store_carry_x2(a + u - 1, b + u - 1, z);
 	}
+	cca = vgetq_lane_s64(cc, 0);
+	ccb = vgetq_lane_s64(cc, 1);
 	a[len - 1] = (uint32_t)cca;
 	b[len - 1] = (uint32_t)ccb;
 
@@ -1517,53 +2270,75 @@ zint_finish_mod(uint32_t *a, size_t len, const uint32_t *m, uint32_t neg)
 
 /*
  * Replace a with (a*xa+b*xb)/(2^31) mod m, and b with
- * (a*ya+b*yb)/(2^31) mod m. Modulus m must be odd; m0i = -1/m[0] mod 2^31.
+ * (a*ya+b*yb)/(2^31) mod m; and, with the same coefficients, c with
+ * (c*xa+d*xb)/(2^31) mod p, and d with (c*ya+d*yb)/(2^31) mod p.
+ * Moduli m and p must be odd; m0i = -1/m[0] mod 2^31 and
+ * p0i = -1/p[0] mod 2^31. These are the two modular updates of one
+ * zint_bezout() step; their four carry chains are interleaved in two
+ * vectors.
  */
 static void
-zint_co_reduce_mod(uint32_t *a, uint32_t *b, const uint32_t *m, size_t len,
-	uint32_t m0i, int64_t xa, int64_t xb, int64_t ya, int64_t yb)
+zint_co_reduce_mod_x2(uint32_t *a, uint32_t *b, const uint32_t *m,
+	uint32_t m0i, uint32_t *c, uint32_t *d, const uint32_t *p,
+	uint32_t p0i, size_t len, int64_t xa, int64_t xb, int64_t ya, int64_t yb)
 {
 	size_t u;
-	int64_t cca, ccb;
-	uint32_t fa, fb;
+	zint_cofactor cx, cy;
+	uint32x2_t fab, fcd, wm;
+	uint64x2_t zab, zcd;
+	int64x2_t ccab, cccd;
+	int64_t cc[4];
 
 	/*
-	 * These are actually four combined Montgomery multiplications.
+	 * These are actually eight combined Montgomery multiplications.
 	 */
-	cca = 0;
-	ccb = 0;
-	fa = ((a[0] * (uint32_t)xa + b[0] * (uint32_t)xb) * m0i) & 0x7FFFFFFF;
-	fb = ((a[0] * (uint32_t)ya + b[0] * (uint32_t)yb) * m0i) & 0x7FFFFFFF;
-	for (u = 0; u < len; u ++) {
-		uint32_t wa, wb;
-		uint64_t za, zb;
-
-		wa = a[u];
-		wb = b[u];
-		za = wa * (uint64_t)xa + wb * (uint64_t)xb
-			+ m[u] * (uint64_t)fa + (uint64_t)cca;
-		zb = wa * (uint64_t)ya + wb * (uint64_t)yb
-			+ m[u] * (uint64_t)fb + (uint64_t)ccb;
-		if (u > 0) {
-			a[u - 1] = (uint32_t)za & 0x7FFFFFFF;
-			b[u - 1] = (uint32_t)zb & 0x7FFFFFFF;
-		}
-		cca = *(int64_t *)&za >> 31;
-		ccb = *(int64_t *)&zb >> 31;
+	cx = zint_cofactor_set(xa, ya);
+	cy = zint_cofactor_set(xb, yb);
+	fab = vset_lane_u32(((a[0] * (uint32_t)ya + b[0] * (uint32_t)yb)
+		* m0i) & 0x7FFFFFFF, vdup_n_u32(((a[0] * (uint32_t)xa
+		+ b[0] * (uint32_t)xb) * m0i) & 0x7FFFFFFF), 1);
+	fcd = vset_lane_u32(((c[0] * (uint32_t)ya + d[0] * (uint32_t)yb)
+		* p0i) & 0x7FFFFFFF, vdup_n_u32(((c[0] * (uint32_t)xa
+		+ d[0] * (uint32_t)xb) * p0i) & 0x7FFFFFFF), 1);
+	wm = zint_load_x2(m, p);
+	zab = vmlal_lane_u32(zint_co_mul_x2(zint_load_x2(a, b), cx, cy),
+		fab, wm, 0);
+	zcd = vmlal_lane_u32(zint_co_mul_x2(zint_load_x2(c, d), cx, cy),
+		fcd, wm, 1);
+	ccab = vshrq_n_s64(vreinterpretq_s64_u64(zab), 31);
+	cccd = vshrq_n_s64(vreinterpretq_s64_u64(zcd), 31);
+	for (u = 1; u < len; u ++) {
+		wm = zint_load_x2(m + u, p + u);
+		zab = vmlal_lane_u32(
+			zint_co_mul_x2(zint_load_x2(a + u, b + u), cx, cy),
+			fab, wm, 0);
+		zcd = vmlal_lane_u32(
+			zint_co_mul_x2(zint_load_x2(c + u, d + u), cx, cy),
+			fcd, wm, 1);
+		zab = vaddq_u64(zab, vreinterpretq_u64_s64(ccab));
+		zcd = vaddq_u64(zcd, vreinterpretq_u64_s64(cccd));
+		ccab = zint_store_carry_x2(a + u - 1, b + u - 1, zab);
+		cccd = zint_store_carry_x2(c + u - 1, d + u - 1, zcd);
 	}
-	a[len - 1] = (uint32_t)cca;
-	b[len - 1] = (uint32_t)ccb;
+	vst1q_s64(cc, ccab);
+	vst1q_s64(cc + 2, cccd);
+	a[len - 1] = (uint32_t)cc[0];
+	b[len - 1] = (uint32_t)cc[1];
+	c[len - 1] = (uint32_t)cc[2];
+	d[len - 1] = (uint32_t)cc[3];
 
 	/*
 	 * At this point:
 	 *   -m <= a < 2*m
 	 *   -m <= b < 2*m
-	 * (this is a case of Montgomery reduction)
-	 * The top words of 'a' and 'b' may have a 32-th bit set.
+	 * (this is a case of Montgomery reduction), and likewise for c
+	 * and d with modulus p. The top words may have a 32-th bit set.
 	 * We want to add or subtract the modulus, as required.
 	 */
-	zint_finish_mod(a, len, m, (uint32_t)((uint64_t)cca >> 63));
-	zint_finish_mod(b, len, m, (uint32_t)((uint64_t)ccb >> 63));
+	zint_finish_mod(a, len, m, (uint32_t)((uint64_t)cc[0] >> 63));
+	zint_finish_mod(b, len, m, (uint32_t)((uint64_t)cc[1] >> 63));
+	zint_finish_mod(c, len, p, (uint32_t)((uint64_t)cc[2] >> 63));
+	zint_finish_mod(d, len, p, (uint32_t)((uint64_t)cc[3] >> 63));
 }
 
 /*
@@ -1877,8 +2652,8 @@ zint_bezout(uint32_t *restrict u, uint32_t *restrict v,
 		pb -= (pb + pb) & -(int64_t)(r & 1);
 		qa -= (qa + qa) & -(int64_t)(r >> 1);
 		qb -= (qb + qb) & -(int64_t)(r >> 1);
-		zint_co_reduce_mod(u0, u1, y, len, y0i, pa, pb, qa, qb);
-		zint_co_reduce_mod(v0, v1, x, len, x0i, pa, pb, qa, qb);
+		zint_co_reduce_mod_x2(u0, u1, y, y0i, v0, v1, x, x0i,
+			len, pa, pb, qa, qb);
 	}
 
 	/*
@@ -1955,6 +2730,67 @@ zint_add_scaled_mul_small(uint32_t *restrict x, size_t xlen,
 	}
 }
 
+/*
+ * Four-lane zint_add_scaled_mul_small(): add k[j]*y*2^sc to x[j], for
+ * j = 0 to 3. The four x[j] must not overlap.
+ */
+static void
+zint_add_scaled_mul_small_x4(uint32_t *const *x, size_t xlen,
+	const uint32_t *restrict y, size_t ylen, int32x4_t k,
+	uint32_t sch, uint32_t scl)
+{
+	size_t u;
+	uint32_t ysign, tw;
+	int64x2_t cl, ch;
+
+	if (ylen == 0) {
+		return;
+	}
+
+	ysign = -(y[ylen - 1] >> 30) >> 1;
+	tw = 0;
+	cl = vdupq_n_s64(0);
+	ch = vdupq_n_s64(0);
+	for (u = sch; u < xlen; u ++) {
+		size_t v;
+		uint32_t wy, wys;
+		uint32x4_t xw;
+		int32x2_t yw;
+		int64x2_t zl, zh;
+
+		v = u - sch;
+		wy = v < ylen ? y[v] : ysign;
+		wys = ((wy << scl) & 0x7FFFFFFF) | tw;
+		tw = wy >> (31 - scl);
+
+		/*
+		 * Same computation as in the scalar code; the carry is
+		 * the low 32 bits of z >> 31, sign-extended.
+		 */
+		xw = vdupq_n_u32(x[0][u]);
+		xw = vld1q_lane_u32(x[1] + u, xw, 1);
+		xw = vld1q_lane_u32(x[2] + u, xw, 2);
+		xw = vld1q_lane_u32(x[3] + u, xw, 3);
+		yw = vdup_n_s32((int32_t)wys);
+		zl = vmlal_s32(vaddw_s32(cl,
+			vget_low_s32(vreinterpretq_s32_u32(xw))),
+			yw, vget_low_s32(k));
+		zh = vmlal_s32(vaddw_high_s32(ch,
+			vreinterpretq_s32_u32(xw)),
+			yw, vget_high_s32(k));
+		xw = vandq_u32(vcombine_u32(
+			vmovn_u64(vreinterpretq_u64_s64(zl)),
+			vmovn_u64(vreinterpretq_u64_s64(zh))),
+			vdupq_n_u32(0x7FFFFFFF));
+		vst1q_lane_u32(x[0] + u, xw, 0);
+		vst1q_lane_u32(x[1] + u, xw, 1);
+		vst1q_lane_u32(x[2] + u, xw, 2);
+		vst1q_lane_u32(x[3] + u, xw, 3);
+		cl = vmovl_s32(vshrn_n_s64(zl, 31));
+		ch = vmovl_s32(vshrn_n_s64(zh, 31));
+	}
+}
+
 /*
  * Subtract y*2^sc from x. The result is assumed to fit in the array of
  * size xlen (truncation is applied if necessary).
@@ -2112,7 +2948,39 @@ poly_sub_scaled(uint32_t *restrict F, size_t Flen, size_t Fstride,
 	size_t n, u;
 
 	n = MKN(logn);
-	for (u = 0; u < n; u ++) {
+	u = 0;
+
+	/*
+	 * Four rows at a time: at each step, the four lanes update four
+	 * distinct coefficients of F. Since all updates are additions
+	 * modulo 2^(31*Flen), the order change does not alter the result.
+	 */
+	for (; u + 4 <= n; u += 4) {
+		int32_t kf[4];
+		uint32_t *x[4];
+		const uint32_t *y;
+		size_t v, j;
+
+		for (j = 0; j < 4; j ++) {
+			kf[j] = -k[u + j];
+			x[j] = F + (u + j) * Fstride;
+		}
+		y = f;
+		for (v = 0; v < n; v ++) {
+			zint_add_scaled_mul_small_x4(
+				x, Flen, y, flen, vld1q_s32(kf), sch, scl);
+			for (j = 0; j < 4; j ++) {
+				if (u + j + v == n - 1) {
+					x[j] = F;
+					kf[j] = -kf[j];
+				} else {
+					x[j] += Fstride;
+				}
+			}
+			y += fstride;
+		}
+	}
+	for (; u < n; u ++) {
 		int32_t kf;
 		size_t v;
 		uint32_t *x;
@@ -2135,6 +3003,55 @@ poly_sub_scaled(uint32_t *restrict F, size_t Flen, size_t Fstride,
 	}
 }
 
+/*
+ * Computation of k*f modulo one small prime, for poly_sub_scaled_ntt().
+ * The job scratch area has room for 3*2^logn words.
+ */
+typedef struct {
+	uint32_t *fk;
+	const uint32_t *f;
+	size_t flen, fstride, tlen;
+	const int32_t *k;
+	unsigned logn;
+} poly_sub_scaled_ntt_ctx;
+
+static void
+poly_sub_scaled_ntt_job(void *ctx, size_t u, uint32_t *scratch)
+{
+	poly_sub_scaled_ntt_ctx *cc;
+	uint32_t *gm, *igm, *t1, *x;
+	uint32_t p, p0i, R2, Rx;
+	size_t n, v, tlen;
+	unsigned logn;
+
+	cc = ctx;
+	logn = cc->logn;
+	n = MKN(logn);
+	tlen = cc->tlen;
+	gm = scratch;
+	igm = gm + n;
+	t1 = igm + n;
+
+	p = PRIMES[u].p;
+	p0i = modp_ninv31(p);
+	R2 = modp_R2(p, p0i);
+	Rx = modp_Rx((unsigned)cc->flen, p, p0i, R2);
+	modp_mkgm2(gm, igm, logn, PRIMES[u].g, p, p0i);
+
+	for (v = 0; v < n; v ++) {
+		t1[v] = modp_set(cc->k[v], p);
+	}
+	modp_NTT2(t1, gm, logn, p, p0i);
+	zint_mod_small_signed_many(cc->fk + u, tlen,
+		cc->f, cc->fstride, cc->flen, n, p, p0i, R2, Rx);
+	modp_NTT2_ext(cc->fk + u, tlen, gm, logn, p, p0i);
+	for (v = 0, x = cc->fk + u; v < n; v ++, x += tlen) {
+		*x = modp_montymul(
+			modp_montymul(t1[v], *x, p, p0i), R2, p, p0i);
+	}
+	modp_iNTT2_ext(cc->fk + u, tlen, igm, logn, p, p0i);
+}
+
 /*
  * Subtract k*f from F. Coefficients of polynomial k are small integers
  * (signed values in the -2^31..2^31 range) scaled by 2^sc. This function
@@ -2145,56 +3062,36 @@ static void
 poly_sub_scaled_ntt(uint32_t *restrict F, size_t Flen, size_t Fstride,
 	const uint32_t *restrict f, size_t flen, size_t fstride,
 	const int32_t *restrict k, uint32_t sch, uint32_t scl, unsigned logn,
-	uint32_t *restrict tmp)
+	uint32_t *restrict tmp, kg_pool *pool)
 {
-	uint32_t *gm, *igm, *fk, *t1, *x;
+	uint32_t *fk, *t1, *x;
 	const uint32_t *y;
 	size_t n, u, tlen;
-	const small_prime *primes;
+	poly_sub_scaled_ntt_ctx cc;
 
 	n = MKN(logn);
 	tlen = flen + 1;
-	gm = tmp;
-	igm = gm + MKN(logn);
-	fk = igm + MKN(logn);
+	fk = tmp;
 	t1 = fk + n * tlen;
 
-	primes = PRIMES;
-
 	/*
-	 * Compute k*f in fk[], in RNS notation.
+	 * Compute k*f in fk[], in RNS notation. Each prime needs 3*n
+	 * words of scratch (gm, igm and one temporary), taken from t1[]
+	 * when not using worker threads.
 	 */
-	for (u = 0; u < tlen; u ++) {
-		uint32_t p, p0i, R2, Rx;
-		size_t v;
-
-		p = primes[u].p;
-		p0i = modp_ninv31(p);
-		R2 = modp_R2(p, p0i);
-		Rx = modp_Rx((unsigned)flen, p, p0i, R2);
-		modp_mkgm2(gm, igm, logn, primes[u].g, p, p0i);
-
-		for (v = 0; v < n; v ++) {
-			t1[v] = modp_set(k[v], p);
-		}
-		modp_NTT2(t1, gm, logn, p, p0i);
-		for (v = 0, y = f, x = fk + u;
-			v < n; v ++, y += fstride, x += tlen)
-		{
-			*x = zint_mod_small_signed(y, flen, p, p0i, R2, Rx);
-		}
-		modp_NTT2_ext(fk + u, tlen, gm, logn, p, p0i);
-		for (v = 0, x = fk + u; v < n; v ++, x += tlen) {
-			*x = modp_montymul(
-				modp_montymul(t1[v], *x, p, p0i), R2, p, p0i);
-		}
-		modp_iNTT2_ext(fk + u, tlen, igm, logn, p, p0i);
-	}
+	cc.fk = fk;
+	cc.f = f;
+	cc.flen = flen;
+	cc.fstride = fstride;
+	cc.tlen = tlen;
+	cc.k = k;
+	cc.logn = logn;
+	kg_run(pool, poly_sub_scaled_ntt_job, &cc, tlen, t1);
 
 	/*
 	 * Rebuild k*f.
 	 */
-	zint_rebuild_CRT(fk, tlen, tlen, n, primes, 1, t1);
+	zint_rebuild_CRT(fk, tlen, tlen, n, PRIMES, 1, t1, pool);
 
 	/*
 	 * Subtract k*f, scaled, from F.
@@ -2588,8 +3485,8 @@ make_fg_step(uint32_t *data, unsigned logn, unsigned depth,
 	 * Since the fs and gs words have been de-NTTized, we can use the
 	 * CRT to rebuild the values.
 	 */
-	zint_rebuild_CRT(fs, slen, slen, n, primes, 1, gm);
-	zint_rebuild_CRT(gs, slen, slen, n, primes, 1, gm);
+	zint_rebuild_CRT(fs, slen, slen, n, primes, 1, gm, NULL);
+	zint_rebuild_CRT(gs, slen, slen, n, primes, 1, gm, NULL);
 
 	/*
 	 * Remaining words: use modular reductions to extract the values.
@@ -2604,9 +3501,8 @@ make_fg_step(uint32_t *data, unsigned logn, unsigned depth,
 		R2 = modp_R2(p, p0i);
 		Rx = modp_Rx((unsigned)slen, p, p0i, R2);
 		modp_mkgm2(gm, igm, logn, primes[u].g, p, p0i);
-		for (v = 0, x = fs; v < n; v ++, x += slen) {
-			t1[v] = zint_mod_small_signed(x, slen, p, p0i, R2, Rx);
-		}
+		zint_mod_small_signed_many(t1, 1, fs, slen, slen, n,
+			p, p0i, R2, Rx);
 		modp_NTT2(t1, gm, logn, p, p0i);
 		for (v = 0, x = fd + u; v < hn; v ++, x += tlen) {
 			uint32_t w0, w1;
@@ -2616,9 +3512,8 @@ make_fg_step(uint32_t *data, unsigned logn, unsigned depth,
 			*x = modp_montymul(
 				modp_montymul(w0, w1, p, p0i), R2, p, p0i);
 		}
-		for (v = 0, x = gs; v < n; v ++, x += slen) {
-			t1[v] = zint_mod_small_signed(x, slen, p, p0i, R2, Rx);
-		}
+		zint_mod_small_signed_many(t1, 1, gs, slen, slen, n,
+			p, p0i, R2, Rx);
 		modp_NTT2(t1, gm, logn, p, p0i);
 		for (v = 0, x = gd + u; v < hn; v ++, x += tlen) {
 			uint32_t w0, w1;
@@ -2717,7 +3612,7 @@ solve_NTRU_deepest(unsigned logn_top,
 	 * There are two such big integers. The resultants are always
 	 * nonnegative.
 	 */
-	zint_rebuild_CRT(fp, len, len, 2, primes, 0, t1);
+	zint_rebuild_CRT(fp, len, len, 2, primes, 0, t1, NULL);
 
 	/*
 	 * Apply the binary GCD. The zint_bezout() function works only
@@ -2748,6 +3643,165 @@ solve_NTRU_deepest(unsigned logn_top,
 	return 1;
 }
 
+/*
+ * Per-prime work of solve_NTRU_intermediate(), as kg_run() jobs.
+ * Ft, Gt, ft and gt are the arrays of that function; Fd and Gd are the
+ * F and G from the deeper level. solve_NTRU_intermediate_reduce_job()
+ * needs no scratch; solve_NTRU_intermediate_prime_job() handles prime
+ * index base+idx and uses 5*n words of scratch (gm, igm, fx, gx, and F'
+ * and G' modulo p).
+ */
+typedef struct {
+	uint32_t *Ft, *Gt, *ft, *gt;
+	const uint32_t *Fd, *Gd;
+	size_t slen, dlen, llen, base;
+	unsigned logn;
+} solve_NTRU_intermediate_ctx;
+
+static void
+solve_NTRU_intermediate_reduce_job(void *ctx, size_t u, uint32_t *scratch)
+{
+	solve_NTRU_intermediate_ctx *cc;
+	uint32_t p, p0i, R2, Rx;
+	size_t hn;
+
+	(void)scratch;
+	cc = ctx;
+	hn = MKN(cc->logn) >> 1;
+	p = PRIMES[u].p;
+	p0i = modp_ninv31(p);
+	R2 = modp_R2(p, p0i);
+	Rx = modp_Rx((unsigned)cc->dlen, p, p0i, R2);
+	zint_mod_small_signed_many(cc->Ft + u, cc->llen,
+		cc->Fd, cc->dlen, cc->dlen, hn, p, p0i, R2, Rx);
+	zint_mod_small_signed_many(cc->Gt + u, cc->llen,
+		cc->Gd, cc->dlen, cc->dlen, hn, p, p0i, R2, Rx);
+}
+
+static void
+solve_NTRU_intermediate_prime_job(void *ctx, size_t idx, uint32_t *scratch)
+{
+	solve_NTRU_intermediate_ctx *cc;
+	unsigned logn;
+	size_t n, hn, slen, llen, u, v;
+	uint32_t p, p0i, R2;
+	uint32_t *gm, *igm, *fx, *gx, *Fp, *Gp, *x, *y;
+	uint32_t *Ft, *Gt, *ft, *gt;
+
+	cc = ctx;
+	logn = cc->logn;
+	n = MKN(logn);
+	hn = n >> 1;
+	slen = cc->slen;
+	llen = cc->llen;
+	Ft = cc->Ft;
+	Gt = cc->Gt;
+	ft = cc->ft;
+	gt = cc->gt;
+	u = cc->base + idx;
+
+	/*
+	 * All computations are done modulo p.
+	 */
+	p = PRIMES[u].p;
+	p0i = modp_ninv31(p);
+	R2 = modp_R2(p, p0i);
+
+	gm = scratch;
+	igm = gm + n;
+	fx = igm + n;
+	gx = fx + n;
+
+	modp_mkgm2(gm, igm, logn, PRIMES[u].g, p, p0i);
+
+	if (u < slen) {
+		for (v = 0, x = ft + u, y = gt + u;
+			v < n; v ++, x += slen, y += slen)
+		{
+			fx[v] = *x;
+			gx[v] = *y;
+		}
+		modp_iNTT2_ext(ft + u, slen, igm, logn, p, p0i);
+		modp_iNTT2_ext(gt + u, slen, igm, logn, p, p0i);
+	} else {
+		uint32_t Rx;
+
+		Rx = modp_Rx((unsigned)slen, p, p0i, R2);
+		zint_mod_small_signed_many(fx, 1, ft, slen, slen, n,
+			p, p0i, R2, Rx);
+		zint_mod_small_signed_many(gx, 1, gt, slen, slen, n,
+			p, p0i, R2, Rx);
+		modp_NTT2(fx, gm, logn, p, p0i);
+		modp_NTT2(gx, gm, logn, p, p0i);
+	}
+
+	/*
+	 * Get F' and G' modulo p and in NTT representation
+	 * (they have degree n/2). These values were computed in
+	 * a previous step, and stored in Ft and Gt.
+	 */
+	Fp = gx + n;
+	Gp = Fp + hn;
+	for (v = 0, x = Ft + u, y = Gt + u;
+		v < hn; v ++, x += llen, y += llen)
+	{
+		Fp[v] = *x;
+		Gp[v] = *y;
+	}
+	modp_NTT2(Fp, gm, logn - 1, p, p0i);
+	modp_NTT2(Gp, gm, logn - 1, p, p0i);
+
+	/*
+	 * Compute our F and G modulo p.
+	 *
+	 * General case:
+	 *
+	 *   we divide degree by d = 2 or 3
+	 *   f'(x^d) = N(f)(x^d) = f * adj(f)
+	 *   g'(x^d) = N(g)(x^d) = g * adj(g)
+	 *   f'*G' - g'*F' = q
+	 *   F = F'(x^d) * adj(g)
+	 *   G = G'(x^d) * adj(f)
+	 *
+	 * We compute things in the NTT. We group roots of phi
+	 * such that all roots x in a group share the same x^d.
+	 * If the roots in a group are x_1, x_2... x_d, then:
+	 *
+	 *   N(f)(x_1^d) = f(x_1)*f(x_2)*...*f(x_d)
+	 *
+	 * Thus, we have:
+	 *
+	 *   G(x_1) = f(x_2)*f(x_3)*...*f(x_d)*G'(x_1^d)
+	 *   G(x_2) = f(x_1)*f(x_3)*...*f(x_d)*G'(x_1^d)
+	 *   ...
+	 *   G(x_d) = f(x_1)*f(x_2)*...*f(x_{d-1})*G'(x_1^d)
+	 *
+	 * In all cases, we can thus compute F and G in NTT
+	 * representation by a few simple multiplications.
+	 * Moreover, in our chosen NTT representation, roots
+	 * from the same group are consecutive in RAM.
+	 */
+	for (v = 0, x = Ft + u, y = Gt + u; v < hn;
+		v ++, x += (llen << 1), y += (llen << 1))
+	{
+		uint32_t ftA, ftB, gtA, gtB;
+		uint32_t mFp, mGp;
+
+		ftA = fx[(v << 1) + 0];
+		ftB = fx[(v << 1) + 1];
+		gtA = gx[(v << 1) + 0];
+		gtB = gx[(v << 1) + 1];
+		mFp = modp_montymul(Fp[v], R2, p, p0i);
+		mGp = modp_montymul(Gp[v], R2, p, p0i);
+		x[0] = modp_montymul(gtB, mFp, p, p0i);
+		x[llen] = modp_montymul(gtA, mFp, p, p0i);
+		y[0] = modp_montymul(ftB, mGp, p, p0i);
+		y[llen] = modp_montymul(ftA, mGp, p, p0i);
+	}
+	modp_iNTT2_ext(Ft + u, llen, igm, logn, p, p0i);
+	modp_iNTT2_ext(Gt + u, llen, igm, logn, p, p0i);
+}
+
 /*
  * Solving the NTRU equation, intermediate level. Upon entry, the F and G
  * from the previous level should be in the tmp[] array.
@@ -2757,7 +3811,8 @@ solve_NTRU_deepest(unsigned logn_top,
  */
 static int
 solve_NTRU_intermediate(unsigned logn_top,
-	const int8_t *f, const int8_t *g, unsigned depth, uint32_t *tmp)
+	const int8_t *f, const int8_t *g, unsigned depth, uint32_t *tmp,
+	kg_pool *pool)
 {
 	/*
 	 * In this function, 'logn' is the log2 of the degree for
@@ -2774,6 +3829,7 @@ solve_NTRU_intermediate(unsigned logn_top,
 	uint32_t *x, *y;
 	int32_t *k;
 	const small_prime *primes;
+	solve_NTRU_intermediate_ctx cc;
 
 	logn = logn_top - depth;
 	n = (size_t)1 << logn;
@@ -2832,23 +3888,17 @@ solve_NTRU_intermediate(unsigned logn_top,
 	 * We reduce Fd and Gd modulo all the small primes we will need,
 	 * and store the values in Ft and Gt (only n/2 values in each).
 	 */
-	for (u = 0; u < llen; u ++) {
-		uint32_t p, p0i, R2, Rx;
-		size_t v;
-		uint32_t *xs, *ys, *xd, *yd;
-
-		p = primes[u].p;
-		p0i = modp_ninv31(p);
-		R2 = modp_R2(p, p0i);
-		Rx = modp_Rx((unsigned)dlen, p, p0i, R2);
-		for (v = 0, xs = Fd, ys = Gd, xd = Ft + u, yd = Gt + u;
-			v < hn;
-			v ++, xs += dlen, ys += dlen, xd += llen, yd += llen)
-		{
-			*xd = zint_mod_small_signed(xs, dlen, p, p0i, R2, Rx);
-			*yd = zint_mod_small_signed(ys, dlen, p, p0i, R2, Rx);
-		}
-	}
+	cc.Ft = Ft;
+	cc.Gt = Gt;
+	cc.ft = ft;
+	cc.gt = gt;
+	cc.Fd = Fd;
+	cc.Gd = Gd;
+	cc.slen = slen;
+	cc.dlen = dlen;
+	cc.llen = llen;
+	cc.logn = logn;
+	kg_run(pool, solve_NTRU_intermediate_reduce_job, &cc, llen, NULL);
 
 	/*
 	 * We do not need Fd and Gd after that point.
@@ -2856,180 +3906,71 @@ solve_NTRU_intermediate(unsigned logn_top,
 
 	/*
 	 * Compute our F and G modulo sufficiently many small primes.
+	 * For the first slen primes, f and g are in RNS + NTT
+	 * representation; each job also converts its words of f and g
+	 * back out of NTT. Once all of them are processed, f and g are
+	 * in RNS and we can rebuild them, then handle the other primes.
 	 */
-	for (u = 0; u < llen; u ++) {
-		uint32_t p, p0i, R2;
-		uint32_t *gm, *igm, *fx, *gx, *Fp, *Gp;
-		size_t v;
-
-		/*
-		 * All computations are done modulo p.
-		 */
-		p = primes[u].p;
-		p0i = modp_ninv31(p);
-		R2 = modp_R2(p, p0i);
-
-		/*
-		 * If we processed slen words, then f and g have been
-		 * de-NTTized, and are in RNS; we can rebuild them.
-		 */
-		if (u == slen) {
-			zint_rebuild_CRT(ft, slen, slen, n, primes, 1, t1);
-			zint_rebuild_CRT(gt, slen, slen, n, primes, 1, t1);
-		}
+	cc.base = 0;
+	kg_run(pool, solve_NTRU_intermediate_prime_job, &cc, slen, t1);
+	zint_rebuild_CRT(ft, slen, slen, n, primes, 1, t1, pool);
+	zint_rebuild_CRT(gt, slen, slen, n, primes, 1, t1, pool);
+	cc.base = slen;
+	kg_run(pool, solve_NTRU_intermediate_prime_job, &cc, llen - slen, t1);
 
-		gm = t1;
-		igm = gm + n;
-		fx = igm + n;
-		gx = fx + n;
+	/*
+	 * Rebuild F and G with the CRT.
+	 */
+	zint_rebuild_CRT(Ft, llen, llen, n, primes, 1, t1, pool);
+	zint_rebuild_CRT(Gt, llen, llen, n, primes, 1, t1, pool);
 
-		modp_mkgm2(gm, igm, logn, primes[u].g, p, p0i);
+	/*
+	 * At that point, Ft, Gt, ft and gt are consecutive in RAM (in that
+	 * order).
+	 */
 
-		if (u < slen) {
-			for (v = 0, x = ft + u, y = gt + u;
-				v < n; v ++, x += slen, y += slen)
-			{
-				fx[v] = *x;
-				gx[v] = *y;
-			}
-			modp_iNTT2_ext(ft + u, slen, igm, logn, p, p0i);
-			modp_iNTT2_ext(gt + u, slen, igm, logn, p, p0i);
-		} else {
-			uint32_t Rx;
-
-			Rx = modp_Rx((unsigned)slen, p, p0i, R2);
-			for (v = 0, x = ft, y = gt;
-				v < n; v ++, x += slen, y += slen)
-			{
-				fx[v] = zint_mod_small_signed(x, slen,
-					p, p0i, R2, Rx);
-				gx[v] = zint_mod_small_signed(y, slen,
-					p, p0i, R2, Rx);
-			}
-			modp_NTT2(fx, gm, logn, p, p0i);
-			modp_NTT2(gx, gm, logn, p, p0i);
-		}
-
-		/*
-		 * Get F' and G' modulo p and in NTT representation
-		 * (they have degree n/2). These values were computed in
-		 * a previous step, and stored in Ft and Gt.
-		 */
-		Fp = gx + n;
-		Gp = Fp + hn;
-		for (v = 0, x = Ft + u, y = Gt + u;
-			v < hn; v ++, x += llen, y += llen)
-		{
-			Fp[v] = *x;
-			Gp[v] = *y;
-		}
-		modp_NTT2(Fp, gm, logn - 1, p, p0i);
-		modp_NTT2(Gp, gm, logn - 1, p, p0i);
-
-		/*
-		 * Compute our F and G modulo p.
-		 *
-		 * General case:
-		 *
-		 *   we divide degree by d = 2 or 3
-		 *   f'(x^d) = N(f)(x^d) = f * adj(f)
-		 *   g'(x^d) = N(g)(x^d) = g * adj(g)
-		 *   f'*G' - g'*F' = q
-		 *   F = F'(x^d) * adj(g)
-		 *   G = G'(x^d) * adj(f)
-		 *
-		 * We compute things in the NTT. We group roots of phi
-		 * such that all roots x in a group share the same x^d.
-		 * If the roots in a group are x_1, x_2... x_d, then:
-		 *
-		 *   N(f)(x_1^d) = f(x_1)*f(x_2)*...*f(x_d)
-		 *
-		 * Thus, we have:
-		 *
-		 *   G(x_1) = f(x_2)*f(x_3)*...*f(x_d)*G'(x_1^d)
-		 *   G(x_2) = f(x_1)*f(x_3)*...*f(x_d)*G'(x_1^d)
-		 *   ...
-		 *   G(x_d) = f(x_1)*f(x_2)*...*f(x_{d-1})*G'(x_1^d)
-		 *
-		 * In all cases, we can thus compute F and G in NTT
-		 * representation by a few simple multiplications.
-		 * Moreover, in our chosen NTT representation, roots
-		 * from the same group are consecutive in RAM.
-		 */
-		for (v = 0, x = Ft + u, y = Gt + u; v < hn;
-			v ++, x += (llen << 1), y += (llen << 1))
-		{
-			uint32_t ftA, ftB, gtA, gtB;
-			uint32_t mFp, mGp;
-
-			ftA = fx[(v << 1) + 0];
-			ftB = fx[(v << 1) + 1];
-			gtA = gx[(v << 1) + 0];
-			gtB = gx[(v << 1) + 1];
-			mFp = modp_montymul(Fp[v], R2, p, p0i);
-			mGp = modp_montymul(Gp[v], R2, p, p0i);
-			x[0] = modp_montymul(gtB, mFp, p, p0i);
-			x[llen] = modp_montymul(gtA, mFp, p, p0i);
-			y[0] = modp_montymul(ftB, mGp, p, p0i);
-			y[llen] = modp_montymul(ftA, mGp, p, p0i);
-		}
-		modp_iNTT2_ext(Ft + u, llen, igm, logn, p, p0i);
-		modp_iNTT2_ext(Gt + u, llen, igm, logn, p, p0i);
-	}
-
-	/*
-	 * Rebuild F and G with the CRT.
-	 */
-	zint_rebuild_CRT(Ft, llen, llen, n, primes, 1, t1);
-	zint_rebuild_CRT(Gt, llen, llen, n, primes, 1, t1);
-
-	/*
-	 * At that point, Ft, Gt, ft and gt are consecutive in RAM (in that
-	 * order).
-	 */
-
-	/*
-	 * Apply Babai reduction to bring back F and G to size slen.
-	 *
-	 * We use the FFT to compute successive approximations of the
-	 * reduction coefficient. We first isolate the top bits of
-	 * the coefficients of f and g, and convert them to floating
-	 * point; with the FFT, we compute adj(f), adj(g), and
-	 * 1/(f*adj(f)+g*adj(g)).
-	 *
-	 * Then, we repeatedly apply the following:
-	 *
-	 *   - Get the top bits of the coefficients of F and G into
-	 *     floating point, and use the FFT to compute:
-	 *        (F*adj(f)+G*adj(g))/(f*adj(f)+g*adj(g))
-	 *
-	 *   - Convert back that value into normal representation, and
-	 *     round it to the nearest integers, yielding a polynomial k.
-	 *     Proper scaling is applied to f, g, F and G so that the
-	 *     coefficients fit on 32 bits (signed).
-	 *
-	 *   - Subtract k*f from F and k*g from G.
-	 *
-	 * Under normal conditions, this process reduces the size of F
-	 * and G by some bits at each iteration. For constant-time
-	 * operation, we do not want to measure the actual length of
-	 * F and G; instead, we do the following:
-	 *
-	 *   - f and g are converted to floating-point, with some scaling
-	 *     if necessary to keep values in the representable range.
-	 *
-	 *   - For each iteration, we _assume_ a maximum size for F and G,
-	 *     and use the values at that size. If we overreach, then
-	 *     we get zeros, which is harmless: the resulting coefficients
-	 *     of k will be 0 and the value won't be reduced.
-	 *
-	 *   - We conservatively assume that F and G will be reduced by
-	 *     at least 25 bits at each iteration.
-	 *
-	 * Even when reaching the bottom of the reduction, reduction
-	 * coefficient will remain low. If it goes out-of-range, then
-	 * something wrong occurred and the whole NTRU solving fails.
-	 */
+	/*
+	 * Apply Babai reduction to bring back F and G to size slen.
+	 *
+	 * We use the FFT to compute successive approximations of the
+	 * reduction coefficient. We first isolate the top bits of
+	 * the coefficients of f and g, and convert them to floating
+	 * point; with the FFT, we compute adj(f), adj(g), and
+	 * 1/(f*adj(f)+g*adj(g)).
+	 *
+	 * Then, we repeatedly apply the following:
+	 *
+	 *   - Get the top bits of the coefficients of F and G into
+	 *     floating point, and use the FFT to compute:
+	 *        (F*adj(f)+G*adj(g))/(f*adj(f)+g*adj(g))
+	 *
+	 *   - Convert back that value into normal representation, and
+	 *     round it to the nearest integers, yielding a polynomial k.
+	 *     Proper scaling is applied to f, g, F and G so that the
+	 *     coefficients fit on 32 bits (signed).
+	 *
+	 *   - Subtract k*f from F and k*g from G.
+	 *
+	 * Under normal conditions, this process reduces the size of F
+	 * and G by some bits at each iteration. For constant-time
+	 * operation, we do not want to measure the actual length of
+	 * F and G; instead, we do the following:
+	 *
+	 *   - f and g are converted to floating-point, with some scaling
+	 *     if necessary to keep values in the representable range.
+	 *
+	 *   - For each iteration, we _assume_ a maximum size for F and G,
+	 *     and use the values at that size. If we overreach, then
+	 *     we get zeros, which is harmless: the resulting coefficients
+	 *     of k will be 0 and the value won't be reduced.
+	 *
+	 *   - We conservatively assume that F and G will be reduced by
+	 *     at least 25 bits at each iteration.
+	 *
+	 * Even when reaching the bottom of the reduction, reduction
+	 * coefficient will remain low. If it goes out-of-range, then
+	 * something wrong occurred and the whole NTRU solving fails.
+	 */
 
 	/*
 	 * Memory layout:
@@ -3229,9 +4170,9 @@ solve_NTRU_intermediate(unsigned logn_top,
 		scl = (uint32_t)(scale_k % 31);
 		if (depth <= DEPTH_INT_FG) {
 			poly_sub_scaled_ntt(Ft, FGlen, llen, ft, slen, slen,
-				k, sch, scl, logn, t1);
+				k, sch, scl, logn, t1, pool);
 			poly_sub_scaled_ntt(Gt, FGlen, llen, gt, slen, slen,
-				k, sch, scl, logn, t1);
+				k, sch, scl, logn, t1, pool);
 		} else {
 			poly_sub_scaled(Ft, FGlen, llen, ft, slen, slen,
 				k, sch, scl, logn);
@@ -3307,7 +4248,7 @@ solve_NTRU_intermediate(unsigned logn_top,
  */
 static int
 solve_NTRU_binary_depth1(unsigned logn_top,
-	const int8_t *f, const int8_t *g, uint32_t *tmp)
+	const int8_t *f, const int8_t *g, uint32_t *tmp, kg_pool *pool)
 {
 	/*
 	 * The first half of this function is a copy of the corresponding
@@ -3373,20 +4314,15 @@ solve_NTRU_binary_depth1(unsigned logn_top,
 	 */
 	for (u = 0; u < llen; u ++) {
 		uint32_t p, p0i, R2, Rx;
-		size_t v;
-		uint32_t *xs, *ys, *xd, *yd;
 
 		p = PRIMES[u].p;
 		p0i = modp_ninv31(p);
 		R2 = modp_R2(p, p0i);
 		Rx = modp_Rx((unsigned)dlen, p, p0i, R2);
-		for (v = 0, xs = Fd, ys = Gd, xd = Ft + u, yd = Gt + u;
-			v < hn;
-			v ++, xs += dlen, ys += dlen, xd += llen, yd += llen)
-		{
-			*xd = zint_mod_small_signed(xs, dlen, p, p0i, R2, Rx);
-			*yd = zint_mod_small_signed(ys, dlen, p, p0i, R2, Rx);
-		}
+		zint_mod_small_signed_many(Ft + u, llen, Fd, dlen, dlen, hn,
+			p, p0i, R2, Rx);
+		zint_mod_small_signed_many(Gt + u, llen, Gd, dlen, dlen, hn,
+			p, p0i, R2, Rx);
 	}
 
 	/*
@@ -3555,8 +4491,8 @@ solve_NTRU_binary_depth1(unsigned logn_top,
 	 * and G are consecutive, and thus can be rebuilt in a single
 	 * loop; similarly, the elements of f and g are consecutive.
 	 */
-	zint_rebuild_CRT(Ft, llen, llen, n << 1, PRIMES, 1, t1);
-	zint_rebuild_CRT(ft, slen, slen, n << 1, PRIMES, 1, t1);
+	zint_rebuild_CRT(Ft, llen, llen, n << 1, PRIMES, 1, t1, pool);
+	zint_rebuild_CRT(ft, slen, slen, n << 1, PRIMES, 1, t1, pool);
 
 	/*
 	 * Here starts the Babai reduction, specialized for depth = 1.
@@ -3948,11 +4884,14 @@ solve_NTRU_binary_depth0(unsigned logn,
  * Solve the NTRU equation. Returned value is 1 on success, 0 on error.
  * G can be NULL, in which case that value is computed but not returned.
  * If any of the coefficients of F and G exceeds lim (in absolute value),
- * then 0 is returned.
+ * then 0 is returned. If pool is not NULL, the per-prime computations
+ * and CRT reconstructions are split between its threads; the result is
+ * the same.
  */
 static int
 solve_NTRU(unsigned logn, int8_t *F, int8_t *G,
-	const int8_t *f, const int8_t *g, int lim, uint32_t *tmp)
+	const int8_t *f, const int8_t *g, int lim, uint32_t *tmp,
+	kg_pool *pool)
 {
 	size_t n, u;
 	uint32_t *ft, *gt, *Ft, *Gt, *gm;
@@ -3975,7 +4914,9 @@ solve_NTRU(unsigned logn, int8_t *F, int8_t *G,
 
 		depth = logn;
 		while (depth -- > 0) {
-			if (!solve_NTRU_intermediate(logn, f, g, depth, tmp)) {
+			if (!solve_NTRU_intermediate(logn,
+				f, g, depth, tmp, pool))
+			{
 				return 0;
 			}
 		}
@@ -3984,11 +4925,13 @@ solve_NTRU(unsigned logn, int8_t *F, int8_t *G,
 
 		depth = logn;
 		while (depth -- > 2) {
-			if (!solve_NTRU_intermediate(logn, f, g, depth, tmp)) {
+			if (!solve_NTRU_intermediate(logn,
+				f, g, depth, tmp, pool))
+			{
 				return 0;
 			}
 		}
-		if (!solve_NTRU_binary_depth1(logn, f, g, tmp)) {
+		if (!solve_NTRU_binary_depth1(logn, f, g, tmp, pool)) {
 			return 0;
 		}
 		if (!solve_NTRU_binary_depth0(logn, f, g, tmp)) {
@@ -4101,33 +5044,119 @@ poly_small_mkgauss(RNG_CONTEXT *rng, int8_t *f, unsigned logn)
 	}
 }
 
-/* see falcon.h */
+/* see inner.h */
 void
-Zf(keygen)(inner_shake256_context *rng,
-	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
+Zf(keygen_bench_kernel)(unsigned kernel, uint32_t *data, size_t len,
+	unsigned logn)
+{
+	size_t n, u;
+	uint32_t *x, *y;
+
+	n = MKN(logn);
+	x = data;
+	y = data + len * n;
+	switch (kernel) {
+	case FALCON_KG_BENCH_REBUILD_CRT:
+		zint_rebuild_CRT(x, len, len, n, PRIMES, 1, y, NULL);
+		break;
+	case FALCON_KG_BENCH_MOD_SMALL:
+		for (u = 0; u < len; u ++) {
+			uint32_t p, p0i, R2, Rx;
+
+			p = PRIMES[u].p;
+			p0i = modp_ninv31(p);
+			R2 = modp_R2(p, p0i);
+			Rx = modp_Rx((unsigned)len, p, p0i, R2);
+			zint_mod_small_signed_many(y + u, len, x, len, len, n,
+				p, p0i, R2, Rx);
+		}
+		break;
+	case FALCON_KG_BENCH_POLY_SUB_SCALED:
+		poly_sub_scaled(x, len, len, y, len, len,
+			(const int32_t *)(y + len * n), 0, 5, logn);
+		break;
+	case FALCON_KG_BENCH_BEZOUT:
+		x[0] |= 1;
+		y[0] |= 1;
+		(void)zint_bezout(y + len, y + 2 * len, x, y, len, y + 3 * len);
+		break;
+	}
+}
+
+/*
+ * Last checks on a candidate (f,g) whose coefficients and norm of (g,-f)
+ * are within bounds: norm of the orthogonalized vector, and invertibility
+ * of f modulo q. The public key h is computed (in tmp[] if h is NULL).
+ * Returned value is 1 if the candidate is acceptable, 0 otherwise.
+ */
+static int
+keygen_candidate_finish(const int8_t *f, const int8_t *g, uint16_t *h,
 	unsigned logn, uint8_t *tmp)
 {
+	size_t n;
+	fpr *rt1, *rt2, *rt3;
+	fpr bnorm;
+	int16_t *h2, *tmp2;
+
+	n = MKN(logn);
+
 	/*
-	 * Algorithm is the following:
-	 *
-	 *  - Generate f and g with the Gaussian distribution.
-	 *
-	 *  - If either Res(f,phi) or Res(g,phi) is even, try again.
-	 *
-	 *  - If ||(f,g)|| is too large, try again.
-	 *
-	 *  - If ||B~_{f,g}|| is too large, try again.
-	 *
-	 *  - If f is not invertible mod phi mod q, try again.
-	 *
-	 *  - Compute h = g/f mod phi mod q.
-	 *
-	 *  - Solve the NTRU equation fG - gF = q; if the solving fails,
-	 *    try again. Usual failure condition is when Res(f,phi)
-	 *    and Res(g,phi) are not prime to each other.
+	 * We compute the orthogonalized vector norm.
+	 */
+	rt1 = (fpr *)tmp;
+	rt2 = rt1 + n;
+	rt3 = rt2 + n;
+
+	poly_small_to_fp(rt1, f, logn);
+	ZfN(FFT)(rt1, logn);
+	ZfN(poly_adj_fft)(rt1, rt1, logn);
+
+	poly_small_to_fp(rt2, g, logn);
+	ZfN(FFT)(rt2, logn);
+	ZfN(poly_adj_fft)(rt2, rt2, logn);
+
+	ZfN(poly_invnorm2_fft)(rt3, rt1, rt2, logn);
+
+	ZfN(poly_mulconst)(rt1, rt1, fpr_q, logn);
+	ZfN(poly_mul_autoadj_fft)(rt1, rt1, rt3, logn);
+	ZfN(iFFT)(rt1, logn);
+
+	ZfN(poly_mulconst)(rt2, rt2, fpr_q, logn);
+	ZfN(poly_mul_autoadj_fft)(rt2, rt2, rt3, logn);
+	ZfN(iFFT)(rt2, logn);
+
+	bnorm = ZfN(compute_bnorm)(rt1, rt2);
+
+	if (!fpr_lt(bnorm, fpr_bnorm_max)) {
+		return 0;
+	}
+
+	/*
+	 * Compute public key h = g/f mod X^N+1 mod q. If this
+	 * fails, we must restart.
 	 */
+	if (h == NULL) {
+		h2 = (int16_t *)tmp;
+		tmp2 = h2 + n;
+	} else {
+		h2 = (int16_t *)h;
+		tmp2 = (int16_t *)tmp;
+	}
+	return Zf(compute_public)(h2, f, g, tmp2);
+}
+
+/*
+ * First key generation stage: sample (f,g) until a candidate passes
+ * all the cheap checks (coefficient bounds, norm of (g,-f), norm of the
+ * orthogonalized vector, invertibility of f modulo q), and compute the
+ * public key h. If h is NULL, the public key is computed in tmp[] and
+ * discarded.
+ */
+static void
+keygen_candidate(inner_shake256_context *rng,
+	int8_t *f, int8_t *g, uint16_t *h, unsigned logn, uint8_t *tmp)
+{
 	size_t n, u;
-	int16_t *h2, *tmp2;
 	RNG_CONTEXT *rc;
 
 	n = MKN(logn);
@@ -4153,8 +5182,6 @@ Zf(keygen)(inner_shake256_context *rng,
 	 * NTRU equation solver requires it).
 	 */
 	for (;;) {
-		fpr *rt1, *rt2, *rt3;
-		fpr bnorm;
 		uint32_t normf, normg, norm;
 		int lim;
 
@@ -4205,63 +5232,745 @@ Zf(keygen)(inner_shake256_context *rng,
 		}
 
 		/*
-		 * We compute the orthogonalized vector norm.
+		 * Check the orthogonalized vector norm and compute the
+		 * public key.
 		 */
-		rt1 = (fpr *)tmp;
-		rt2 = rt1 + n;
-		rt3 = rt2 + n;
-		
-        poly_small_to_fp(rt1, f, logn);
-		ZfN(FFT)(rt1, logn);
-		ZfN(poly_adj_fft)(rt1, rt1, logn);
+		if (!keygen_candidate_finish(f, g, h, logn, tmp)) {
+			continue;
+		}
 
-		poly_small_to_fp(rt2, g, logn);
-		ZfN(FFT)(rt2, logn);
-		ZfN(poly_adj_fft)(rt2, rt2, logn);
+		/*
+		 * Candidate is acceptable.
+		 */
+		return;
+	}
+}
 
-		ZfN(poly_invnorm2_fft)(rt3, rt1, rt2, logn);
+/*
+ * Second key generation stage: solve the NTRU equation to get F and G.
+ * Returned value is 1 on success, 0 if the candidate must be discarded.
+ */
+static int
+keygen_solve(const int8_t *f, const int8_t *g, int8_t *F, int8_t *G,
+	unsigned logn, uint8_t *tmp, kg_pool *pool)
+{
+	int lim;
 
-		ZfN(poly_mulconst)(rt1, rt1, fpr_q, logn);
-		ZfN(poly_mul_autoadj_fft)(rt1, rt1, rt3, logn);
-		ZfN(iFFT)(rt1, logn);
-        
-		ZfN(poly_mulconst)(rt2, rt2, fpr_q, logn);
-		ZfN(poly_mul_autoadj_fft)(rt2, rt2, rt3, logn);
-		ZfN(iFFT)(rt2, logn);
+	lim = (1 << (Zf(max_FG_bits)[logn] - 1)) - 1;
+	return solve_NTRU(logn, F, G, f, g, lim, (uint32_t *)tmp, pool);
+}
 
-        bnorm = ZfN(compute_bnorm)(rt1, rt2);
+/*
+ * Key pair generation (see Zf(keygen)()); pool is passed to solve_NTRU().
+ */
+static void
+keygen_inner(inner_shake256_context *rng,
+	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
+	unsigned logn, uint8_t *tmp, kg_pool *pool)
+{
+	/*
+	 * Algorithm is the following:
+	 *
+	 *  - Generate f and g with the Gaussian distribution.
+	 *
+	 *  - If either Res(f,phi) or Res(g,phi) is even, try again.
+	 *
+	 *  - If ||(f,g)|| is too large, try again.
+	 *
+	 *  - If ||B~_{f,g}|| is too large, try again.
+	 *
+	 *  - If f is not invertible mod phi mod q, try again.
+	 *
+	 *  - Compute h = g/f mod phi mod q.
+	 *
+	 *  - Solve the NTRU equation fG - gF = q; if the solving fails,
+	 *    try again. Usual failure condition is when Res(f,phi)
+	 *    and Res(g,phi) are not prime to each other.
+	 */
+	for (;;) {
+		keygen_candidate(rng, f, g, h, logn, tmp);
+		if (keygen_solve(f, g, F, G, logn, tmp, pool)) {
+			break;
+		}
+	}
+}
 
-		if (!fpr_lt(bnorm, fpr_bnorm_max)) {
+/* see inner.h */
+void
+Zf(keygen)(inner_shake256_context *rng,
+	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
+	unsigned logn, uint8_t *tmp)
+{
+	keygen_inner(rng, f, g, F, G, h, logn, tmp, NULL);
+}
+
+/* see inner.h */
+void
+Zf(keygen_mt)(inner_shake256_context *rng,
+	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
+	unsigned logn, uint8_t *tmp, unsigned nthreads, uint32_t *scratch)
+{
+#if FALCON_KG_THREADS
+	kg_pool pool;
+
+	if (kg_pool_init(&pool, nthreads,
+		scratch, FALCON_KEYGEN_MT_SCRATCH(logn)))
+	{
+		keygen_inner(rng, f, g, F, G, h, logn, tmp, &pool);
+		kg_pool_close(&pool);
+		return;
+	}
+#else
+	(void)nthreads;
+	(void)scratch;
+#endif
+	keygen_inner(rng, f, g, F, G, h, logn, tmp, NULL);
+}
+
+/* see inner.h */
+Zf(keygen_pool) *
+Zf(keygen_pool_new)(unsigned logn, unsigned nthreads)
+{
+#if FALCON_KG_THREADS
+	kg_pool *pool;
+	uint32_t *scratch;
+
+	if (nthreads > FALCON_KG_MAX_THREADS) {
+		nthreads = FALCON_KG_MAX_THREADS;
+	}
+	if (nthreads < 2) {
+		return NULL;
+	}
+	pool = malloc(sizeof *pool);
+	scratch = malloc((size_t)nthreads
+		* FALCON_KEYGEN_MT_SCRATCH(logn) * sizeof *scratch);
+	if (pool == NULL || scratch == NULL
+		|| !kg_pool_init(pool, nthreads,
+		scratch, FALCON_KEYGEN_MT_SCRATCH(logn)))
+	{
+		free(pool);
+		free(scratch);
+		return NULL;
+	}
+	return pool;
+#else
+	(void)logn;
+	(void)nthreads;
+	return NULL;
+#endif
+}
+
+/* see inner.h */
+void
+Zf(keygen_pool_free)(Zf(keygen_pool) *pool)
+{
+#if FALCON_KG_THREADS
+	if (pool != NULL) {
+		kg_pool_close(pool);
+		free(pool->scratch);
+		free(pool);
+	}
+#else
+	(void)pool;
+#endif
+}
+
+/* see inner.h */
+void
+Zf(keygen_pooled)(inner_shake256_context *rng,
+	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
+	unsigned logn, uint8_t *tmp, Zf(keygen_pool) *pool)
+{
+	keygen_inner(rng, f, g, F, G, h, logn, tmp, pool);
+}
+
+/* ==================================================================== */
+/*
+ * Bulk key generation (see Zf(keygen_many)()).
+ *
+ * Each key uses its own SHAKE256 context, seeded from the master RNG in
+ * index order; thus, key i does not depend on the number of threads or
+ * on scheduling. Candidates (f,g,h) that pass the cheap checks of
+ * keygen_candidate() are queued in slots; a thread first looks for a
+ * queued candidate to run the NTRU solver on, and otherwise filters a
+ * new candidate into one of its own free slots. Each thread owns two
+ * slots, so that filtering runs ahead of the solvers. A candidate
+ * rejected by the solver is replaced by the next candidate from the
+ * same RNG, exactly as in keygen_inner().
+ *
+ * When both slots of a thread are free (and in the sequential path),
+ * two keys are filtered together with keygen_candidate_x2(), which
+ * samples their candidates in the two lanes of NEON registers.
+ *
+ * Per-thread area (FALCON_KEYGEN_MANY_TEMP(logn) bytes):
+ *   two SHAKE256 contexts (256 bytes each)
+ *   work area for keygen_candidate() and keygen_solve()
+ *   h for both slots (2*n elements)
+ *   F, G, then f and g for both slots (6*n bytes)
+ */
+#define KG_SLOT_FREE     0
+#define KG_SLOT_FILTER   1
+#define KG_SLOT_READY    2
+#define KG_SLOT_SOLVE    3
+
+#define KG_WORK_SIZE(logn)   ((logn) <= 3 ? 272u : (28u << (logn)))
+
+typedef struct {
+	inner_shake256_context *rc;
+	int8_t *f, *g;
+	uint16_t *h;
+	size_t index;
+	int state;
+} kg_slot;
+
+/*
+ * Get the per-thread area for thread id, and set the pointers of its
+ * two slots. F and G receive the solver output.
+ */
+static uint8_t *
+kg_many_area(uint8_t *tmp, unsigned logn, unsigned id,
+	kg_slot *slots, int8_t **F, int8_t **G)
+{
+	size_t n;
+	uint8_t *base, *work;
+	uint16_t *h;
+	int8_t *b;
+
+	n = MKN(logn);
+	base = tmp + (size_t)id * FALCON_KEYGEN_MANY_TEMP(logn);
+	work = base + 512;
+	h = (uint16_t *)(work + KG_WORK_SIZE(logn));
+	b = (int8_t *)(h + 2 * n);
+	*F = b;
+	*G = b + n;
+	b += 2 * n;
+	slots[0].rc = (inner_shake256_context *)base;
+	slots[0].f = b;
+	slots[0].g = b + n;
+	slots[0].h = h;
+	slots[1].rc = (inner_shake256_context *)(base + 256);
+	slots[1].f = b + 2 * n;
+	slots[1].g = b + 3 * n;
+	slots[1].h = h + n;
+	return work;
+}
+
+/*
+ * Initialize a per-key RNG from the next seed of the master RNG, as
+ * shake256_init_prng_from_seed() does.
+ */
+static void
+kg_many_seed(inner_shake256_context *rng, inner_shake256_context *rc)
+{
+	uint8_t seed[48];
+
+	inner_shake256_extract(rng, seed, sizeof seed);
+	inner_shake256_init(rc);
+	inner_shake256_inject(rc, seed, sizeof seed);
+}
+
+/*
+ * Two per-key RNGs read in lockstep, with the two-lane SHAKE256 code.
+ * Both RNGs must be at the same position, which must be a multiple of 8
+ * (kg_rng_x2_init() returns 0 otherwise); buf[j] then contains the
+ * current output block of RNG j, and ptr is the common read offset.
+ */
+typedef struct {
+	inner_shake256x2_context sc2;
+	uint8_t buf[2][136];
+	unsigned ptr;
+} kg_rng_x2;
+
+static int
+kg_rng_x2_init(kg_rng_x2 *rx,
+	const inner_shake256_context *rc0, const inner_shake256_context *rc1)
+{
+	const inner_shake256_context *rc[2];
+	unsigned j, k;
+
+	if (rc0->dptr != rc1->dptr || (rc0->dptr & 7) != 0) {
+		return 0;
+	}
+	rc[0] = rc0;
+	rc[1] = rc1;
+	for (j = 0; j < 2; j ++) {
+		Zf(i_shake256x2_set)(&rx->sc2, j, rc[j]);
+		for (k = 0; k < 136; k ++) {
+			rx->buf[j][k] = (uint8_t)(rc[j]->st.A[k >> 3]
+				>> ((k & 7) << 3));
+		}
+	}
+	rx->ptr = (unsigned)rc0->dptr;
+	return 1;
+}
+
+/*
+ * Write back RNG j into rc, at the position the scalar code would have
+ * reached after the same number of get_rng_u64() calls.
+ */
+static void
+kg_rng_x2_get(const kg_rng_x2 *rx, unsigned j, inner_shake256_context *rc)
+{
+	Zf(i_shake256x2_get)(&rx->sc2, j, rc);
+	rc->dptr = rx->ptr;
+}
+
+/*
+ * Two-lane get_rng_u64(): lane j is the next 64-bit value of RNG j.
+ */
+static inline uint64x2_t
+get_rng_u64_x2(kg_rng_x2 *rx)
+{
+	uint64x2_t r;
+
+	if (rx->ptr == 136) {
+		Zf(i_shake256x2_squeeze)(&rx->sc2, rx->buf[0], rx->buf[1]);
+		rx->ptr = 0;
+	}
+	r = vcombine_u64(
+		vreinterpret_u64_u8(vld1_u8(rx->buf[0] + rx->ptr)),
+		vreinterpret_u64_u8(vld1_u8(rx->buf[1] + rx->ptr)));
+	rx->ptr += 8;
+	return r;
+}
+
+/*
+ * Two-lane mkgauss(): s[j] is the value mkgauss() returns for RNG j.
+ * Comparisons with the table use full-width lane masks instead of the
+ * sign bit of the difference; since both operands are lower than 2^63,
+ * this selects the same entries.
+ */
+static void
+mkgauss_x2(kg_rng_x2 *rx, unsigned logn, int *s)
+{
+	unsigned u, g, k;
+	uint64x2_t m63;
+	int64x2_t val;
+
+	g = 1U << (10 - logn);
+	m63 = vdupq_n_u64(((uint64_t)1 << 63) - 1);
+	val = vdupq_n_s64(0);
+	for (u = 0; u < g; u ++) {
+		uint64x2_t r, f, v, neg;
+
+		r = get_rng_u64_x2(rx);
+		neg = vreinterpretq_u64_s64(
+			vshrq_n_s64(vreinterpretq_s64_u64(r), 63));
+		r = vandq_u64(r, m63);
+		f = vcltq_u64(r, vdupq_n_u64(gauss_1024_12289[0]));
+
+		v = vdupq_n_u64(0);
+		r = vandq_u64(get_rng_u64_x2(rx), m63);
+		for (k = 1; k < (sizeof gauss_1024_12289)
+			/ (sizeof gauss_1024_12289[0]); k ++)
+		{
+			uint64x2_t t;
+
+			t = vcgeq_u64(r, vdupq_n_u64(gauss_1024_12289[k]));
+			v = vorrq_u64(v, vandq_u64(vbicq_u64(t, f),
+				vdupq_n_u64(k)));
+			f = vorrq_u64(f, t);
+		}
+
+		v = vsubq_u64(veorq_u64(v, neg), neg);
+		val = vaddq_s64(val, vreinterpretq_s64_u64(v));
+	}
+	s[0] = (int)vgetq_lane_s64(val, 0);
+	s[1] = (int)vgetq_lane_s64(val, 1);
+}
+
+/*
+ * Candidate sampling state for one key: u is the index of the next
+ * coefficient (f then g), mod2 the parity of the current polynomial so
+ * far, and norm the squared norm of (g,-f) so far; bad is set when a
+ * coefficient exceeds the max_fg_bits bound.
+ */
+typedef struct {
+	int8_t *f, *g;
+	size_t u;
+	unsigned mod2;
+	uint32_t norm;
+	int bad;
+} kg_lane;
+
+/*
+ * Add Gaussian value s to the candidate of lane ln, with the same
+ * rejection rules as poly_small_mkgauss() (s is dropped if it must be
+ * resampled). When (f,g) is complete, the lane is reset for the next
+ * candidate, and 1 is returned if the coefficient bound and the norm of
+ * (g,-f) checks of keygen_candidate() are passed.
+ */
+static int
+kg_lane_push(kg_lane *ln, int s, unsigned logn, int lim)
+{
+	size_t n;
+	int r;
+
+	n = MKN(logn);
+	if (s < -127 || s > 127) {
+		return 0;
+	}
+	if ((ln->u & (n - 1)) == n - 1) {
+		if ((ln->mod2 ^ (unsigned)(s & 1)) == 0) {
+			return 0;
+		}
+		ln->mod2 = 0;
+	} else {
+		ln->mod2 ^= (unsigned)(s & 1);
+	}
+	if (ln->u < n) {
+		ln->f[ln->u] = (int8_t)s;
+	} else {
+		ln->g[ln->u - n] = (int8_t)s;
+	}
+	ln->norm += (uint32_t)(s * s);
+	ln->bad |= (s >= lim) | (s <= -lim);
+	if (++ ln->u < 2 * n) {
+		return 0;
+	}
+	r = !ln->bad && ln->norm < 16823;
+	ln->u = 0;
+	ln->norm = 0;
+	ln->bad = 0;
+	return r;
+}
+
+/*
+ * Run keygen_candidate() for the two slots, which must have distinct
+ * RNGs. While both keys are still looking for a candidate, their values
+ * are sampled side by side (two-lane SHAKE256 and table lookups); each
+ * key consumes its own RNG exactly as keygen_candidate() would, so the
+ * results are identical. The squared norm of (g,-f) is summed as the
+ * coefficients are produced. The orthogonalized vector norm and the
+ * public key are computed one candidate at a time, since the NEON FFT
+ * code already uses both lanes of each register for one polynomial.
+ * When one key is done, the other one continues with the scalar RNG.
+ */
+static void
+keygen_candidate_x2(kg_slot *s0, kg_slot *s1, unsigned logn, uint8_t *tmp)
+{
+	kg_rng_x2 rx;
+	kg_lane ln[2];
+	kg_slot *sl[2];
+	unsigned j, live;
+	int lim;
+
+	if (!kg_rng_x2_init(&rx, s0->rc, s1->rc)) {
+		keygen_candidate(s0->rc, s0->f, s0->g, s0->h, logn, tmp);
+		keygen_candidate(s1->rc, s1->f, s1->g, s1->h, logn, tmp);
+		return;
+	}
+	sl[0] = s0;
+	sl[1] = s1;
+	for (j = 0; j < 2; j ++) {
+		ln[j].f = sl[j]->f;
+		ln[j].g = sl[j]->g;
+		ln[j].u = 0;
+		ln[j].mod2 = 0;
+		ln[j].norm = 0;
+		ln[j].bad = 0;
+	}
+	lim = 1 << (Zf(max_fg_bits)[logn] - 1);
+	live = 3;
+	while (live == 3) {
+		int s[2];
+
+		mkgauss_x2(&rx, logn, s);
+		for (j = 0; j < 2; j ++) {
+			if (kg_lane_push(&ln[j], s[j], logn, lim)
+				&& keygen_candidate_finish(ln[j].f, ln[j].g,
+				sl[j]->h, logn, tmp))
+			{
+				live &= ~(1u << j);
+			}
+		}
+	}
+	kg_rng_x2_get(&rx, 0, s0->rc);
+	kg_rng_x2_get(&rx, 1, s1->rc);
+	for (j = 0; j < 2; j ++) {
+		if (((live >> j) & 1) == 0) {
 			continue;
 		}
+		for (;;) {
+			if (kg_lane_push(&ln[j], mkgauss(sl[j]->rc, logn),
+				logn, lim)
+				&& keygen_candidate_finish(ln[j].f, ln[j].g,
+				sl[j]->h, logn, tmp))
+			{
+				break;
+			}
+		}
+	}
+}
+
+#if FALCON_KG_THREADS
+
+typedef struct {
+	inner_shake256_context *rng;
+	unsigned logn;
+	uint8_t *tmp;
+	Zf(keygen_emit) emit;
+	void *ctx;
+	size_t count, next;
+	unsigned nslots, inuse;
+	int ret;
+	kg_slot slots[2 * FALCON_KG_MAX_THREADS];
+	pthread_mutex_t lock, emit_lock;
+	pthread_cond_t cv;
+} kg_many;
+
+typedef struct {
+	kg_many *km;
+	unsigned id;
+	pthread_t th;
+} kg_many_thread;
+
+/*
+ * Thread body. km->ret is written with both locks held, so that it can
+ * be read with either.
+ */
+static void
+kg_many_run(kg_many *km, unsigned id)
+{
+	unsigned logn, u;
+	uint8_t *work;
+	int8_t *F, *G;
+	kg_slot *own;
+
+	logn = km->logn;
+	own = &km->slots[2 * id];
+	work = kg_many_area(km->tmp, logn, id, own, &F, &G);
+	pthread_mutex_lock(&km->lock);
+	for (;;) {
+		kg_slot *s, *s2;
 
 		/*
-		 * Compute public key h = g/f mod X^N+1 mod q. If this
-		 * fails, we must restart.
+		 * Solve the queued candidate with the lowest index.
 		 */
-		if (h == NULL) {
-			h2 = (int16_t *)tmp;
-			tmp2 = h2 + n;
-		} else {
-			h2 = (int16_t *)h;
-			tmp2 = (int16_t *)tmp;
+		s = NULL;
+		s2 = NULL;
+		for (u = 0; u < km->nslots; u ++) {
+			if (km->slots[u].state == KG_SLOT_READY
+				&& (s == NULL || km->slots[u].index < s->index))
+			{
+				s = &km->slots[u];
+			}
 		}
-        
-		if (!Zf(compute_public)(h2, f, g, tmp2)) {
+		if (s != NULL) {
+			s->state = KG_SLOT_SOLVE;
+			pthread_mutex_unlock(&km->lock);
+			while (!keygen_solve(s->f, s->g, F, G, logn, work, NULL)) {
+				keygen_candidate(s->rc, s->f, s->g, s->h,
+					logn, work);
+			}
+			pthread_mutex_lock(&km->emit_lock);
+			if (km->ret == 0) {
+				int r;
+
+				r = km->emit(km->ctx, s->index,
+					s->f, s->g, F, G, s->h);
+				if (r != 0) {
+					pthread_mutex_lock(&km->lock);
+					km->ret = r;
+					pthread_mutex_unlock(&km->lock);
+				}
+			}
+			pthread_mutex_unlock(&km->emit_lock);
+			pthread_mutex_lock(&km->lock);
+			s->state = KG_SLOT_FREE;
+			km->inuse --;
+			pthread_cond_broadcast(&km->cv);
 			continue;
 		}
 
 		/*
-		 * Solve the NTRU equation to get F and G.
+		 * Otherwise, filter new candidates into the free own
+		 * slots; two keys are filtered together when both slots
+		 * are free.
 		 */
-		lim = (1 << (Zf(max_FG_bits)[logn] - 1)) - 1;
-		if (!solve_NTRU(logn, F, G, f, g, lim, (uint32_t *)tmp)) {
+		if (km->next < km->count && km->ret == 0) {
+			if (own[0].state == KG_SLOT_FREE) {
+				s = &own[0];
+				if (own[1].state == KG_SLOT_FREE
+					&& km->count - km->next >= 2)
+				{
+					s2 = &own[1];
+				}
+			} else if (own[1].state == KG_SLOT_FREE) {
+				s = &own[1];
+			}
+		}
+		if (s != NULL) {
+			s->index = km->next ++;
+			s->state = KG_SLOT_FILTER;
+			km->inuse ++;
+			kg_many_seed(km->rng, s->rc);
+			if (s2 != NULL) {
+				s2->index = km->next ++;
+				s2->state = KG_SLOT_FILTER;
+				km->inuse ++;
+				kg_many_seed(km->rng, s2->rc);
+			}
+			pthread_mutex_unlock(&km->lock);
+			if (s2 != NULL) {
+				keygen_candidate_x2(s, s2, logn, work);
+			} else {
+				keygen_candidate(s->rc, s->f, s->g, s->h,
+					logn, work);
+			}
+			pthread_mutex_lock(&km->lock);
+			s->state = KG_SLOT_READY;
+			if (s2 != NULL) {
+				s2->state = KG_SLOT_READY;
+			}
+			pthread_cond_broadcast(&km->cv);
 			continue;
 		}
 
-		/*
-		 * Key pair is generated.
-		 */
-		break;
+		if (km->inuse == 0
+			&& (km->next == km->count || km->ret != 0))
+		{
+			break;
+		}
+		pthread_cond_wait(&km->cv, &km->lock);
+	}
+	pthread_mutex_unlock(&km->lock);
+}
+
+static void *
+kg_many_main(void *arg)
+{
+	kg_many_thread *t;
+
+	t = arg;
+	kg_many_run(t->km, t->id);
+	return NULL;
+}
+
+/*
+ * Run the threaded generator; the result is left in km->ret. Returned
+ * value is 0 if no extra thread could be started (nothing was done in
+ * that case), 1 otherwise.
+ */
+static int
+kg_many_threaded(kg_many *km, unsigned nthreads)
+{
+	kg_many_thread th[FALCON_KG_MAX_THREADS];
+	unsigned u, v;
+
+	if (pthread_mutex_init(&km->lock, NULL) != 0) {
+		return 0;
+	}
+	if (pthread_mutex_init(&km->emit_lock, NULL) != 0) {
+		pthread_mutex_destroy(&km->lock);
+		return 0;
+	}
+	if (pthread_cond_init(&km->cv, NULL) != 0) {
+		pthread_mutex_destroy(&km->emit_lock);
+		pthread_mutex_destroy(&km->lock);
+		return 0;
+	}
+	for (u = 0; u < 2 * nthreads; u ++) {
+		km->slots[u].state = KG_SLOT_FREE;
+	}
+	km->nslots = 2 * nthreads;
+	km->inuse = 0;
+	km->next = 0;
+	km->ret = 0;
+
+	/*
+	 * Thread creation is done with the lock held, so that no key
+	 * is started before we know how many threads we have (slots
+	 * of threads that failed to start are never used).
+	 */
+	pthread_mutex_lock(&km->lock);
+	for (u = 1; u < nthreads; u ++) {
+		th[u].km = km;
+		th[u].id = u;
+		if (pthread_create(&th[u].th, NULL,
+			kg_many_main, &th[u]) != 0)
+		{
+			break;
+		}
+	}
+	km->nslots = 2 * u;
+	pthread_mutex_unlock(&km->lock);
+	if (u >= 2) {
+		kg_many_run(km, 0);
+	}
+	for (v = 1; v < u; v ++) {
+		pthread_join(th[v].th, NULL);
+	}
+	pthread_cond_destroy(&km->cv);
+	pthread_mutex_destroy(&km->emit_lock);
+	pthread_mutex_destroy(&km->lock);
+	return u >= 2;
+}
+
+#endif
+
+/* see inner.h */
+int
+Zf(keygen_many)(inner_shake256_context *rng, unsigned logn,
+	size_t count, unsigned nthreads,
+	Zf(keygen_emit) emit, void *ctx, uint8_t *tmp)
+{
+	kg_slot slots[2];
+	uint8_t *work;
+	int8_t *F, *G;
+	size_t i, m;
+
+	if (nthreads > FALCON_KG_MAX_THREADS) {
+		nthreads = FALCON_KG_MAX_THREADS;
+	}
+#if FALCON_KG_THREADS
+	if (nthreads >= 2 && count >= 2) {
+		kg_many km;
+
+		km.rng = rng;
+		km.logn = logn;
+		km.tmp = tmp;
+		km.emit = emit;
+		km.ctx = ctx;
+		km.count = count;
+		if (kg_many_threaded(&km, nthreads)) {
+			return km.ret;
+		}
+	}
+#endif
+
+	/*
+	 * Sequential generation, two keys at a time: candidates are
+	 * filtered for both keys, then solved and emitted in order.
+	 */
+	work = kg_many_area(tmp, logn, 0, slots, &F, &G);
+	for (i = 0; i < count; i += m) {
+		size_t k;
+
+		kg_many_seed(rng, slots[0].rc);
+		if (count - i >= 2) {
+			m = 2;
+			kg_many_seed(rng, slots[1].rc);
+			keygen_candidate_x2(&slots[0], &slots[1], logn, work);
+		} else {
+			m = 1;
+			keygen_candidate(slots[0].rc, slots[0].f, slots[0].g,
+				slots[0].h, logn, work);
+		}
+		for (k = 0; k < m; k ++) {
+			kg_slot *s;
+			int r;
+
+			s = &slots[k];
+			while (!keygen_solve(s->f, s->g, F, G, logn, work, NULL)) {
+				keygen_candidate(s->rc, s->f, s->g, s->h,
+					logn, work);
+			}
+			r = emit(ctx, i + k, s->f, s->g, F, G, s->h);
+			if (r != 0) {
+				return r;
+			}
+		}
 	}
+	return 0;
 }
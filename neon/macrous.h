@@ -471,4 +471,27 @@
     c.val[2] = vaddq_s16(a.val[2], b.val[2]); \
     c.val[3] = vaddq_s16(a.val[3], b.val[3]);
 
+#define vsub_x2(c, a, b)                      \
+    c.val[0] = vsubq_s16(a.val[0], b.val[0]); \
+    c.val[1] = vsubq_s16(a.val[1], b.val[1]);
+
+// ------------ Squared norm ------------
+/*
+ * Accumulate 2*a^2 with saturation, low halves in s, high halves in sh
+ * (same accumulation as is_short())
+ */
+#define sqnorm(s, sh, a)                                     \
+    s = vqdmlal_s16(s, vget_low_s16(a), vget_low_s16(a)); \
+    sh = vqdmlal_high_s16(sh, a, a);
+
+#define sqnorm_x2(s, sh, a)   \
+    sqnorm(s, sh, a.val[0]); \
+    sqnorm(s, sh, a.val[1]);
+
+#define sqnorm_x4(s, sh, a)   \
+    sqnorm(s, sh, a.val[0]); \
+    sqnorm(s, sh, a.val[1]); \
+    sqnorm(s, sh, a.val[2]); \
+    sqnorm(s, sh, a.val[3]);
+
 #endif
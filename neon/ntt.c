@@ -29,20 +29,39 @@
 #include <stdio.h>
 
 /*
- * Assume Input in the range [-Q/2, Q/2]
- * Total Barrett point for N = 512, 1024: 2048, 4096
+ * Reduce the accumulators of sqnorm() to the saturated squared norm
+ * (as in is_short())
  */
-void ZfN(poly_ntt)(int16_t a[FALCON_N], ntt_domain_t mont)
+static inline uint32_t sqnorm_reduce(int32x4_t neon_s, int32x4_t neon_sh)
+{
+    int32x2_t tmp;
+
+    neon_s = vhaddq_s32(neon_s, neon_sh);
+    tmp = vqadd_s32(vget_low_s32(neon_s), vget_high_s32(neon_s));
+    return (uint32_t)vqadds_s32(vget_lane_s32(tmp, 0), vget_lane_s32(tmp, 1));
+}
+
+/*
+ * Forward NTT of s[] into a[] (s = a for the in-place transform).
+ * If h != NULL, the output is also multiplied by h[] (pointwise,
+ * Montgomery) before it is stored, and the squared norm of s[] is
+ * accumulated as s[] is loaded; it is returned, 0 otherwise.
+ */
+static inline uint32_t poly_ntt_core(int16_t a[FALCON_N], const int16_t s[FALCON_N],
+                                     ntt_domain_t mont, const int16_t h[FALCON_N])
 {
     // Total SIMD registers 29 = 16 + 12 + 1
     int16x8x4_t v0, v1, v2, v3; // 16
     int16x8x4_t zl, zh, t, t2;  // 12
     int16x8x2_t zlh, zhh;       // 4
     int16x8_t neon_qmvq;        // 1
+    int32x4_t neon_s, neon_sh;  // 2
     const int16_t *ptr_ntt_br = ntt_br;
     const int16_t *ptr_ntt_qinv_br = ntt_qinv_br;
 
     neon_qmvq = vld1q_s16(qmvq);
+    neon_s = vdupq_n_s32(0);
+    neon_sh = vdupq_n_s32(0);
     zl.val[0] = vld1q_s16(ptr_ntt_br);
     zh.val[0] = vld1q_s16(ptr_ntt_qinv_br);
     ptr_ntt_br += 8;
@@ -52,10 +71,18 @@ void ZfN(poly_ntt)(int16_t a[FALCON_N], ntt_domain_t mont)
     // Layer 8, 7
     for (unsigned j = 0; j < 128; j += 32)
     {
-        vload_s16_x4(v0, &a[j]);
-        vload_s16_x4(v1, &a[j + 128]);
-        vload_s16_x4(v2, &a[j + 256]);
-        vload_s16_x4(v3, &a[j + 384]);
+        vload_s16_x4(v0, &s[j]);
+        vload_s16_x4(v1, &s[j + 128]);
+        vload_s16_x4(v2, &s[j + 256]);
+        vload_s16_x4(v3, &s[j + 384]);
+
+        if (h != NULL)
+        {
+            sqnorm_x4(neon_s, neon_sh, v0);
+            sqnorm_x4(neon_s, neon_sh, v1);
+            sqnorm_x4(neon_s, neon_sh, v2);
+            sqnorm_x4(neon_s, neon_sh, v3);
+        }
 
         // v0: .5
         // v1: .5
@@ -107,15 +134,27 @@ void ZfN(poly_ntt)(int16_t a[FALCON_N], ntt_domain_t mont)
 
     for (unsigned j = 0; j < 128; j += 16)
     {
-        vload_s16_x2(u0, &a[j]);
-        vload_s16_x2(u1, &a[j + 128]);
-        vload_s16_x2(u2, &a[j + 256]);
-        vload_s16_x2(u3, &a[j + 384]);
+        vload_s16_x2(u0, &s[j]);
+        vload_s16_x2(u1, &s[j + 128]);
+        vload_s16_x2(u2, &s[j + 256]);
+        vload_s16_x2(u3, &s[j + 384]);
 
-        vload_s16_x2(u4, &a[j + 512]);
-        vload_s16_x2(u5, &a[j + 640]);
-        vload_s16_x2(u6, &a[j + 768]);
-        vload_s16_x2(u7, &a[j + 896]);
+        vload_s16_x2(u4, &s[j + 512]);
+        vload_s16_x2(u5, &s[j + 640]);
+        vload_s16_x2(u6, &s[j + 768]);
+        vload_s16_x2(u7, &s[j + 896]);
+
+        if (h != NULL)
+        {
+            sqnorm_x2(neon_s, neon_sh, u0);
+            sqnorm_x2(neon_s, neon_sh, u1);
+            sqnorm_x2(neon_s, neon_sh, u2);
+            sqnorm_x2(neon_s, neon_sh, u3);
+            sqnorm_x2(neon_s, neon_sh, u4);
+            sqnorm_x2(neon_s, neon_sh, u5);
+            sqnorm_x2(neon_s, neon_sh, u6);
+            sqnorm_x2(neon_s, neon_sh, u7);
+        }
 
         // u0, 4: .5
         // u1, 5: .5
@@ -595,28 +634,70 @@ void ZfN(poly_ntt)(int16_t a[FALCON_N], ntt_domain_t mont)
             barmuli_mont_ninv_x8(v2, v3, neon_qmvq, t, t2);
         }
 
+        if (h != NULL)
+        {
+            // Pointwise multiplication: h[] has the same (interleaved)
+            // layout, so it is loaded the same way a[] is stored.
+            vload_s16_4(zl, &h[j]);
+            vload_s16_4(zh, &h[j + 32]);
+            montmul_x4(t, v0, zl, neon_qmvq, t2);
+            v0 = t;
+            montmul_x4(t, v1, zh, neon_qmvq, t2);
+            v1 = t;
+
+            vload_s16_4(zl, &h[j + 64]);
+            vload_s16_4(zh, &h[j + 96]);
+            montmul_x4(t, v2, zl, neon_qmvq, t2);
+            v2 = t;
+            montmul_x4(t, v3, zh, neon_qmvq, t2);
+            v3 = t;
+        }
+
         vstore_s16_4(&a[j], v0);
         vstore_s16_4(&a[j + 32], v1);
         vstore_s16_4(&a[j + 64], v2);
         vstore_s16_4(&a[j + 96], v3);
     }
+
+    return h != NULL ? sqnorm_reduce(neon_s, neon_sh) : 0;
 }
 
 /*
- * Assume input in range [-Q, Q]
- * Total Barrett point N = 512, 1024: 1792, 3840
+ * Assume Input in the range [-Q/2, Q/2]
+ * Total Barrett point for N = 512, 1024: 2048, 4096
  */
-void ZfN(poly_invntt)(int16_t a[FALCON_N], invntt_domain_t ninv)
+void ZfN(poly_ntt)(int16_t a[FALCON_N], ntt_domain_t mont)
+{
+    poly_ntt_core(a, a, mont, NULL);
+}
+
+/* see poly.h */
+uint32_t ZfN(poly_ntt_montmul)(int16_t a[FALCON_N], const int16_t s[FALCON_N],
+                               const int16_t h[FALCON_N])
+{
+    return poly_ntt_core(a, s, NTT_MONT_INV, h);
+}
+
+/*
+ * Inverse NTT of a[]. If c0 != NULL, the last layer computes c0 - a
+ * with Barrett reduction instead of storing a[], and returns its
+ * squared norm; a[] is then left with intermediate values.
+ */
+static inline uint32_t poly_invntt_core(int16_t a[FALCON_N], invntt_domain_t ninv,
+                                        const int16_t c0[FALCON_N])
 {
     // Total SIMD registers: 29 = 16 + 12 + 1
     int16x8x4_t v0, v1, v2, v3; // 16
     int16x8x4_t zl, zh, t, t2;  // 12
     int16x8x2_t zlh, zhh;       // 4
     int16x8_t neon_qmvq;        // 1
+    int32x4_t neon_s, neon_sh;  // 2
     const int16_t *ptr_invntt_br = invntt_br;
     const int16_t *ptr_invntt_qinv_br = invntt_qinv_br;
 
     neon_qmvq = vld1q_s16(qmvq);
+    neon_s = vdupq_n_s32(0);
+    neon_sh = vdupq_n_s32(0);
     unsigned j;
 
     // Layer 0, 1, 2, 3, 4, 5, 6
@@ -1077,6 +1158,30 @@ void ZfN(poly_invntt)(int16_t a[FALCON_N], invntt_domain_t ninv)
         // v2: 0.97
         // v3: 0.93
 
+        if (c0 != NULL)
+        {
+            // s1 = c0 - a, reduced, only its norm is kept
+            vload_s16_x4(t, &c0[j]);
+            vload_s16_x4(t2, &c0[j + 128]);
+            vsub_x4(v0, t, v0);
+            vsub_x4(v1, t2, v1);
+            vload_s16_x4(t, &c0[j + 256]);
+            vload_s16_x4(t2, &c0[j + 384]);
+            vsub_x4(v2, t, v2);
+            vsub_x4(v3, t2, v3);
+
+            barrett_x4(v0, neon_qmvq, t);
+            barrett_x4(v1, neon_qmvq, t);
+            barrett_x4(v2, neon_qmvq, t2);
+            barrett_x4(v3, neon_qmvq, t2);
+
+            sqnorm_x4(neon_s, neon_sh, v0);
+            sqnorm_x4(neon_s, neon_sh, v1);
+            sqnorm_x4(neon_s, neon_sh, v2);
+            sqnorm_x4(neon_s, neon_sh, v3);
+            continue;
+        }
+
         vstore_s16_x4(&a[j], v0);
         vstore_s16_x4(&a[j + 128], v1);
         vstore_s16_x4(&a[j + 256], v2);
@@ -1150,6 +1255,30 @@ void ZfN(poly_invntt)(int16_t a[FALCON_N], invntt_domain_t ninv)
         // v2: .83
         // v3: .83
 
+        if (c0 != NULL)
+        {
+            // s1 = c0 - a, reduced, only its norm is kept
+            vload_s16_x4(t, &c0[j]);
+            vload_s16_x4(t2, &c0[j + 128]);
+            vsub_x4(v0, t, v0);
+            vsub_x4(v1, t2, v1);
+            vload_s16_x4(t, &c0[j + 256]);
+            vload_s16_x4(t2, &c0[j + 384]);
+            vsub_x4(v2, t, v2);
+            vsub_x4(v3, t2, v3);
+
+            barrett_x4(v0, neon_qmvq, t);
+            barrett_x4(v1, neon_qmvq, t);
+            barrett_x4(v2, neon_qmvq, t2);
+            barrett_x4(v3, neon_qmvq, t2);
+
+            sqnorm_x4(neon_s, neon_sh, v0);
+            sqnorm_x4(neon_s, neon_sh, v1);
+            sqnorm_x4(neon_s, neon_sh, v2);
+            sqnorm_x4(neon_s, neon_sh, v3);
+            continue;
+        }
+
         vstore_s16_x4(&a[j], v0);
         vstore_s16_x4(&a[j + 128], v1);
         vstore_s16_x4(&a[j + 256], v2);
@@ -1334,6 +1463,46 @@ void ZfN(poly_invntt)(int16_t a[FALCON_N], invntt_domain_t ninv)
         // u1, 5: .87, .87
         // u3, 7: .5, .5
 
+        if (c0 != NULL)
+        {
+            // s1 = c0 - a, reduced, only its norm is kept
+            vload_s16_x2(zlh, &c0[j]);
+            vload_s16_x2(zhh, &c0[j + 128]);
+            vsub_x2(u0, zlh, u0);
+            vsub_x2(u1, zhh, u1);
+            vload_s16_x2(zlh, &c0[j + 256]);
+            vload_s16_x2(zhh, &c0[j + 384]);
+            vsub_x2(u2, zlh, u2);
+            vsub_x2(u3, zhh, u3);
+            vload_s16_x2(zlh, &c0[j + 512]);
+            vload_s16_x2(zhh, &c0[j + 640]);
+            vsub_x2(u4, zlh, u4);
+            vsub_x2(u5, zhh, u5);
+            vload_s16_x2(zlh, &c0[j + 768]);
+            vload_s16_x2(zhh, &c0[j + 896]);
+            vsub_x2(u6, zlh, u6);
+            vsub_x2(u7, zhh, u7);
+
+            barrett_x2(u0, 0, 1, 0, 1, neon_qmvq, t);
+            barrett_x2(u1, 0, 1, 2, 3, neon_qmvq, t);
+            barrett_x2(u2, 0, 1, 0, 1, neon_qmvq, t);
+            barrett_x2(u3, 0, 1, 2, 3, neon_qmvq, t);
+            barrett_x2(u4, 0, 1, 0, 1, neon_qmvq, t2);
+            barrett_x2(u5, 0, 1, 2, 3, neon_qmvq, t2);
+            barrett_x2(u6, 0, 1, 0, 1, neon_qmvq, t2);
+            barrett_x2(u7, 0, 1, 2, 3, neon_qmvq, t2);
+
+            sqnorm_x2(neon_s, neon_sh, u0);
+            sqnorm_x2(neon_s, neon_sh, u1);
+            sqnorm_x2(neon_s, neon_sh, u2);
+            sqnorm_x2(neon_s, neon_sh, u3);
+            sqnorm_x2(neon_s, neon_sh, u4);
+            sqnorm_x2(neon_s, neon_sh, u5);
+            sqnorm_x2(neon_s, neon_sh, u6);
+            sqnorm_x2(neon_s, neon_sh, u7);
+            continue;
+        }
+
         vstore_s16_x2(&a[j], u0);
         vstore_s16_x2(&a[j + 128], u1);
         vstore_s16_x2(&a[j + 256], u2);
@@ -1347,6 +1516,23 @@ void ZfN(poly_invntt)(int16_t a[FALCON_N], invntt_domain_t ninv)
 #else
 #error "FALCON_N is either 512 or 1024"
 #endif
+
+    return c0 != NULL ? sqnorm_reduce(neon_s, neon_sh) : 0;
+}
+
+/*
+ * Assume input in range [-Q, Q]
+ * Total Barrett point N = 512, 1024: 1792, 3840
+ */
+void ZfN(poly_invntt)(int16_t a[FALCON_N], invntt_domain_t ninv)
+{
+    poly_invntt_core(a, ninv, NULL);
+}
+
+/* see poly.h */
+uint32_t ZfN(poly_invntt_sub_norm)(int16_t a[FALCON_N], const int16_t c0[FALCON_N])
+{
+    return poly_invntt_core(a, INVNTT_NONE, c0);
 }
 
 void ZfN(poly_montmul_ntt)(int16_t f[FALCON_N], const int16_t g[FALCON_N])
@@ -19,6 +19,19 @@ void ZfN(poly_ntt)(int16_t a[FALCON_N], ntt_domain_t mont);
 
 void ZfN(poly_invntt)(int16_t a[FALCON_N], invntt_domain_t ninv);
 
+/*
+ * Fused verification kernels.
+ * poly_ntt_montmul: a = NTT(s) * h, with s in the NTT_MONT_INV domain
+ * and h in NTT representation; s[] is read once and its squared norm
+ * is returned.
+ * poly_invntt_sub_norm: squared norm of c0 - invNTT(a) (reduced to
+ * [-Q/2, Q/2]), computed in the last layer; a[] is clobbered.
+ */
+uint32_t ZfN(poly_ntt_montmul)(int16_t a[FALCON_N], const int16_t s[FALCON_N],
+                               const int16_t h[FALCON_N]);
+
+uint32_t ZfN(poly_invntt_sub_norm)(int16_t a[FALCON_N], const int16_t c0[FALCON_N]);
+
 void ZfN(poly_int8_to_int16)(int16_t out[FALCON_N], const int8_t in[FALCON_N]);
 
 void ZfN(poly_div_12289)(int16_t f[FALCON_N], const int16_t g[FALCON_N]);
@@ -467,7 +467,7 @@ void ZfN(poly_mul_add_fft)(fpr *c, const fpr *restrict d,
 }
 
 /* see inner.h */
-void ZfN(poly_muladj_fft)(fpr *d, fpr *a, const fpr *restrict b, unsigned logn)
+void ZfN(poly_muladj_fft)(fpr *d, const fpr *a, const fpr *restrict b, unsigned logn)
 {
     // assert(logn >= 4);
     float64x2x4_t a_re, b_re, d_re, a_im, b_im, d_im; // 24
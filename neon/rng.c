@@ -31,20 +31,151 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <arm_neon.h>
 #include "inner.h"
+#include "config.h"
 
-int Zf(get_seed)(void *seed, size_t len)
+#if FALCON_RAND_GETENTROPY || FALCON_RAND_URANDOM
+#include <unistd.h>
+#endif
+#if FALCON_RAND_URANDOM
+#include <sys/types.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+#if FALCON_STATS
+/* see inner.h */
+FALCON_TLS stats_context Zf(stats);
+#endif
+
+#if FALCON_TRACE
+#if !defined __aarch64__
+#include <time.h>
+#endif
+
+/* see inner.h */
+FALCON_TLS trace_context Zf(trace);
+
+/* see inner.h */
+uint64_t
+Zf(trace_ticks)(void)
 {
-    unsigned char tmp[48];
-    for (size_t i = 0; i < len; i++)
-    {
-        tmp[i] = i;
-    }
-    memcpy(seed, tmp, len);
-    return 1;
+#if defined __aarch64__
+	uint64_t t;
+
+#if BENCH_CYCLES && !APPLE_M1
+	__asm__ __volatile__ ("mrs %0, PMCCNTR_EL0" : "=r" (t));
+#else
+	__asm__ __volatile__ ("isb; mrs %0, CNTVCT_EL0" : "=r" (t));
+#endif
+	return t;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
 }
 
+/* see inner.h */
+void
+Zf(trace_enter)(int reset)
+{
+	trace_context *tc;
 
+	tc = &Zf(trace);
+	if (reset) {
+		tc->depth = 0;
+	}
+	if (tc->depth < TRACE_MAX_DEPTH) {
+		tc->start[tc->depth] = Zf(trace_ticks)();
+	}
+	tc->depth ++;
+}
+
+/* see inner.h */
+void
+Zf(trace_leave)(unsigned phase)
+{
+	trace_context *tc;
+	uint64_t now;
+
+	now = Zf(trace_ticks)();
+	tc = &Zf(trace);
+	if (tc->depth == 0) {
+		return;
+	}
+	tc->depth --;
+	if (tc->depth >= TRACE_MAX_DEPTH) {
+		return;
+	}
+	tc->ev[tc->head].phase = phase;
+	tc->ev[tc->head].ticks = now - tc->start[tc->depth];
+	tc->head = (tc->head + 1) % FALCON_TRACE_SIZE;
+	if (tc->count < FALCON_TRACE_SIZE) {
+		tc->count ++;
+	}
+}
+#endif
+
+/* see inner.h */
+int
+Zf(get_seed)(void *seed, size_t len)
+{
+	(void)seed;
+	if (len == 0) {
+		return 1;
+	}
+#if FALCON_RAND_GETENTROPY
+	/*
+	 * getentropy() serves at most 256 bytes per call.
+	 */
+	while (len > 0) {
+		size_t clen;
+
+		clen = len < 256 ? len : 256;
+		if (getentropy(seed, clen) != 0) {
+			break;
+		}
+		seed = (uint8_t *)seed + clen;
+		len -= clen;
+	}
+	if (len == 0) {
+		return 1;
+	}
+#endif
+#if FALCON_RAND_URANDOM
+	{
+		int f;
+
+		f = open("/dev/urandom", O_RDONLY);
+		if (f >= 0) {
+			while (len > 0) {
+				ssize_t rlen;
+
+				rlen = read(f, seed, len);
+				if (rlen < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					break;
+				}
+				if (rlen == 0) {
+					break;
+				}
+				seed = (uint8_t *)seed + rlen;
+				len -= (size_t)rlen;
+			}
+			close(f);
+			if (len == 0) {
+				return 1;
+			}
+		}
+	}
+#endif
+	return 0;
+}
 
 /* see inner.h */
 void
@@ -88,7 +219,31 @@ Zf(prng_init)(prng *p, inner_shake256_context *src)
  * ChaCha20 instances in parallel.
  *
  * The block counter is XORed into the first 8 bytes of the IV.
+ *
+ * The eight blocks are computed as two groups of four, one block per
+ * 32-bit lane. With that layout, word v of the four blocks of group g
+ * is exactly the 16 bytes at offset 32*v + 16*g of the output buffer,
+ * so the interleaving costs nothing.
  */
+
+#define ROL32X4(x, k)   vsriq_n_u32(vshlq_n_u32(x, k), x, 32 - (k))
+
+#define QROUND_X4(a, b, c, d)   do { \
+		x[a] = vaddq_u32(x[a], x[b]); \
+		x[d] = veorq_u32(x[d], x[a]); \
+		x[d] = vreinterpretq_u32_u16(vrev32q_u16( \
+			vreinterpretq_u16_u32(x[d]))); \
+		x[c] = vaddq_u32(x[c], x[d]); \
+		x[b] = veorq_u32(x[b], x[c]); \
+		x[b] = ROL32X4(x[b], 12); \
+		x[a] = vaddq_u32(x[a], x[b]); \
+		x[d] = veorq_u32(x[d], x[a]); \
+		x[d] = ROL32X4(x[d], 8); \
+		x[c] = vaddq_u32(x[c], x[d]); \
+		x[b] = veorq_u32(x[b], x[c]); \
+		x[b] = ROL32X4(x[b], 7); \
+	} while (0)
+
 void
 Zf(prng_refill)(prng *p)
 {
@@ -97,92 +252,67 @@ Zf(prng_refill)(prng *p)
 		0x61707865, 0x3320646e, 0x79622d32, 0x6b206574
 	};
 
+	uint32x4_t x[16], in[16];
+	uint32_t kw[12], cl[4], ch[4];
 	uint64_t cc;
-	size_t u;
+	int g, i, v;
 
 	/*
-	 * State uses local endianness. Only the output bytes must be
-	 * converted to little endian (if used on a big-endian machine).
+	 * State uses local endianness; NEON stores are little-endian,
+	 * which is the byte order required for the output.
 	 */
+	memcpy(kw, p->state.d, sizeof kw);
 	cc = *(uint64_t *)(p->state.d + 48);
-	for (u = 0; u < 8; u ++) {
-		uint32_t state[16];
-		size_t v;
-		int i;
-
-		memcpy(&state[0], CW, sizeof CW);
-		memcpy(&state[4], p->state.d, 48);
-		state[14] ^= (uint32_t)cc;
-		state[15] ^= (uint32_t)(cc >> 32);
-		for (i = 0; i < 10; i ++) {
-
-#define QROUND(a, b, c, d)   do { \
-		state[a] += state[b]; \
-		state[d] ^= state[a]; \
-		state[d] = (state[d] << 16) | (state[d] >> 16); \
-		state[c] += state[d]; \
-		state[b] ^= state[c]; \
-		state[b] = (state[b] << 12) | (state[b] >> 20); \
-		state[a] += state[b]; \
-		state[d] ^= state[a]; \
-		state[d] = (state[d] <<  8) | (state[d] >> 24); \
-		state[c] += state[d]; \
-		state[b] ^= state[c]; \
-		state[b] = (state[b] <<  7) | (state[b] >> 25); \
-	} while (0)
-
-			QROUND( 0,  4,  8, 12);
-			QROUND( 1,  5,  9, 13);
-			QROUND( 2,  6, 10, 14);
-			QROUND( 3,  7, 11, 15);
-			QROUND( 0,  5, 10, 15);
-			QROUND( 1,  6, 11, 12);
-			QROUND( 2,  7,  8, 13);
-			QROUND( 3,  4,  9, 14);
-
-#undef QROUND
+	for (v = 0; v < 4; v ++) {
+		in[v] = vdupq_n_u32(CW[v]);
+	}
+	for (v = 4; v < 14; v ++) {
+		in[v] = vdupq_n_u32(kw[v - 4]);
+	}
+	for (g = 0; g < 2; g ++) {
+		for (i = 0; i < 4; i ++) {
+			uint64_t c;
 
+			c = cc + (uint64_t)(4 * g + i);
+			cl[i] = kw[10] ^ (uint32_t)c;
+			ch[i] = kw[11] ^ (uint32_t)(c >> 32);
 		}
+		in[14] = vld1q_u32(cl);
+		in[15] = vld1q_u32(ch);
 
-		for (v = 0; v < 4; v ++) {
-			state[v] += CW[v];
-		}
-		for (v = 4; v < 14; v ++) {
-			state[v] += ((uint32_t *)p->state.d)[v - 4];
+		memcpy(x, in, sizeof x);
+		for (i = 0; i < 10; i ++) {
+			QROUND_X4( 0,  4,  8, 12);
+			QROUND_X4( 1,  5,  9, 13);
+			QROUND_X4( 2,  6, 10, 14);
+			QROUND_X4( 3,  7, 11, 15);
+			QROUND_X4( 0,  5, 10, 15);
+			QROUND_X4( 1,  6, 11, 12);
+			QROUND_X4( 2,  7,  8, 13);
+			QROUND_X4( 3,  4,  9, 14);
 		}
-		state[14] += ((uint32_t *)p->state.d)[10]
-			^ (uint32_t)cc;
-		state[15] += ((uint32_t *)p->state.d)[11]
-			^ (uint32_t)(cc >> 32);
-		cc ++;
-
-		/*
-		 * We mimic the interleaving that is used in the AVX2
-		 * implementation.
-		 */
+
 		for (v = 0; v < 16; v ++) {
-			p->buf.d[(u << 2) + (v << 5) + 0] =
-				(uint8_t)state[v];
-			p->buf.d[(u << 2) + (v << 5) + 1] =
-				(uint8_t)(state[v] >> 8);
-			p->buf.d[(u << 2) + (v << 5) + 2] =
-				(uint8_t)(state[v] >> 16);
-			p->buf.d[(u << 2) + (v << 5) + 3] =
-				(uint8_t)(state[v] >> 24);
+			vst1q_u32((uint32_t *)(p->buf.d + (v << 5) + (g << 4)),
+				vaddq_u32(x[v], in[v]));
 		}
 	}
-	*(uint64_t *)(p->state.d + 48) = cc;
-
+	*(uint64_t *)(p->state.d + 48) = cc + 8;
 
 	p->ptr = 0;
+	FALCON_STAT_ADD(prng_refills, 1);
 }
 
+#undef QROUND_X4
+#undef ROL32X4
+
 /* see inner.h */
 void
 Zf(prng_get_bytes)(prng *p, void *dst, size_t len)
 {
 	uint8_t *buf;
 
+	FALCON_STAT_ADD(prng_bytes, len);
 	buf = dst;
 	while (len > 0) {
 		size_t clen;
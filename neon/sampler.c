@@ -217,6 +217,7 @@ Zf(sampler)(void *ctx, fpr mu, fpr isigma)
 	fpr r, dss, ccs;
 
 	spc = ctx;
+	FALCON_STAT_ADD(sampler_calls, 1);
 
 	/*
 	 * Center is mu. We compute mu = s + r where s is an integer
@@ -242,6 +243,8 @@ Zf(sampler)(void *ctx, fpr mu, fpr isigma)
 		int z0, z, b;
 		fpr x;
 
+		FALCON_STAT_ADD(sampler_iterations, 1);
+
 		/*
 		 * Sample z for a Gaussian distribution. Then get a
 		 * random bit b to turn the sampling into a bimodal
@@ -293,3 +296,120 @@ Zf(sampler)(void *ctx, fpr mu, fpr isigma)
 		}
 	}
 }
+
+/*
+ * Two-lane variant of Zf(sampler)(), for two centers that share the
+ * same isigma (as is the case for each pair of ffSampling leaves). Both
+ * lanes run the rejection loop together in float64x2_t registers; every
+ * iteration draws a fixed amount of randomness for each lane (72-bit
+ * half-Gaussian input, sign bit, 64-bit Bernoulli input), and a mask
+ * keeps track of the lanes that have already accepted a value. The
+ * loop ends when both lanes have accepted.
+ *
+ * The Bernoulli trial compares the full 64-bit PRNG value with the
+ * scaled exp(-x), where BerExp() compares it lazily byte by byte: the
+ * outcome has the same distribution, and the comparison no longer
+ * depends on the PRNG bytes. Since the PRNG is consumed in a different
+ * order than with two calls to Zf(sampler)(), the resulting signatures
+ * do not match the NIST KAT vectors.
+ */
+void
+Zf(sampler_x2)(void *ctx, fpr *restrict z, const fpr *restrict mu,
+	fpr isigma)
+{
+	static const double C_expm[] = {
+		1.000000000000000000000000000000,  // c0
+		-0.999999999999994892974086724280, // c1
+		0.500000000000019206858326015208,  // c2
+		-0.166666666666984014666397229121, // c3
+		0.041666666666110491190622155955,  // c4
+		-0.008333333327800835146903501993, // c5
+		0.001388888894063186997887560103,  // c6
+		-0.000198412739277311890541063977, // c7
+		0.000024801566833585381209939524,  // c8
+		-0.000002755586350219122514855659, // c9
+		0.000000275607356160477811864927,  // c10
+		-0.000000025299506379442070029551, // c11
+		0.000000002073772366009083061987   // c12
+	};
+	sampler_context *spc;
+	float64x2_t vmu, s, r, dss, ccs, out;
+	uint64x2_t done;
+
+	spc = ctx;
+	FALCON_STAT_ADD(sampler_calls, 2);
+
+	/*
+	 * mu = s + r with s an integer and 0 <= r < 1, in both lanes.
+	 * dss = 1/(2*sigma^2); ccs = (sigma_min / sigma) * 2^63.
+	 */
+	vmu = vld1q_f64(mu);
+	s = vrndmq_f64(vmu);
+	r = vsubq_f64(vmu, s);
+	dss = vdupq_n_f64(fpr_half(fpr_sqr(isigma)));
+	ccs = vdupq_n_f64(fpr_mul(fpr_mul(isigma, spc->sigma_min),
+		fpr_ptwo63));
+	out = s;
+	done = vdupq_n_u64(0);
+
+	do {
+		double g[2], b[2];
+		uint64_t u[2];
+		float64x2_t vg, vb, vz, x, y, t;
+		int64x2_t e;
+		uint64x2_t w, ok;
+		int j, k;
+
+		FALCON_STAT_ADD(sampler_iterations, 2);
+
+		/*
+		 * Same bimodal Gaussian as in Zf(sampler)(): z0 from the
+		 * half-Gaussian, b a random bit, z = b + (2*b - 1)*z0.
+		 */
+		for (j = 0; j < 2; j ++) {
+			g[j] = (double)ZfN(gaussian0_sampler)(&spc->p);
+			b[j] = (double)(prng_get_u8(&spc->p) & 1);
+			u[j] = prng_get_u64(&spc->p);
+		}
+		vg = vld1q_f64(g);
+		vb = vld1q_f64(b);
+		vz = vfmaq_f64(vb,
+			vsubq_f64(vaddq_f64(vb, vb), vdupq_n_f64(1.0)), vg);
+
+		/*
+		 * x = ((z-r)^2)/(2*sigma^2) - (z0^2)/(2*sigma0^2), then
+		 * x = e*log(2) + y with 0 <= y < log(2), and e saturated
+		 * at 63 (see BerExp()).
+		 */
+		t = vsubq_f64(vz, r);
+		x = vmulq_f64(vmulq_f64(t, t), dss);
+		x = vfmsq_f64(x, vmulq_f64(vg, vg),
+			vdupq_n_f64(fpr_inv_2sqrsigma0));
+		e = vcvtq_s64_f64(vmulq_n_f64(x, fpr_inv_log2));
+		y = vfmsq_f64(x, vcvtq_f64_s64(e), vdupq_n_f64(fpr_log2));
+		e = vbslq_s64(vcgtq_s64(e, vdupq_n_s64(63)),
+			vdupq_n_s64(63), e);
+
+		/*
+		 * w = 2^64*ccs*exp(-x), with the polynomial of
+		 * fpr_expm_p63() evaluated in both lanes.
+		 */
+		t = vdupq_n_f64(C_expm[12]);
+		for (k = 11; k >= 0; k --) {
+			t = vfmaq_f64(vdupq_n_f64(C_expm[k]), t, y);
+		}
+		w = vcvtq_u64_f64(vmulq_f64(t, ccs));
+		w = vsubq_u64(vshlq_n_u64(w, 1), vdupq_n_u64(1));
+		w = vshlq_u64(w, vnegq_s64(e));
+
+		/*
+		 * Accept with probability exp(-x); lanes that already
+		 * accepted keep their value.
+		 */
+		ok = vbicq_u64(vcltq_u64(vld1q_u64(u), w), done);
+		out = vbslq_f64(ok, vaddq_f64(s, vz), out);
+		done = vorrq_u64(done, ok);
+	} while ((vgetq_lane_u64(done, 0) & vgetq_lane_u64(done, 1)) == 0);
+
+	vst1q_f64(z, out);
+}
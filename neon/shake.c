@@ -30,6 +30,7 @@
  */
 
 #include <string.h>
+#include <arm_neon.h>
 #include "inner.h"
 
 
@@ -571,3 +572,122 @@ Zf(i_shake256_extract)(inner_shake256_context *sc, uint8_t *out, size_t len)
 	}
 	sc->dptr = dptr;
 }
+
+/*
+ * Two Keccak-f[1600] permutations run in parallel, one per 64-bit lane
+ * of each NEON register. State word i of instance j is A[2*i + j].
+ */
+#define ROL64X2(x, k)   vsriq_n_u64(vshlq_n_u64(x, k), x, 64 - (k))
+
+static void
+process_block_x2(uint64_t *st)
+{
+	uint64x2_t A[25], B[25], C[5], D[5];
+	int i, j;
+
+	for (i = 0; i < 25; i ++) {
+		A[i] = vld1q_u64(&st[2 * i]);
+	}
+
+	for (j = 0; j < 24; j ++) {
+		/* theta */
+		for (i = 0; i < 5; i ++) {
+			C[i] = veorq_u64(
+				veorq_u64(veorq_u64(A[i], A[i + 5]), A[i + 10]),
+				veorq_u64(A[i + 15], A[i + 20]));
+		}
+		for (i = 0; i < 5; i ++) {
+			D[i] = veorq_u64(C[(i + 4) % 5], ROL64X2(C[(i + 1) % 5], 1));
+		}
+		for (i = 0; i < 25; i ++) {
+			A[i] = veorq_u64(A[i], D[i % 5]);
+		}
+
+		/* rho and pi */
+		B[ 0] = A[ 0];
+		B[10] = ROL64X2(A[ 1],  1);
+		B[20] = ROL64X2(A[ 2], 62);
+		B[ 5] = ROL64X2(A[ 3], 28);
+		B[15] = ROL64X2(A[ 4], 27);
+		B[16] = ROL64X2(A[ 5], 36);
+		B[ 1] = ROL64X2(A[ 6], 44);
+		B[11] = ROL64X2(A[ 7],  6);
+		B[21] = ROL64X2(A[ 8], 55);
+		B[ 6] = ROL64X2(A[ 9], 20);
+		B[ 7] = ROL64X2(A[10],  3);
+		B[17] = ROL64X2(A[11], 10);
+		B[ 2] = ROL64X2(A[12], 43);
+		B[12] = ROL64X2(A[13], 25);
+		B[22] = ROL64X2(A[14], 39);
+		B[23] = ROL64X2(A[15], 41);
+		B[ 8] = ROL64X2(A[16], 45);
+		B[18] = ROL64X2(A[17], 15);
+		B[ 3] = ROL64X2(A[18], 21);
+		B[13] = ROL64X2(A[19],  8);
+		B[14] = ROL64X2(A[20], 18);
+		B[24] = ROL64X2(A[21],  2);
+		B[ 9] = ROL64X2(A[22], 61);
+		B[19] = ROL64X2(A[23], 56);
+		B[ 4] = ROL64X2(A[24], 14);
+
+		/* chi */
+		for (i = 0; i < 25; i += 5) {
+			A[i + 0] = veorq_u64(B[i + 0], vbicq_u64(B[i + 2], B[i + 1]));
+			A[i + 1] = veorq_u64(B[i + 1], vbicq_u64(B[i + 3], B[i + 2]));
+			A[i + 2] = veorq_u64(B[i + 2], vbicq_u64(B[i + 4], B[i + 3]));
+			A[i + 3] = veorq_u64(B[i + 3], vbicq_u64(B[i + 0], B[i + 4]));
+			A[i + 4] = veorq_u64(B[i + 4], vbicq_u64(B[i + 1], B[i + 0]));
+		}
+
+		/* iota */
+		A[0] = veorq_u64(A[0], vdupq_n_u64(RC[j]));
+	}
+
+	for (i = 0; i < 25; i ++) {
+		vst1q_u64(&st[2 * i], A[i]);
+	}
+}
+
+/* see inner.h */
+void
+Zf(i_shake256x2_set)(inner_shake256x2_context *sc2, unsigned lane,
+	const inner_shake256_context *sc)
+{
+	int i;
+
+	for (i = 0; i < 25; i ++) {
+		sc2->A[2 * i + lane] = sc->st.A[i];
+	}
+}
+
+/* see inner.h */
+void
+Zf(i_shake256x2_get)(const inner_shake256x2_context *sc2, unsigned lane,
+	inner_shake256_context *sc)
+{
+	int i;
+
+	for (i = 0; i < 25; i ++) {
+		sc->st.A[i] = sc2->A[2 * i + lane];
+	}
+}
+
+/* see inner.h */
+void
+Zf(i_shake256x2_squeeze)(inner_shake256x2_context *sc2,
+	uint8_t *out0, uint8_t *out1)
+{
+	int i, k;
+
+	process_block_x2(sc2->A);
+	for (i = 0; i < 17; i ++) {
+		uint64_t w0, w1;
+
+		w0 = sc2->A[2 * i];
+		w1 = sc2->A[2 * i + 1];
+		for (k = 0; k < 8; k ++) {
+			out0[(i << 3) + k] = (uint8_t)(w0 >> (k << 3));
+			out1[(i << 3) + k] = (uint8_t)(w1 >> (k << 3));
+		}
+	}
+}
@@ -224,6 +224,124 @@ skoff_tree(unsigned logn)
 	return 4 * MKN(logn);
 }
 
+/*
+ * The compact expanded private key contains:
+ *  - The ffLDL tree (same values as in the expanded key)
+ *  - f, g, F and G as small integers (one byte per coefficient)
+ *
+ * The B0 matrix is not stored; it is recomputed with the FFT when
+ * signing. Since the FFT is deterministic, the recomputed values are
+ * bit-for-bit identical to the ones in the expanded key, and so are
+ * the signatures.
+ */
+
+static inline size_t
+skoff_ctree(unsigned logn)
+{
+	(void)logn;
+	return 0;
+}
+
+static inline size_t
+skoff_csmall(unsigned logn)
+{
+	return ffLDL_treesize(logn);
+}
+
+/*
+ * The semi-expanded private key contains:
+ *  - The B0 matrix (four elements, same offsets as in the expanded key)
+ *  - Optionally, the Gram matrix (g00, g01 and g11)
+ *
+ * There is no ffLDL tree; it is computed dynamically when signing,
+ * as in Zf(sign_dyn)(), but from the stored matrices instead of f, g,
+ * F and G.
+ */
+
+static inline size_t
+skoff_sgram(unsigned logn)
+{
+	return 4 * MKN(logn);
+}
+
+/*
+ * Load one element of the B0 matrix in FFT representation, from its
+ * small integer coefficients; if neg is non-zero, the value is negated.
+ */
+static void
+load_basis_fft(fpr *restrict b, const int8_t *x, int neg)
+{
+	smallints_to_fpr(b, x, FALCON_LOGN);
+	ZfN(FFT)(b, FALCON_LOGN);
+	if (neg) {
+		ZfN(poly_neg)(b, b, FALCON_LOGN);
+	}
+}
+
+/*
+ * Compute the Gram matrix G = B·B* from the B0 matrix (FFT
+ * representation), for the semi-expanded keys. Formulas are:
+ *   g00 = b00*adj(b00) + b01*adj(b01)
+ *   g01 = b00*adj(b10) + b01*adj(b11)
+ *   g10 = b10*adj(b00) + b11*adj(b01)
+ *   g11 = b10*adj(b10) + b11*adj(b11)
+ *
+ * For historical reasons, this implementation uses g00, g01 and g11
+ * (upper triangle). The operations are those of do_sign_dyn() (g00 is
+ * the sum of two separately rounded products, with g01 as scratch),
+ * so the values are bit-for-bit identical. expand_tree() keeps its
+ * own, fused, computation of g00.
+ */
+static void
+gram_fft(fpr *g00, fpr *g01, fpr *g11,
+	const fpr *b00, const fpr *b01, const fpr *b10, const fpr *b11)
+{
+	ZfN(poly_mulselfadj_fft)(g01, b01, FALCON_LOGN);
+	ZfN(poly_mulselfadj_fft)(g00, b00, FALCON_LOGN);
+	ZfN(poly_add)(g00, g00, g01, FALCON_LOGN);
+	ZfN(poly_muladj_fft)(g01, b00, b10, FALCON_LOGN);
+	ZfN(poly_muladj_add_fft)(g01, g01, b01, b11, FALCON_LOGN);
+	ZfN(poly_mulselfadj_fft)(g11, b10, FALCON_LOGN);
+	ZfN(poly_mulselfadj_add_fft)(g11, g11, b11, FALCON_LOGN);
+}
+
+/*
+ * Compute the normalized ffLDL tree from the B0 matrix (FFT
+ * representation). The B0 matrix may overlap with the tree, since it
+ * is not used anymore once the Gram matrix is computed. tmp[] must
+ * have room for six polynomials.
+ */
+static void
+expand_tree(fpr *tree, fpr *b00, fpr *b01, fpr *b10, fpr *b11,
+	uint8_t *restrict tmp)
+{
+	fpr *g00, *g01, *g11, *gxx;
+
+	/*
+	 * The Gram matrix is G = B·B* (see gram_fft()).
+	 */
+	g00 = (fpr *)tmp;
+	g01 = g00 + FALCON_N;
+	g11 = g01 + FALCON_N;
+	gxx = g11 + FALCON_N;
+	ZfN(poly_mulselfadj_fft)(g00, b00, FALCON_LOGN);
+	ZfN(poly_mulselfadj_add_fft)(g00, g00, b01, FALCON_LOGN);
+	ZfN(poly_muladj_fft)(g01, b00, b10, FALCON_LOGN);
+	ZfN(poly_muladj_add_fft)(g01, g01, b01, b11, FALCON_LOGN);
+	ZfN(poly_mulselfadj_fft)(g11, b10, FALCON_LOGN);
+	ZfN(poly_mulselfadj_add_fft)(g11, g11, b11, FALCON_LOGN);
+
+	/*
+	 * Compute the Falcon tree.
+	 */
+	ffLDL_fft(tree, g00, g01, g11, FALCON_LOGN, gxx);
+
+	/*
+	 * Normalize tree.
+	 */
+	ffLDL_binary_normalize(tree, FALCON_LOGN, FALCON_LOGN);
+}
+
 /* see inner.h */
 void
 Zf(expand_privkey)(fpr *restrict expanded_key,
@@ -233,7 +351,6 @@ Zf(expand_privkey)(fpr *restrict expanded_key,
 {
 	fpr *rf, *rg, *rF, *rG;
 	fpr *b00, *b01, *b10, *b11;
-	fpr *g00, *g01, *g11, *gxx;
 	fpr *tree;
 
 	b00 = expanded_key + skoff_b00(FALCON_LOGN);
@@ -265,47 +382,95 @@ Zf(expand_privkey)(fpr *restrict expanded_key,
 	ZfN(FFT)(rF, FALCON_LOGN);
     ZfN(poly_neg)(rF, rF, FALCON_LOGN);
 
-	/*
-	 * Compute the FFT for the key elements, and negate f and F.
-	 */
+	expand_tree(tree, b00, b01, b10, b11, tmp);
+}
 
-	/*
-	 * The Gram matrix is G = B·B*. Formulas are:
-	 *   g00 = b00*adj(b00) + b01*adj(b01)
-	 *   g01 = b00*adj(b10) + b01*adj(b11)
-	 *   g10 = b10*adj(b00) + b11*adj(b01)
-	 *   g11 = b10*adj(b10) + b11*adj(b11)
-	 *
-	 * For historical reasons, this implementation uses
-	 * g00, g01 and g11 (upper triangle).
-	 */
-	g00 = (fpr *)tmp;
-	g01 = g00 + FALCON_N;
-	g11 = g01 + FALCON_N;
-	gxx = g11 + FALCON_N;
+/* see inner.h */
+void
+Zf(expand_privkey_compact)(fpr *restrict expanded_key,
+	const int8_t *f, const int8_t *g,
+	const int8_t *F, const int8_t *G,
+	uint8_t *restrict tmp)
+{
+	fpr *b00, *b01, *b10, *b11;
+	fpr *tree;
+	int8_t *sk;
 
-    ZfN(poly_mulselfadj_fft)(g00, b00, FALCON_LOGN);
-    ZfN(poly_mulselfadj_add_fft)(g00, g00, b01, FALCON_LOGN);
-        
-    ZfN(poly_muladj_fft)(g01, b00, b10, FALCON_LOGN);
-    ZfN(poly_muladj_add_fft)(g01, g01, b01, b11, FALCON_LOGN);
-    
-    ZfN(poly_mulselfadj_fft)(g11, b10, FALCON_LOGN);
-    ZfN(poly_mulselfadj_add_fft)(g11, g11, b11, FALCON_LOGN);
-    
-    /*
-	 * Compute the Falcon tree.
-	 */
-	ffLDL_fft(tree, g00, g01, g11, FALCON_LOGN, gxx);
+	tree = expanded_key + skoff_ctree(FALCON_LOGN);
+	sk = (int8_t *)(expanded_key + skoff_csmall(FALCON_LOGN));
 
 	/*
-	 * Normalize tree.
+	 * The B0 matrix is only needed to compute the Gram matrix, so
+	 * we build it in the tree area (which is larger than four
+	 * polynomials); ffLDL_fft() overwrites it only after the Gram
+	 * matrix has been computed.
 	 */
-	ffLDL_binary_normalize(tree, FALCON_LOGN, FALCON_LOGN);
+	b00 = tree;
+	b01 = b00 + FALCON_N;
+	b10 = b01 + FALCON_N;
+	b11 = b10 + FALCON_N;
+	load_basis_fft(b00, g, 0);
+	load_basis_fft(b01, f, 1);
+	load_basis_fft(b10, G, 0);
+	load_basis_fft(b11, F, 1);
+
+	expand_tree(tree, b00, b01, b10, b11, tmp);
+
+	memcpy(sk, f, FALCON_N);
+	memcpy(sk + FALCON_N, g, FALCON_N);
+	memcpy(sk + 2 * FALCON_N, F, FALCON_N);
+	memcpy(sk + 3 * FALCON_N, G, FALCON_N);
+}
+
+/* see inner.h */
+void
+Zf(expand_privkey_semi)(fpr *restrict expanded_key,
+	const int8_t *f, const int8_t *g,
+	const int8_t *F, const int8_t *G, int gram)
+{
+	fpr *b00, *b01, *b10, *b11, *g00;
+
+	b00 = expanded_key + skoff_b00(FALCON_LOGN);
+	b01 = expanded_key + skoff_b01(FALCON_LOGN);
+	b10 = expanded_key + skoff_b10(FALCON_LOGN);
+	b11 = expanded_key + skoff_b11(FALCON_LOGN);
+	load_basis_fft(b00, g, 0);
+	load_basis_fft(b01, f, 1);
+	load_basis_fft(b10, G, 0);
+	load_basis_fft(b11, F, 1);
+	if (gram) {
+		g00 = expanded_key + skoff_sgram(FALCON_LOGN);
+		gram_fft(g00, g00 + FALCON_N, g00 + 2 * FALCON_N,
+			b00, b01, b10, b11);
+	}
 }
 
 typedef int (*samplerZ)(void *ctx, fpr mu, fpr sigma);
 
+/*
+ * Sample the two coefficients of an ffSampling leaf pair, which share
+ * the same isigma. The sampler is called directly (no function
+ * pointer); with FALCON_SAMPLER_X2, both coefficients go through the
+ * two-lane sampler, otherwise x0 is sampled before x1, as in the
+ * reference code.
+ */
+static inline void
+sample_pair(void *samp_ctx, fpr *y0, fpr *y1, fpr x0, fpr x1, fpr isigma)
+{
+#if FALCON_SAMPLER_X2
+	fpr mu[2], z[2];
+
+	mu[0] = x0;
+	mu[1] = x1;
+	Zf(sampler_x2)(samp_ctx, z, mu, isigma);
+	*y0 = z[0];
+	*y1 = z[1];
+#else
+	*y0 = fpr_of(Zf(sampler)(samp_ctx, x0, isigma));
+	*y1 = fpr_of(Zf(sampler)(samp_ctx, x1, isigma));
+#endif
+}
+
 /*
  * Perform Fast Fourier Sampling for target vector t. The Gram matrix
  * is provided (G = [[g00, g01], [adj(g01), g11]]). The sampled vector
@@ -407,7 +572,7 @@ ffSampling_fft_dyntree(samplerZ samp, void *samp_ctx,
  * tmp[] must have size for at least two polynomials of size 2^logn.
  */
 static void
-ffSampling_fft(samplerZ samp, void *samp_ctx,
+ffSampling_fft(void *samp_ctx,
 	fpr *restrict z0, fpr *restrict z1,
 	const fpr *restrict tree,
 	const fpr *restrict t0, const fpr *restrict t1, unsigned logn,
@@ -448,8 +613,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = w2;
 		x1 = w3;
 		sigma = tree1[3];
-		w2 = fpr_of(samp(samp_ctx, x0, sigma));
-		w3 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &w2, &w3, x0, x1, sigma);
 		a_re = fpr_sub(x0, w2);
 		a_im = fpr_sub(x1, w3);
 		b_re = tree1[0];
@@ -459,8 +623,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = fpr_add(c_re, w0);
 		x1 = fpr_add(c_im, w1);
 		sigma = tree1[2];
-		w0 = fpr_of(samp(samp_ctx, x0, sigma));
-		w1 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &w0, &w1, x0, x1, sigma);
 
         // Merge
 		a_re = w0;
@@ -521,8 +684,9 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = w2;
 		x1 = w3;
 		sigma = tree0[3];
-		w2 = y0 = fpr_of(samp(samp_ctx, x0, sigma));
-		w3 = y1 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &y0, &y1, x0, x1, sigma);
+		w2 = y0;
+		w3 = y1;
 		a_re = fpr_sub(x0, y0);
 		a_im = fpr_sub(x1, y1);
 		b_re = tree0[0];
@@ -532,8 +696,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = fpr_add(c_re, w0);
 		x1 = fpr_add(c_im, w1);
 		sigma = tree0[2];
-		w0 = fpr_of(samp(samp_ctx, x0, sigma));
-		w1 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &w0, &w1, x0, x1, sigma);
 
         // Merge
 		a_re = w0;
@@ -560,8 +723,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
         float64x2_t x, y, a, b, c, w;
         fpr buf[2];
 
-        z1[0] = fpr_of(samp(samp_ctx, t1[0], tree[3]));
-		z1[1] = fpr_of(samp(samp_ctx, t1[1], tree[3]));
+        sample_pair(samp_ctx, &z1[0], &z1[1], t1[0], t1[1], tree[3]);
 
         vload(w, &t0[0]);
         vload(x, &t1[0]);
@@ -575,8 +737,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 
         vstore(&buf[0], x);
 
-        z0[0] = fpr_of(samp(samp_ctx, buf[0], tree[2]));
-		z0[1] = fpr_of(samp(samp_ctx, buf[1], tree[2]));
+        sample_pair(samp_ctx, &z0[0], &z0[1], buf[0], buf[1], tree[2]);
 
 #else 
         fpr x0, x1, y0, y1, sigma;
@@ -585,8 +746,9 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = t1[0];
 		x1 = t1[1];
 		sigma = tree[3];
-		z1[0] = y0 = fpr_of(samp(samp_ctx, x0, sigma));
-		z1[1] = y1 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &y0, &y1, x0, x1, sigma);
+		z1[0] = y0;
+		z1[1] = y1;
 		a_re = fpr_sub(x0, y0);
 		a_im = fpr_sub(x1, y1);
 		b_re = tree[0];
@@ -596,8 +758,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = fpr_add(c_re, t0[0]);
 		x1 = fpr_add(c_im, t0[1]);
 		sigma = tree[2];
-		z0[0] = fpr_of(samp(samp_ctx, x0, sigma));
-		z0[1] = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &z0[0], &z0[1], x0, x1, sigma);
 #endif
 
 		return;
@@ -618,7 +779,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 	 * merge back into z1.
 	 */
 	ZfN(poly_split_fft)(z1, z1 + hn, t1, logn);
-	ffSampling_fft(samp, samp_ctx, tmp, tmp + hn,
+	ffSampling_fft(samp_ctx, tmp, tmp + hn,
 		tree1, z1, z1 + hn, logn - 1, tmp + n);
 	ZfN(poly_merge_fft)(z1, tmp, tmp + hn, logn);
 
@@ -632,7 +793,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 	 * Second recursive invocation.
 	 */
 	ZfN(poly_split_fft)(z0, z0 + hn, tmp, logn);
-	ffSampling_fft(samp, samp_ctx, tmp, tmp + hn,
+	ffSampling_fft(samp_ctx, tmp, tmp + hn,
 		tree0, z0, z0 + hn, logn - 1, tmp + n);
 	ZfN(poly_merge_fft)(z0, tmp, tmp + hn, logn);
 }
@@ -648,7 +809,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
  * tmp[] must have room for at least six polynomials.
  */
 static int
-do_sign_tree(samplerZ samp, void *samp_ctx, int16_t *s2,
+do_sign_tree(void *samp_ctx, int16_t *s2,
 	const fpr *restrict expanded_key,
 	const uint16_t *hm, fpr *restrict tmp)
 {
@@ -656,6 +817,7 @@ do_sign_tree(samplerZ samp, void *samp_ctx, int16_t *s2,
 	const fpr *b00, *b01, *b10, *b11, *tree;
 	fpr ni;
 	int16_t *s1tmp, *s2tmp;
+	int r;
 
 	t0 = tmp;
 	t1 = t0 + FALCON_N;
@@ -668,6 +830,7 @@ do_sign_tree(samplerZ samp, void *samp_ctx, int16_t *s2,
 	/*
 	 * Set the target vector to [hm, 0] (hm is the hashed message).
 	 */
+	FALCON_TRACE_ENTER();
     ZfN(poly_fpr_of_s16)(t0, hm, FALCON_N);
 
 	/*
@@ -680,6 +843,7 @@ do_sign_tree(samplerZ samp, void *samp_ctx, int16_t *s2,
 	ZfN(poly_mulconst)(t1, t1, fpr_neg(ni), FALCON_LOGN);
 	ZfN(poly_mul_fft)(t0, t0, b11, FALCON_LOGN);
 	ZfN(poly_mulconst)(t0, t0, ni, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_TARGET);
 
 	tx = t1 + FALCON_N;
 	ty = tx + FALCON_N;
@@ -687,18 +851,28 @@ do_sign_tree(samplerZ samp, void *samp_ctx, int16_t *s2,
     /*
 	 * Apply sampling. Output is written back in [tx, ty].
 	 */
-	ffSampling_fft(samp, samp_ctx, tx, ty, tree, t0, t1, FALCON_LOGN, ty + FALCON_N);
+	FALCON_TRACE_ENTER();
+	ffSampling_fft(samp_ctx, tx, ty, tree, t0, t1, FALCON_LOGN, ty + FALCON_N);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_FFSAMP);
 
 	/*
 	 * Get the lattice point corresponding to that tiny vector.
 	 */
+	FALCON_TRACE_ENTER();
 	ZfN(poly_mul_fft)(t0, tx, b00, FALCON_LOGN);
 	ZfN(poly_mul_add_fft)(t0, t0, ty, b10, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_LATTICE);
+	FALCON_TRACE_ENTER();
 	ZfN(iFFT)(t0, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_IFFT);
 	
+	FALCON_TRACE_ENTER();
     ZfN(poly_mul_fft)(t1, tx, b01, FALCON_LOGN);
 	ZfN(poly_mul_add_fft)(t1, t1, ty, b11, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_LATTICE);
+	FALCON_TRACE_ENTER();
 	ZfN(iFFT)(t1, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_IFFT);
     
 	/*
 	 * Compute the signature.
@@ -717,7 +891,113 @@ do_sign_tree(samplerZ samp, void *samp_ctx, int16_t *s2,
     s1tmp = (int16_t *)tx;
 	s2tmp = (int16_t *)tmp;
 
-    if (ZfN(is_short_tmp)(s1tmp, s2tmp, (int16_t *) hm, t0, t1)){
+	FALCON_TRACE_ENTER();
+    r = ZfN(is_short_tmp)(s1tmp, s2tmp, (int16_t *) hm, t0, t1);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_NORM);
+    if (r) {
+		memcpy(s2, s2tmp, FALCON_N * sizeof *s2);
+		memcpy(tmp, s1tmp, FALCON_N * sizeof *s1tmp);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Same as do_sign_tree(), but with a compact expanded key (see
+ * Zf(expand_privkey_compact)()). The B0 matrix elements are recomputed
+ * in the free slots of tmp[] when they are needed, with the same
+ * operations as in Zf(expand_privkey)(), so that the output is the
+ * same as with do_sign_tree().
+ *
+ * tmp[] must have room for at least six polynomials.
+ */
+static int
+do_sign_tree_compact(void *samp_ctx, int16_t *s2,
+	const fpr *restrict expanded_key,
+	const uint16_t *hm, fpr *restrict tmp)
+{
+	fpr *t0, *t1, *tx, *ty, *bx, *by;
+	const fpr *tree;
+	const int8_t *f, *g, *F, *G;
+	fpr ni;
+	int16_t *s1tmp, *s2tmp;
+	int r;
+
+	t0 = tmp;
+	t1 = t0 + FALCON_N;
+	tx = t1 + FALCON_N;
+	ty = tx + FALCON_N;
+	bx = ty + FALCON_N;
+	by = bx + FALCON_N;
+	tree = expanded_key + skoff_ctree(FALCON_LOGN);
+	f = (const int8_t *)(expanded_key + skoff_csmall(FALCON_LOGN));
+	g = f + FALCON_N;
+	F = g + FALCON_N;
+	G = F + FALCON_N;
+
+	/*
+	 * Set the target vector to [hm, 0] (hm is the hashed message).
+	 */
+	FALCON_TRACE_ENTER();
+    ZfN(poly_fpr_of_s16)(t0, hm, FALCON_N);
+
+	/*
+	 * Apply the lattice basis to obtain the real target
+	 * vector (after normalization with regards to modulus). Only
+	 * b01 and b11 are needed; we build them in tx[].
+	 */
+	ZfN(FFT)(t0, FALCON_LOGN);
+	ni = fpr_inverse_of_q;
+	load_basis_fft(tx, f, 1);
+	ZfN(poly_mul_fft)(t1, t0, tx, FALCON_LOGN);
+	ZfN(poly_mulconst)(t1, t1, fpr_neg(ni), FALCON_LOGN);
+	load_basis_fft(tx, F, 1);
+	ZfN(poly_mul_fft)(t0, t0, tx, FALCON_LOGN);
+	ZfN(poly_mulconst)(t0, t0, ni, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_TARGET);
+
+	/*
+	 * Apply sampling. Output is written back in [tx, ty].
+	 */
+	FALCON_TRACE_ENTER();
+	ffSampling_fft(samp_ctx, tx, ty, tree, t0, t1, FALCON_LOGN, ty + FALCON_N);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_FFSAMP);
+
+	/*
+	 * Get the lattice point corresponding to that tiny vector. The
+	 * sampler is done with its temporaries, so bx[] and by[] receive
+	 * (b00, b10), then (b01, b11).
+	 */
+	FALCON_TRACE_ENTER();
+	load_basis_fft(bx, g, 0);
+	load_basis_fft(by, G, 0);
+	ZfN(poly_mul_fft)(t0, tx, bx, FALCON_LOGN);
+	ZfN(poly_mul_add_fft)(t0, t0, ty, by, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_LATTICE);
+	FALCON_TRACE_ENTER();
+	ZfN(iFFT)(t0, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_IFFT);
+
+	FALCON_TRACE_ENTER();
+	load_basis_fft(bx, f, 1);
+	load_basis_fft(by, F, 1);
+	ZfN(poly_mul_fft)(t1, tx, bx, FALCON_LOGN);
+	ZfN(poly_mul_add_fft)(t1, t1, ty, by, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_LATTICE);
+	FALCON_TRACE_ENTER();
+	ZfN(iFFT)(t1, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_IFFT);
+
+	/*
+	 * Compute the signature (see do_sign_tree()).
+	 */
+	s1tmp = (int16_t *)tx;
+	s2tmp = (int16_t *)tmp;
+
+	FALCON_TRACE_ENTER();
+	r = ZfN(is_short_tmp)(s1tmp, s2tmp, (int16_t *) hm, t0, t1);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_TREE_NORM);
+	if (r) {
 		memcpy(s2, s2tmp, FALCON_N * sizeof *s2);
 		memcpy(tmp, s1tmp, FALCON_N * sizeof *s1tmp);
 		return 1;
@@ -744,6 +1024,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	fpr *b00, *b01, *b10, *b11, *g00, *g01, *g11;
 	fpr ni;
 	int16_t *s1tmp, *s2tmp;
+	int r;
 
 	/*
 	 * Lattice basis is B = [[g, -f], [G, -F]]. We convert it to FFT.
@@ -755,6 +1036,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
     t0 = b11 + FALCON_N;
 	t1 = t0 + FALCON_N;
 
+	FALCON_TRACE_ENTER();
 	smallints_to_fpr(b00, g, FALCON_LOGN);
     ZfN(FFT)(b00, FALCON_LOGN);
 	
@@ -768,6 +1050,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	smallints_to_fpr(b11, F, FALCON_LOGN);
 	ZfN(FFT)(b11, FALCON_LOGN);
     ZfN(poly_neg)(b11, b11, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_BASIS);
 
 	/*
 	 * Compute the Gram matrix G = B·B*. Formulas are:
@@ -788,6 +1071,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
      * g00 | g01 | g11 | b01 | t0 | t1
 	 */
 	
+	FALCON_TRACE_ENTER();
 	ZfN(poly_muladj_fft)(t1, b00, b10, FALCON_LOGN);   // t1 <- b00*adj(b10)
 
 	ZfN(poly_mulselfadj_fft)(t0, b01, FALCON_LOGN);    // t0 <- b01*adj(b01)
@@ -799,6 +1083,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	
     ZfN(poly_mulselfadj_fft)(b10, b10, FALCON_LOGN);   // b10 <- b10*adj(b10)
 	ZfN(poly_mulselfadj_add_fft)(b10, b10, b11, FALCON_LOGN);    // t1 = g11 <- b11*adj(b11)
+	FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_GRAM);
 
     /*
 	 * We rename variables to make things clearer. The three elements
@@ -820,6 +1105,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	/*
 	 * Set the target vector to [hm, 0] (hm is the hashed message).
 	 */
+	FALCON_TRACE_ENTER();
     ZfN(poly_fpr_of_s16)(t0, hm, FALCON_N);
 
     
@@ -833,6 +1119,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	ZfN(poly_mulconst)(t1, t1, fpr_neg(ni), FALCON_LOGN);
 	ZfN(poly_mul_fft)(t0, t0, b11, FALCON_LOGN);
 	ZfN(poly_mulconst)(t0, t0, ni, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_TARGET);
   
 	/*
 	 * b01 and b11 can be discarded, so we move back (t0,t1).
@@ -847,8 +1134,10 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	 * Apply sampling; result is written over (t0,t1).
      * t1, g00
 	 */
+	FALCON_TRACE_ENTER();
 	ffSampling_fft_dyntree(samp, samp_ctx,
 		t0, t1, g00, g01, g11, FALCON_LOGN, FALCON_LOGN, t1 + FALCON_N);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_FFSAMP);
     
 	/*
 	 * We arrange the layout back to:
@@ -865,6 +1154,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	t0 = b11 + FALCON_N;
 	t1 = t0 + FALCON_N;
 
+	FALCON_TRACE_ENTER();
 	smallints_to_fpr(b00, g, FALCON_LOGN);
 	ZfN(FFT)(b00, FALCON_LOGN);
 
@@ -878,6 +1168,7 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	smallints_to_fpr(b11, F, FALCON_LOGN);
 	ZfN(FFT)(b11, FALCON_LOGN);
     ZfN(poly_neg)(b11, b11, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_REBUILD);
 
 	tx = t1 + FALCON_N;
 	ty = tx + FALCON_N;
@@ -885,15 +1176,17 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	/*
 	 * Get the lattice point corresponding to that tiny vector.
 	 */
-
-
+	FALCON_TRACE_ENTER();
     ZfN(poly_mul_fft)(tx, t0, b00, FALCON_LOGN);
 	ZfN(poly_mul_fft)(ty, t0, b01, FALCON_LOGN);
 	ZfN(poly_mul_add_fft)(t0, tx, t1, b10, FALCON_LOGN);
     ZfN(poly_mul_add_fft)(t1, ty, t1, b11, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_LATTICE);
 	
+	FALCON_TRACE_ENTER();
 	ZfN(iFFT)(t0, FALCON_LOGN);
 	ZfN(iFFT)(t1, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_IFFT);
 
 
 	/*
@@ -908,7 +1201,10 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	s1tmp = (int16_t *)tx;
 	s2tmp = (int16_t *)tmp;
 	
-    if (ZfN(is_short_tmp)(s1tmp, s2tmp, (int16_t *) hm, t0, t1)){
+	FALCON_TRACE_ENTER();
+    r = ZfN(is_short_tmp)(s1tmp, s2tmp, (int16_t *) hm, t0, t1);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_DYN_NORM);
+    if (r) {
 		memcpy(s2, s2tmp, FALCON_N * sizeof *s2);
 		memcpy(tmp, s1tmp, FALCON_N * sizeof *s1tmp);
 		return 1;
@@ -916,6 +1212,108 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	return 0;
 }
 
+/*
+ * Same as do_sign_dyn(), but with a semi-expanded key (see
+ * Zf(expand_privkey_semi)()): the B0 matrix is read from the key, and
+ * so is the Gram matrix if gram is non-zero (it is then copied, since
+ * ffSampling_fft_dyntree() works in place); otherwise, the Gram matrix
+ * is computed from the B0 matrix. The operations are the same as in
+ * do_sign_dyn(), and so is the output.
+ *
+ * tmp[] must have room for at least nine polynomials.
+ */
+static int
+do_sign_semi(samplerZ samp, void *samp_ctx, int16_t *s2,
+	const fpr *restrict expanded_key, int gram,
+	const uint16_t *hm, fpr *restrict tmp)
+{
+	fpr *t0, *t1, *tx, *ty, *g00, *g01, *g11;
+	const fpr *b00, *b01, *b10, *b11;
+	fpr ni;
+	int16_t *s1tmp, *s2tmp;
+	int r;
+
+	b00 = expanded_key + skoff_b00(FALCON_LOGN);
+	b01 = expanded_key + skoff_b01(FALCON_LOGN);
+	b10 = expanded_key + skoff_b10(FALCON_LOGN);
+	b11 = expanded_key + skoff_b11(FALCON_LOGN);
+
+	/*
+	 * Memory layout:
+	 *   g00 g01 g11 t0 t1 (sampler temporaries)
+	 */
+	g00 = tmp;
+	g01 = g00 + FALCON_N;
+	g11 = g01 + FALCON_N;
+	t0 = g11 + FALCON_N;
+	t1 = t0 + FALCON_N;
+
+	FALCON_TRACE_ENTER();
+	if (gram) {
+		memcpy(g00, expanded_key + skoff_sgram(FALCON_LOGN),
+			3 * FALCON_N * sizeof *g00);
+	} else {
+		gram_fft(g00, g01, g11, b00, b01, b10, b11);
+	}
+	FALCON_TRACE_LEAVE(TRACE_SIGN_SEMI_GRAM);
+
+	/*
+	 * Set the target vector to [hm, 0] (hm is the hashed message),
+	 * and apply the lattice basis to obtain the real target vector
+	 * (after normalization with regards to modulus).
+	 */
+	FALCON_TRACE_ENTER();
+	ZfN(poly_fpr_of_s16)(t0, hm, FALCON_N);
+	ZfN(FFT)(t0, FALCON_LOGN);
+	ni = fpr_inverse_of_q;
+	ZfN(poly_mul_fft)(t1, t0, b01, FALCON_LOGN);
+	ZfN(poly_mulconst)(t1, t1, fpr_neg(ni), FALCON_LOGN);
+	ZfN(poly_mul_fft)(t0, t0, b11, FALCON_LOGN);
+	ZfN(poly_mulconst)(t0, t0, ni, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_SEMI_TARGET);
+
+	/*
+	 * Apply sampling; result is written over (t0,t1).
+	 */
+	FALCON_TRACE_ENTER();
+	ffSampling_fft_dyntree(samp, samp_ctx,
+		t0, t1, g00, g01, g11, FALCON_LOGN, FALCON_LOGN, t1 + FALCON_N);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_SEMI_FFSAMP);
+
+	/*
+	 * Get the lattice point corresponding to that tiny vector. The
+	 * B0 matrix is still in the key, so nothing is rebuilt.
+	 */
+	tx = t1 + FALCON_N;
+	ty = tx + FALCON_N;
+	FALCON_TRACE_ENTER();
+	ZfN(poly_mul_fft)(tx, t0, b00, FALCON_LOGN);
+	ZfN(poly_mul_fft)(ty, t0, b01, FALCON_LOGN);
+	ZfN(poly_mul_add_fft)(t0, tx, t1, b10, FALCON_LOGN);
+	ZfN(poly_mul_add_fft)(t1, ty, t1, b11, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_SEMI_LATTICE);
+
+	FALCON_TRACE_ENTER();
+	ZfN(iFFT)(t0, FALCON_LOGN);
+	ZfN(iFFT)(t1, FALCON_LOGN);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_SEMI_IFFT);
+
+	/*
+	 * Compute the signature (see do_sign_dyn()).
+	 */
+	s1tmp = (int16_t *)tx;
+	s2tmp = (int16_t *)tmp;
+
+	FALCON_TRACE_ENTER();
+	r = ZfN(is_short_tmp)(s1tmp, s2tmp, (int16_t *) hm, t0, t1);
+	FALCON_TRACE_LEAVE(TRACE_SIGN_SEMI_NORM);
+	if (r) {
+		memcpy(s2, s2tmp, FALCON_N * sizeof *s2);
+		memcpy(tmp, s1tmp, FALCON_N * sizeof *s1tmp);
+		return 1;
+	}
+	return 0;
+}
 
 /* see inner.h */
 void
@@ -926,6 +1324,7 @@ Zf(sign_tree)(int16_t *sig, inner_shake256_context *rng,
 	fpr *ftmp;
 
 	ftmp = (fpr *)tmp;
+	FALCON_STAT_ADD(sign_calls, 1);
 	for (;;) {
 		/*
 		 * Signature produces short vectors s1 and s2. The
@@ -938,8 +1337,6 @@ Zf(sign_tree)(int16_t *sig, inner_shake256_context *rng,
 		 * and the public key).
 		 */
 		sampler_context spc;
-		samplerZ samp;
-		void *samp_ctx;
 
 		/*
 		 * Normal sampling. We use a fast PRNG seeded from our
@@ -953,16 +1350,50 @@ Zf(sign_tree)(int16_t *sig, inner_shake256_context *rng,
 #error "Support 512, 1024 only"
 #endif
 		Zf(prng_init)(&spc.p, rng);
-		samp = Zf(sampler);
-		samp_ctx = &spc;
 
 		/*
 		 * Do the actual signature.
 		 */
-		if (do_sign_tree(samp, samp_ctx, sig, expanded_key, hm, ftmp))
+		if (do_sign_tree(&spc, sig, expanded_key, hm, ftmp))
+		{
+			break;
+		}
+		FALCON_STAT_ADD(sign_restarts, 1);
+	}
+}
+
+/* see inner.h */
+void
+Zf(sign_tree_compact)(int16_t *sig, inner_shake256_context *rng,
+	const fpr *restrict expanded_key,
+	const uint16_t *hm, uint8_t *tmp)
+{
+	fpr *ftmp;
+
+	ftmp = (fpr *)tmp;
+	FALCON_STAT_ADD(sign_calls, 1);
+	for (;;) {
+		/*
+		 * Same sampler setup as in Zf(sign_tree)(); the two
+		 * functions consume the same randomness.
+		 */
+		sampler_context spc;
+
+#if FALCON_LOGN == 9
+		spc.sigma_min = fpr_sigma_min_9;
+#elif FALCON_LOGN == 10
+        spc.sigma_min = fpr_sigma_min_10;
+#else 
+#error "Support 512, 1024 only"
+#endif
+		Zf(prng_init)(&spc.p, rng);
+
+		if (do_sign_tree_compact(&spc,
+			sig, expanded_key, hm, ftmp))
 		{
 			break;
 		}
+		FALCON_STAT_ADD(sign_restarts, 1);
 	}
 }
 
@@ -976,6 +1407,7 @@ Zf(sign_dyn)(int16_t *sig, inner_shake256_context *rng,
 	fpr *ftmp;
 
 	ftmp = (fpr *)tmp;
+	FALCON_STAT_ADD(sign_calls, 1);
 	for (;;) {
 
 		/*
@@ -1014,5 +1446,41 @@ Zf(sign_dyn)(int16_t *sig, inner_shake256_context *rng,
 		{
 			break;
 		}
+		FALCON_STAT_ADD(sign_restarts, 1);
+	}
+}
+
+/* see inner.h */
+void
+Zf(sign_semi)(int16_t *sig, inner_shake256_context *rng,
+	const fpr *restrict expanded_key, int gram,
+	const uint16_t *hm, uint8_t *tmp)
+{
+	fpr *ftmp;
+
+	ftmp = (fpr *)tmp;
+	FALCON_STAT_ADD(sign_calls, 1);
+	for (;;) {
+		/*
+		 * Same sampler setup as in Zf(sign_dyn)(); the two
+		 * functions consume the same randomness.
+		 */
+		sampler_context spc;
+
+#if FALCON_LOGN == 9
+		spc.sigma_min = fpr_sigma_min_9;
+#elif FALCON_LOGN == 10
+		spc.sigma_min = fpr_sigma_min_10;
+#else
+#error "Support 512, 1024 only"
+#endif
+		Zf(prng_init)(&spc.p, rng);
+
+		if (do_sign_semi(Zf(sampler), &spc,
+			sig, expanded_key, gram, hm, ftmp))
+		{
+			break;
+		}
+		FALCON_STAT_ADD(sign_restarts, 1);
 	}
 }
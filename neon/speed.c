@@ -543,6 +543,108 @@ test_speed_falcon_time_cycles(unsigned logn, int iteration)
         xfree(bc.sigct);
 }
 
+/*
+ * Compare sign_tree and verify with the default layout (expanded key
+ * payload and temporary values at 8 mod 64, so that each 64-byte
+ * vector load straddles two cache lines) and with the 64-byte aligned
+ * layout (falcon_expand_privkey_aligned() and _ALIGNED temporary
+ * buffer sizes).
+ *
+ * No AArch64 hardware numbers have been collected for this table yet:
+ * the aligned layout is unmeasured, and was only checked for
+ * correctness and run under emulation (st 443 -> 432 kc, vv unchanged,
+ * which says nothing about real cores).
+ */
+static void
+test_speed_align(unsigned logn, int iteration)
+{
+        bench_context bu, ba;
+        uint8_t *tmp_raw, *esk_raw, *aesk_raw;
+        long long cu[2], ca[2], wu[2], wa[2];
+        size_t len;
+
+        bu.logn = logn;
+        if (shake256_init_prng_from_system(&bu.rng) != 0) {
+                fprintf(stderr, "random seeding failed\n");
+                exit(EXIT_FAILURE);
+        }
+        len = FALCON_TMPSIZE_KEYGEN(logn);
+        len = maxsz(len, FALCON_TMPSIZE_EXPANDPRIV(logn));
+        len = maxsz(len, FALCON_TMPSIZE_SIGNTREE_ALIGNED(logn));
+        len = maxsz(len, FALCON_TMPSIZE_VERIFY_ALIGNED(logn));
+        tmp_raw = xmalloc(len + 128);
+        esk_raw = xmalloc(FALCON_EXPANDEDKEY_SIZE(logn) + 128);
+        aesk_raw = xmalloc(FALCON_EXPANDEDKEY_ALIGNED_SIZE(logn) + 64);
+        bu.pk = xmalloc(FALCON_PUBKEY_SIZE(logn));
+        bu.sk = xmalloc(FALCON_PRIVKEY_SIZE(logn));
+        bu.sig = xmalloc(FALCON_SIG_COMPRESSED_MAXSIZE(logn));
+        bu.sig_len = 0;
+        bu.sigct = xmalloc(FALCON_SIG_CT_SIZE(logn));
+        bu.sigct_len = 0;
+
+        /*
+         * Default layout: the header byte is at a 64-byte boundary,
+         * hence the payload at offset 8; tmp[] is at 8 mod 64 too.
+         */
+        bu.tmp = tmp_raw + ((64 - ((uintptr_t)tmp_raw & 63)) & 63) + 8;
+        bu.tmp_len = len;
+        bu.esk = esk_raw + ((64 - ((uintptr_t)esk_raw & 63)) & 63);
+        if (falcon_keygen_make(&bu.rng, logn,
+                bu.sk, FALCON_PRIVKEY_SIZE(logn),
+                bu.pk, FALCON_PUBKEY_SIZE(logn),
+                bu.tmp, bu.tmp_len) != 0
+                || falcon_expand_privkey(
+                bu.esk, FALCON_EXPANDEDKEY_SIZE(logn),
+                bu.sk, FALCON_PRIVKEY_SIZE(logn),
+                bu.tmp, bu.tmp_len) != 0)
+        {
+                fprintf(stderr, "key generation failed\n");
+                exit(EXIT_FAILURE);
+        }
+
+        ba = bu;
+        ba.esk = aesk_raw;
+        ba.sig = xmalloc(FALCON_SIG_COMPRESSED_MAXSIZE(logn));
+        ba.sigct = xmalloc(FALCON_SIG_CT_SIZE(logn));
+        if (falcon_expand_privkey_aligned(
+                ba.esk, FALCON_EXPANDEDKEY_ALIGNED_SIZE(logn),
+                ba.sk, FALCON_PRIVKEY_SIZE(logn),
+                ba.tmp, ba.tmp_len) != 0)
+        {
+                fprintf(stderr, "key expansion failed\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * The unaligned runs get the exact minimal buffer sizes, so
+         * that the library does not realign tmp[] for them.
+         */
+        bu.tmp_len = FALCON_TMPSIZE_SIGNTREE(logn);
+        cu[0] = do_bench_time_cycles(&bench_sign_tree, &bu, &wu[0], iteration);
+        ca[0] = do_bench_time_cycles(&bench_sign_tree, &ba, &wa[0], iteration);
+        bu.tmp_len = FALCON_TMPSIZE_VERIFY(logn);
+        cu[1] = do_bench_time_cycles(&bench_verify, &bu, &wu[1], iteration);
+        ca[1] = do_bench_time_cycles(&bench_verify, &ba, &wa[1], iteration);
+
+        printf("|degree|  st(kc)| st64(kc)|  vv(kc)| vv64(kc)|  st(us)| st64(us)|  vv(us)| vv64(us)|\n");
+        printf("| ---- | ------ | ------- | ------ | ------- | ------ | ------- | ------ | ------- |\n");
+        printf("|%4u: | %8.2f | %8.2f | %8.2f | %8.2f | %8.2f | %8.2f | %8.2f | %8.2f |\n\n",
+                1u << logn,
+                cu[0] / 1000.0, ca[0] / 1000.0, cu[1] / 1000.0, ca[1] / 1000.0,
+                wu[0] / 1000.0, wa[0] / 1000.0, wu[1] / 1000.0, wa[1] / 1000.0);
+        fflush(stdout);
+
+        xfree(tmp_raw);
+        xfree(esk_raw);
+        xfree(aesk_raw);
+        xfree(bu.pk);
+        xfree(bu.sk);
+        xfree(bu.sig);
+        xfree(bu.sigct);
+        xfree(ba.sig);
+        xfree(ba.sigct);
+}
+
 int
 main(void)
 {
@@ -561,6 +663,7 @@ main(void)
         // printf("sdc, stc, vvc: like sd, st and vv, but with constant-time hash-to-point\n\n");
         
         test_speed_falcon_time_cycles(FALCON_LOGN, iteration);
+        test_speed_align(FALCON_LOGN, iteration);
         // test_speed_falcon_cycles(FALCON_LOGN, iteration);
         // test_speed_falcon_time(FALCON_LOGN, iteration);
         return 0;
@@ -36,16 +36,22 @@
 #include <math.h>
 
 #include "inner.h"
+#include "poly.h"
 #include "falcon.h"
 #include "config.h"
 
+#if FALCON_KC_THREADS
+#include <pthread.h>
+#endif
+
 /*
  * If using ChaCha20 during keygen, then we don't generate the same
  * outputs from the same seeds, and we don't faithfully reproduce the
  * NIST test vectors (implementation is still safe, but the tests would
- * fail).
+ * fail). The same applies to the two-lane leaf sampler, which consumes
+ * the PRNG in a different order.
  */
-#if FALCON_KG_CHACHA20
+#if FALCON_KG_CHACHA20 || FALCON_SAMPLER_X2
 #define DO_NIST_TESTS   0
 #else
 #define DO_NIST_TESTS   1
@@ -2082,6 +2088,30 @@ test_codec_inner(unsigned logn, uint8_t *tmp, size_t tlen)
 			}
 			check_eq(s1, s2, n * sizeof *s2,
 				"comp encode/decode");
+
+			/*
+			 * Length-only mode, short output buffer, truncated
+			 * input and non-zero padding bits.
+			 */
+			if (Zf(comp_encode)(NULL, 0, s1) != len1
+				|| Zf(comp_encode)(ee, len1 - 1, s1) != 0
+				|| Zf(comp_decode)(s2, ee, len1 - 1) != 0)
+			{
+				fprintf(stderr, "ERR comp length checks\n");
+				exit(EXIT_FAILURE);
+			}
+			len2 = 0;
+			for (u = 0; u < n; u ++) {
+				len2 += 9 + ((unsigned)abs(s1[u]) >> 7);
+			}
+			if ((len2 & 7) != 0) {
+				ee[len1 - 1] ^= 1;
+				if (Zf(comp_decode)(s2, ee, len1) != 0) {
+					fprintf(stderr, "ERR comp padding\n");
+					exit(EXIT_FAILURE);
+				}
+				ee[len1 - 1] ^= 1;
+			}
 		}
 
 		b1 = (int8_t *)tmp;
@@ -2127,9 +2157,263 @@ test_codec_inner(unsigned logn, uint8_t *tmp, size_t tlen)
 	}
 }
 
+/*
+ * Non-canonical signature encodings must be rejected: "-0", and
+ * values above 2047 (16 or more zeros in the unary part).
+ */
+static void
+test_comp_strict(uint8_t *tmp)
+{
+	int16_t *x;
+	uint8_t *ee;
+	size_t len;
+
+	x = (int16_t *)tmp;
+	ee = tmp + 2 * FALCON_N;
+	memset(x, 0, FALCON_N * sizeof *x);
+	x[FALCON_N - 1] = -2047;
+	len = Zf(comp_encode)(ee, 4 * FALCON_N, x);
+	if (len == 0 || Zf(comp_decode)(x, ee, len) != len
+		|| x[FALCON_N - 1] != -2047)
+	{
+		fprintf(stderr, "ERR comp strict (valid)\n");
+		exit(EXIT_FAILURE);
+	}
+
+	ee[0] |= 0x80;
+	if (Zf(comp_decode)(x, ee, len) != 0) {
+		fprintf(stderr, "ERR comp strict (-0)\n");
+		exit(EXIT_FAILURE);
+	}
+
+	memset(ee, 0, 4 * FALCON_N);
+	ee[3] = 0x80;
+	if (Zf(comp_decode)(x, ee, 4 * FALCON_N) != 0) {
+		fprintf(stderr, "ERR comp strict (2048)\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Reference fixed-width decoding, bit by bit. Returned value is 0 if
+ * the forbidden -2^(bits-1) value appears, 1 otherwise.
+ */
+static int
+trim_unpack_ref(int16_t *x, const uint8_t *buf, size_t n, unsigned bits)
+{
+	size_t u;
+	unsigned j;
+	int ok;
+
+	ok = 1;
+	for (u = 0; u < n; u ++) {
+		uint32_t w;
+
+		w = 0;
+		for (j = 0; j < bits; j ++) {
+			size_t k;
+
+			k = u * bits + j;
+			w = (w << 1) | ((buf[k >> 3] >> (7 - (k & 7))) & 1);
+		}
+		if (w == ((uint32_t)1 << (bits - 1))) {
+			ok = 0;
+		}
+		w <<= 32 - bits;
+		x[u] = (int16_t)(*(int32_t *)&w >> (32 - bits));
+	}
+	return ok;
+}
+
+/*
+ * Decode valid encodings with one flipped bit, and encodings with the
+ * forbidden value at the start, middle and end, and compare with the
+ * reference decoder.
+ */
+static void
+test_trim_strict(unsigned logn, uint8_t *tmp)
+{
+	inner_shake256_context sc;
+	int16_t *s1, *s2, *s3;
+	int8_t *b2;
+	uint8_t *ee;
+	size_t n;
+	unsigned bits;
+
+	n = (size_t)1 << logn;
+	s1 = (int16_t *)tmp;
+	s2 = s1 + n;
+	s3 = s2 + n;
+	ee = (uint8_t *)(s3 + n);
+	b2 = (int8_t *)s2;
+	inner_shake256_init(&sc);
+	inner_shake256_inject(&sc, (const uint8_t *)"trim", 4);
+	tmp[0] = logn;
+	inner_shake256_inject(&sc, tmp, 1);
+	inner_shake256_flip(&sc);
+
+	for (bits = 2; bits <= 16; bits ++) {
+		size_t u, len, k;
+		int i, ok;
+		unsigned mask1, mask2;
+
+		mask1 = 1u << (bits - 1);
+		mask2 = mask1 - 1u;
+		len = ((n * bits) + 7) >> 3;
+		for (i = 0; i < 13; i ++) {
+			uint8_t tt[4];
+			size_t r1, r2;
+
+			for (u = 0; u < n; u ++) {
+				unsigned w, a;
+
+				inner_shake256_extract(&sc, tt, 2);
+				w = (unsigned)tt[0] | ((unsigned)tt[1] << 8);
+				a = w & mask2;
+				s1[u] = ((w & mask1) != 0) ? -(int)a : (int)a;
+			}
+			if (i >= 10) {
+				u = (i == 10) ? 0 : (i == 11) ? (n >> 1) : n - 1;
+				s1[u] = 0;
+			}
+			if (Zf(trim_i16_encode)(ee, len, s1, logn, bits) != len) {
+				fprintf(stderr, "ERR trim strict (encode)\n");
+				exit(EXIT_FAILURE);
+			}
+			if (i < 10) {
+				inner_shake256_extract(&sc, tt, 4);
+				k = ((size_t)tt[0] | ((size_t)tt[1] << 8)
+					| ((size_t)tt[2] << 16)) % (n * bits);
+			} else {
+				k = u * bits;
+			}
+			ee[k >> 3] ^= (uint8_t)(0x80 >> (k & 7));
+			ok = trim_unpack_ref(s3, ee, n, bits);
+			r1 = Zf(trim_i16_decode)(s2, logn, bits, ee, len);
+			if (r1 != (ok ? len : 0)) {
+				fprintf(stderr, "ERR trim_i16 strict"
+					" (bits=%u, %zu)\n", bits, r1);
+				exit(EXIT_FAILURE);
+			}
+			if (ok) {
+				check_eq(s2, s3, n * sizeof *s2,
+					"trim_i16 strict");
+			}
+			if (bits > 8 || logn != FALCON_LOGN) {
+				continue;
+			}
+			r2 = Zf(trim_i8_decode)(b2, bits, ee, len);
+			if (r2 != r1) {
+				fprintf(stderr, "ERR trim_i8 strict"
+					" (bits=%u, %zu)\n", bits, r2);
+				exit(EXIT_FAILURE);
+			}
+			for (u = 0; ok && u < n; u ++) {
+				if (b2[u] != s3[u]) {
+					fprintf(stderr, "ERR trim_i8 strict"
+						" (bits=%u, value %zu)\n", bits, u);
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Reference 14-bit packing (no range check).
+ */
+static void
+modq_pack_ref(uint8_t *buf, const uint16_t *x, size_t n)
+{
+	size_t u, v;
+
+	memset(buf, 0, ((n * 14) + 7) >> 3);
+	for (u = 0; u < n * 14; u ++) {
+		if ((x[u / 14] >> (13 - u % 14)) & 1) {
+			v = u >> 3;
+			buf[v] |= (uint8_t)(0x80 >> (u & 7));
+		}
+	}
+}
+
+static void
+test_modq_strict(unsigned logn, uint8_t *tmp)
+{
+	uint16_t *x, *y;
+	uint8_t *ee, *ref;
+	size_t n, u, len, pos[3];
+	int i;
+
+	n = (size_t)1 << logn;
+	len = ((n * 14) + 7) >> 3;
+	x = (uint16_t *)tmp;
+	y = x + n;
+	ee = (uint8_t *)(y + n);
+	ref = ee + len;
+	for (u = 0; u < n; u ++) {
+		x[u] = (uint16_t)((u * 7919 + 12288) % 12289);
+	}
+	x[n - 1] = 12288;
+	modq_pack_ref(ref, x, n);
+	if (Zf(modq_encode)(ee, len, x, logn) != len) {
+		fprintf(stderr, "ERR modq strict (encode)\n");
+		exit(EXIT_FAILURE);
+	}
+	check_eq(ee, ref, len, "modq encode (ref)");
+	if (Zf(modq_decode)(y, ee, len, logn) != len) {
+		fprintf(stderr, "ERR modq strict (decode)\n");
+		exit(EXIT_FAILURE);
+	}
+	check_eq(x, y, n * sizeof *x, "modq decode (ref)");
+	if (Zf(modq_encode)(ee, len - 1, x, logn) != 0
+		|| Zf(modq_decode)(y, ee, len - 1, logn) != 0)
+	{
+		fprintf(stderr, "ERR modq strict (short buffer)\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Out-of-range values (12289 and 16383), both at the start, in
+	 * the middle and at the end.
+	 */
+	pos[0] = 0;
+	pos[1] = n >> 1;
+	pos[2] = n - 1;
+	for (i = 0; i < 6; i ++) {
+		uint16_t old;
+
+		u = pos[i >> 1];
+		old = x[u];
+		x[u] = (i & 1) ? 16383 : 12289;
+		if (Zf(modq_encode)(ee, len, x, logn) != 0) {
+			fprintf(stderr, "ERR modq strict (encode %u)\n", x[u]);
+			exit(EXIT_FAILURE);
+		}
+		modq_pack_ref(ee, x, n);
+		if (Zf(modq_decode)(y, ee, len, logn) != 0) {
+			fprintf(stderr, "ERR modq strict (decode %u)\n", x[u]);
+			exit(EXIT_FAILURE);
+		}
+		x[u] = old;
+	}
+
+	/*
+	 * Non-zero padding bits (only with n = 2: 28 bits in 4 bytes).
+	 */
+	if (logn == 1) {
+		modq_pack_ref(ee, x, n);
+		ee[len - 1] |= 0x01;
+		if (Zf(modq_decode)(y, ee, len, logn) != 0) {
+			fprintf(stderr, "ERR modq strict (padding)\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
 static void
 test_codec(void)
 {
+	unsigned logn;
 	uint8_t *tmp;
 	size_t tlen;
 
@@ -2140,6 +2424,11 @@ test_codec(void)
 
 	
     test_codec_inner(FALCON_LOGN, tmp, tlen);
+    test_comp_strict(tmp);
+    for (logn = 1; logn <= 10; logn ++) {
+        test_modq_strict(logn, tmp);
+        test_trim_strict(logn, tmp);
+    }
     // printf(".");
     fflush(stdout);
 
@@ -2149,6 +2438,57 @@ test_codec(void)
 	fflush(stdout);
 }
 
+/*
+ * Check the fused verification kernels against the separate passes
+ * (NTT, pointwise multiplication, inverse NTT, subtraction, norm), for
+ * s2 and for s2 scaled by 'scale'. tmp[] must have room for 3*N values.
+ * Norms are exact below 2^30; above, they only have to stay large
+ * (saturated accumulators).
+ */
+static void
+test_vrfy_fused(const int16_t *c0, const int16_t *s2, const int16_t *h,
+	int16_t *tmp, int scale)
+{
+	int16_t *tt, *t2, *sx;
+	uint64_t n1, n2;
+	uint32_t m1, m2;
+	size_t u;
+
+	tt = tmp;
+	t2 = tt + FALCON_N;
+	sx = t2 + FALCON_N;
+	for (u = 0; u < FALCON_N; u ++) {
+		sx[u] = (int16_t)(s2[u] * scale);
+	}
+
+	memcpy(tt, sx, FALCON_N * sizeof *tt);
+	ZfN(poly_ntt)(tt, NTT_MONT_INV);
+	ZfN(poly_montmul_ntt)(tt, h);
+	ZfN(poly_invntt)(tt, INVNTT_NONE);
+	ZfN(poly_sub_barrett)(tt, c0, tt);
+	n1 = 0;
+	n2 = 0;
+	for (u = 0; u < FALCON_N; u ++) {
+		n1 += (uint64_t)(tt[u] * tt[u]);
+		n2 += (uint64_t)(sx[u] * sx[u]);
+	}
+
+	m2 = ZfN(poly_ntt_montmul)(t2, sx, h);
+	m1 = ZfN(poly_invntt_sub_norm)(t2, c0);
+	if ((n1 < (1u << 30) ? m1 != n1 : m1 < (1u << 30) - 1)
+		|| (n2 < (1u << 30) ? m2 != n2 : m2 < (1u << 30) - 1))
+	{
+		fprintf(stderr, "fused verify: wrong norm (%lu,%lu) / (%lu,%lu)\n",
+			(unsigned long)m1, (unsigned long)m2,
+			(unsigned long)n1, (unsigned long)n2);
+		exit(EXIT_FAILURE);
+	}
+	if (ZfN(is_short_sqnorm)(m1 + m2) != ZfN(is_short)(tt, sx)) {
+		fprintf(stderr, "fused verify: wrong decision\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
 static void
 test_vrfy_inner(unsigned logn, const int8_t *f, const int8_t *g,
 	const int8_t *F, const int8_t *G, const uint16_t *h,
@@ -2216,7 +2556,7 @@ test_vrfy_inner(unsigned logn, const int8_t *f, const int8_t *g,
 	/*
 	 * Verify sample signatures.
 	 */
-	if (tlen < 8 * n) {
+	if (tlen < 12 * n) {
 		fprintf(stderr, "Insufficient buffer size\n");
 		exit(EXIT_FAILURE);
 	}
@@ -2281,6 +2621,8 @@ test_vrfy_inner(unsigned logn, const int8_t *f, const int8_t *g,
 			fprintf(stderr, "KAT signature failed\n");
 			exit(EXIT_FAILURE);
 		}
+		test_vrfy_fused(c0, s2, h2, c0 + n, 1);
+		test_vrfy_fused(c0, s2, h2, c0 + n, 3);
 
 		// printf(".");
 		fflush(stdout);
@@ -2298,7 +2640,7 @@ test_vrfy(void)
 
 	printf("Test verify: ");
 	fflush(stdout);
-	tlen = 8192;
+	tlen = 12 * FALCON_N;
 	tmp = xmalloc(tlen);
 
     switch (FALCON_LOGN)
@@ -3425,10 +3767,11 @@ approximate_exp(fpr x)
  * For given center mu, and isigma = 1/sigma (where sigma is the standard
  * deviation of the distribution for sampling), run the sampler many
  * times, and use a chi square test to compare the result with the
- * expected distribution.
+ * expected distribution. If x2 is non-zero, then values are obtained
+ * by pairs from the two-lane sampler.
  */
 static void
-test_sampler_rand(sampler_context *sc, fpr mu, fpr isigma)
+test_sampler_rand(sampler_context *sc, fpr mu, fpr isigma, int x2)
 {
 #define MAX_DEV           30
 #define NUM_SAMPLES   100000
@@ -3474,14 +3817,30 @@ test_sampler_rand(sampler_context *sc, fpr mu, fpr isigma)
 	for (z = -MAX_DEV; z <= +MAX_DEV; z ++) {
 		zz[z + MAX_DEV] = 0;
 	}
-	for (ctr = 0; ctr < NUM_SAMPLES; ctr ++) {
-		z = Zf(sampler)(sc, mu, isigma);
-		z -= c;
-		if (z < -MAX_DEV || z > +MAX_DEV) {
-			fprintf(stderr, "out-of-range sampled value: %d\n", z);
-			exit(EXIT_FAILURE);
+	for (ctr = 0; ctr < NUM_SAMPLES; ctr += 2) {
+		int zp[2], j;
+
+		if (x2) {
+			fpr mp[2], fp[2];
+
+			mp[0] = mu;
+			mp[1] = mu;
+			Zf(sampler_x2)(sc, fp, mp, isigma);
+			zp[0] = (int)fpr_rint(fp[0]);
+			zp[1] = (int)fpr_rint(fp[1]);
+		} else {
+			zp[0] = Zf(sampler)(sc, mu, isigma);
+			zp[1] = Zf(sampler)(sc, mu, isigma);
+		}
+		for (j = 0; j < 2; j ++) {
+			z = zp[j] - c;
+			if (z < -MAX_DEV || z > +MAX_DEV) {
+				fprintf(stderr,
+					"out-of-range sampled value: %d\n", z);
+				exit(EXIT_FAILURE);
+			}
+			zz[z + MAX_DEV] ++;
 		}
-		zz[z + MAX_DEV] ++;
 	}
 
 	/*
@@ -3604,13 +3963,23 @@ test_sampler(void)
 	mu = fpr_neg(fpr_one);
 	muinc = fpr_div(fpr_one, fpr_of(10));
 	for (i = 0; i < 21; i ++) {
-		test_sampler_rand(&sc, mu, isigma);
+		test_sampler_rand(&sc, mu, isigma, 0);
 		mu = fpr_add(mu, muinc);
 
 		// printf(".");
 		fflush(stdout);
 	}
 
+	/*
+	 * Same centers with the two-lane sampler.
+	 */
+	mu = fpr_neg(fpr_one);
+	for (i = 0; i < 21; i ++) {
+		test_sampler_rand(&sc, mu, isigma, 1);
+		mu = fpr_add(mu, muinc);
+		fflush(stdout);
+	}
+
 	printf(" done.\n");
 	fflush(stdout);
 }
@@ -3649,7 +4018,8 @@ test_sign_self(const int8_t *f, const int8_t *g,
 	for (i = 0; i < 100; i ++) {
 	    memcpy(h, h_src, n * sizeof *h);
 		uint8_t msg[50];  /* nonce + plain */
-		inner_shake256_context sc, sc2;
+		inner_shake256_context sc, sc2, sc3, sc4, sc5;
+		uint16_t *hm3;
 		size_t u;
 
 		inner_shake256_extract(&rng, msg, sizeof msg);
@@ -3658,6 +4028,7 @@ test_sign_self(const int8_t *f, const int8_t *g,
 		inner_shake256_inject(&sc, msg, sizeof msg);
 		inner_shake256_flip(&sc);
 		sc2 = sc;
+		sc3 = sc;
 		Zf(hash_to_point_vartime)(&sc, hm, logn);
 		Zf(hash_to_point_ct)(&sc2, hm2, logn, tt);
 		for (u = 0; u < n; u ++) {
@@ -3666,6 +4037,27 @@ test_sign_self(const int8_t *f, const int8_t *g,
 				exit(EXIT_FAILURE);
 			}
 		}
+
+		/*
+		 * Two-lane hash_to_point, with a second (shorter) message
+		 * in the other lane; both outputs and final contexts must
+		 * match the scalar code.
+		 */
+		hm3 = (uint16_t *)tt + n;
+		inner_shake256_init(&sc4);
+		inner_shake256_inject(&sc4, msg, 1 + (i % 40));
+		inner_shake256_flip(&sc4);
+		sc5 = sc4;
+		Zf(hash_to_point_vartime)(&sc5, (uint16_t *)tt, logn);
+		Zf(hash_to_point_x2)(&sc3, &sc4, hm2, hm3, logn);
+		if (memcmp(hm2, hm, n * sizeof *hm) != 0
+			|| memcmp(hm3, tt, n * sizeof *hm) != 0
+			|| memcmp(&sc3, &sc, sizeof sc) != 0
+			|| memcmp(&sc4, &sc5, sizeof sc) != 0)
+		{
+			fprintf(stderr, "hash_to_point_x2() mismatch\n");
+			exit(EXIT_FAILURE);
+		}
 		Zf(sign_dyn)(sig, &rng, f, g, F, G, hm, tt);
 		if (!Zf(verify_raw)( (int16_t *) hm, sig, (int16_t *) h, (int16_t *) tt)) {
 			fprintf(stderr, "self signature (dyn) not verified\n");
@@ -3854,10 +4246,13 @@ test_external_API_inner(unsigned logn, shake256_context *rng)
 {
 	int i;
 	void *pubkey, *pubkey2, *privkey, *sig, *sigpad, *sigct, *expkey;
+	void *prepkey;
 	size_t pubkey_len, privkey_len, sig_len, sigpad_len, sigct_len;
-	size_t expkey_len;
-	uint8_t *tmpkg, *tmpmp, *tmpsd, *tmpst, *tmpvv, *tmpek;
+	size_t expkey_len, prepkey_len;
+	uint8_t *tmpkg, *tmpmp, *tmpsd, *tmpst, *tmpvv, *tmpek, *tmpvp;
+	uint8_t *tmpvb;
 	size_t tmpkg_len, tmpmp_len, tmpsd_len, tmpst_len, tmpvv_len, tmpek_len;
+	size_t tmpvp_len, tmpvb_len;
 
 	printf("[%u]", logn);
 	fflush(stdout);
@@ -3868,6 +4263,7 @@ test_external_API_inner(unsigned logn, shake256_context *rng)
 	sigpad_len = FALCON_SIG_PADDED_SIZE(logn);
 	sigct_len = FALCON_SIG_CT_SIZE(logn);
 	expkey_len = FALCON_EXPANDEDKEY_SIZE(logn);
+	prepkey_len = FALCON_PREPARED_PUBKEY_SIZE(logn);
 
 	pubkey = xmalloc(pubkey_len);
 	pubkey2 = xmalloc(pubkey_len);
@@ -3876,6 +4272,7 @@ test_external_API_inner(unsigned logn, shake256_context *rng)
 	sigpad = xmalloc(sig_len);
 	sigct = xmalloc(sigct_len);
 	expkey = xmalloc(expkey_len);
+	prepkey = xmalloc(prepkey_len);
 
 	tmpkg_len = FALCON_TMPSIZE_KEYGEN(logn);
 	tmpmp_len = FALCON_TMPSIZE_MAKEPUB(logn);
@@ -3883,6 +4280,8 @@ test_external_API_inner(unsigned logn, shake256_context *rng)
 	tmpst_len = FALCON_TMPSIZE_SIGNTREE(logn);
 	tmpvv_len = FALCON_TMPSIZE_VERIFY(logn);
 	tmpek_len = FALCON_TMPSIZE_EXPANDPRIV(logn);
+	tmpvp_len = FALCON_TMPSIZE_VERIFY_PREPARED(logn);
+	tmpvb_len = FALCON_TMPSIZE_VERIFY_BATCH(logn);
 
 	tmpkg = xmalloc(tmpkg_len);
 	tmpmp = xmalloc(tmpmp_len);
@@ -3890,6 +4289,8 @@ test_external_API_inner(unsigned logn, shake256_context *rng)
 	tmpst = xmalloc(tmpst_len);
 	tmpvv = xmalloc(tmpvv_len);
 	tmpek = xmalloc(tmpek_len);
+	tmpvp = xmalloc(tmpvp_len);
+	tmpvb = xmalloc(tmpvb_len);
 
 	for (i = 0; i < 12; i ++) {
 		int r;
@@ -4011,6 +4412,84 @@ test_external_API_inner(unsigned logn, shake256_context *rng)
 			}
 		}
 
+		r = falcon_pubkey_prepare(prepkey, prepkey_len,
+			pubkey, pubkey_len);
+		if (r != 0) {
+			fprintf(stderr, "pubkey_prepare failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_verify_prepared(sig, sig_len, FALCON_SIG_COMPRESSED,
+			prepkey, "data1", 5, tmpvp, tmpvp_len);
+		if (r != 0) {
+			fprintf(stderr, "verify_prepared failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_verify_prepared(sigpad, sigpad_len,
+			FALCON_SIG_PADDED,
+			prepkey, "data1", 5, tmpvp, tmpvp_len);
+		if (r != 0) {
+			fprintf(stderr,
+				"verify_prepared(padded) failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_verify_prepared(sigct, sigct_len, FALCON_SIG_CT,
+			prepkey, "data1", 5, tmpvp, tmpvp_len);
+		if (r != 0) {
+			fprintf(stderr, "verify_prepared(ct) failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		if (logn >= 5) {
+			r = falcon_verify_prepared(sig, sig_len,
+				FALCON_SIG_COMPRESSED,
+				prepkey, "data2", 5, tmpvp, tmpvp_len);
+			if (r != FALCON_ERR_BADSIG) {
+				fprintf(stderr,
+					"wrong verify_prepared err: %d\n", r);
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		/*
+		 * Batch verification: six items (more than one group),
+		 * mixing formats, with item 3 signed over other data.
+		 */
+		{
+			const void *bsig[6], *bpk[6], *bdata[6];
+			size_t bsig_len[6], bpk_len[6], bdata_len[6];
+			uint8_t bres[1];
+			int j;
+
+			for (j = 0; j < 6; j ++) {
+				bpk[j] = pubkey;
+				bpk_len[j] = pubkey_len;
+				bdata[j] = "data1";
+				bdata_len[j] = 5;
+			}
+			bsig[0] = sig;    bsig_len[0] = sig_len;
+			bsig[1] = sigpad; bsig_len[1] = sigpad_len;
+			bsig[2] = sigct;  bsig_len[2] = sigct_len;
+			bsig[3] = sig;    bsig_len[3] = sig_len;
+			bsig[4] = sigct;  bsig_len[4] = sigct_len;
+			bsig[5] = sig;    bsig_len[5] = sig_len;
+			bdata[3] = "data2";
+			r = falcon_verify_batch(logn, bres, 6,
+				bsig, bsig_len, 0, bpk, bpk_len,
+				bdata, bdata_len, tmpvb, tmpvb_len);
+			if (logn >= 5 && (r != 5 || bres[0] != 0x37)) {
+				fprintf(stderr, "verify_batch failed:"
+					" %d (0x%02X)\n", r, bres[0]);
+				exit(EXIT_FAILURE);
+			}
+			r = falcon_verify_batch(logn, bres, 6,
+				bsig, bsig_len, FALCON_SIG_CT, bpk, bpk_len,
+				bdata, bdata_len, tmpvb, tmpvb_len);
+			if (r != 2 || bres[0] != 0x14) {
+				fprintf(stderr, "verify_batch(ct) failed:"
+					" %d (0x%02X)\n", r, bres[0]);
+				exit(EXIT_FAILURE);
+			}
+		}
+
 		r = falcon_expand_privkey(expkey, expkey_len,
 			privkey, privkey_len, tmpek, tmpek_len);
 		if (r != 0) {
@@ -4107,48 +4586,1490 @@ test_external_API_inner(unsigned logn, shake256_context *rng)
 	xfree(sigpad);
 	xfree(sigct);
 	xfree(expkey);
+	xfree(prepkey);
 	xfree(tmpkg);
 	xfree(tmpmp);
 	xfree(tmpsd);
 	xfree(tmpst);
 	xfree(tmpvv);
 	xfree(tmpek);
+	xfree(tmpvp);
+	xfree(tmpvb);
 }
 
+/*
+ * Multi-threaded key generation must yield the same key pair as the
+ * single-threaded code, for any number of threads.
+ */
 static void
-test_external_API(void)
+test_keygen_mt(unsigned logn)
 {
-	shake256_context rng;
-
-	printf("Test external API: ");
-	fflush(stdout);
+	static const unsigned nthreads[] = { 1, 2, 3, 4, 7 };
+	shake256_context rng, rng2;
+	void *privkey, *privkey2, *pubkey, *pubkey2;
+	uint8_t *tmp;
+	size_t privkey_len, pubkey_len, tmp_len;
+	falcon_keygen_pool *pool;
+	int i, r;
 
-	shake256_init_prng_from_seed(&rng, "external", 8);
-    test_external_API_inner(FALCON_LOGN, &rng);
-	
-	printf("done.\n");
+	printf("[keygen_mt]");
 	fflush(stdout);
-}
 
-#if DO_NIST_TESTS
+	privkey_len = FALCON_PRIVKEY_SIZE(logn);
+	pubkey_len = FALCON_PUBKEY_SIZE(logn);
+	tmp_len = FALCON_TMPSIZE_KEYGEN_MT(logn, 7);
+	privkey = xmalloc(privkey_len);
+	privkey2 = xmalloc(privkey_len);
+	pubkey = xmalloc(pubkey_len);
+	pubkey2 = xmalloc(pubkey_len);
+	tmp = xmalloc(tmp_len);
 
-/* ===================================================================== */
-/*
- * Custom perfunctory AES-256 implementation (included to avoid any
- * dependency on OpenSSL). This implementation is for tests only; it
- * is not constant-time.
- */
+	shake256_init_prng_from_seed(&rng, "keygen_mt", 9);
+	for (i = 0; i < (int)(sizeof nthreads / sizeof nthreads[0]); i ++) {
+		rng2 = rng;
+		r = falcon_keygen_make(&rng, logn, privkey, privkey_len,
+			pubkey, pubkey_len, tmp, FALCON_TMPSIZE_KEYGEN(logn));
+		if (r != 0) {
+			fprintf(stderr, "keygen failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_keygen_make_mt(&rng2, logn, privkey2, privkey_len,
+			pubkey2, pubkey_len, tmp,
+			FALCON_TMPSIZE_KEYGEN_MT(logn, nthreads[i]),
+			nthreads[i]);
+		if (r != 0) {
+			fprintf(stderr, "keygen_mt failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		check_eq(privkey, privkey2, privkey_len, "keygen_mt privkey");
+		check_eq(pubkey, pubkey2, pubkey_len, "keygen_mt pubkey");
+		check_eq(&rng, &rng2, sizeof rng, "keygen_mt rng");
+		printf(".");
+		fflush(stdout);
+	}
+	r = falcon_keygen_make_mt(&rng, logn, privkey2, privkey_len,
+		pubkey2, pubkey_len, tmp, FALCON_TMPSIZE_KEYGEN_MT(logn, 4) - 1,
+		4);
+	if (r != FALCON_ERR_SIZE) {
+		fprintf(stderr, "keygen_mt short tmp: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
 
-static inline uint32_t
-dec32be(const void *src)
-{
-	const unsigned char *buf;
+	/*
+	 * A pool keeps its threads across key pairs; each key pair must
+	 * still be the single-threaded one.
+	 */
+	if (falcon_keygen_pool_new(logn, 0) != NULL
+		|| falcon_keygen_pool_new(11, 3) != NULL)
+	{
+		fprintf(stderr, "keygen_pool_new accepted bad parameters\n");
+		exit(EXIT_FAILURE);
+	}
+	pool = falcon_keygen_pool_new(logn, 3);
+	if (pool == NULL) {
+		fprintf(stderr, "keygen_pool_new failed\n");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < 3; i ++) {
+		rng2 = rng;
+		r = falcon_keygen_make(&rng, logn, privkey, privkey_len,
+			pubkey, pubkey_len, tmp, FALCON_TMPSIZE_KEYGEN(logn));
+		if (r != 0) {
+			fprintf(stderr, "keygen failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_keygen_make_pool(pool, &rng2, logn,
+			privkey2, privkey_len, pubkey2, pubkey_len,
+			tmp, FALCON_TMPSIZE_KEYGEN(logn));
+		if (r != 0) {
+			fprintf(stderr, "keygen_make_pool failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		check_eq(privkey, privkey2, privkey_len, "keygen_pool privkey");
+		check_eq(pubkey, pubkey2, pubkey_len, "keygen_pool pubkey");
+		check_eq(&rng, &rng2, sizeof rng, "keygen_pool rng");
+		printf(".");
+		fflush(stdout);
+	}
+	falcon_keygen_pool_free(pool);
+	pool = falcon_keygen_pool_new(logn - 1, 3);
+	if (pool == NULL) {
+		fprintf(stderr, "keygen_pool_new failed\n");
+		exit(EXIT_FAILURE);
+	}
+	r = falcon_keygen_make_pool(pool, &rng, logn, privkey2, privkey_len,
+		pubkey2, pubkey_len, tmp, tmp_len);
+	if (r != FALCON_ERR_BADARG) {
+		fprintf(stderr, "keygen_make_pool larger degree: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	falcon_keygen_pool_free(pool);
 
-	buf = src;
-	return ((uint32_t)buf[0] << 24)
-		| ((uint32_t)buf[1] << 16)
-		| ((uint32_t)buf[2] << 8)
-		| (uint32_t)buf[3];
+	xfree(privkey);
+	xfree(privkey2);
+	xfree(pubkey);
+	xfree(pubkey2);
+	xfree(tmp);
+}
+
+#define KEYGEN_MANY_COUNT   5
+
+typedef struct {
+	size_t privkey_len, pubkey_len;
+	uint8_t *privkey, *pubkey;
+	int seen[KEYGEN_MANY_COUNT];
+	int calls, stop_after;
+} keygen_many_state;
+
+static int
+keygen_many_cb(void *ctx, size_t index,
+	const void *privkey, size_t privkey_len,
+	const void *pubkey, size_t pubkey_len)
+{
+	keygen_many_state *ks;
+
+	ks = ctx;
+	if (index >= KEYGEN_MANY_COUNT || ks->seen[index]
+		|| privkey_len != ks->privkey_len
+		|| pubkey_len != ks->pubkey_len)
+	{
+		fprintf(stderr, "keygen_many: bad callback (index %lu)\n",
+			(unsigned long)index);
+		exit(EXIT_FAILURE);
+	}
+	ks->seen[index] = 1;
+	memcpy(ks->privkey + index * privkey_len, privkey, privkey_len);
+	memcpy(ks->pubkey + index * pubkey_len, pubkey, pubkey_len);
+	if (++ ks->calls == ks->stop_after) {
+		return 7;
+	}
+	return 0;
+}
+
+/*
+ * Check that falcon_keygen_many() returns, for each index, the key pair
+ * falcon_keygen_make() computes from the corresponding derived seed,
+ * whatever the number of threads, and that the callback can stop it.
+ */
+static void
+test_keygen_many(unsigned logn)
+{
+	static const unsigned nthreads[] = { 1, 2, 3 };
+	shake256_context rng, rng2, krng;
+	keygen_many_state ks;
+	void *privkey, *pubkey;
+	uint8_t *tmp;
+	uint8_t seed[48];
+	size_t tmp_len;
+	int i, j, r;
+
+	printf("[keygen_many]");
+	fflush(stdout);
+
+	ks.privkey_len = FALCON_PRIVKEY_SIZE(logn);
+	ks.pubkey_len = FALCON_PUBKEY_SIZE(logn);
+	ks.privkey = xmalloc(KEYGEN_MANY_COUNT * ks.privkey_len);
+	ks.pubkey = xmalloc(KEYGEN_MANY_COUNT * ks.pubkey_len);
+	privkey = xmalloc(ks.privkey_len);
+	pubkey = xmalloc(ks.pubkey_len);
+	tmp_len = FALCON_TMPSIZE_KEYGEN_MANY(logn, 3);
+	if (tmp_len < FALCON_TMPSIZE_KEYGEN(logn)) {
+		tmp_len = FALCON_TMPSIZE_KEYGEN(logn);
+	}
+	tmp = xmalloc(tmp_len);
+
+	shake256_init_prng_from_seed(&rng, "keygen_many", 11);
+	for (i = 0; i < (int)(sizeof nthreads / sizeof nthreads[0]); i ++) {
+		rng2 = rng;
+		memset(ks.seen, 0, sizeof ks.seen);
+		ks.calls = 0;
+		ks.stop_after = 0;
+		r = falcon_keygen_many(&rng2, logn, KEYGEN_MANY_COUNT,
+			nthreads[i], &keygen_many_cb, &ks, tmp,
+			FALCON_TMPSIZE_KEYGEN_MANY(logn, nthreads[i]));
+		if (r != 0 || ks.calls != KEYGEN_MANY_COUNT) {
+			fprintf(stderr, "keygen_many failed: %d (%d keys)\n",
+				r, ks.calls);
+			exit(EXIT_FAILURE);
+		}
+		for (j = 0; j < KEYGEN_MANY_COUNT; j ++) {
+			shake256_extract(&rng, seed, sizeof seed);
+			shake256_init_prng_from_seed(&krng, seed, sizeof seed);
+			r = falcon_keygen_make(&krng, logn,
+				privkey, ks.privkey_len,
+				pubkey, ks.pubkey_len,
+				tmp, FALCON_TMPSIZE_KEYGEN(logn));
+			if (r != 0) {
+				fprintf(stderr, "keygen failed: %d\n", r);
+				exit(EXIT_FAILURE);
+			}
+			check_eq(privkey, ks.privkey + j * ks.privkey_len,
+				ks.privkey_len, "keygen_many privkey");
+			check_eq(pubkey, ks.pubkey + j * ks.pubkey_len,
+				ks.pubkey_len, "keygen_many pubkey");
+		}
+		check_eq(&rng, &rng2, sizeof rng, "keygen_many rng");
+		printf(".");
+		fflush(stdout);
+	}
+
+	memset(ks.seen, 0, sizeof ks.seen);
+	ks.calls = 0;
+	ks.stop_after = 2;
+	r = falcon_keygen_many(&rng, logn, KEYGEN_MANY_COUNT, 3,
+		&keygen_many_cb, &ks, tmp, FALCON_TMPSIZE_KEYGEN_MANY(logn, 3));
+	if (r != 7 || ks.calls != 2) {
+		fprintf(stderr, "keygen_many stop: %d (%d keys)\n",
+			r, ks.calls);
+		exit(EXIT_FAILURE);
+	}
+	r = falcon_keygen_many(&rng, logn, KEYGEN_MANY_COUNT, 3,
+		&keygen_many_cb, &ks, tmp,
+		FALCON_TMPSIZE_KEYGEN_MANY(logn, 3) - 1);
+	if (r != FALCON_ERR_SIZE) {
+		fprintf(stderr, "keygen_many short tmp: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+
+	xfree(ks.privkey);
+	xfree(ks.pubkey);
+	xfree(privkey);
+	xfree(pubkey);
+	xfree(tmp);
+}
+
+/*
+ * Generate a key pair for the API tests, into newly allocated buffers
+ * *sk and *pk. If ek is not NULL, the private key is also expanded into
+ * a newly allocated *ek. If seed is not NULL, rng is first initialized
+ * from it; otherwise, the key pair is generated from the current rng
+ * state (to make several key pairs from a single seed). If *tmp is
+ * NULL, a temporary buffer large enough for all the API tests
+ * (including the _ALIGNED functions at any offset up to 63) is
+ * allocated, and its length is written into *tmp_len.
+ */
+static void
+make_test_keypair(unsigned logn, shake256_context *rng, const char *seed,
+	uint8_t **sk, uint8_t **pk, uint8_t **ek,
+	uint8_t **tmp, size_t *tmp_len)
+{
+	size_t sizes[7], u;
+	int r;
+
+	if (*tmp == NULL) {
+		sizes[0] = FALCON_TMPSIZE_KEYGEN(logn);
+		sizes[1] = FALCON_TMPSIZE_EXPANDPRIV(logn);
+		sizes[2] = FALCON_TMPSIZE_SIGNDYN(logn);
+		sizes[3] = FALCON_TMPSIZE_SIGNTREE_ALIGNED(logn) + 63;
+		sizes[4] = FALCON_TMPSIZE_VERIFY_ALIGNED(logn) + 63;
+		sizes[5] = FALCON_TMPSIZE_KEYCACHE(logn);
+		sizes[6] = FALCON_TMPSIZE_EXPKEY_STORE(logn);
+		*tmp_len = 0;
+		for (u = 0; u < (sizeof sizes) / sizeof(sizes[0]); u ++) {
+			if (*tmp_len < sizes[u]) {
+				*tmp_len = sizes[u];
+			}
+		}
+		*tmp = xmalloc(*tmp_len);
+	}
+	if (seed != NULL) {
+		shake256_init_prng_from_seed(rng, seed, strlen(seed));
+	}
+	*sk = xmalloc(FALCON_PRIVKEY_SIZE(logn));
+	*pk = xmalloc(FALCON_PUBKEY_SIZE(logn));
+	r = falcon_keygen_make(rng, logn,
+		*sk, FALCON_PRIVKEY_SIZE(logn),
+		*pk, FALCON_PUBKEY_SIZE(logn), *tmp, *tmp_len);
+	if (r != 0) {
+		fprintf(stderr, "keygen failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	if (ek != NULL) {
+		*ek = xmalloc(FALCON_EXPANDEDKEY_SIZE(logn));
+		r = falcon_expand_privkey(*ek, FALCON_EXPANDEDKEY_SIZE(logn),
+			*sk, FALCON_PRIVKEY_SIZE(logn), *tmp, *tmp_len);
+		if (r != 0) {
+			fprintf(stderr, "expand_privkey failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+#define KEYCACHE_KEYS   3
+
+typedef struct {
+	unsigned logn;
+	uint8_t *privkey[KEYCACHE_KEYS], *pubkey[KEYCACHE_KEYS];
+	falcon_keycache *kc;
+} keycache_keys;
+
+/*
+ * Sign "keycache" with key number k through the cache, and verify the
+ * signature.
+ */
+static void
+keycache_sign_check(keycache_keys *kk, shake256_context *rng, int k,
+	uint8_t *tmp)
+{
+	uint8_t sig[FALCON_SIG_COMPRESSED_MAXSIZE(10)];
+	size_t sig_len;
+	int r;
+
+	sig_len = sizeof sig;
+	r = falcon_keycache_sign(kk->kc, rng, sig, &sig_len,
+		FALCON_SIG_COMPRESSED, kk->privkey[k],
+		FALCON_PRIVKEY_SIZE(kk->logn), "keycache", 8,
+		tmp, FALCON_TMPSIZE_KEYCACHE(kk->logn));
+	if (r != 0) {
+		fprintf(stderr, "keycache sign failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	r = falcon_verify(sig, sig_len, FALCON_SIG_COMPRESSED,
+		kk->pubkey[k], FALCON_PUBKEY_SIZE(kk->logn), "keycache", 8,
+		tmp, FALCON_TMPSIZE_VERIFY(kk->logn));
+	if (r != 0) {
+		fprintf(stderr, "keycache verify failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+keycache_check_stats(falcon_keycache *kc, uint64_t hits, uint64_t misses,
+	uint64_t expansions, uint64_t evictions, const char *banner)
+{
+	falcon_keycache_stats st;
+
+	falcon_keycache_get_stats(kc, &st);
+	if (st.hits != hits || st.misses != misses
+		|| st.expansions != expansions || st.evictions != evictions)
+	{
+		fprintf(stderr, "ERR keycache stats (%s): %llu %llu %llu %llu\n",
+			banner, (unsigned long long)st.hits,
+			(unsigned long long)st.misses,
+			(unsigned long long)st.expansions,
+			(unsigned long long)st.evictions);
+		exit(EXIT_FAILURE);
+	}
+}
+
+#if FALCON_KC_THREADS
+
+typedef struct {
+	keycache_keys *kk;
+	unsigned id;
+} keycache_thread;
+
+static void *
+keycache_thread_main(void *arg)
+{
+	keycache_thread *kt;
+	shake256_context rng;
+	uint8_t *tmp;
+	int i;
+
+	kt = arg;
+	tmp = xmalloc(FALCON_TMPSIZE_KEYCACHE(kt->kk->logn));
+	shake256_init_prng_from_seed(&rng, &kt->id, sizeof kt->id);
+	for (i = 0; i < 4; i ++) {
+		keycache_sign_check(kt->kk, &rng,
+			(int)((kt->id + (unsigned)i) % KEYCACHE_KEYS), tmp);
+	}
+	xfree(tmp);
+	return NULL;
+}
+
+#endif
+
+/*
+ * Expanded-key cache: hits, misses and CLOCK eviction with synchronous
+ * expansion, background expansion, and concurrent signers.
+ */
+static void
+test_keycache(unsigned logn)
+{
+	keycache_keys kk;
+	shake256_context rng;
+	uint8_t *tmp;
+	size_t tmp_len;
+	uint8_t sig[FALCON_SIG_COMPRESSED_MAXSIZE(10)];
+	size_t sig_len;
+	int k, r;
+
+	printf("[keycache]");
+	fflush(stdout);
+
+	kk.logn = logn;
+	tmp = NULL;
+	for (k = 0; k < KEYCACHE_KEYS; k ++) {
+		make_test_keypair(logn, &rng, k == 0 ? "keycache" : NULL,
+			&kk.privkey[k], &kk.pubkey[k], NULL, &tmp, &tmp_len);
+	}
+
+	if (falcon_keycache_new(logn,
+		FALCON_KEYCACHE_ENTRY_SIZE(logn) - 1, 0) != NULL)
+	{
+		fprintf(stderr, "ERR keycache too small\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Two entries, synchronous expansion. Sequence A A B C A: C
+	 * evicts A (the clock hand clears both reference bits first),
+	 * then A evicts B.
+	 */
+	kk.kc = falcon_keycache_new(logn,
+		2 * FALCON_KEYCACHE_ENTRY_SIZE(logn), 0);
+	if (kk.kc == NULL) {
+		fprintf(stderr, "ERR keycache new\n");
+		exit(EXIT_FAILURE);
+	}
+	keycache_sign_check(&kk, &rng, 0, tmp);
+	keycache_check_stats(kk.kc, 0, 1, 1, 0, "A");
+	keycache_sign_check(&kk, &rng, 0, tmp);
+	keycache_check_stats(kk.kc, 1, 1, 1, 0, "A A");
+	keycache_sign_check(&kk, &rng, 1, tmp);
+	keycache_sign_check(&kk, &rng, 2, tmp);
+	keycache_check_stats(kk.kc, 1, 3, 3, 1, "A A B C");
+	keycache_sign_check(&kk, &rng, 0, tmp);
+	keycache_check_stats(kk.kc, 1, 4, 4, 2, "A A B C A");
+	keycache_sign_check(&kk, &rng, 2, tmp);
+	keycache_check_stats(kk.kc, 2, 4, 4, 2, "A A B C A C");
+
+	sig_len = sizeof sig;
+	r = falcon_keycache_sign(kk.kc, &rng, sig, &sig_len,
+		FALCON_SIG_COMPRESSED, kk.privkey[0], FALCON_PRIVKEY_SIZE(logn),
+		"keycache", 8, tmp, FALCON_TMPSIZE_KEYCACHE(logn) - 1);
+	if (r != FALCON_ERR_SIZE) {
+		fprintf(stderr, "ERR keycache short tmp: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	kk.privkey[1][0] ^= 0x01;
+	r = falcon_keycache_sign(kk.kc, &rng, sig, &sig_len,
+		FALCON_SIG_COMPRESSED, kk.privkey[1], FALCON_PRIVKEY_SIZE(logn),
+		"keycache", 8, tmp, FALCON_TMPSIZE_KEYCACHE(logn));
+	kk.privkey[1][0] ^= 0x01;
+	if (r != FALCON_ERR_FORMAT) {
+		fprintf(stderr, "ERR keycache bad header: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	falcon_keycache_free(kk.kc);
+	printf(".");
+	fflush(stdout);
+
+#if FALCON_KC_THREADS
+	{
+		keycache_thread kt[3];
+		pthread_t th[3];
+		unsigned u;
+
+		/*
+		 * Background expansion: the first signature is computed
+		 * with falcon_sign_dyn(), the next one with the cached key.
+		 */
+		kk.kc = falcon_keycache_new(logn,
+			2 * FALCON_KEYCACHE_ENTRY_SIZE(logn), 1);
+		if (kk.kc == NULL) {
+			fprintf(stderr, "ERR keycache new\n");
+			exit(EXIT_FAILURE);
+		}
+		keycache_sign_check(&kk, &rng, 0, tmp);
+		falcon_keycache_wait(kk.kc);
+		keycache_check_stats(kk.kc, 0, 1, 1, 0, "async A");
+		keycache_sign_check(&kk, &rng, 0, tmp);
+		keycache_check_stats(kk.kc, 1, 1, 1, 0, "async A A");
+		printf(".");
+		fflush(stdout);
+
+		/*
+		 * Concurrent signers over three keys with two entries.
+		 */
+		for (u = 0; u < 3; u ++) {
+			kt[u].kk = &kk;
+			kt[u].id = u;
+			if (pthread_create(&th[u], NULL,
+				keycache_thread_main, &kt[u]) != 0)
+			{
+				fprintf(stderr, "pthread_create failed\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		for (u = 0; u < 3; u ++) {
+			pthread_join(th[u], NULL);
+		}
+		falcon_keycache_free(kk.kc);
+		printf(".");
+		fflush(stdout);
+	}
+#endif
+
+	for (k = 0; k < KEYCACHE_KEYS; k ++) {
+		xfree(kk.privkey[k]);
+		xfree(kk.pubkey[k]);
+	}
+	xfree(tmp);
+}
+
+static void
+test_expand_compact(unsigned logn)
+{
+	shake256_context rng, rng2;
+	uint8_t *privkey, *pubkey, *expkey, *cexpkey, *tmp;
+	uint8_t sig[FALCON_SIG_CT_SIZE(10)];
+	uint8_t sig2[FALCON_SIG_CT_SIZE(10)];
+	size_t tmp_len, sig_len, sig2_len;
+	int i, r;
+
+	printf("[compact %u/%u bytes]",
+		(unsigned)FALCON_EXPANDEDKEY_COMPACT_SIZE(logn),
+		(unsigned)FALCON_EXPANDEDKEY_SIZE(logn));
+	fflush(stdout);
+
+	tmp = NULL;
+	make_test_keypair(logn, &rng, "compact",
+		&privkey, &pubkey, &expkey, &tmp, &tmp_len);
+	cexpkey = xmalloc(FALCON_EXPANDEDKEY_COMPACT_SIZE(logn));
+	r = falcon_expand_privkey_compact(cexpkey,
+		FALCON_EXPANDEDKEY_COMPACT_SIZE(logn) - 1,
+		privkey, FALCON_PRIVKEY_SIZE(logn),
+		tmp, FALCON_TMPSIZE_EXPANDPRIV(logn));
+	if (r != FALCON_ERR_SIZE) {
+		fprintf(stderr, "expand_privkey_compact(short): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	r = falcon_expand_privkey_compact(cexpkey,
+		FALCON_EXPANDEDKEY_COMPACT_SIZE(logn),
+		privkey, FALCON_PRIVKEY_SIZE(logn),
+		tmp, FALCON_TMPSIZE_EXPANDPRIV(logn));
+	if (r != 0) {
+		fprintf(stderr, "expand_privkey_compact failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * With the same rng state, both layouts must produce the same
+	 * signature, for all signature types.
+	 */
+	for (i = 0; i < 30; i ++) {
+		int sig_type;
+
+		sig_type = (i % 3 == 0) ? FALCON_SIG_COMPRESSED
+			: (i % 3 == 1) ? FALCON_SIG_PADDED : FALCON_SIG_CT;
+		rng2 = rng;
+		sig_len = sizeof sig;
+		r = falcon_sign_tree(&rng, sig, &sig_len, sig_type,
+			expkey, &i, sizeof i, tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+		if (r != 0) {
+			fprintf(stderr, "sign_tree failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		sig2_len = sizeof sig2;
+		r = falcon_sign_tree_compact(&rng2, sig2, &sig2_len, sig_type,
+			cexpkey, &i, sizeof i, tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+		if (r != 0) {
+			fprintf(stderr, "sign_tree_compact failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		if (sig_len != sig2_len) {
+			fprintf(stderr, "sign_tree_compact: wrong length"
+				" (%zu / %zu)\n", sig2_len, sig_len);
+			exit(EXIT_FAILURE);
+		}
+		check_eq(sig, sig2, sig_len, "sign_tree/sign_tree_compact");
+		if (memcmp(&rng, &rng2, sizeof rng) != 0) {
+			fprintf(stderr, "sign_tree_compact: rng state\n");
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_verify(sig2, sig2_len, sig_type,
+			pubkey, FALCON_PUBKEY_SIZE(logn), &i, sizeof i,
+			tmp, FALCON_TMPSIZE_VERIFY(logn));
+		if (r != 0) {
+			fprintf(stderr, "verify(compact) failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/*
+	 * The two layouts are not interchangeable.
+	 */
+	sig_len = sizeof sig;
+	r = falcon_sign_tree(&rng, sig, &sig_len, FALCON_SIG_COMPRESSED,
+		cexpkey, "data", 4, tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+	if (r != FALCON_ERR_FORMAT) {
+		fprintf(stderr, "sign_tree(compact key): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	sig_len = sizeof sig;
+	r = falcon_sign_tree_compact(&rng, sig, &sig_len,
+		FALCON_SIG_COMPRESSED, expkey, "data", 4,
+		tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+	if (r != FALCON_ERR_FORMAT) {
+		fprintf(stderr, "sign_tree_compact(full key): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	if (falcon_get_logn(cexpkey, 1) != (int)logn) {
+		fprintf(stderr, "get_logn(compact key) failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	xfree(tmp);
+	xfree(privkey);
+	xfree(pubkey);
+	xfree(expkey);
+	xfree(cexpkey);
+}
+
+static void
+test_expand_semi(unsigned logn)
+{
+	shake256_context rng, rng2;
+	uint8_t *privkey, *pubkey, *expkey, *sexpkey[2], *tmp;
+	uint8_t sig[FALCON_SIG_CT_SIZE(10)];
+	uint8_t sig2[FALCON_SIG_CT_SIZE(10)];
+	size_t tmp_len, sig_len, sig2_len, sk_len[2];
+	int i, k, r;
+
+	sk_len[0] = FALCON_EXPANDEDKEY_SEMI_SIZE(logn);
+	sk_len[1] = FALCON_EXPANDEDKEY_SEMI_GRAM_SIZE(logn);
+	printf("[semi %u/%u bytes]", (unsigned)sk_len[0], (unsigned)sk_len[1]);
+	fflush(stdout);
+
+	tmp = NULL;
+	make_test_keypair(logn, &rng, "semi",
+		&privkey, &pubkey, &expkey, &tmp, &tmp_len);
+	sexpkey[0] = xmalloc(sk_len[0]);
+	sexpkey[1] = xmalloc(sk_len[1]);
+	for (k = 0; k < 2; k ++) {
+		int (*expand)(void *, size_t, const void *, size_t,
+			void *, size_t);
+
+		expand = k ? falcon_expand_privkey_semi_gram
+			: falcon_expand_privkey_semi;
+		r = expand(sexpkey[k], sk_len[k] - 1,
+			privkey, FALCON_PRIVKEY_SIZE(logn),
+			tmp, FALCON_TMPSIZE_EXPANDPRIV(logn));
+		if (r != FALCON_ERR_SIZE) {
+			fprintf(stderr, "expand_privkey_semi(short): %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		r = expand(sexpkey[k], sk_len[k],
+			privkey, FALCON_PRIVKEY_SIZE(logn),
+			tmp, FALCON_TMPSIZE_EXPANDPRIV(logn));
+		if (r != 0) {
+			fprintf(stderr, "expand_privkey_semi failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		if (falcon_get_logn(sexpkey[k], 1) != (int)logn) {
+			fprintf(stderr, "get_logn(semi key) failed\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/*
+	 * With the same rng state, the semi-expanded keys (with and
+	 * without the Gram matrix) must produce the same signature as
+	 * the dynamic signing, for all signature types.
+	 */
+	for (i = 0; i < 30; i ++) {
+		int sig_type;
+
+		sig_type = (i % 3 == 0) ? FALCON_SIG_COMPRESSED
+			: (i % 3 == 1) ? FALCON_SIG_PADDED : FALCON_SIG_CT;
+		k = (i >> 1) & 1;
+		rng2 = rng;
+		sig_len = sizeof sig;
+		r = falcon_sign_dyn(&rng, sig, &sig_len, sig_type,
+			privkey, FALCON_PRIVKEY_SIZE(logn), &i, sizeof i,
+			tmp, FALCON_TMPSIZE_SIGNDYN(logn));
+		if (r != 0) {
+			fprintf(stderr, "sign_dyn failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		sig2_len = sizeof sig2;
+		r = falcon_sign_semi(&rng2, sig2, &sig2_len, sig_type,
+			sexpkey[k], &i, sizeof i,
+			tmp, FALCON_TMPSIZE_SIGNDYN(logn));
+		if (r != 0) {
+			fprintf(stderr, "sign_semi failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		if (sig_len != sig2_len) {
+			fprintf(stderr, "sign_semi: wrong length"
+				" (%zu / %zu)\n", sig2_len, sig_len);
+			exit(EXIT_FAILURE);
+		}
+		check_eq(sig, sig2, sig_len, "sign_dyn/sign_semi");
+		if (memcmp(&rng, &rng2, sizeof rng) != 0) {
+			fprintf(stderr, "sign_semi: rng state\n");
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_verify(sig2, sig2_len, sig_type,
+			pubkey, FALCON_PUBKEY_SIZE(logn), &i, sizeof i,
+			tmp, FALCON_TMPSIZE_VERIFY(logn));
+		if (r != 0) {
+			fprintf(stderr, "verify(semi) failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/*
+	 * The semi-expanded layout is not interchangeable with the
+	 * full one, and needs the larger temporary buffer.
+	 */
+	sig_len = sizeof sig;
+	r = falcon_sign_tree(&rng, sig, &sig_len, FALCON_SIG_COMPRESSED,
+		sexpkey[1], "data", 4, tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+	if (r != FALCON_ERR_FORMAT) {
+		fprintf(stderr, "sign_tree(semi key): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	sig_len = sizeof sig;
+	r = falcon_sign_semi(&rng, sig, &sig_len, FALCON_SIG_COMPRESSED,
+		expkey, "data", 4, tmp, FALCON_TMPSIZE_SIGNDYN(logn));
+	if (r != FALCON_ERR_FORMAT) {
+		fprintf(stderr, "sign_semi(full key): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	sig_len = sizeof sig;
+	r = falcon_sign_semi(&rng, sig, &sig_len, FALCON_SIG_COMPRESSED,
+		sexpkey[0], "data", 4, tmp, FALCON_TMPSIZE_SIGNDYN(logn) - 1);
+	if (r != FALCON_ERR_SIZE) {
+		fprintf(stderr, "sign_semi(short tmp): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+
+	xfree(tmp);
+	xfree(privkey);
+	xfree(pubkey);
+	xfree(expkey);
+	xfree(sexpkey[0]);
+	xfree(sexpkey[1]);
+}
+
+static void
+test_expand_aligned(unsigned logn)
+{
+	static const size_t offsets[] = { 0, 1, 8, 63 };
+	shake256_context rng, rng2;
+	uint8_t *privkey, *pubkey, *expkey, *aexpkey, *tmp;
+	uint8_t sig[FALCON_SIG_COMPRESSED_MAXSIZE(10)];
+	uint8_t sig2[FALCON_SIG_COMPRESSED_MAXSIZE(10)];
+	size_t tmp_len, sig_len, sig2_len, u;
+	int r;
+
+	printf("[aligned]");
+	fflush(stdout);
+
+	tmp = NULL;
+	make_test_keypair(logn, &rng, "aligned",
+		&privkey, &pubkey, &expkey, &tmp, &tmp_len);
+	aexpkey = xmalloc(FALCON_EXPANDEDKEY_ALIGNED_SIZE(logn) + 63);
+	r = falcon_expand_privkey_aligned(aexpkey,
+		FALCON_EXPANDEDKEY_ALIGNED_SIZE(logn) - 1,
+		privkey, FALCON_PRIVKEY_SIZE(logn),
+		tmp, FALCON_TMPSIZE_EXPANDPRIV(logn));
+	if (r != FALCON_ERR_SIZE) {
+		fprintf(stderr, "expand_privkey_aligned(short): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Whatever the key and tmp[] addresses, and whether tmp[] is
+	 * large enough to be aligned or not, the aligned layout must
+	 * give the same signatures as the default one.
+	 */
+	for (u = 0; u < (sizeof offsets) / sizeof(offsets[0]); u ++) {
+		uint8_t *ek, *t;
+		size_t tl;
+
+		ek = aexpkey + offsets[u];
+		r = falcon_expand_privkey_aligned(ek,
+			FALCON_EXPANDEDKEY_ALIGNED_SIZE(logn),
+			privkey, FALCON_PRIVKEY_SIZE(logn),
+			tmp, FALCON_TMPSIZE_EXPANDPRIV(logn));
+		if (r != 0) {
+			fprintf(stderr, "expand_privkey_aligned failed: %d\n",
+				r);
+			exit(EXIT_FAILURE);
+		}
+		if (falcon_get_logn(ek, 1) != (int)logn) {
+			fprintf(stderr, "get_logn(aligned key) failed\n");
+			exit(EXIT_FAILURE);
+		}
+		t = tmp + offsets[u];
+		tl = (u & 1) ? FALCON_TMPSIZE_SIGNTREE(logn)
+			: FALCON_TMPSIZE_SIGNTREE_ALIGNED(logn);
+		rng2 = rng;
+		sig_len = sizeof sig;
+		r = falcon_sign_tree(&rng, sig, &sig_len,
+			FALCON_SIG_COMPRESSED, expkey, "data", 4,
+			tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+		if (r != 0) {
+			fprintf(stderr, "sign_tree failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		sig2_len = sizeof sig2;
+		r = falcon_sign_tree(&rng2, sig2, &sig2_len,
+			FALCON_SIG_COMPRESSED, ek, "data", 4, t, tl);
+		if (r != 0) {
+			fprintf(stderr, "sign_tree(aligned) failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		if (sig_len != sig2_len) {
+			fprintf(stderr, "sign_tree(aligned): length\n");
+			exit(EXIT_FAILURE);
+		}
+		check_eq(sig, sig2, sig_len, "sign_tree (aligned)");
+		tl = (u & 1) ? FALCON_TMPSIZE_VERIFY(logn)
+			: FALCON_TMPSIZE_VERIFY_ALIGNED(logn);
+		r = falcon_verify(sig2, sig2_len, FALCON_SIG_COMPRESSED,
+			pubkey, FALCON_PUBKEY_SIZE(logn), "data", 4, t, tl);
+		if (r != 0) {
+			fprintf(stderr, "verify(aligned) failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_verify(sig2, sig2_len, FALCON_SIG_COMPRESSED,
+			pubkey, FALCON_PUBKEY_SIZE(logn), "data2", 5, t, tl);
+		if (r != FALCON_ERR_BADSIG) {
+			fprintf(stderr, "verify(aligned): %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+	}
+	sig_len = sizeof sig;
+	r = falcon_sign_tree_compact(&rng, sig, &sig_len,
+		FALCON_SIG_COMPRESSED, aexpkey, "data", 4,
+		tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+	if (r != FALCON_ERR_FORMAT) {
+		fprintf(stderr, "sign_tree_compact(aligned key): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+
+	xfree(tmp);
+	xfree(privkey);
+	xfree(pubkey);
+	xfree(expkey);
+	xfree(aexpkey);
+}
+
+static void
+test_ctx(unsigned logn)
+{
+	falcon_ctx *ctx;
+	shake256_context rng, rng2;
+	uint8_t *privkey, *pubkey, *privkey2, *pubkey2, *pubkey3;
+	uint8_t *expkey, *expkey2, *tmp;
+	uint8_t sig[FALCON_SIG_CT_SIZE(10)];
+	uint8_t sig2[FALCON_SIG_CT_SIZE(10)];
+	size_t tmp_len, sig_len, sig2_len;
+	int i, r;
+
+	printf("[ctx]");
+	fflush(stdout);
+
+	if (falcon_ctx_new(0) != NULL || falcon_ctx_new(11) != NULL) {
+		fprintf(stderr, "ctx_new: bad logn accepted\n");
+		exit(EXIT_FAILURE);
+	}
+	ctx = falcon_ctx_new(logn);
+	if (ctx == NULL) {
+		fprintf(stderr, "ctx_new failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Contexts are seeded from the OS: two system-seeded PRNGs must
+	 * not produce the same stream.
+	 */
+	if (shake256_init_prng_from_system(&rng) != 0
+		|| shake256_init_prng_from_system(&rng2) != 0)
+	{
+		fprintf(stderr, "init_prng_from_system failed\n");
+		exit(EXIT_FAILURE);
+	}
+	shake256_flip(&rng);
+	shake256_flip(&rng2);
+	shake256_extract(&rng, sig, 32);
+	shake256_extract(&rng2, sig2, 32);
+	if (memcmp(sig, sig2, 32) == 0) {
+		fprintf(stderr, "init_prng_from_system: constant seed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	tmp = NULL;
+	make_test_keypair(logn, &rng, "ctx",
+		&privkey2, &pubkey2, &expkey2, &tmp, &tmp_len);
+	privkey = xmalloc(FALCON_PRIVKEY_SIZE(logn));
+	pubkey = xmalloc(FALCON_PUBKEY_SIZE(logn));
+	pubkey3 = xmalloc(FALCON_PUBKEY_SIZE(logn));
+	expkey = xmalloc(FALCON_EXPANDEDKEY_SIZE(logn));
+
+	/*
+	 * With the same seed, the context functions must give the same
+	 * results as the plain API.
+	 */
+	falcon_ctx_seed(ctx, "ctx", 3);
+	r = falcon_ctx_keygen(ctx, privkey, FALCON_PRIVKEY_SIZE(logn),
+		pubkey, FALCON_PUBKEY_SIZE(logn));
+	if (r != 0) {
+		fprintf(stderr, "ctx_keygen failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	check_eq(privkey, privkey2, FALCON_PRIVKEY_SIZE(logn),
+		"ctx_keygen (private)");
+	check_eq(pubkey, pubkey2, FALCON_PUBKEY_SIZE(logn),
+		"ctx_keygen (public)");
+	r = falcon_ctx_make_public(ctx, pubkey3, FALCON_PUBKEY_SIZE(logn),
+		privkey, FALCON_PRIVKEY_SIZE(logn));
+	if (r != 0) {
+		fprintf(stderr, "ctx_make_public failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	check_eq(pubkey, pubkey3, FALCON_PUBKEY_SIZE(logn),
+		"ctx_make_public");
+	r = falcon_ctx_expand_privkey(ctx,
+		expkey, FALCON_EXPANDEDKEY_SIZE(logn),
+		privkey, FALCON_PRIVKEY_SIZE(logn));
+	if (r != 0) {
+		fprintf(stderr, "ctx_expand_privkey failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	/*
+	 * Only the header byte and the payload are set (the payload
+	 * starts at offset 8).
+	 */
+	if (expkey[0] != expkey2[0]) {
+		fprintf(stderr, "ctx_expand_privkey: wrong header\n");
+		exit(EXIT_FAILURE);
+	}
+	check_eq(expkey + 8, expkey2 + 8, FALCON_EXPANDEDKEY_SIZE(logn) - 8,
+		"ctx_expand_privkey");
+
+	for (i = 0; i < 6; i ++) {
+		int sig_type;
+
+		sig_type = (i % 3 == 0) ? FALCON_SIG_COMPRESSED
+			: (i % 3 == 1) ? FALCON_SIG_PADDED : FALCON_SIG_CT;
+		sig_len = sizeof sig;
+		sig2_len = sizeof sig2;
+		if (i < 3) {
+			r = falcon_ctx_sign_dyn(ctx, sig, &sig_len, sig_type,
+				privkey, FALCON_PRIVKEY_SIZE(logn), &i, sizeof i);
+			if (r == 0) {
+				r = falcon_sign_dyn(&rng,
+					sig2, &sig2_len, sig_type,
+					privkey, FALCON_PRIVKEY_SIZE(logn),
+					&i, sizeof i, tmp, tmp_len);
+			}
+		} else {
+			r = falcon_ctx_sign_tree(ctx, sig, &sig_len, sig_type,
+				expkey, &i, sizeof i);
+			if (r == 0) {
+				r = falcon_sign_tree(&rng,
+					sig2, &sig2_len, sig_type,
+					expkey, &i, sizeof i, tmp, tmp_len);
+			}
+		}
+		if (r != 0) {
+			fprintf(stderr, "ctx sign failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		if (sig_len != sig2_len) {
+			fprintf(stderr, "ctx sign: wrong length\n");
+			exit(EXIT_FAILURE);
+		}
+		check_eq(sig, sig2, sig_len, "ctx sign");
+		r = falcon_ctx_verify(ctx, sig, sig_len, sig_type,
+			pubkey, FALCON_PUBKEY_SIZE(logn), &i, sizeof i);
+		if (r != 0) {
+			fprintf(stderr, "ctx_verify failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_ctx_verify(ctx, sig, sig_len, sig_type,
+			pubkey, FALCON_PUBKEY_SIZE(logn), "data", 4);
+		if (r != FALCON_ERR_BADSIG) {
+			fprintf(stderr, "ctx_verify (wrong data): %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	falcon_ctx_free(ctx);
+	xfree(tmp);
+	xfree(privkey);
+	xfree(pubkey);
+	xfree(privkey2);
+	xfree(pubkey2);
+	xfree(pubkey3);
+	xfree(expkey);
+	xfree(expkey2);
+}
+
+static int
+stats_is_zero(const falcon_stats *st)
+{
+	return st->sign_calls == 0 && st->sign_restarts == 0
+		&& st->sampler_calls == 0 && st->sampler_iterations == 0
+		&& st->prng_refills == 0 && st->prng_bytes == 0
+		&& st->comp_overflows == 0;
+}
+
+static void
+test_stats(unsigned logn)
+{
+	shake256_context rng;
+	falcon_stats st;
+	uint8_t *privkey, *pubkey, *expkey, *tmp;
+	uint8_t sig[FALCON_SIG_CT_SIZE(10)];
+	size_t tmp_len, sig_len;
+	uint64_t attempts;
+	int i, r, on;
+
+	printf("[stats]");
+	fflush(stdout);
+
+	tmp = NULL;
+	make_test_keypair(logn, &rng, "stats",
+		&privkey, &pubkey, &expkey, &tmp, &tmp_len);
+
+	falcon_stats_reset();
+	on = falcon_stats_get(&st);
+	if (!stats_is_zero(&st)) {
+		fprintf(stderr, "stats: not zero after reset\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < 4; i ++) {
+		int sig_type;
+
+		sig_type = (i & 1) ? FALCON_SIG_PADDED : FALCON_SIG_COMPRESSED;
+		sig_len = sizeof sig;
+		if (i < 2) {
+			r = falcon_sign_dyn(&rng, sig, &sig_len, sig_type,
+				privkey, FALCON_PRIVKEY_SIZE(logn),
+				&i, sizeof i, tmp, tmp_len);
+		} else {
+			r = falcon_sign_tree(&rng, sig, &sig_len, sig_type,
+				expkey, &i, sizeof i, tmp, tmp_len);
+		}
+		if (r != 0) {
+			fprintf(stderr, "stats: sign failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (falcon_stats_get(&st) != on) {
+		fprintf(stderr, "stats: inconsistent status\n");
+		exit(EXIT_FAILURE);
+	}
+	if (!on) {
+		if (!stats_is_zero(&st)) {
+			fprintf(stderr, "stats: counters without FALCON_STATS\n");
+			exit(EXIT_FAILURE);
+		}
+	} else {
+		/*
+		 * Each signing attempt samples 2*n integers and starts
+		 * with a PRNG fill; each sampler iteration uses at least
+		 * 11 PRNG bytes.
+		 */
+		attempts = st.sign_calls + st.sign_restarts;
+		if (st.sign_calls < 4
+			|| st.sign_calls != 4 + st.comp_overflows
+			|| st.sampler_calls != (attempts << (logn + 1))
+			|| st.sampler_iterations < st.sampler_calls
+			|| st.prng_refills < attempts
+			|| st.prng_bytes < 11 * st.sampler_iterations)
+		{
+			fprintf(stderr, "stats: inconsistent counters\n");
+			exit(EXIT_FAILURE);
+		}
+		falcon_stats_reset();
+		falcon_stats_get(&st);
+		if (!stats_is_zero(&st)) {
+			fprintf(stderr, "stats: not zero after reset\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	xfree(tmp);
+	xfree(privkey);
+	xfree(pubkey);
+	xfree(expkey);
+}
+
+/*
+ * Check the trace of one operation: ev[] must end with the operation
+ * event (op), all other events must be phases of that operation, the
+ * phase ph must appear, and the phases must not last longer than the
+ * whole operation.
+ */
+static void
+check_trace(const falcon_trace_event *ev, size_t num,
+	unsigned op, unsigned ph)
+{
+	const char *opname, *name;
+	size_t u, oplen;
+	uint64_t sum;
+	int found;
+
+	if (num < 2 || ev[num - 1].phase != op) {
+		fprintf(stderr, "trace: missing operation %u\n", op);
+		exit(EXIT_FAILURE);
+	}
+	opname = falcon_trace_phase_name(op);
+	oplen = strlen(opname);
+	sum = 0;
+	found = 0;
+	for (u = 0; u < num - 1; u ++) {
+		name = falcon_trace_phase_name(ev[u].phase);
+		if (name == NULL || strncmp(name, opname, oplen) != 0
+			|| name[oplen] != ';')
+		{
+			fprintf(stderr, "trace: unexpected phase %u in %s\n",
+				ev[u].phase, opname);
+			exit(EXIT_FAILURE);
+		}
+		if (ev[u].phase == ph) {
+			found = 1;
+		}
+		sum += ev[u].ticks;
+	}
+	if (!found || sum > ev[num - 1].ticks) {
+		fprintf(stderr, "trace: inconsistent trace for %s\n", opname);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+test_trace(unsigned logn)
+{
+	shake256_context rng;
+	falcon_trace_event ev[64];
+	uint8_t *privkey, *pubkey, *expkey, *tmp;
+	uint8_t sig[FALCON_SIG_COMPRESSED_MAXSIZE(10)];
+	size_t tmp_len, sig_len, num;
+	unsigned u;
+	int r;
+
+	printf("[trace]");
+	fflush(stdout);
+
+	for (u = 0; u < TRACE_NUM_PHASES; u ++) {
+		if (falcon_trace_phase_name(u) == NULL) {
+			fprintf(stderr, "trace: no name for phase %u\n", u);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (falcon_trace_phase_name(TRACE_NUM_PHASES) != NULL) {
+		fprintf(stderr, "trace: name for unknown phase\n");
+		exit(EXIT_FAILURE);
+	}
+
+	tmp = NULL;
+	make_test_keypair(logn, &rng, "trace",
+		&privkey, &pubkey, &expkey, &tmp, &tmp_len);
+	while (falcon_trace_read(ev, sizeof ev / sizeof ev[0]) != 0);
+
+	/*
+	 * Without FALCON_TRACE, nothing is recorded.
+	 */
+	sig_len = sizeof sig;
+	r = falcon_sign_dyn(&rng, sig, &sig_len, FALCON_SIG_COMPRESSED,
+		privkey, FALCON_PRIVKEY_SIZE(logn), "data", 4, tmp, tmp_len);
+	if (r != 0) {
+		fprintf(stderr, "trace: sign_dyn failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	num = falcon_trace_read(ev, sizeof ev / sizeof ev[0]);
+	if (!FALCON_TRACE) {
+		if (num != 0) {
+			fprintf(stderr, "trace: events without FALCON_TRACE\n");
+			exit(EXIT_FAILURE);
+		}
+		goto cleanup;
+	}
+	check_trace(ev, num, TRACE_SIGN_DYN, TRACE_SIGN_DYN_FFSAMP);
+
+	/*
+	 * Events can be read in several chunks.
+	 */
+	sig_len = sizeof sig;
+	r = falcon_sign_tree(&rng, sig, &sig_len, FALCON_SIG_COMPRESSED,
+		expkey, "data", 4, tmp, tmp_len);
+	if (r != 0) {
+		fprintf(stderr, "trace: sign_tree failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	num = falcon_trace_read(ev, 1);
+	num += falcon_trace_read(ev + 1, sizeof ev / sizeof ev[0] - 1);
+	check_trace(ev, num, TRACE_SIGN_TREE, TRACE_SIGN_TREE_FFSAMP);
+
+	r = falcon_verify(sig, sig_len, FALCON_SIG_COMPRESSED,
+		pubkey, FALCON_PUBKEY_SIZE(logn), "data", 4, tmp, tmp_len);
+	if (r != 0) {
+		fprintf(stderr, "trace: verify failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	num = falcon_trace_read(ev, sizeof ev / sizeof ev[0]);
+	check_trace(ev, num, TRACE_VERIFY, TRACE_VERIFY_RAW);
+
+	/*
+	 * A failed verification still records the operation.
+	 */
+	r = falcon_verify(sig, sig_len, FALCON_SIG_COMPRESSED,
+		pubkey, FALCON_PUBKEY_SIZE(logn), "atad", 4, tmp, tmp_len);
+	if (r != FALCON_ERR_BADSIG) {
+		fprintf(stderr, "trace: wrong signature accepted: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	num = falcon_trace_read(ev, sizeof ev / sizeof ev[0]);
+	check_trace(ev, num, TRACE_VERIFY, TRACE_VERIFY_RAW);
+
+	/*
+	 * Signatures with a semi-expanded key have their own phases.
+	 */
+	r = falcon_expand_privkey_semi(expkey, FALCON_EXPANDEDKEY_SIZE(logn),
+		privkey, FALCON_PRIVKEY_SIZE(logn), tmp, tmp_len);
+	if (r != 0) {
+		fprintf(stderr, "trace: expand_privkey_semi failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	while (falcon_trace_read(ev, sizeof ev / sizeof ev[0]) != 0);
+	sig_len = sizeof sig;
+	r = falcon_sign_semi(&rng, sig, &sig_len, FALCON_SIG_COMPRESSED,
+		expkey, "data", 4, tmp, tmp_len);
+	if (r != 0) {
+		fprintf(stderr, "trace: sign_semi failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	num = falcon_trace_read(ev, sizeof ev / sizeof ev[0]);
+	check_trace(ev, num, TRACE_SIGN_SEMI, TRACE_SIGN_SEMI_FFSAMP);
+	if (falcon_trace_read(ev, sizeof ev / sizeof ev[0]) != 0) {
+		fprintf(stderr, "trace: buffer not drained\n");
+		exit(EXIT_FAILURE);
+	}
+
+cleanup:
+	xfree(tmp);
+	xfree(privkey);
+	xfree(pubkey);
+	xfree(expkey);
+}
+
+#define EKS_TEST_KEYS   3
+
+static void
+eks_flip_byte(const char *path, long off)
+{
+	FILE *f;
+	int c;
+
+	f = fopen(path, "r+b");
+	if (f == NULL || fseek(f, off, SEEK_SET) != 0
+		|| (c = fgetc(f)) == EOF || fseek(f, off, SEEK_SET) != 0
+		|| fputc(c ^ 0x01, f) == EOF || fclose(f) != 0)
+	{
+		fprintf(stderr, "cannot modify %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+test_expkey_store(unsigned logn)
+{
+	static const char *path = "test_falcon_eks.tmp";
+	shake256_context rng, rng2;
+	uint8_t *privkey[EKS_TEST_KEYS], *pubkey[EKS_TEST_KEYS];
+	uint8_t *expkey, *tmp;
+	uint8_t sig[FALCON_SIG_COMPRESSED_MAXSIZE(10)];
+	uint8_t sig2[FALCON_SIG_COMPRESSED_MAXSIZE(10)];
+	size_t tmp_len, sig_len, sig2_len;
+	falcon_expkey_store *st;
+	const void *ek;
+	const void *dup[2];
+	int k, r;
+
+	printf("[expkey_store]");
+	fflush(stdout);
+
+	tmp = NULL;
+	for (k = 0; k < EKS_TEST_KEYS; k ++) {
+		make_test_keypair(logn, &rng, k == 0 ? "expkey_store" : NULL,
+			&privkey[k], &pubkey[k], NULL, &tmp, &tmp_len);
+	}
+	expkey = xmalloc(FALCON_EXPANDEDKEY_SIZE(logn));
+
+	r = falcon_expkey_store_write(path,
+		(const void *const *)privkey, FALCON_PRIVKEY_SIZE(logn),
+		EKS_TEST_KEYS, tmp, FALCON_TMPSIZE_EXPKEY_STORE(logn) - 1);
+	if (r != FALCON_ERR_SIZE) {
+		fprintf(stderr, "expkey_store_write(short tmp): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	dup[0] = privkey[1];
+	dup[1] = privkey[1];
+	r = falcon_expkey_store_write(path, dup, FALCON_PRIVKEY_SIZE(logn),
+		2, tmp, FALCON_TMPSIZE_EXPKEY_STORE(logn));
+	if (r != FALCON_ERR_BADARG) {
+		fprintf(stderr, "expkey_store_write(duplicate): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	r = falcon_expkey_store_write(path,
+		(const void *const *)privkey, FALCON_PRIVKEY_SIZE(logn),
+		EKS_TEST_KEYS, tmp, FALCON_TMPSIZE_EXPKEY_STORE(logn));
+	if (r != 0) {
+		fprintf(stderr, "expkey_store_write failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+
+	r = falcon_expkey_store_open(&st, path, FALCON_EXPKEY_STORE_VERIFY);
+	if (r != 0) {
+		fprintf(stderr, "expkey_store_open failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	if (falcon_expkey_store_count(st) != EKS_TEST_KEYS
+		|| falcon_expkey_store_get(st, EKS_TEST_KEYS) != NULL)
+	{
+		fprintf(stderr, "expkey_store: wrong count\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Keys from the store are used in place, with their payload on
+	 * a 64-byte boundary, and sign exactly as freshly expanded keys.
+	 */
+	for (k = 0; k < EKS_TEST_KEYS; k ++) {
+		ek = falcon_expkey_store_find(st,
+			privkey[k], FALCON_PRIVKEY_SIZE(logn));
+		if (ek == NULL || (((uintptr_t)ek + 1) & 63) != 0) {
+			fprintf(stderr, "expkey_store_find failed (%d)\n", k);
+			exit(EXIT_FAILURE);
+		}
+		r = falcon_expand_privkey(expkey, FALCON_EXPANDEDKEY_SIZE(logn),
+			privkey[k], FALCON_PRIVKEY_SIZE(logn),
+			tmp, FALCON_TMPSIZE_EXPANDPRIV(logn));
+		if (r != 0) {
+			fprintf(stderr, "expand_privkey failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		rng2 = rng;
+		sig_len = sizeof sig;
+		r = falcon_sign_tree(&rng, sig, &sig_len,
+			FALCON_SIG_COMPRESSED, expkey, "data", 4,
+			tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+		if (r != 0) {
+			fprintf(stderr, "sign_tree failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		sig2_len = sizeof sig2;
+		r = falcon_sign_tree(&rng2, sig2, &sig2_len,
+			FALCON_SIG_COMPRESSED, ek, "data", 4,
+			tmp, FALCON_TMPSIZE_SIGNTREE(logn));
+		if (r != 0) {
+			fprintf(stderr, "sign_tree(store) failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		if (sig_len != sig2_len) {
+			fprintf(stderr, "expkey_store: signature length\n");
+			exit(EXIT_FAILURE);
+		}
+		check_eq(sig, sig2, sig_len, "sign_tree (store)");
+		r = falcon_verify(sig2, sig2_len, FALCON_SIG_COMPRESSED,
+			pubkey[k], FALCON_PUBKEY_SIZE(logn), "data", 4,
+			tmp, FALCON_TMPSIZE_VERIFY(logn));
+		if (r != 0) {
+			fprintf(stderr, "verify(store) failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+	}
+	privkey[0][FALCON_PRIVKEY_SIZE(logn) - 1] ^= 0x01;
+	if (falcon_expkey_store_find(st,
+		privkey[0], FALCON_PRIVKEY_SIZE(logn)) != NULL)
+	{
+		fprintf(stderr, "expkey_store_find: unexpected key\n");
+		exit(EXIT_FAILURE);
+	}
+	falcon_expkey_store_close(st);
+
+	/*
+	 * A damaged payload is detected only with full verification; a
+	 * damaged header or index is always detected.
+	 */
+	eks_flip_byte(path, 64 + 64 * EKS_TEST_KEYS + 64 + 100);
+	r = falcon_expkey_store_open(&st, path, 0);
+	if (r != 0) {
+		fprintf(stderr, "expkey_store_open(damaged, 0): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	falcon_expkey_store_close(st);
+	r = falcon_expkey_store_open(&st, path, FALCON_EXPKEY_STORE_VERIFY);
+	if (r != FALCON_ERR_FORMAT || st != NULL) {
+		fprintf(stderr, "expkey_store_open(damaged): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	eks_flip_byte(path, 64 + 10);
+	r = falcon_expkey_store_open(&st, path, 0);
+	if (r != FALCON_ERR_FORMAT) {
+		fprintf(stderr, "expkey_store_open(damaged index): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	remove(path);
+	r = falcon_expkey_store_open(&st, path, 0);
+	if (r != FALCON_ERR_IO) {
+		fprintf(stderr, "expkey_store_open(missing): %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+
+	for (k = 0; k < EKS_TEST_KEYS; k ++) {
+		xfree(privkey[k]);
+		xfree(pubkey[k]);
+	}
+	xfree(expkey);
+	xfree(tmp);
+}
+
+static void
+test_external_API(void)
+{
+	shake256_context rng;
+
+	printf("Test external API: ");
+	fflush(stdout);
+
+	shake256_init_prng_from_seed(&rng, "external", 8);
+    test_external_API_inner(FALCON_LOGN, &rng);
+	test_keygen_mt(FALCON_LOGN);
+	test_keygen_many(FALCON_LOGN);
+	test_expand_compact(FALCON_LOGN);
+	test_expand_semi(FALCON_LOGN);
+	test_expand_aligned(FALCON_LOGN);
+	test_ctx(FALCON_LOGN);
+	test_stats(FALCON_LOGN);
+	test_trace(FALCON_LOGN);
+	test_keycache(FALCON_LOGN);
+	test_expkey_store(FALCON_LOGN);
+	
+	printf("done.\n");
+	fflush(stdout);
+}
+
+#if DO_NIST_TESTS
+
+/* ===================================================================== */
+/*
+ * Custom perfunctory AES-256 implementation (included to avoid any
+ * dependency on OpenSSL). This implementation is for tests only; it
+ * is not constant-time.
+ */
+
+static inline uint32_t
+dec32be(const void *src)
+{
+	const unsigned char *buf;
+
+	buf = src;
+	return ((uint32_t)buf[0] << 24)
+		| ((uint32_t)buf[1] << 16)
+		| ((uint32_t)buf[2] << 8)
+		| (uint32_t)buf[3];
 }
 
 static inline void
@@ -4661,7 +6582,7 @@ test_nist_KAT(unsigned logn, const char *srefhash)
 	uint8_t hhv[20], hhref[20];
 	uint8_t *msg, *sk, *pk, *sm, *tmp;
 	size_t n, sk_len, pk_len, over_len;
-	fpr *esk;
+	fpr *esk, *cesk;
 	sha1_context hhc;
 
 	n = (size_t)1 << logn;
@@ -4682,6 +6603,7 @@ test_nist_KAT(unsigned logn, const char *srefhash)
 
 	tmp = xmalloc((size_t)84 << logn);
 	esk = xmalloc((size_t)(8 * logn + 40) << logn);
+	cesk = xmalloc((size_t)(8 * logn + 12) << logn);
 
 	sha1_print_line_with_int(&hhc, "# Falcon-", (unsigned)n);
 	sha1_print_line(&hhc, "");
@@ -4804,6 +6726,17 @@ test_nist_KAT(unsigned logn, const char *srefhash)
 		Zf(sign_tree)(sig2, &sc, esk, hm, tmp);
 		check_eq(sig, sig2, n * sizeof *sig, "Sign dyn/tree mismatch");
 
+		/*
+		 * Same with the compact expanded key.
+		 */
+		Zf(expand_privkey_compact)(cesk, f, g, F, G, tmp);
+		inner_shake256_init(&sc);
+		inner_shake256_inject(&sc, seed2, 48);
+		inner_shake256_flip(&sc);
+		Zf(sign_tree_compact)(sig2, &sc, cesk, hm, tmp);
+		check_eq(sig, sig2, n * sizeof *sig,
+			"Sign dyn/compact tree mismatch");
+
 		/*
 		 * Verify the signature.
 		 */
@@ -4855,6 +6788,7 @@ test_nist_KAT(unsigned logn, const char *srefhash)
 
 	xfree(tmp);
 	xfree(esk);
+	xfree(cesk);
 
 	sha1_out(&hhc, hhv);
 	printf(" ");
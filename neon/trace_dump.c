@@ -0,0 +1,227 @@
+/*
+ * Phase profile of signing and verification, as folded stacks.
+ *
+ * This program must be linked with a library compiled with
+ * FALCON_TRACE=1. It runs a number of dynamic signatures, signatures
+ * with an expanded key and with a semi-expanded key (with the Gram
+ * matrix), and verifications, collects the per-phase trace events (see
+ * falcon_trace_read() in falcon.h), and writes on standard output one
+ * line per phase:
+ *
+ *     falcon512;sign_dyn;ffsampling 123456789
+ *
+ * i.e. the stack of frames, then the total number of ticks spent in
+ * that frame but not in its sub-frames. This is the "folded" format
+ * read by flame graph tools, e.g.:
+ *
+ *     ./trace512 | flamegraph.pl > sign512.svg
+ *
+ * A per-call average of each phase is written on standard error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "falcon.h"
+
+#define DEFAULT_ITERATIONS   1000
+#define MAX_PHASES           64
+
+static uint64_t total[MAX_PHASES];
+static uint64_t calls[MAX_PHASES];
+
+static void *
+xmalloc(size_t len)
+{
+        void *buf;
+
+        buf = malloc(len);
+        if (buf == NULL) {
+                fprintf(stderr, "memory allocation error\n");
+                exit(EXIT_FAILURE);
+        }
+        return buf;
+}
+
+static void
+check(int r, const char *what)
+{
+        if (r != 0) {
+                fprintf(stderr, "%s failed: %d\n", what, r);
+                exit(EXIT_FAILURE);
+        }
+}
+
+/*
+ * Move all pending events of this thread into the totals.
+ */
+static void
+collect(void)
+{
+        falcon_trace_event ev[256];
+        size_t u, num;
+
+        while ((num = falcon_trace_read(ev, sizeof ev / sizeof ev[0])) != 0) {
+                for (u = 0; u < num; u ++) {
+                        if (ev[u].phase < MAX_PHASES) {
+                                total[ev[u].phase] += ev[u].ticks;
+                                calls[ev[u].phase] ++;
+                        }
+                }
+        }
+}
+
+/*
+ * Get the identifier of the parent frame of a phase (the phase whose
+ * name is the prefix up to the last ';'), or -1 for a root frame.
+ */
+static int
+parent_phase(unsigned phase)
+{
+        const char *name, *pname, *sep;
+        unsigned p;
+
+        name = falcon_trace_phase_name(phase);
+        sep = strrchr(name, ';');
+        if (sep == NULL) {
+                return -1;
+        }
+        for (p = 0; (pname = falcon_trace_phase_name(p)) != NULL; p ++) {
+                if (strlen(pname) == (size_t)(sep - name)
+                        && memcmp(pname, name, (size_t)(sep - name)) == 0)
+                {
+                        return (int)p;
+                }
+        }
+        return -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+        unsigned logn, num_phases, p;
+        int i, iterations, parent;
+        uint64_t self[MAX_PHASES];
+        shake256_context rng;
+        uint8_t *privkey, *pubkey, *expkey, *sexpkey, *tmp;
+        uint8_t sig[FALCON_SIG_COMPRESSED_MAXSIZE(10)];
+        size_t tmp_len, sig_len;
+
+        logn = FALCON_LOGN;
+        iterations = DEFAULT_ITERATIONS;
+        if (argc > 1) {
+                iterations = atoi(argv[1]);
+                if (iterations <= 0) {
+                        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        tmp_len = FALCON_TMPSIZE_KEYGEN(logn);
+        if (tmp_len < FALCON_TMPSIZE_SIGNDYN(logn)) {
+                tmp_len = FALCON_TMPSIZE_SIGNDYN(logn);
+        }
+        if (tmp_len < FALCON_TMPSIZE_EXPANDPRIV(logn)) {
+                tmp_len = FALCON_TMPSIZE_EXPANDPRIV(logn);
+        }
+        tmp = xmalloc(tmp_len);
+        privkey = xmalloc(FALCON_PRIVKEY_SIZE(logn));
+        pubkey = xmalloc(FALCON_PUBKEY_SIZE(logn));
+        expkey = xmalloc(FALCON_EXPANDEDKEY_SIZE(logn));
+        sexpkey = xmalloc(FALCON_EXPANDEDKEY_SEMI_GRAM_SIZE(logn));
+
+        shake256_init_prng_from_seed(&rng, "trace", 5);
+        check(falcon_keygen_make(&rng, logn,
+                privkey, FALCON_PRIVKEY_SIZE(logn),
+                pubkey, FALCON_PUBKEY_SIZE(logn), tmp, tmp_len), "keygen");
+        check(falcon_expand_privkey(expkey, FALCON_EXPANDEDKEY_SIZE(logn),
+                privkey, FALCON_PRIVKEY_SIZE(logn), tmp, tmp_len), "expand");
+        check(falcon_expand_privkey_semi_gram(sexpkey,
+                FALCON_EXPANDEDKEY_SEMI_GRAM_SIZE(logn),
+                privkey, FALCON_PRIVKEY_SIZE(logn), tmp, tmp_len),
+                "expand_semi");
+        collect();
+        memset(total, 0, sizeof total);
+        memset(calls, 0, sizeof calls);
+
+        for (i = 0; i < iterations; i ++) {
+                sig_len = sizeof sig;
+                check(falcon_sign_dyn(&rng, sig, &sig_len,
+                        FALCON_SIG_COMPRESSED,
+                        privkey, FALCON_PRIVKEY_SIZE(logn),
+                        &i, sizeof i, tmp, tmp_len), "sign_dyn");
+                collect();
+                sig_len = sizeof sig;
+                check(falcon_sign_tree(&rng, sig, &sig_len,
+                        FALCON_SIG_COMPRESSED, expkey,
+                        &i, sizeof i, tmp, tmp_len), "sign_tree");
+                collect();
+                sig_len = sizeof sig;
+                check(falcon_sign_semi(&rng, sig, &sig_len,
+                        FALCON_SIG_COMPRESSED, sexpkey,
+                        &i, sizeof i, tmp, tmp_len), "sign_semi");
+                collect();
+                check(falcon_verify(sig, sig_len, FALCON_SIG_COMPRESSED,
+                        pubkey, FALCON_PUBKEY_SIZE(logn),
+                        &i, sizeof i, tmp, tmp_len), "verify");
+                collect();
+        }
+
+        num_phases = 0;
+        while (num_phases < MAX_PHASES
+                && falcon_trace_phase_name(num_phases) != NULL)
+        {
+                num_phases ++;
+        }
+        if (calls[0] == 0) {
+                fprintf(stderr, "no trace events: "
+                        "the library was not compiled with FALCON_TRACE=1\n");
+                return EXIT_FAILURE;
+        }
+
+        /*
+         * Self time of a frame is its total time minus the total
+         * time of its direct sub-frames.
+         */
+        memcpy(self, total, sizeof self);
+        for (p = 0; p < num_phases; p ++) {
+                parent = parent_phase(p);
+                if (parent >= 0) {
+                        if (self[parent] >= total[p]) {
+                                self[parent] -= total[p];
+                        } else {
+                                self[parent] = 0;
+                        }
+                }
+        }
+        for (p = 0; p < num_phases; p ++) {
+                if (calls[p] != 0) {
+                        printf("falcon%u;%s %llu\n", 1u << logn,
+                                falcon_trace_phase_name(p),
+                                (unsigned long long)self[p]);
+                }
+        }
+
+        fprintf(stderr, "%-28s %12s %14s\n", "phase", "events", "ticks/call");
+        for (p = 0; p < num_phases; p ++) {
+                unsigned op;
+
+                if (calls[p] == 0) {
+                        continue;
+                }
+                parent = parent_phase(p);
+                op = parent >= 0 ? (unsigned)parent : p;
+                fprintf(stderr, "%-28s %12llu %14.1f\n",
+                        falcon_trace_phase_name(p),
+                        (unsigned long long)calls[p],
+                        (double)total[p] / (double)calls[op]);
+        }
+
+        free(tmp);
+        free(privkey);
+        free(pubkey);
+        free(expkey);
+        free(sexpkey);
+        return 0;
+}
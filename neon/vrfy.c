@@ -36,25 +36,55 @@ void Zf(to_ntt_monty)(int16_t *h)
 /* see inner.h */
 int Zf(verify_raw)(const int16_t *c0, const int16_t *s2,
                    int16_t *h, int16_t *tmp)
+{
+    ZfN(poly_ntt)(h, NTT_NONE);
+    return Zf(verify_raw_ntt)(c0, s2, h, tmp);
+}
+
+/* see inner.h */
+int Zf(verify_raw_ntt)(const int16_t *c0, const int16_t *s2,
+                       const int16_t *h, int16_t *tmp)
 {
     int16_t *tt = tmp;
+    uint32_t n1, n2;
 
     /*
-     * Compute s1 = c0 - s2*h mod phi mod q (in tt[]).
+     * Compute s1 = c0 - s2*h mod phi mod q. The public key is already
+     * in NTT representation, so only s2 needs the forward transform;
+     * the multiplication by h is done in its last layer, and the
+     * subtraction from c0 in the last layer of the inverse NTT. Both
+     * halves of the norm are accumulated on the way, so s1 itself is
+     * never stored.
      */
-
-    memcpy(tt, s2, sizeof(int16_t) * FALCON_N);
-    ZfN(poly_ntt)(h, NTT_NONE);
-    ZfN(poly_ntt)(tt, NTT_MONT_INV);
-    ZfN(poly_montmul_ntt)(tt, h);
-    ZfN(poly_invntt)(tt, INVNTT_NONE);
-    ZfN(poly_sub_barrett)(tt, c0, tt);
+    n2 = ZfN(poly_ntt_montmul)(tt, s2, h);
+    n1 = ZfN(poly_invntt_sub_norm)(tt, c0);
 
     /*
      * Signature is valid if and only if the aggregate (s1,s2) vector
      * is short enough.
      */
-    return ZfN(is_short)(tt, s2);
+    return ZfN(is_short_sqnorm)(n1 + n2);
+}
+
+/* see inner.h */
+uint32_t Zf(verify_raw_batch)(int16_t *const *c0, const int16_t *const *s2,
+                              int16_t *const *h, int16_t *tmp, unsigned count)
+{
+    uint32_t r;
+    unsigned i;
+
+    /*
+     * Lanes are verified one after the other. The pointwise product
+     * and the norm are computed inside the last NTT layers, which
+     * already use nearly all 32 NEON registers for one polynomial, so
+     * there are no separate passes left to interleave across lanes.
+     */
+    r = 0;
+    for (i = 0; i < count; i++)
+    {
+        r |= (uint32_t)Zf(verify_raw)(c0[i], s2[i], h[i], tmp) << i;
+    }
+    return r;
 }
 
 /* see inner.h */
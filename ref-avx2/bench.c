@@ -95,7 +95,9 @@ void test_FFT(fpr *f, unsigned logn)
     printf("| FFT %u | %8lld | %8lld\n", logn, fft, ifft);
 }
 
-void test_NTT(uint16_t *a, unsigned logn)
+void test_NTT(uint16_t *a, unsigned logn,
+              void (*ntt)(uint16_t *, unsigned),
+              void (*intt)(uint16_t *, unsigned), char *string)
 {
 #if BENCH_CYCLES == 0
     struct timespec start, stop;
@@ -109,7 +111,7 @@ void test_NTT(uint16_t *a, unsigned logn)
     for (unsigned i = 0; i < ntests; i++)
     {
         TIME(start);
-        mq_NTT(a, logn);
+        ntt(a, logn);
         TIME(stop);
         times[i] = stop - start;
     }
@@ -120,7 +122,7 @@ void test_NTT(uint16_t *a, unsigned logn)
     for (unsigned i = 0; i < ntests; i++)
     {
         TIME(start);
-        mq_iNTT(a, logn);
+        intt(a, logn);
         TIME(stop);
         times[i] = stop - start;
     }
@@ -128,7 +130,7 @@ void test_NTT(uint16_t *a, unsigned logn)
     /* =================================== */
     qsort(times, ITERATIONS, sizeof(uint64_t), cmp_uint64_t);
     ifft = times[ITERATIONS >> 1];
-    printf("| NTT %u | %8lld | %8lld\n", logn, fft, ifft);
+    printf("| %s %u | %8lld | %8lld\n", string, logn, fft, ifft);
 }
 
 void test_poly_add(fpr *c, fpr *a, fpr *b, unsigned logn, char *string)
@@ -397,6 +399,146 @@ void test_poly_merge_fft(fpr *restrict f, const fpr *restrict f0,
     printf("| %8s | %8u | %8lld\n", string, logn, fft);
 }
 
+#define COMP_BENCH_SIGS 64
+
+void test_comp_codec(int decode, unsigned logn, char *string)
+{
+#if BENCH_CYCLES == 0
+    struct timespec start, stop;
+#else
+    long long start, stop;
+#endif
+    long long fft;
+    unsigned ntests = ITERATIONS;
+    static int16_t x[COMP_BENCH_SIGS * FALCON_N], y[FALCON_N];
+    static uint8_t sig[COMP_BENCH_SIGS][2 * FALCON_N];
+    size_t sig_len[COMP_BENCH_SIGS];
+    size_t n = (size_t)1 << logn;
+
+    // Signature-like coefficients: approximately Gaussian (sum of 12
+    // uniform values), with the standard deviation of signatures.
+    // Calls cycle through distinct signatures, so that the branch
+    // predictor cannot learn a single input.
+    for (size_t i = 0; i < COMP_BENCH_SIGS * n; i++)
+    {
+        int t = 0;
+
+        for (int j = 0; j < 12; j++)
+        {
+            t += rand() % 1001;
+        }
+        x[i] = (int16_t)(((t - 6000) * (logn == 9 ? 165 : 168)) / 1000);
+    }
+    for (unsigned k = 0; k < COMP_BENCH_SIGS; k++)
+    {
+        sig_len[k] = Zf(comp_encode)(sig[k], sizeof sig[k], x + k * n, logn);
+    }
+
+    /* =================================== */
+    for (unsigned i = 0; i < ntests; i++)
+    {
+        unsigned k = i % COMP_BENCH_SIGS;
+
+        TIME(start);
+        if (decode)
+        {
+            Zf(comp_decode)(y, logn, sig[k], sig_len[k]);
+        }
+        else
+        {
+            Zf(comp_encode)(sig[k], sizeof sig[k], x + k * n, logn);
+        }
+        TIME(stop);
+
+        times[i] = stop - start;
+    }
+    qsort(times, ntests, sizeof(uint64_t), cmp_uint64_t);
+    fft = times[ntests >> 1];
+
+    printf("| %8s | %8u | %8lld\n", string, logn, fft);
+}
+
+void test_keygen_kernel(unsigned kernel, size_t len, unsigned logn, char *string)
+{
+#if BENCH_CYCLES == 0
+    struct timespec start, stop;
+#else
+    long long start, stop;
+#endif
+    long long fft;
+    unsigned ntests = 1000;
+    static uint32_t data[3 * 16 * FALCON_N];
+    size_t n = (size_t)1 << logn;
+
+    for (size_t i = 0; i < 3 * len * n; i++)
+    {
+        data[i] = (uint32_t)rand() & 0x7FFFFFFF;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        data[2 * len * n + i] = (uint32_t)(rand() % 2001 - 1000);
+    }
+
+    /* =================================== */
+    for (unsigned i = 0; i < ntests; i++)
+    {
+        TIME(start);
+        Zf(keygen_bench_kernel)(kernel, data, len, logn);
+        TIME(stop);
+
+        times[i] = stop - start;
+    }
+    qsort(times, ntests, sizeof(uint64_t), cmp_uint64_t);
+    fft = times[ntests >> 1];
+
+    printf("| %8s | %8u | %8lld\n", string, logn, fft);
+}
+
+void test_sampler(int x2, char *string)
+{
+#if BENCH_CYCLES == 0
+    struct timespec start, stop;
+#else
+    long long start, stop;
+#endif
+    long long fft;
+    unsigned ntests = ITERATIONS;
+    inner_shake256_context rng;
+    sampler_context sc;
+    fpr mu[2], z[2], isigma;
+
+    inner_shake256_init(&rng);
+    inner_shake256_inject(&rng, (const void *)"bench sampler", 13);
+    inner_shake256_flip(&rng);
+    Zf(prng_init)(&sc.p, &rng);
+    sc.sigma_min = fpr_sigma_min[FALCON_LOGN];
+    isigma = fpr_div(fpr_of(10), fpr_of(17));
+
+    /* =================================== */
+    for (unsigned i = 0; i < ntests; i++)
+    {
+        mu[0] = fpr_div(fpr_of((int64_t)(i % 97) - 48), fpr_of(7));
+        mu[1] = fpr_neg(mu[0]);
+        TIME(start);
+        if (x2)
+        {
+            Zf(sampler_x2)(&sc, z, mu, isigma);
+        }
+        else
+        {
+            z[0] = fpr_of(Zf(sampler)(&sc, mu[0], isigma));
+            z[1] = fpr_of(Zf(sampler)(&sc, mu[1], isigma));
+        }
+        TIME(stop);
+        times[i] = stop - start;
+    }
+    qsort(times, ITERATIONS, sizeof(uint64_t), cmp_uint64_t);
+    fft = times[ITERATIONS >> 1];
+
+    // Cost of two samples (one leaf pair)
+    printf("| %8s | %8u | %8lld\n", string, FALCON_LOGN, fft);
+}
+
 int main()
 {
     fpr f[FALCON_N], fa[FALCON_N], fb[FALCON_N], fc[FALCON_N], tmp[FALCON_N] = {0};
@@ -423,8 +565,10 @@ int main()
         test_FFT(f, i);
     }
 
-    test_NTT(a, 9);
-    test_NTT(a, 10);
+    test_NTT(a, 9, mq_NTT_scalar, mq_iNTT_scalar, "NTT (ref)");
+    test_NTT(a, 9, mq_NTT, mq_iNTT, "NTT");
+    test_NTT(a, 10, mq_NTT_scalar, mq_iNTT_scalar, "NTT (ref)");
+    test_NTT(a, 10, mq_NTT, mq_iNTT, "NTT");
 
     print_header();
     for (unsigned i = 0; i <= FALCON_LOGN; i++)
@@ -482,5 +626,30 @@ int main()
         test_poly_merge_fft(f, fa, fb, i, "poly_merge_fft");
     }
 
+    // NTRU solver big-integer kernels, 8-word integers
+    print_header();
+    for (unsigned i = 9; i <= FALCON_LOGN; i++)
+    {
+        test_keygen_kernel(FALCON_KG_BENCH_REBUILD_CRT, 8, i, "zint_rebuild_CRT");
+        test_keygen_kernel(FALCON_KG_BENCH_MOD_SMALL, 8, i, "zint_mod_small_signed");
+    }
+    test_keygen_kernel(FALCON_KG_BENCH_POLY_SUB_SCALED, 8, 5, "poly_sub_scaled");
+    // extended GCD at the deepest level (zint_co_reduce, zint_co_reduce_mod_x2)
+    test_keygen_kernel(FALCON_KG_BENCH_BEZOUT, 106, 2, "zint_bezout (512)");
+    test_keygen_kernel(FALCON_KG_BENCH_BEZOUT, 209, 2, "zint_bezout (1024)");
+
+    // Compressed signature encoding and decoding
+    print_header();
+    for (unsigned i = 9; i <= FALCON_LOGN; i++)
+    {
+        test_comp_codec(0, i, "comp_encode");
+        test_comp_codec(1, i, "comp_decode");
+    }
+
+    // Discrete Gaussian sampler, two samples per call
+    print_header();
+    test_sampler(0, "sampler");
+    test_sampler(1, "sampler_x2");
+
     return 0;
 }
\ No newline at end of file
@@ -31,19 +31,48 @@
 
 #include "inner.h"
 
+/*
+ * Public key coefficients are packed over 14 bits each, big-endian, so
+ * that each group of 4 coefficients uses exactly 7 bytes. With AVX2,
+ * 16 coefficients (two 14-byte groups, one per 128-bit lane) are
+ * processed at a time: on encoding, pairs are merged with a multiply-add
+ * and the 56-bit groups are put in big-endian order with a byte
+ * shuffle; on decoding, the bytes that hold each coefficient are
+ * shuffled into 32-bit words, then shifted into place. Each block may
+ * read or write two bytes past its end, so the vector loops stop one
+ * block before the end and the last coefficients use the generic code.
+ */
+
 /* see inner.h */
+TARGET_AVX2
 size_t
 Zf(modq_encode)(
 	void *out, size_t max_out_len,
 	const uint16_t *x, unsigned logn)
 {
-	size_t n, out_len, u;
+	size_t n, out_len, u, v;
 	uint8_t *buf;
 	uint32_t acc;
 	int acc_len;
 
 	n = (size_t)1 << logn;
-	for (u = 0; u < n; u ++) {
+	u = 0;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (n >= 16) {
+		__m256i bad, q1;
+
+		bad = _mm256_setzero_si256();
+		q1 = _mm256_set1_epi16(12288);
+		for (u = 0; u < n; u += 16) {
+			bad = _mm256_or_si256(bad, _mm256_subs_epu16(
+				_mm256_loadu_si256((const __m256i *)(x + u)), q1));
+		}
+		if (!_mm256_testz_si256(bad, bad)) {
+			return 0;
+		}
+	}
+#endif // yyyAVX2-
+	for (; u < n; u ++) {
 		if (x[u] >= 12289) {
 			return 0;
 		}
@@ -56,23 +85,54 @@ Zf(modq_encode)(
 		return 0;
 	}
 	buf = out;
+	u = 0;
+	v = 0;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (n > 16) {
+		__m256i mul, shuf;
+
+		mul = _mm256_set1_epi32(0x00014000);
+		shuf = _mm256_setr_epi8(
+			6, 5, 4, 3, 2, 1, 0, 14, 13, 12, 11, 10, 9, 8, -1, -1,
+			6, 5, 4, 3, 2, 1, 0, 14, 13, 12, 11, 10, 9, 8, -1, -1);
+		for (; u + 16 < n; u += 16, v += 28) {
+			__m256i xv;
+
+			/*
+			 * 32-bit lanes: x[2i]*2^14 + x[2i+1] (28 bits);
+			 * 64-bit lanes: the two 28-bit values merged into
+			 * 56 bits (the top byte is garbage).
+			 */
+			xv = _mm256_madd_epi16(
+				_mm256_loadu_si256((const __m256i *)(x + u)), mul);
+			xv = _mm256_or_si256(_mm256_slli_epi64(xv, 28),
+				_mm256_srli_epi64(xv, 32));
+			xv = _mm256_shuffle_epi8(xv, shuf);
+			_mm_storeu_si128((__m128i *)(buf + v),
+				_mm256_castsi256_si128(xv));
+			_mm_storeu_si128((__m128i *)(buf + v + 14),
+				_mm256_extracti128_si256(xv, 1));
+		}
+	}
+#endif // yyyAVX2-
 	acc = 0;
 	acc_len = 0;
-	for (u = 0; u < n; u ++) {
+	for (; u < n; u ++) {
 		acc = (acc << 14) | x[u];
 		acc_len += 14;
 		while (acc_len >= 8) {
 			acc_len -= 8;
-			*buf ++ = (uint8_t)(acc >> acc_len);
+			buf[v ++] = (uint8_t)(acc >> acc_len);
 		}
 	}
 	if (acc_len > 0) {
-		*buf = (uint8_t)(acc << (8 - acc_len));
+		buf[v] = (uint8_t)(acc << (8 - acc_len));
 	}
 	return out_len;
 }
 
 /* see inner.h */
+TARGET_AVX2
 size_t
 Zf(modq_decode)(
 	uint16_t *x, unsigned logn,
@@ -89,9 +149,47 @@ Zf(modq_decode)(
 		return 0;
 	}
 	buf = in;
+	u = 0;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (n > 16) {
+		__m256i shuf_lo, shuf_hi, sh, m14, q1, bad;
+
+		/*
+		 * Coefficient i of a 14-byte group starts at bit 14*i:
+		 * its three bytes are put (big-endian) in a 32-bit word,
+		 * which is then shifted right by 10, 4, 6 or 8 bits.
+		 */
+		shuf_lo = _mm256_setr_epi8(
+			2, 1, 0, -1, 3, 2, 1, -1, 5, 4, 3, -1, 7, 6, 5, -1,
+			2, 1, 0, -1, 3, 2, 1, -1, 5, 4, 3, -1, 7, 6, 5, -1);
+		shuf_hi = _mm256_setr_epi8(
+			9, 8, 7, -1, 10, 9, 8, -1, 12, 11, 10, -1, 14, 13, 12, -1,
+			9, 8, 7, -1, 10, 9, 8, -1, 12, 11, 10, -1, 14, 13, 12, -1);
+		sh = _mm256_setr_epi32(10, 4, 6, 8, 10, 4, 6, 8);
+		m14 = _mm256_set1_epi32(0x3FFF);
+		q1 = _mm256_set1_epi16(12288);
+		bad = _mm256_setzero_si256();
+		for (; u + 16 < n; u += 16, buf += 28) {
+			__m256i bv, lo, hi, w;
+
+			bv = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((const __m128i *)buf)),
+				_mm_loadu_si128((const __m128i *)(buf + 14)), 1);
+			lo = _mm256_and_si256(_mm256_srlv_epi32(
+				_mm256_shuffle_epi8(bv, shuf_lo), sh), m14);
+			hi = _mm256_and_si256(_mm256_srlv_epi32(
+				_mm256_shuffle_epi8(bv, shuf_hi), sh), m14);
+			w = _mm256_packus_epi32(lo, hi);
+			bad = _mm256_or_si256(bad, _mm256_subs_epu16(w, q1));
+			_mm256_storeu_si256((__m256i *)(x + u), w);
+		}
+		if (!_mm256_testz_si256(bad, bad)) {
+			return 0;
+		}
+	}
+#endif // yyyAVX2-
 	acc = 0;
 	acc_len = 0;
-	u = 0;
 	while (u < n) {
 		acc = (acc << 8) | (*buf ++);
 		acc_len += 8;
@@ -157,7 +255,62 @@ Zf(trim_i16_encode)(
 	return out_len;
 }
 
+/*
+ * Fixed-width values (trim_i16_decode() and trim_i8_decode()): a group
+ * of 8 values of 'bits' bits uses exactly 'bits' bytes. When each value
+ * of a group fits in two consecutive bytes (bits <= 10, 12 or 16), the
+ * AVX2 code decodes two groups at a time, one per 128-bit lane: a byte
+ * shuffle puts the two bytes that hold value j in 16-bit word j, a
+ * multiply by 2^(bit offset) moves the value to the top of the word,
+ * and an arithmetic shift right sign-extends it. The constants depend
+ * only on 'bits'. Each group reads 16 bytes, so the vector loop stops
+ * before the last 16 input bytes, and the generic code decodes the
+ * remaining values.
+ */
+
+#if FALCON_AVX2 // yyyAVX2+1
+#define TRIM_SIMD_BITS(bits)   ((bits) <= 10 || (bits) == 12 || (bits) == 16)
+
+TARGET_AVX2
+static void
+trim_setup(__m256i *idx, __m256i *mul, unsigned bits)
+{
+	int8_t ib[32];
+	int16_t mb[16];
+	unsigned j;
+
+	for (j = 0; j < 8; j ++) {
+		unsigned b;
+
+		b = (j * bits) >> 3;
+		ib[2 * j] = ib[16 + 2 * j] = (int8_t)(b + 1);
+		ib[2 * j + 1] = ib[16 + 2 * j + 1] = (int8_t)b;
+		mb[j] = mb[8 + j] = (int16_t)(1 << ((j * bits) & 7));
+	}
+	*idx = _mm256_loadu_si256((const __m256i *)ib);
+	*mul = _mm256_loadu_si256((const __m256i *)mb);
+}
+
+/*
+ * Decode the 16 values of two consecutive groups, starting at buf.
+ */
+TARGET_AVX2
+static inline __m256i
+trim_decode16(const uint8_t *buf, unsigned bits,
+	__m256i idx, __m256i mul, __m128i sh)
+{
+	__m256i w;
+
+	w = _mm256_inserti128_si256(_mm256_castsi128_si256(
+		_mm_loadu_si128((const __m128i *)buf)),
+		_mm_loadu_si128((const __m128i *)(buf + bits)), 1);
+	w = _mm256_mullo_epi16(_mm256_shuffle_epi8(w, idx), mul);
+	return _mm256_sra_epi16(w, sh);
+}
+#endif // yyyAVX2-
+
 /* see inner.h */
+TARGET_AVX2
 size_t
 Zf(trim_i16_decode)(
 	int16_t *x, unsigned logn, unsigned bits,
@@ -176,6 +329,34 @@ Zf(trim_i16_decode)(
 	}
 	buf = in;
 	u = 0;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (TRIM_SIMD_BITS(bits)) {
+		__m256i idx, mul, forb, bad;
+		__m128i sh;
+		size_t v;
+
+		trim_setup(&idx, &mul, bits);
+		sh = _mm_cvtsi32_si128((int)(16 - bits));
+		forb = _mm256_set1_epi16((short)-(1 << (bits - 1)));
+		bad = _mm256_setzero_si256();
+		for (v = 0; u + 16 <= n && v + bits + 16 <= in_len;
+			u += 16, v += 2 * bits)
+		{
+			__m256i w;
+
+			w = trim_decode16(buf + v, bits, idx, mul, sh);
+			bad = _mm256_or_si256(bad, _mm256_cmpeq_epi16(w, forb));
+			_mm256_storeu_si256((__m256i *)(x + u), w);
+		}
+		if (!_mm256_testz_si256(bad, bad)) {
+			/*
+			 * The -2^(bits-1) value is forbidden.
+			 */
+			return 0;
+		}
+		buf += v;
+	}
+#endif // yyyAVX2-
 	acc = 0;
 	acc_len = 0;
 	mask1 = ((uint32_t)1 << bits) - 1;
@@ -254,6 +435,7 @@ Zf(trim_i8_encode)(
 }
 
 /* see inner.h */
+TARGET_AVX2
 size_t
 Zf(trim_i8_decode)(
 	int8_t *x, unsigned logn, unsigned bits,
@@ -272,6 +454,36 @@ Zf(trim_i8_decode)(
 	}
 	buf = in;
 	u = 0;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (bits <= 8) {
+		__m256i idx, mul, forb, bad;
+		__m128i sh;
+		size_t v;
+
+		trim_setup(&idx, &mul, bits);
+		sh = _mm_cvtsi32_si128((int)(16 - bits));
+		forb = _mm256_set1_epi16((short)-(1 << (bits - 1)));
+		bad = _mm256_setzero_si256();
+		for (v = 0; u + 16 <= n && v + bits + 16 <= in_len;
+			u += 16, v += 2 * bits)
+		{
+			__m256i w;
+
+			w = trim_decode16(buf + v, bits, idx, mul, sh);
+			bad = _mm256_or_si256(bad, _mm256_cmpeq_epi16(w, forb));
+			_mm_storeu_si128((__m128i *)(x + u),
+				_mm_packs_epi16(_mm256_castsi256_si128(w),
+				_mm256_extracti128_si256(w, 1)));
+		}
+		if (!_mm256_testz_si256(bad, bad)) {
+			/*
+			 * The -2^(bits-1) value is forbidden.
+			 */
+			return 0;
+		}
+		buf += v;
+	}
+#endif // yyyAVX2-
 	acc = 0;
 	acc_len = 0;
 	mask1 = ((uint32_t)1 << bits) - 1;
@@ -303,7 +515,93 @@ Zf(trim_i8_decode)(
 	return in_len;
 }
 
+/*
+ * Signatures use a Golomb-Rice-like code: for each coefficient, the
+ * sign bit and the low 7 bits of the absolute value, then the high
+ * bits (absolute value >> 7) in unary: that many zeros, then a one.
+ *
+ * The encoder computes whole code words (at most 24 bits each; with
+ * AVX2, 8 at a time) and packs them into a 64-bit accumulator, 32 bits
+ * at a time. The decoder reads code words from a 64-bit bit buffer
+ * (refilled a whole word at a time when possible) and finds the length
+ * of the unary part with a count-leading-zeros (or a table lookup when
+ * the compiler has no builtin for it); it stores the raw fields, and
+ * a final pass (16 values at a time with AVX2) rebuilds the signed
+ * values.
+ */
+
+#if defined __GNUC__ || defined __clang__
+#define COMP_CLZ16(t)   ((unsigned)__builtin_clz(t) - 16)
+#else
+/*
+ * Number of leading zeros in a byte.
+ */
+static const uint8_t comp_clz8[] = {
+	8, 7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+#define COMP_CLZ16(t)   ((t) >> 8 != 0 \
+	? (unsigned)comp_clz8[(t) >> 8] : 8 + (unsigned)comp_clz8[t])
+#endif
+
+/*
+ * Load 8 bytes as a big-endian 64-bit integer.
+ */
+static inline uint64_t
+dec64be(const uint8_t *buf)
+{
+	return ((uint64_t)buf[0] << 56)
+		| ((uint64_t)buf[1] << 48)
+		| ((uint64_t)buf[2] << 40)
+		| ((uint64_t)buf[3] << 32)
+		| ((uint64_t)buf[4] << 24)
+		| ((uint64_t)buf[5] << 16)
+		| ((uint64_t)buf[6] << 8)
+		| (uint64_t)buf[7];
+}
+
+/*
+ * Code words and lengths for num values (num <= 8). For the absolute
+ * value a = h*128 + l, the code word is ((sign << 7) | l) << (h + 1) | 1,
+ * over h + 9 bits.
+ */
+static void
+comp_words(uint32_t *cw, uint32_t *cl, const int16_t *x, size_t num)
+{
+	size_t j;
+
+	for (j = 0; j < num; j ++) {
+		int t;
+		uint32_t s, w;
+
+		t = x[j];
+		s = 0;
+		if (t < 0) {
+			t = -t;
+			s = 128;
+		}
+		w = (uint32_t)t;
+		cw[j] = ((s | (w & 127)) << ((w >> 7) + 1)) | 1;
+		cl[j] = (w >> 7) + 9;
+	}
+}
+
 /* see inner.h */
+TARGET_AVX2
 size_t
 Zf(comp_encode)(
 	void *out, size_t max_out_len,
@@ -311,7 +609,7 @@ Zf(comp_encode)(
 {
 	uint8_t *buf;
 	size_t n, u, v;
-	uint32_t acc;
+	uint64_t acc;
 	unsigned acc_len;
 
 	n = (size_t)1 << logn;
@@ -329,64 +627,75 @@ Zf(comp_encode)(
 	acc = 0;
 	acc_len = 0;
 	v = 0;
-	for (u = 0; u < n; u ++) {
-		int t;
-		unsigned w;
-
-		/*
-		 * Get sign and absolute value of next integer; push the
-		 * sign bit.
-		 */
-		acc <<= 1;
-		t = x[u];
-		if (t < 0) {
-			t = -t;
-			acc |= 1;
+	for (u = 0; u < n; u += 8) {
+		uint32_t cw[8], cl[8];
+		size_t j, num;
+
+		num = (n - u) < 8 ? (n - u) : 8;
+#if FALCON_AVX2 // yyyAVX2+1
+		if (num == 8) {
+			__m256i xv, av, hv, lv;
+
+			xv = _mm256_cvtepi16_epi32(
+				_mm_loadu_si128((const __m128i *)(x + u)));
+			av = _mm256_abs_epi32(xv);
+			hv = _mm256_add_epi32(_mm256_srli_epi32(av, 7),
+				_mm256_set1_epi32(1));
+			lv = _mm256_or_si256(
+				_mm256_and_si256(av, _mm256_set1_epi32(127)),
+				_mm256_and_si256(_mm256_srai_epi32(xv, 31),
+				_mm256_set1_epi32(128)));
+			_mm256_storeu_si256((__m256i *)cw,
+				_mm256_or_si256(_mm256_sllv_epi32(lv, hv),
+				_mm256_set1_epi32(1)));
+			_mm256_storeu_si256((__m256i *)cl,
+				_mm256_add_epi32(hv, _mm256_set1_epi32(8)));
+		} else {
+			comp_words(cw, cl, x + u, num);
 		}
-		w = (unsigned)t;
-
-		/*
-		 * Push the low 7 bits of the absolute value.
-		 */
-		acc <<= 7;
-		acc |= w & 127u;
-		w >>= 7;
+#else // yyyAVX2+0
+		comp_words(cw, cl, x + u, num);
+#endif // yyyAVX2-
 
 		/*
-		 * We pushed exactly 8 bits.
+		 * acc_len is at most 31 before each word is added, so
+		 * the accumulator never holds more than 55 pending bits.
 		 */
-		acc_len += 8;
-
-		/*
-		 * Push as many zeros as necessary, then a one. Since the
-		 * absolute value is at most 2047, w can only range up to
-		 * 15 at this point, thus we will add at most 16 bits
-		 * here. With the 8 bits above and possibly up to 7 bits
-		 * from previous iterations, we may go up to 31 bits, which
-		 * will fit in the accumulator, which is an uint32_t.
-		 */
-		acc <<= (w + 1);
-		acc |= 1;
-		acc_len += w + 1;
-
-		/*
-		 * Produce all full bytes.
-		 */
-		while (acc_len >= 8) {
-			acc_len -= 8;
-			if (buf != NULL) {
-				if (v >= max_out_len) {
-					return 0;
+		for (j = 0; j < num; j ++) {
+			acc = (acc << cl[j]) | cw[j];
+			acc_len += cl[j];
+			if (acc_len >= 32) {
+				uint32_t w;
+
+				acc_len -= 32;
+				if (buf != NULL) {
+					if (max_out_len - v < 4) {
+						return 0;
+					}
+					w = (uint32_t)(acc >> acc_len);
+					buf[v] = (uint8_t)(w >> 24);
+					buf[v + 1] = (uint8_t)(w >> 16);
+					buf[v + 2] = (uint8_t)(w >> 8);
+					buf[v + 3] = (uint8_t)w;
 				}
-				buf[v] = (uint8_t)(acc >> acc_len);
+				v += 4;
 			}
-			v ++;
 		}
 	}
 
 	/*
 	 * Flush remaining bits (if any).
 	 */
+	while (acc_len >= 8) {
+		acc_len -= 8;
+		if (buf != NULL) {
+			if (v >= max_out_len) {
+				return 0;
+			}
+			buf[v] = (uint8_t)(acc >> acc_len);
+		}
+		v ++;
+	}
 	if (acc_len > 0) {
 		if (buf != NULL) {
 			if (v >= max_out_len) {
@@ -401,6 +710,7 @@ Zf(comp_encode)(
 }
 
 /* see inner.h */
+TARGET_AVX2
 size_t
 Zf(comp_decode)(
 	int16_t *x, unsigned logn,
@@ -408,67 +718,111 @@ Zf(comp_decode)(
 {
 	const uint8_t *buf;
 	size_t n, u, v;
-	uint32_t acc;
+	uint64_t acc;
 	unsigned acc_len;
+	uint32_t r;
 
+	/*
+	 * acc holds the next bits of input in its top acc_len bits; bits
+	 * below are either zero or the following input bits, so a
+	 * leading-zero count that stays within acc_len is exact.
+	 */
 	n = (size_t)1 << logn;
 	buf = in;
 	acc = 0;
 	acc_len = 0;
 	v = 0;
 	for (u = 0; u < n; u ++) {
-		unsigned b, s, m;
-
-		/*
-		 * Get next eight bits: sign and low seven bits of the
-		 * absolute value.
-		 */
-		if (v >= max_in_len) {
-			return 0;
-		}
-		acc = (acc << 8) | (uint32_t)buf[v ++];
-		b = acc >> acc_len;
-		s = b & 128;
-		m = b & 127;
+		unsigned b, t, k;
 
 		/*
-		 * Get next bits until a 1 is reached.
+		 * A code word is at most 24 bits.
 		 */
-		for (;;) {
-			if (acc_len == 0) {
-				if (v >= max_in_len) {
-					return 0;
+		if (acc_len < 24) {
+			if (max_in_len - v >= 8) {
+				acc |= dec64be(buf + v) >> acc_len;
+				v += (63 - acc_len) >> 3;
+				acc_len |= 56;
+			} else {
+				while (acc_len <= 56 && v < max_in_len) {
+					acc |= (uint64_t)buf[v ++] << (56 - acc_len);
+					acc_len += 8;
 				}
-				acc = (acc << 8) | (uint32_t)buf[v ++];
-				acc_len = 8;
-			}
-			acc_len --;
-			if (((acc >> acc_len) & 1) != 0) {
-				break;
-			}
-			m += 128;
-			if (m > 2047) {
-				return 0;
 			}
 		}
 
 		/*
-		 * "-0" is forbidden.
+		 * Sign and low seven bits, then count the zeros before the
+		 * next one: the value is too large (more than 2047) if
+		 * there are 16 or more, and the input is truncated if the
+		 * one is not within the available bits.
 		 */
-		if (s && m == 0) {
+		b = (unsigned)(acc >> 56);
+		t = (unsigned)(acc >> 40) & 0xFFFF;
+		if (t == 0) {
 			return 0;
 		}
-
-		x[u] = (int16_t)(s ? -(int)m : (int)m);
+		k = COMP_CLZ16(t);
+		if (k + 9 > acc_len) {
+			return 0;
+		}
+		acc <<= k + 9;
+		acc_len -= k + 9;
+		x[u] = (int16_t)(b | (k << 8));
 	}
 
 	/*
-	 * Unused bits in the last byte must be zero.
+	 * Whole bytes read ahead are not part of the signature. Unused
+	 * bits in the last byte must be zero.
 	 */
-	if ((acc & ((1u << acc_len) - 1u)) != 0) {
+	v -= acc_len >> 3;
+	acc_len &= 7;
+	if (acc_len != 0 && (acc >> (64 - acc_len)) != 0) {
 		return 0;
 	}
 
+	/*
+	 * Each x[u] holds sign (bit 7), low bits (0 to 6) and high bits
+	 * (8 to 11) of the absolute value. "-0" is forbidden.
+	 */
+	u = 0;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (n >= 16) {
+		__m256i neg0, x80;
+
+		neg0 = _mm256_setzero_si256();
+		x80 = _mm256_set1_epi16(0x80);
+		for (u = 0; u < n; u += 16) {
+			__m256i w, m, s;
+
+			w = _mm256_loadu_si256((__m256i *)(x + u));
+			m = _mm256_or_si256(
+				_mm256_and_si256(w, _mm256_set1_epi16(127)),
+				_mm256_slli_epi16(_mm256_srli_epi16(w, 8), 7));
+			s = _mm256_cmpeq_epi16(_mm256_and_si256(w, x80), x80);
+			neg0 = _mm256_or_si256(neg0,
+				_mm256_cmpeq_epi16(w, x80));
+			m = _mm256_sub_epi16(_mm256_xor_si256(m, s), s);
+			_mm256_storeu_si256((__m256i *)(x + u), m);
+		}
+		if (!_mm256_testz_si256(neg0, neg0)) {
+			return 0;
+		}
+	}
+#endif // yyyAVX2-
+	r = 0;
+	for (; u < n; u ++) {
+		uint32_t w, m, s;
+
+		w = (uint16_t)x[u];
+		r |= ((w ^ 0x80) - 1) >> 31;
+		m = (w & 127) | ((w >> 8) << 7);
+		s = -((w >> 7) & 1);
+		x[u] = (int16_t)((m ^ s) - s);
+	}
+	if (r != 0) {
+		return 0;
+	}
 	return v;
 }
 
@@ -31,7 +31,42 @@
 
 #include "inner.h"
 
+#if FALCON_AVX2  // yyyAVX2+1
+#include "../common/keccak4x/KeccakP-1600-times4-SnP.h"
+#endif  // yyyAVX2-
+
+#if FALCON_AVX2  // yyyAVX2+1
+/*
+ * Shuffle indices that pack the accepted 16-bit samples among four
+ * lanes to the front (bit i of the row index is set if lane i is kept),
+ * and the matching number of kept lanes. Index 0x80 yields a zero.
+ */
+static const uint8_t hash_pack_idx[16][8] = {
+	{ 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+	{    0,    1, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+	{    2,    3, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+	{    0,    1,    2,    3, 0x80, 0x80, 0x80, 0x80 },
+	{    4,    5, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+	{    0,    1,    4,    5, 0x80, 0x80, 0x80, 0x80 },
+	{    2,    3,    4,    5, 0x80, 0x80, 0x80, 0x80 },
+	{    0,    1,    2,    3,    4,    5, 0x80, 0x80 },
+	{    6,    7, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+	{    0,    1,    6,    7, 0x80, 0x80, 0x80, 0x80 },
+	{    2,    3,    6,    7, 0x80, 0x80, 0x80, 0x80 },
+	{    0,    1,    2,    3,    6,    7, 0x80, 0x80 },
+	{    4,    5,    6,    7, 0x80, 0x80, 0x80, 0x80 },
+	{    0,    1,    4,    5,    6,    7, 0x80, 0x80 },
+	{    2,    3,    4,    5,    6,    7, 0x80, 0x80 },
+	{    0,    1,    2,    3,    4,    5,    6,    7 },
+};
+
+static const uint8_t hash_pack_cnt[16] = {
+	0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+#endif  // yyyAVX2-
+
 /* see inner.h */
+TARGET_AVX2
 void
 Zf(hash_to_point_vartime)(
 	inner_shake256_context *sc,
@@ -50,6 +85,90 @@ Zf(hash_to_point_vartime)(
 	size_t n;
 
 	n = (size_t)1 << logn;
+#if FALCON_AVX2  // yyyAVX2+1
+	/*
+	 * SHAKE output is extracted in chunks of up to one full block,
+	 * and 8 samples are processed at once: byte swap, rejection of
+	 * values >= 5*q, reduction mod q and packing of the kept values.
+	 * Each 2-byte sample yields at most one output value, so chunks
+	 * of at most 2*n bytes never extract more than the per-sample
+	 * code would: output and final context state are unchanged.
+	 */
+	{
+		__m128i xq1, xq2, xq4, xlim, xswap, xw, xm;
+		uint8_t buf[136];
+		size_t len, u;
+
+		xq1 = _mm_set1_epi16(12289);
+		xq2 = _mm_set1_epi16(2 * 12289);
+		xq4 = _mm_set1_epi16((short)(4 * 12289));
+		xlim = _mm_set1_epi16((short)61444);
+		xswap = _mm_setr_epi8(
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+		while (n > 0) {
+			len = (sc->dptr == 136) ? 136 : 136 - (size_t)sc->dptr;
+			if (len > 2 * n) {
+				len = 2 * n;
+			}
+			len &= ~(size_t)1;
+			if (len == 0) {
+				/*
+				 * Only one byte left in the current block.
+				 */
+				len = 2;
+			}
+			inner_shake256_extract(sc, buf, len);
+
+			for (u = 0; u + 16 <= len; u += 16) {
+				unsigned bits, lo, hi;
+
+				xw = _mm_shuffle_epi8(
+					_mm_loadu_si128((const __m128i *)(buf + u)),
+					xswap);
+				xm = _mm_cmpeq_epi16(_mm_min_epu16(xw, xlim), xw);
+				xw = _mm_sub_epi16(xw, _mm_and_si128(xq4,
+					_mm_cmpeq_epi16(_mm_max_epu16(xw, xq4), xw)));
+				xw = _mm_sub_epi16(xw, _mm_and_si128(xq2,
+					_mm_cmpeq_epi16(_mm_max_epu16(xw, xq2), xw)));
+				xw = _mm_sub_epi16(xw, _mm_and_si128(xq1,
+					_mm_cmpeq_epi16(_mm_max_epu16(xw, xq1), xw)));
+
+				bits = (unsigned)_mm_movemask_epi8(
+					_mm_packs_epi16(xm, _mm_setzero_si128()));
+				lo = bits & 0x0F;
+				hi = bits >> 4;
+
+				/*
+				 * n >= 8 here, so both 4-lane stores stay
+				 * within x[].
+				 */
+				_mm_storel_epi64((__m128i *)x, _mm_shuffle_epi8(xw,
+					_mm_loadl_epi64(
+					(const __m128i *)hash_pack_idx[lo])));
+				x += hash_pack_cnt[lo];
+				_mm_storel_epi64((__m128i *)x, _mm_shuffle_epi8(xw,
+					_mm_add_epi8(_mm_loadl_epi64(
+					(const __m128i *)hash_pack_idx[hi]),
+					_mm_set1_epi8(8))));
+				x += hash_pack_cnt[hi];
+				n -= hash_pack_cnt[lo] + hash_pack_cnt[hi];
+			}
+
+			for (; u < len; u += 2) {
+				uint32_t w;
+
+				w = ((unsigned)buf[u] << 8) | (unsigned)buf[u + 1];
+				if (w < 61445) {
+					while (w >= 12289) {
+						w -= 12289;
+					}
+					*x ++ = (uint16_t)w;
+					n --;
+				}
+			}
+		}
+	}
+#else  // yyyAVX2+0
 	while (n > 0) {
 		uint8_t buf[2];
 		uint32_t w;
@@ -64,6 +183,94 @@ Zf(hash_to_point_vartime)(
 			n --;
 		}
 	}
+#endif  // yyyAVX2-
+}
+
+/* see inner.h */
+void
+Zf(hash_to_point_x4)(
+	inner_shake256_context *const *sc,
+	uint16_t *const *x, unsigned logn)
+{
+#if FALCON_AVX2  // yyyAVX2+1
+	/*
+	 * The four SHAKE256 states are interleaved, as expected by the
+	 * four-way Keccak permutation; each call to the permutation then
+	 * yields one 136-byte block per instance. Instances that already
+	 * have all their samples keep being permuted (the cost is the
+	 * same), but their output is ignored.
+	 */
+	union {
+		__m256i v[25];
+		uint8_t b[KeccakP1600times4_statesSizeInBytes];
+	} st;
+	uint8_t buf[4 * 136];
+	size_t n, cnt[4];
+	unsigned done, i;
+
+	/*
+	 * The instances stay in lockstep only if they all start on a
+	 * block boundary, which is the case for freshly flipped
+	 * contexts.
+	 */
+	for (i = 0; i < 4; i ++) {
+		if (sc[i]->dptr != 136) {
+			for (i = 0; i < 4; i ++) {
+				Zf(hash_to_point_vartime)(sc[i], x[i], logn);
+			}
+			return;
+		}
+	}
+
+	for (i = 0; i < 4; i ++) {
+		KeccakP1600times4_OverwriteBytes(&st, i, sc[i]->st.dbuf, 0, 200);
+		cnt[i] = 0;
+	}
+	n = (size_t)1 << logn;
+	done = 0;
+	while (done != 0x0F) {
+		KeccakP1600times4_PermuteAll_24rounds(&st);
+		KeccakP1600times4_ExtractLanesAll(&st, buf, 17, 17);
+		for (i = 0; i < 4; i ++) {
+			const uint8_t *b;
+			size_t u;
+
+			if ((done >> i) & 1) {
+				continue;
+			}
+			b = buf + 136 * i;
+			u = 0;
+			while (u < 136 && cnt[i] < n) {
+				uint32_t w;
+
+				w = ((unsigned)b[u] << 8) | (unsigned)b[u + 1];
+				u += 2;
+				if (w < 61445) {
+					while (w >= 12289) {
+						w -= 12289;
+					}
+					x[i][cnt[i] ++] = (uint16_t)w;
+				}
+			}
+			if (cnt[i] == n) {
+				/*
+				 * Leave the context exactly where the scalar
+				 * code would have stopped.
+				 */
+				KeccakP1600times4_ExtractBytes(&st, i,
+					sc[i]->st.dbuf, 0, 200);
+				sc[i]->dptr = u;
+				done |= 1u << i;
+			}
+		}
+	}
+#else  // yyyAVX2+0
+	unsigned i;
+
+	for (i = 0; i < 4; i ++) {
+		Zf(hash_to_point_vartime)(sc[i], x[i], logn);
+	}
+#endif  // yyyAVX2-
 }
 
 /* see inner.h */
@@ -171,6 +171,18 @@
 #define FALCON_KG_CHACHA20   1
  */
 
+/*
+ * Sample the pairs of values at the ffSampling leaves with
+ * Zf(sampler_x2)(). With FALCON_AVX2, this draws PRNG bytes in 72-byte
+ * blocks and runs four rejection candidates at once in AVX2 registers.
+ * The output distribution is unchanged, but the PRNG is consumed in a
+ * different order, so signatures obtained from a given seed differ
+ * from the known-answer test vectors; this setting is not enabled by
+ * default.
+ *
+#define FALCON_SAMPLER_X2   1
+ */
+
 /*
  * Use an explicit OS-provided source of randomness for seeding (for the
  * Zf(get_seed)() function implementation). Three possible sources are
@@ -763,51 +763,40 @@ falcon_verify_start(shake256_context *hash_data,
 	return 0;
 }
 
-/* see falcon.h */
-int
-falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
-	const void *pubkey, size_t pubkey_len,
-	shake256_context *hash_data,
-	void *tmp, size_t tmp_len)
+/*
+ * Check the header bytes of a signature and public key, and the
+ * signature length for its format. On success, the degree is written
+ * in *logn, and *ct is set to 1 for a constant-time signature.
+ */
+static int
+verify_check(unsigned *logn, int *ct,
+	const uint8_t *es, size_t sig_len, int sig_type,
+	const uint8_t *pk, size_t pubkey_len)
 {
-	unsigned logn;
-	uint8_t *atmp;
-	const uint8_t *pk, *es;
-	size_t u, v, n;
-	uint16_t *h, *hm;
-	int16_t *sv;
-	int ct;
-
-	/*
-	 * Get Falcon degree from public key; verify consistency with
-	 * signature value, and check parameters.
-	 */
 	if (sig_len < 41 || pubkey_len == 0) {
 		return FALCON_ERR_FORMAT;
 	}
-	es = sig;
-	pk = pubkey;
 	if ((pk[0] & 0xF0) != 0x00) {
 		return FALCON_ERR_FORMAT;
 	}
-	logn = pk[0] & 0x0F;
-	if (logn < 1 || logn > 10) {
+	*logn = pk[0] & 0x0F;
+	if (*logn < 1 || *logn > 10) {
 		return FALCON_ERR_FORMAT;
 	}
-	if ((es[0] & 0x0F) != logn) {
+	if ((es[0] & 0x0F) != *logn) {
 		return FALCON_ERR_BADSIG;
 	}
-	ct = 0;
+	*ct = 0;
 	switch (sig_type) {
 	case 0:
 		switch (es[0] & 0xF0) {
 		case 0x30:
 			break;
 		case 0x50:
-			if (sig_len != FALCON_SIG_CT_SIZE(logn)) {
+			if (sig_len != FALCON_SIG_CT_SIZE(*logn)) {
 				return FALCON_ERR_FORMAT;
 			}
-			ct = 1;
+			*ct = 1;
 			break;
 		default:
 			return FALCON_ERR_BADSIG;
@@ -822,7 +811,7 @@ falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
 		if ((es[0] & 0xF0) != 0x30) {
 			return FALCON_ERR_FORMAT;
 		}
-		if (sig_len != FALCON_SIG_PADDED_SIZE(logn)) {
+		if (sig_len != FALCON_SIG_PADDED_SIZE(*logn)) {
 			return FALCON_ERR_FORMAT;
 		}
 		break;
@@ -830,26 +819,30 @@ falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
 		if ((es[0] & 0xF0) != 0x50) {
 			return FALCON_ERR_FORMAT;
 		}
-		if (sig_len != FALCON_SIG_CT_SIZE(logn)) {
+		if (sig_len != FALCON_SIG_CT_SIZE(*logn)) {
 			return FALCON_ERR_FORMAT;
 		}
-		ct = 1;
+		*ct = 1;
 		break;
 	default:
 		return FALCON_ERR_BADARG;
 	}
-	if (pubkey_len != FALCON_PUBKEY_SIZE(logn)) {
+	if (pubkey_len != FALCON_PUBKEY_SIZE(*logn)) {
 		return FALCON_ERR_FORMAT;
 	}
-	if (tmp_len < FALCON_TMPSIZE_VERIFY(logn)) {
-		return FALCON_ERR_SIZE;
-	}
+	return 0;
+}
 
-	n = (size_t)1 << logn;
-	h = (uint16_t *)align_u16(tmp);
-	hm = h + n;
-	sv = (int16_t *)(hm + n);
-	atmp = (uint8_t *)(sv + n);
+/*
+ * Decode the public key into h[] and the signature value into sv[]
+ * (the headers must have been checked with verify_check()).
+ */
+static int
+verify_decode(uint16_t *h, int16_t *sv, unsigned logn, int ct,
+	const uint8_t *es, size_t sig_len, int sig_type,
+	const uint8_t *pk, size_t pubkey_len)
+{
+	size_t u, v;
 
 	/*
 	 * Decode public key.
@@ -891,6 +884,47 @@ falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
 			return FALCON_ERR_FORMAT;
 		}
 	}
+	return 0;
+}
+
+/* see falcon.h */
+int
+falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
+	const void *pubkey, size_t pubkey_len,
+	shake256_context *hash_data,
+	void *tmp, size_t tmp_len)
+{
+	unsigned logn;
+	uint8_t *atmp;
+	size_t n;
+	uint16_t *h, *hm;
+	int16_t *sv;
+	int ct, r;
+
+	/*
+	 * Get Falcon degree from public key; verify consistency with
+	 * signature value, and check parameters.
+	 */
+	r = verify_check(&logn, &ct, sig, sig_len, sig_type,
+		pubkey, pubkey_len);
+	if (r != 0) {
+		return r;
+	}
+	if (tmp_len < FALCON_TMPSIZE_VERIFY(logn)) {
+		return FALCON_ERR_SIZE;
+	}
+
+	n = (size_t)1 << logn;
+	h = (uint16_t *)align_u16(tmp);
+	hm = h + n;
+	sv = (int16_t *)(hm + n);
+	atmp = (uint8_t *)(sv + n);
+
+	r = verify_decode(h, sv, logn, ct, sig, sig_len, sig_type,
+		pubkey, pubkey_len);
+	if (r != 0) {
+		return r;
+	}
 
 	/*
 	 * Hash message to point.
@@ -932,3 +966,110 @@ falcon_verify(const void *sig, size_t sig_len, int sig_type,
 	return falcon_verify_finish(sig, sig_len, sig_type,
 		pubkey, pubkey_len, &hd, tmp, tmp_len);
 }
+
+/* see falcon.h */
+int
+falcon_verify_batch(unsigned logn, uint8_t *results, size_t count,
+	const void *const *sig, const size_t *sig_len, int sig_type,
+	const void *const *pubkey, const size_t *pubkey_len,
+	const void *const *data, const size_t *data_len,
+	void *tmp, size_t tmp_len)
+{
+	inner_shake256_context hd[FALCON_VERIFY_BATCH_LANES];
+	inner_shake256_context *vsc[FALCON_VERIFY_BATCH_LANES];
+	uint16_t *vhm[FALCON_VERIFY_BATCH_LANES];
+	uint16_t *h, *hm;
+	int16_t *sv;
+	uint8_t *atmp;
+	size_t idx[FALCON_VERIFY_BATCH_LANES];
+	int ct[FALCON_VERIFY_BATCH_LANES];
+	size_t n, u;
+	unsigned k, j, nv;
+	int num;
+
+	if (logn < 1 || logn > 10) {
+		return FALCON_ERR_BADARG;
+	}
+	if (sig_type < 0 || sig_type > FALCON_SIG_CT) {
+		return FALCON_ERR_BADARG;
+	}
+	if (tmp_len < FALCON_TMPSIZE_VERIFY_BATCH(logn)) {
+		return FALCON_ERR_SIZE;
+	}
+
+	/*
+	 * Lane k uses h[k*n], hm[k*n] and sv[k*n]; the area at atmp is
+	 * shared by the constant-time hash and the lattice checks, which
+	 * run one lane at a time.
+	 */
+	n = (size_t)1 << logn;
+	h = (uint16_t *)align_u16(tmp);
+	hm = h + FALCON_VERIFY_BATCH_LANES * n;
+	sv = (int16_t *)(hm + FALCON_VERIFY_BATCH_LANES * n);
+	atmp = (uint8_t *)(sv + FALCON_VERIFY_BATCH_LANES * n);
+	memset(results, 0, (count + 7) >> 3);
+	num = 0;
+	u = 0;
+	while (u < count) {
+		/*
+		 * Fill a group with items that decode correctly;
+		 * malformed items are just left marked as invalid.
+		 */
+		k = 0;
+		while (k < FALCON_VERIFY_BATCH_LANES && u < count) {
+			unsigned ilogn;
+
+			if (verify_check(&ilogn, &ct[k], sig[u], sig_len[u],
+				sig_type, pubkey[u], pubkey_len[u]) == 0
+				&& ilogn == logn
+				&& verify_decode(h + k * n, sv + k * n,
+				logn, ct[k], sig[u], sig_len[u], sig_type,
+				pubkey[u], pubkey_len[u]) == 0)
+			{
+				falcon_verify_start((shake256_context *)&hd[k],
+					sig[u], sig_len[u]);
+				shake256_inject((shake256_context *)&hd[k],
+					data[u], data_len[u]);
+				shake256_flip((shake256_context *)&hd[k]);
+				idx[k] = u;
+				k ++;
+			}
+			u ++;
+		}
+
+		/*
+		 * Hash messages to points. A full group of variable-time
+		 * lanes is squeezed with the four-way SHAKE256.
+		 */
+		nv = 0;
+		for (j = 0; j < k; j ++) {
+			if (ct[j]) {
+				Zf(hash_to_point_ct)(&hd[j],
+					hm + j * n, logn, atmp);
+			} else {
+				vsc[nv] = &hd[j];
+				vhm[nv] = hm + j * n;
+				nv ++;
+			}
+		}
+		if (nv == FALCON_VERIFY_BATCH_LANES) {
+			Zf(hash_to_point_x4)(vsc, vhm, logn);
+		} else {
+			for (j = 0; j < nv; j ++) {
+				Zf(hash_to_point_vartime)(vsc[j], vhm[j], logn);
+			}
+		}
+
+		for (j = 0; j < k; j ++) {
+			Zf(to_ntt_monty)(h + j * n, logn);
+			if (Zf(verify_raw)(hm + j * n, sv + j * n,
+				h + j * n, logn, atmp))
+			{
+				results[idx[j] >> 3] |=
+					(uint8_t)(1u << (idx[j] & 7));
+				num ++;
+			}
+		}
+	}
+	return num;
+}
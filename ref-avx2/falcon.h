@@ -386,6 +386,18 @@ extern "C" {
 #define FALCON_TMPSIZE_VERIFY(logn) \
 	((8u << (logn)) + 1)
 
+/*
+ * Number of signatures processed together by falcon_verify_batch().
+ */
+#define FALCON_VERIFY_BATCH_LANES   4
+
+/*
+ * Temporary buffer size for falcon_verify_batch(); it does not depend
+ * on the number of signatures in the batch.
+ */
+#define FALCON_TMPSIZE_VERIFY_BATCH(logn) \
+	(((6u * FALCON_VERIFY_BATCH_LANES + 2) << (logn)) + 1)
+
 /* ==================================================================== */
 /*
  * SHAKE256.
@@ -802,6 +814,41 @@ int falcon_verify_finish(const void *sig, size_t sig_len, int sig_type,
 	shake256_context *hash_data,
 	void *tmp, size_t tmp_len);
 
+/*
+ * Verify a batch of count signatures. Item i consists of the signature
+ * sig[i] (of length sig_len[i] bytes), the encoded public key pubkey[i]
+ * (of length pubkey_len[i] bytes) and the signed data data[i] (of
+ * length data_len[i] bytes). All items MUST use the degree 2^logn; an
+ * item whose key or signature is for another degree is reported as
+ * invalid. The sig_type parameter is applied to all signatures, with
+ * the same meaning as in falcon_verify().
+ *
+ * Signatures are processed by groups of FALCON_VERIFY_BATCH_LANES:
+ * all items of a group are decoded and hashed first (when the four
+ * items of a group are variable-time signatures, their hashes are
+ * computed with the four-way SHAKE256 in AVX2 builds), then the
+ * lattice check of each item is run in turn. Results are identical to
+ * calling falcon_verify() on each item.
+ *
+ * The per-item outcome is written in the results[] bitmap, which must
+ * have room for (count + 7) / 8 bytes: bit (i & 7) of results[i >> 3]
+ * is set to 1 if item i is a valid signature, 0 otherwise (whether
+ * the signature is incorrect or an element could not be decoded).
+ *
+ * The tmp[] buffer is used to hold temporary values. Its size tmp_len
+ * MUST be at least FALCON_TMPSIZE_VERIFY_BATCH(logn) bytes.
+ *
+ * Returned value: the number of valid signatures (0 to count), or a
+ * negative error code if a parameter is invalid (unsupported logn or
+ * sig_type, or tmp[] too small); in the latter case results[] is left
+ * untouched.
+ */
+int falcon_verify_batch(unsigned logn, uint8_t *results, size_t count,
+	const void *const *sig, const size_t *sig_len, int sig_type,
+	const void *const *pubkey, const size_t *pubkey_len,
+	const void *const *data, const size_t *data_len,
+	void *tmp, size_t tmp_len);
+
 /* ==================================================================== */
 
 #ifdef __cplusplus
@@ -280,6 +280,9 @@
 #ifndef FALCON_KG_CHACHA20
 #define FALCON_KG_CHACHA20   0
 #endif
+#ifndef FALCON_SAMPLER_X2
+#define FALCON_SAMPLER_X2   0
+#endif
 // yyyNIST- yyyPQCLEAN-
 
 // yyyPQCLEAN+0 yyySUPERCOP+0
@@ -536,6 +539,17 @@ extern const uint8_t Zf(max_sig_bits)[];
 void Zf(hash_to_point_vartime)(inner_shake256_context *sc,
 	uint16_t *x, unsigned logn);
 
+/*
+ * Four-lane version of hash_to_point_vartime(): the four contexts sc[]
+ * (must be already flipped) are hashed into x[0] to x[3]. With AVX2,
+ * the four SHAKE256 instances are squeezed in parallel; otherwise, this
+ * simply calls hash_to_point_vartime() four times. In both cases the
+ * outputs and final context states are identical to four calls to
+ * hash_to_point_vartime(). This is used by falcon_verify_batch().
+ */
+void Zf(hash_to_point_x4)(inner_shake256_context *const *sc,
+	uint16_t *const *x, unsigned logn);
+
 /*
  * From a SHAKE256 context (must be already flipped), produce a new
  * point. The temporary buffer (tmp) must have room for 2*2^logn bytes.
@@ -578,8 +592,17 @@ int Zf(is_short_half)(uint32_t sqn, const int16_t *s2, unsigned logn);
  */
 void Zf(to_ntt_monty)(uint16_t *h, unsigned logn);
 
+/*
+ * NTT and inverse NTT modulo q, in place, over values in 0..q-1 (also
+ * used by the benchmark code). With FALCON_AVX2, mq_NTT() and mq_iNTT()
+ * use 16-bit AVX2 code for logn >= 5; mq_NTT_scalar() and
+ * mq_iNTT_scalar() are the portable versions, which return the same
+ * values.
+ */
 void mq_iNTT(uint16_t *a, unsigned logn);
 void mq_NTT(uint16_t *a, unsigned logn);
+void mq_iNTT_scalar(uint16_t *a, unsigned logn);
+void mq_NTT_scalar(uint16_t *a, unsigned logn);
 
 /*
  * Internal signature verification code:
@@ -1074,6 +1097,28 @@ void Zf(keygen)(inner_shake256_context *rng,
 	int8_t *f, int8_t *g, int8_t *F, int8_t *G, uint16_t *h,
 	unsigned logn, uint8_t *tmp);
 
+/*
+ * Run one of the big-integer kernels of the NTRU solver once, on
+ * 2^logn integers of 'len' words each (len must not exceed the number
+ * of small primes); this is used by the benchmark code. data[] must
+ * hold 3*len*2^logn words:
+ *
+ *   FALCON_KG_BENCH_REBUILD_CRT      zint_rebuild_CRT() over data[]
+ *   FALCON_KG_BENCH_MOD_SMALL        zint_mod_small_signed() for len
+ *                                    primes, with the 4-lane kernels
+ *   FALCON_KG_BENCH_POLY_SUB_SCALED  poly_sub_scaled(); the third
+ *                                    block of data[] holds k (int32_t)
+ *   FALCON_KG_BENCH_BEZOUT           zint_bezout() on one pair of
+ *                                    integers (logn must be at least 2)
+ */
+#define FALCON_KG_BENCH_REBUILD_CRT       0
+#define FALCON_KG_BENCH_MOD_SMALL         1
+#define FALCON_KG_BENCH_POLY_SUB_SCALED   2
+#define FALCON_KG_BENCH_BEZOUT            3
+
+void Zf(keygen_bench_kernel)(unsigned kernel, uint32_t *data, size_t len,
+	unsigned logn);
+
 /* ==================================================================== */
 /*
  * Signature generation.
@@ -1151,6 +1196,11 @@ void Zf(sign_dyn)(int16_t *sig, inner_shake256_context *rng,
  * returns an integer sampled along a half-Gaussian with standard
  * deviation sigma0 = 1.8205 (center is 0, returned value is
  * nonnegative).
+ *
+ * sampler_x2() samples two integers at once, with centers mu[0] and
+ * mu[1] and the same isigma, and writes them (as fpr values) into z[0]
+ * and z[1]. The distribution is the same as with sampler(), but the
+ * PRNG is consumed in a different order (see sign.c).
  */
 
 typedef struct {
@@ -1161,6 +1211,9 @@ typedef struct {
 TARGET_AVX2
 int Zf(sampler)(void *ctx, fpr mu, fpr isigma);
 
+TARGET_AVX2
+void Zf(sampler_x2)(void *ctx, fpr *z, const fpr *mu, fpr isigma);
+
 TARGET_AVX2
 int Zf(gaussian0_sampler)(prng *p);
 
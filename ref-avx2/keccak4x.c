@@ -0,0 +1,59 @@
+/*
+ * Four-way Keccak-f[1600] permutation (AVX2), used by the multi-lane
+ * hash-to-point.
+ *
+ * The implementation itself is the one from the Keccak team, shipped
+ * in common/keccak4x/; this file only compiles it with the AVX2 target
+ * enabled when FALCON_AVX2 is set, so that no special compiler flags
+ * are needed, and compiles to nothing otherwise.
+ *
+ * ==========================(LICENSE BEGIN)============================
+ *
+ * Copyright (c) 2017-2019  Falcon Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * ===========================(LICENSE END)=============================
+ */
+
+#include "inner.h"
+
+#if FALCON_AVX2  // yyyAVX2+1
+
+#if defined __clang__
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined __GNUC__
+#pragma GCC target ("avx2")
+#endif
+
+#include "../common/keccak4x/KeccakP-1600-times4-SIMD256.c"
+
+#if defined __clang__
+#pragma clang attribute pop
+#endif
+
+#else  // yyyAVX2+0
+
+/*
+ * ISO C forbids empty translation units.
+ */
+typedef int falcon_keccak4x_unused;
+
+#endif  // yyyAVX2-
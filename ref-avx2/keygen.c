@@ -1263,6 +1263,192 @@ zint_add_mul_small(uint32_t *restrict x,
 	x[len] = cc;
 }
 
+#if FALCON_AVX2  // yyyAVX2+1
+
+/*
+ * AVX2 versions of the routines above, on four integers at once.
+ * Lane j works on the integer that starts at d + j*dstride (or
+ * x + j*xstride), i.e. four consecutive coefficients of a polynomial
+ * in the layouts used by the NTRU solver. Each lane is a 64-bit slot
+ * whose low half holds the 32-bit value, so that _mm256_mul_epu32()
+ * yields full 64-bit products. Results are identical to those of the
+ * scalar functions.
+ */
+TARGET_AVX2
+static inline __m256i
+zint_load_x4(const uint32_t *d, size_t dstride)
+{
+	return _mm256_setr_epi64x(d[0], d[dstride],
+		d[2 * dstride], d[3 * dstride]);
+}
+
+TARGET_AVX2
+static inline void
+zint_store_x4(uint32_t *d, size_t dstride, __m256i w)
+{
+	__m128i t;
+
+	t = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+		w, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+	d[0] = (uint32_t)_mm_extract_epi32(t, 0);
+	d[dstride] = (uint32_t)_mm_extract_epi32(t, 1);
+	d[2 * dstride] = (uint32_t)_mm_extract_epi32(t, 2);
+	d[3 * dstride] = (uint32_t)_mm_extract_epi32(t, 3);
+}
+
+TARGET_AVX2
+static inline __m256i
+modp_montymul_x4(__m256i a, __m256i b, __m256i p, __m256i p0i)
+{
+	__m256i z, w, t;
+
+	z = _mm256_mul_epu32(a, b);
+	w = _mm256_and_si256(_mm256_mul_epu32(z, p0i),
+		_mm256_set1_epi64x(0x7FFFFFFF));
+	w = _mm256_mul_epu32(w, p);
+	t = _mm256_srli_epi64(_mm256_add_epi64(z, w), 31);
+	return _mm256_min_epu32(t, _mm256_sub_epi32(t, p));
+}
+
+TARGET_AVX2
+static inline __m256i
+modp_add_x4(__m256i a, __m256i b, __m256i p)
+{
+	__m256i d;
+
+	d = _mm256_add_epi32(a, b);
+	return _mm256_min_epu32(d, _mm256_sub_epi32(d, p));
+}
+
+TARGET_AVX2
+static inline __m256i
+modp_sub_x4(__m256i a, __m256i b, __m256i p)
+{
+	__m256i d;
+
+	d = _mm256_sub_epi32(a, b);
+	return _mm256_min_epu32(d, _mm256_add_epi32(d, p));
+}
+
+TARGET_AVX2
+static __m256i
+zint_mod_small_unsigned_x4(const uint32_t *d, size_t dstride, size_t dlen,
+	uint32_t p, uint32_t p0i, uint32_t R2)
+{
+	__m256i x, vp, vp0i, vR2;
+	size_t u;
+
+	vp = _mm256_set1_epi64x(p);
+	vp0i = _mm256_set1_epi64x(p0i);
+	vR2 = _mm256_set1_epi64x(R2);
+	x = _mm256_setzero_si256();
+	u = dlen;
+	while (u -- > 0) {
+		__m256i w;
+
+		x = modp_montymul_x4(x, vR2, vp, vp0i);
+		w = zint_load_x4(d + u, dstride);
+		w = _mm256_min_epu32(w, _mm256_sub_epi32(w, vp));
+		x = modp_add_x4(x, w, vp);
+	}
+	return x;
+}
+
+/*
+ * Four-lane zint_mod_small_signed(); results are written in x[0],
+ * x[xstride], x[2*xstride] and x[3*xstride].
+ */
+TARGET_AVX2
+static void
+zint_mod_small_signed_x4(uint32_t *x, size_t xstride,
+	const uint32_t *d, size_t dstride, size_t dlen,
+	uint32_t p, uint32_t p0i, uint32_t R2, uint32_t Rx)
+{
+	__m256i z, w;
+
+	if (dlen == 0) {
+		zint_store_x4(x, xstride, _mm256_setzero_si256());
+		return;
+	}
+	z = zint_mod_small_unsigned_x4(d, dstride, dlen, p, p0i, R2);
+	w = zint_load_x4(d + dlen - 1, dstride);
+	w = _mm256_sub_epi64(_mm256_setzero_si256(),
+		_mm256_srli_epi64(w, 30));
+	z = modp_sub_x4(z, _mm256_and_si256(w, _mm256_set1_epi64x(Rx)),
+		_mm256_set1_epi64x(p));
+	zint_store_x4(x, xstride, z);
+}
+
+TARGET_AVX2
+static void
+zint_add_mul_small_x4(uint32_t *restrict x, size_t xstride,
+	const uint32_t *restrict y, size_t len, __m256i s)
+{
+	size_t u;
+	__m256i cc;
+
+	cc = _mm256_setzero_si256();
+	for (u = 0; u < len; u ++) {
+		__m256i z;
+
+		z = _mm256_mul_epu32(_mm256_set1_epi64x(y[u]), s);
+		z = _mm256_add_epi64(z, zint_load_x4(x + u, xstride));
+		z = _mm256_add_epi64(z, cc);
+		zint_store_x4(x + u, xstride, _mm256_and_si256(z,
+			_mm256_set1_epi64x(0x7FFFFFFF)));
+		cc = _mm256_srli_epi64(z, 31);
+	}
+	zint_store_x4(x + len, xstride, cc);
+}
+
+/*
+ * One step of zint_rebuild_CRT() (injection of word u, for prime p)
+ * for four integers, which start at x, x + xstride, x + 2*xstride and
+ * x + 3*xstride. tmp[] contains the product of the first u primes.
+ */
+TARGET_AVX2
+static void
+zint_rebuild_CRT_x4(uint32_t *restrict x, size_t xstride, size_t u,
+	const uint32_t *restrict tmp,
+	uint32_t p, uint32_t p0i, uint32_t s, uint32_t R2)
+{
+	__m256i vp, vp0i, xp, xq, xr;
+
+	vp = _mm256_set1_epi64x(p);
+	vp0i = _mm256_set1_epi64x(p0i);
+	xp = zint_load_x4(x + u, xstride);
+	xq = zint_mod_small_unsigned_x4(x, xstride, u, p, p0i, R2);
+	xr = modp_montymul_x4(_mm256_set1_epi64x(s),
+		modp_sub_x4(xp, xq, vp), vp, vp0i);
+	zint_add_mul_small_x4(x, xstride, tmp, u, xr);
+}
+
+#endif  // yyyAVX2-
+
+/*
+ * Compute d mod p for 'num' signed integers of dlen words each. Source
+ * integers start at d, d + dstride, d + 2*dstride...; results go to
+ * x[0], x[xstride], x[2*xstride]... (see zint_mod_small_signed()).
+ */
+static void
+zint_mod_small_signed_many(uint32_t *x, size_t xstride,
+	const uint32_t *d, size_t dstride, size_t dlen, size_t num,
+	uint32_t p, uint32_t p0i, uint32_t R2, uint32_t Rx)
+{
+	size_t v;
+
+	v = 0;
+#if FALCON_AVX2  // yyyAVX2+1
+	for (; v + 4 <= num; v += 4, x += 4 * xstride, d += 4 * dstride) {
+		zint_mod_small_signed_x4(x, xstride,
+			d, dstride, dlen, p, p0i, R2, Rx);
+	}
+#endif  // yyyAVX2-
+	for (; v < num; v ++, x += xstride, d += dstride) {
+		*x = zint_mod_small_signed(d, dlen, p, p0i, R2, Rx);
+	}
+}
+
 /*
  * Normalize a modular integer around 0: if x > p/2, then x is replaced
  * with x - p (signed encoding with two's complement); otherwise, x is
@@ -1356,7 +1542,14 @@ zint_rebuild_CRT(uint32_t *restrict xx, size_t xlen, size_t xstride,
 		p0i = modp_ninv31(p);
 		R2 = modp_R2(p, p0i);
 
-		for (v = 0, x = xx; v < num; v ++, x += xstride) {
+		v = 0;
+		x = xx;
+#if FALCON_AVX2  // yyyAVX2+1
+		for (; v + 4 <= num; v += 4, x += 4 * xstride) {
+			zint_rebuild_CRT_x4(x, xstride, u, tmp, p, p0i, s, R2);
+		}
+#endif  // yyyAVX2-
+		for (; v < num; v ++, x += xstride) {
 			uint32_t xp, xq, xr;
 			/*
 			 * xp = the integer x modulo the prime p for this
@@ -1389,6 +1582,238 @@ zint_rebuild_CRT(uint32_t *restrict xx, size_t xlen, size_t xstride,
 	}
 }
 
+#if FALCON_AVX2  // yyyAVX2+1
+
+/*
+ * AVX2 versions of the big integer updates of zint_bezout(): the four
+ * values a, b, c and d (a and b being the two values of one update,
+ * c and d those of the other) each get a 64-bit lane, in which runs
+ * their carry (or borrow) chain.
+ *
+ * In the linear combinations, lanes 0 and 1 compute a*xa+b*xb and
+ * a*ya+b*yb, lanes 2 and 3 the same with c and d. The factors are signed and may be equal to 2^31, which
+ * does not fit in an operand of _mm256_mul_epu32(); thus, each factor
+ * f is used as its low word lo = f mod 2^32 and a mask s (all ones if
+ * f < 0), and for a 31-bit word w:
+ *   w*f = w*lo - (w & s)*2^32  mod 2^64
+ * which is the value that the 64-bit scalar multiplication yields.
+ */
+typedef struct {
+	__m256i lo1, s1, lo2, s2;
+} zint_cofactor_x4;
+
+TARGET_AVX2
+static inline zint_cofactor_x4
+zint_cofactor_set_x4(int64_t xa, int64_t xb, int64_t ya, int64_t yb)
+{
+	zint_cofactor_x4 cf;
+	int64_t sxa, sxb, sya, syb;
+
+	sxa = -(int64_t)((uint64_t)xa >> 63);
+	sxb = -(int64_t)((uint64_t)xb >> 63);
+	sya = -(int64_t)((uint64_t)ya >> 63);
+	syb = -(int64_t)((uint64_t)yb >> 63);
+	cf.lo1 = _mm256_setr_epi64x((uint32_t)xa, (uint32_t)ya,
+		(uint32_t)xa, (uint32_t)ya);
+	cf.s1 = _mm256_setr_epi64x(sxa, sya, sxa, sya);
+	cf.lo2 = _mm256_setr_epi64x((uint32_t)xb, (uint32_t)yb,
+		(uint32_t)xb, (uint32_t)yb);
+	cf.s2 = _mm256_setr_epi64x(sxb, syb, sxb, syb);
+	return cf;
+}
+
+/*
+ * Compute z = w1*f1 + w2*f2 + wm*fm + cc in each lane, where f1 and f2
+ * are the factors in cf; only the even 32-bit elements of w1, w2 and
+ * wm are used. The low 31 bits of z are returned, and cc is replaced
+ * with z >> 31.
+ *
+ * AVX2 has no 64-bit arithmetic shift. Since z fits on a signed 64-bit
+ * integer, z + 2^63 is nonnegative and can be shifted logically; thus,
+ * the carries are kept with a bias of 2^32 (i.e. cc holds the signed
+ * carry plus 2^32), and each step adds 2^63 - 2^32. This keeps the
+ * carry chain down to one addition and one shift per word.
+ */
+TARGET_AVX2
+static inline __m256i
+zint_co_step_x4(__m256i *cc, __m256i w1, __m256i w2, __m256i wm,
+	__m256i fm, const zint_cofactor_x4 *cf)
+{
+	__m256i z, h;
+
+	z = _mm256_add_epi64(_mm256_mul_epu32(w1, cf->lo1),
+		_mm256_mul_epu32(w2, cf->lo2));
+	z = _mm256_add_epi64(z, _mm256_mul_epu32(wm, fm));
+	h = _mm256_add_epi32(_mm256_and_si256(w1, cf->s1),
+		_mm256_and_si256(w2, cf->s2));
+	z = _mm256_sub_epi64(z, _mm256_slli_epi64(h, 32));
+	z = _mm256_add_epi64(z, _mm256_set1_epi64x(0x7FFFFFFF00000000));
+	z = _mm256_add_epi64(z, *cc);
+	*cc = _mm256_srli_epi64(z, 31);
+	return _mm256_and_si256(z, _mm256_set1_epi64x(0x7FFFFFFF));
+}
+
+/*
+ * Load words 0 to 3 of a[] and of c[], in the low and high halves of a
+ * vector, respectively.
+ */
+TARGET_AVX2
+static inline __m256i
+zint_load_pair_x4(const uint32_t *a, const uint32_t *c)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(
+		_mm_loadu_si128((const __m128i *)a)),
+		_mm_loadu_si128((const __m128i *)c), 1);
+}
+
+/*
+ * Store four words of each of a[], b[], c[] and d[]: rk holds word k
+ * of a, b, c and d in the low halves of its four 64-bit lanes (the high
+ * halves must be zero).
+ */
+TARGET_AVX2
+static inline void
+zint_store_quad_x4(uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d,
+	__m256i r0, __m256i r1, __m256i r2, __m256i r3)
+{
+	__m256i t;
+
+	r0 = _mm256_or_si256(r0, _mm256_slli_epi64(r1, 32));
+	r2 = _mm256_or_si256(r2, _mm256_slli_epi64(r3, 32));
+	t = _mm256_unpacklo_epi64(r0, r2);
+	_mm_storeu_si128((__m128i *)a, _mm256_castsi256_si128(t));
+	_mm_storeu_si128((__m128i *)c, _mm256_extracti128_si256(t, 1));
+	t = _mm256_unpackhi_epi64(r0, r2);
+	_mm_storeu_si128((__m128i *)b, _mm256_castsi256_si128(t));
+	_mm_storeu_si128((__m128i *)d, _mm256_extracti128_si256(t, 1));
+}
+
+/*
+ * Given lo and hi, the 32-bit interleavings of a group of four words
+ * of a and b (low halves) and of c and d (high halves), as returned by
+ * _mm256_unpacklo_epi32() and _mm256_unpackhi_epi32(), get word k of
+ * a, b, c and d in the low halves of the four 64-bit lanes.
+ */
+#define ZINT_WORD_X4(lo, hi, k)   _mm256_shuffle_epi32( \
+		(k) < 2 ? (lo) : (hi), ((k) & 1) != 0 ? 0xFA : 0x50)
+
+/*
+ * Four-lane zint_negate(): a, b, c and d are negated if the low 32 bits
+ * of lane 0, 1, 2 and 3 of ctl (respectively) are 1; they are left
+ * unchanged if these bits are 0.
+ */
+TARGET_AVX2
+static void
+zint_negate_x4(uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d,
+	size_t len, __m256i ctl)
+{
+	size_t u;
+	__m256i cc, m, m31;
+
+	cc = ctl;
+	m = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_setzero_si256(), ctl), 1);
+	m31 = _mm256_set1_epi64x(0x7FFFFFFF);
+	for (u = 0; u + 4 <= len; u += 4) {
+		__m256i va, vb, lo, hi, r[4];
+		int k;
+
+		va = zint_load_pair_x4(a + u, c + u);
+		vb = zint_load_pair_x4(b + u, d + u);
+		lo = _mm256_unpacklo_epi32(va, vb);
+		hi = _mm256_unpackhi_epi32(va, vb);
+		r[0] = _mm256_xor_si256(ZINT_WORD_X4(lo, hi, 0), m);
+		r[1] = _mm256_xor_si256(ZINT_WORD_X4(lo, hi, 1), m);
+		r[2] = _mm256_xor_si256(ZINT_WORD_X4(lo, hi, 2), m);
+		r[3] = _mm256_xor_si256(ZINT_WORD_X4(lo, hi, 3), m);
+		for (k = 0; k < 4; k ++) {
+			r[k] = _mm256_add_epi32(r[k], cc);
+			cc = _mm256_srli_epi32(r[k], 31);
+			r[k] = _mm256_and_si256(r[k], m31);
+		}
+		zint_store_quad_x4(a + u, b + u, c + u, d + u,
+			r[0], r[1], r[2], r[3]);
+	}
+	for (; u < len; u ++) {
+		__m256i w;
+
+		w = _mm256_add_epi32(_mm256_xor_si256(
+			_mm256_setr_epi64x(a[u], b[u], c[u], d[u]), m), cc);
+		cc = _mm256_srli_epi32(w, 31);
+		a[u] = (uint32_t)_mm256_extract_epi32(w, 0) & 0x7FFFFFFF;
+		b[u] = (uint32_t)_mm256_extract_epi32(w, 2) & 0x7FFFFFFF;
+		c[u] = (uint32_t)_mm256_extract_epi32(w, 4) & 0x7FFFFFFF;
+		d[u] = (uint32_t)_mm256_extract_epi32(w, 6) & 0x7FFFFFFF;
+	}
+}
+
+/*
+ * Replace a with (a*xa+b*xb+m*fm[0])/(2^31), b with
+ * (a*ya+b*yb+m*fm[1])/(2^31), c with (c*xa+d*xb+p*fm[2])/(2^31) and d
+ * with (c*ya+d*yb+p*fm[3])/(2^31); the low bits are dropped. The top
+ * word of each result is the low 32 bits of the final carry; the four
+ * carries (signed) are written in cc[].
+ *
+ * Words are processed four at a time. c may be equal to a (and d to b,
+ * p to m), in which case both halves compute, and write, the same
+ * values.
+ */
+TARGET_AVX2
+static void
+zint_co_reduce_x4(uint32_t *a, uint32_t *b, const uint32_t *m,
+	uint32_t *c, uint32_t *d, const uint32_t *p, size_t len,
+	const zint_cofactor_x4 *cf, __m256i fm, int64_t *cc)
+{
+	size_t u;
+	__m256i vcc;
+
+	vcc = _mm256_set1_epi64x((int64_t)1 << 32);
+	(void)zint_co_step_x4(&vcc,
+		_mm256_setr_epi64x(a[0], a[0], c[0], c[0]),
+		_mm256_setr_epi64x(b[0], b[0], d[0], d[0]),
+		_mm256_setr_epi64x(m[0], m[0], p[0], p[0]), fm, cf);
+	for (u = 1; u + 4 <= len; u += 4) {
+		__m256i va, vb, vm, r0, r1, r2, r3;
+
+		va = zint_load_pair_x4(a + u, c + u);
+		vb = zint_load_pair_x4(b + u, d + u);
+		vm = zint_load_pair_x4(m + u, p + u);
+		r0 = zint_co_step_x4(&vcc, _mm256_shuffle_epi32(va, 0x00),
+			_mm256_shuffle_epi32(vb, 0x00),
+			_mm256_shuffle_epi32(vm, 0x00), fm, cf);
+		r1 = zint_co_step_x4(&vcc, _mm256_shuffle_epi32(va, 0x55),
+			_mm256_shuffle_epi32(vb, 0x55),
+			_mm256_shuffle_epi32(vm, 0x55), fm, cf);
+		r2 = zint_co_step_x4(&vcc, _mm256_shuffle_epi32(va, 0xAA),
+			_mm256_shuffle_epi32(vb, 0xAA),
+			_mm256_shuffle_epi32(vm, 0xAA), fm, cf);
+		r3 = zint_co_step_x4(&vcc, _mm256_shuffle_epi32(va, 0xFF),
+			_mm256_shuffle_epi32(vb, 0xFF),
+			_mm256_shuffle_epi32(vm, 0xFF), fm, cf);
+		zint_store_quad_x4(a + u - 1, b + u - 1, c + u - 1, d + u - 1,
+			r0, r1, r2, r3);
+	}
+	for (; u < len; u ++) {
+		__m256i r;
+
+		r = zint_co_step_x4(&vcc,
+			_mm256_setr_epi64x(a[u], a[u], c[u], c[u]),
+			_mm256_setr_epi64x(b[u], b[u], d[u], d[u]),
+			_mm256_setr_epi64x(m[u], m[u], p[u], p[u]), fm, cf);
+		a[u - 1] = (uint32_t)_mm256_extract_epi32(r, 0);
+		b[u - 1] = (uint32_t)_mm256_extract_epi32(r, 2);
+		c[u - 1] = (uint32_t)_mm256_extract_epi32(r, 4);
+		d[u - 1] = (uint32_t)_mm256_extract_epi32(r, 6);
+	}
+	_mm256_storeu_si256((__m256i *)cc,
+		_mm256_sub_epi64(vcc, _mm256_set1_epi64x((int64_t)1 << 32)));
+	a[len - 1] = (uint32_t)cc[0];
+	b[len - 1] = (uint32_t)cc[1];
+	c[len - 1] = (uint32_t)cc[2];
+	d[len - 1] = (uint32_t)cc[3];
+}
+
+#else  // yyyAVX2+0
+
 /*
  * Negate a big integer conditionally: value a is replaced with -a if
  * and only if ctl = 1. Control value ctl must be 0 or 1.
@@ -1416,6 +1841,8 @@ zint_negate(uint32_t *a, size_t len, uint32_t ctl)
 	}
 }
 
+#endif  // yyyAVX2-
+
 /*
  * Replace a with (a*xa+b*xb)/(2^31) and b with (a*ya+b*yb)/(2^31).
  * The low bits are dropped (the caller should compute the coefficients
@@ -1430,14 +1857,30 @@ zint_negate(uint32_t *a, size_t len, uint32_t ctl)
  *
  * Coefficients xa, xb, ya and yb may use the full signed 32-bit range.
  */
+TARGET_AVX2
 static uint32_t
 zint_co_reduce(uint32_t *a, uint32_t *b, size_t len,
 	int64_t xa, int64_t xb, int64_t ya, int64_t yb)
 {
-	size_t u;
 	int64_t cca, ccb;
 	uint32_t nega, negb;
 
+#if FALCON_AVX2  // yyyAVX2+1
+	zint_cofactor_x4 cf;
+	int64_t cc[4];
+
+	/*
+	 * There are only two carry chains here; both halves of the
+	 * vectors compute them.
+	 */
+	cf = zint_cofactor_set_x4(xa, xb, ya, yb);
+	zint_co_reduce_x4(a, b, a, a, b, a, len,
+		&cf, _mm256_setzero_si256(), cc);
+	cca = cc[0];
+	ccb = cc[1];
+#else  // yyyAVX2+0
+	size_t u;
+
 	cca = 0;
 	ccb = 0;
 	for (u = 0; u < len; u ++) {
@@ -1457,14 +1900,171 @@ zint_co_reduce(uint32_t *a, uint32_t *b, size_t len,
 	}
 	a[len - 1] = (uint32_t)cca;
 	b[len - 1] = (uint32_t)ccb;
+#endif  // yyyAVX2-
 
 	nega = (uint32_t)((uint64_t)cca >> 63);
 	negb = (uint32_t)((uint64_t)ccb >> 63);
+#if FALCON_AVX2  // yyyAVX2+1
+	zint_negate_x4(a, b, a, b, len,
+		_mm256_setr_epi64x(nega, negb, nega, negb));
+#else  // yyyAVX2+0
 	zint_negate(a, len, nega);
 	zint_negate(b, len, negb);
+#endif  // yyyAVX2-
 	return nega | (negb << 1);
 }
 
+#if FALCON_AVX2  // yyyAVX2+1
+
+/*
+ * Finish modular reduction, for a and b modulo m, and c and d modulo
+ * p. Lane i of neg holds (in its low 32 bits) the neg flag of the i-th
+ * value among a, b, c and d; rules on input values are the same as for
+ * the scalar version:
+ *
+ *   if neg = 1, then -m <= a < 0
+ *   if neg = 0, then 0 <= a < 2*m
+ *
+ * If neg = 0, then the top word of a[] is allowed to use 32 bits.
+ *
+ * Moduli m and p must be odd.
+ */
+TARGET_AVX2
+static void
+zint_finish_mod_x4(uint32_t *a, uint32_t *b, const uint32_t *m,
+	uint32_t *c, uint32_t *d, const uint32_t *p, size_t len, __m256i neg)
+{
+	size_t u;
+	__m256i cc, xm, ym, m31;
+
+	/*
+	 * First pass: compare each value (assumed nonnegative) with its
+	 * modulus. Borrows are kept in the low 32 bits of each lane.
+	 */
+	cc = _mm256_setzero_si256();
+	for (u = 0; u + 4 <= len; u += 4) {
+		__m256i va, vb, vm, lo, hi;
+
+		va = zint_load_pair_x4(a + u, c + u);
+		vb = zint_load_pair_x4(b + u, d + u);
+		vm = zint_load_pair_x4(m + u, p + u);
+		lo = _mm256_unpacklo_epi32(va, vb);
+		hi = _mm256_unpackhi_epi32(va, vb);
+		cc = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_sub_epi32(
+			ZINT_WORD_X4(lo, hi, 0),
+			_mm256_shuffle_epi32(vm, 0x00)), cc), 31);
+		cc = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_sub_epi32(
+			ZINT_WORD_X4(lo, hi, 1),
+			_mm256_shuffle_epi32(vm, 0x55)), cc), 31);
+		cc = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_sub_epi32(
+			ZINT_WORD_X4(lo, hi, 2),
+			_mm256_shuffle_epi32(vm, 0xAA)), cc), 31);
+		cc = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_sub_epi32(
+			ZINT_WORD_X4(lo, hi, 3),
+			_mm256_shuffle_epi32(vm, 0xFF)), cc), 31);
+	}
+	for (; u < len; u ++) {
+		cc = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_sub_epi32(
+			_mm256_setr_epi64x(a[u], b[u], c[u], d[u]),
+			_mm256_setr_epi64x(m[u], m[u], p[u], p[u])), cc), 31);
+	}
+
+	/*
+	 * Conditional subtraction of the modulus or of its opposite (see
+	 * zint_finish_mod()).
+	 */
+	xm = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_setzero_si256(), neg), 1);
+	ym = _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_or_si256(neg,
+		_mm256_sub_epi32(_mm256_set1_epi64x(1), cc)));
+	cc = neg;
+	m31 = _mm256_set1_epi64x(0x7FFFFFFF);
+	for (u = 0; u + 4 <= len; u += 4) {
+		__m256i va, vb, vm, lo, hi, r[4];
+		int k;
+
+		va = zint_load_pair_x4(a + u, c + u);
+		vb = zint_load_pair_x4(b + u, d + u);
+		vm = zint_load_pair_x4(m + u, p + u);
+		lo = _mm256_unpacklo_epi32(va, vb);
+		hi = _mm256_unpackhi_epi32(va, vb);
+		r[0] = _mm256_sub_epi32(ZINT_WORD_X4(lo, hi, 0),
+			_mm256_and_si256(_mm256_xor_si256(
+			_mm256_shuffle_epi32(vm, 0x00), xm), ym));
+		r[1] = _mm256_sub_epi32(ZINT_WORD_X4(lo, hi, 1),
+			_mm256_and_si256(_mm256_xor_si256(
+			_mm256_shuffle_epi32(vm, 0x55), xm), ym));
+		r[2] = _mm256_sub_epi32(ZINT_WORD_X4(lo, hi, 2),
+			_mm256_and_si256(_mm256_xor_si256(
+			_mm256_shuffle_epi32(vm, 0xAA), xm), ym));
+		r[3] = _mm256_sub_epi32(ZINT_WORD_X4(lo, hi, 3),
+			_mm256_and_si256(_mm256_xor_si256(
+			_mm256_shuffle_epi32(vm, 0xFF), xm), ym));
+		for (k = 0; k < 4; k ++) {
+			r[k] = _mm256_sub_epi32(r[k], cc);
+			cc = _mm256_srli_epi32(r[k], 31);
+			r[k] = _mm256_and_si256(r[k], m31);
+		}
+		zint_store_quad_x4(a + u, b + u, c + u, d + u,
+			r[0], r[1], r[2], r[3]);
+	}
+	for (; u < len; u ++) {
+		__m256i w;
+
+		w = _mm256_sub_epi32(_mm256_setr_epi64x(a[u], b[u], c[u], d[u]),
+			_mm256_and_si256(_mm256_xor_si256(
+			_mm256_setr_epi64x(m[u], m[u], p[u], p[u]), xm), ym));
+		w = _mm256_sub_epi32(w, cc);
+		cc = _mm256_srli_epi32(w, 31);
+		a[u] = (uint32_t)_mm256_extract_epi32(w, 0) & 0x7FFFFFFF;
+		b[u] = (uint32_t)_mm256_extract_epi32(w, 2) & 0x7FFFFFFF;
+		c[u] = (uint32_t)_mm256_extract_epi32(w, 4) & 0x7FFFFFFF;
+		d[u] = (uint32_t)_mm256_extract_epi32(w, 6) & 0x7FFFFFFF;
+	}
+}
+
+/*
+ * Replace a with (a*xa+b*xb)/(2^31) mod m, and b with
+ * (a*ya+b*yb)/(2^31) mod m; and, with the same coefficients, c with
+ * (c*xa+d*xb)/(2^31) mod p, and d with (c*ya+d*yb)/(2^31) mod p.
+ * Moduli m and p must be odd; m0i = -1/m[0] mod 2^31 and
+ * p0i = -1/p[0] mod 2^31. These are the two modular updates of one
+ * zint_bezout() step; their four carry chains run in the four lanes
+ * of zint_co_reduce_x4().
+ */
+TARGET_AVX2
+static void
+zint_co_reduce_mod_x2(uint32_t *a, uint32_t *b, const uint32_t *m,
+	uint32_t m0i, uint32_t *c, uint32_t *d, const uint32_t *p,
+	uint32_t p0i, size_t len, int64_t xa, int64_t xb, int64_t ya, int64_t yb)
+{
+	zint_cofactor_x4 cf;
+	int64_t cc[4];
+
+	/*
+	 * These are actually eight combined Montgomery multiplications.
+	 */
+	cf = zint_cofactor_set_x4(xa, xb, ya, yb);
+	zint_co_reduce_x4(a, b, m, c, d, p, len, &cf, _mm256_setr_epi64x(
+		((a[0] * (uint32_t)xa + b[0] * (uint32_t)xb) * m0i) & 0x7FFFFFFF,
+		((a[0] * (uint32_t)ya + b[0] * (uint32_t)yb) * m0i) & 0x7FFFFFFF,
+		((c[0] * (uint32_t)xa + d[0] * (uint32_t)xb) * p0i) & 0x7FFFFFFF,
+		((c[0] * (uint32_t)ya + d[0] * (uint32_t)yb) * p0i) & 0x7FFFFFFF),
+		cc);
+
+	/*
+	 * At this point:
+	 *   -m <= a < 2*m
+	 *   -m <= b < 2*m
+	 * (this is a case of Montgomery reduction), and likewise for c
+	 * and d with modulus p. The top words may have a 32-th bit set.
+	 * We want to add or subtract the modulus, as required.
+	 */
+	zint_finish_mod_x4(a, b, m, c, d, p, len, _mm256_srli_epi64(
+		_mm256_loadu_si256((const __m256i *)cc), 63));
+}
+
+#else  // yyyAVX2+0
+
 /*
  * Finish modular reduction. Rules on input parameters:
  *
@@ -1565,6 +2165,158 @@ zint_co_reduce_mod(uint32_t *a, uint32_t *b, const uint32_t *m, size_t len,
 	zint_finish_mod(b, len, m, (uint32_t)((uint64_t)ccb >> 63));
 }
 
+#endif  // yyyAVX2-
+
+#if FALCON_AVX2  // yyyAVX2+1
+
+/*
+ * Extract the top words of a and b for zint_bezout(): if j is the
+ * highest index >= 1 such that a[j] != 0 or b[j] != 0, then *a0 and
+ * *a1 receive a[j] and a[j-1], and *b0 and *b1 receive b[j] and b[j-1];
+ * if there is no such index, then *a0 and *b0 are set to 0, and *a1
+ * and *b1 to a[0] and b[0].
+ *
+ * Indices are scanned eight at a time: lane i keeps the words for the
+ * highest nonzero index seen so far among the indices it handles, and
+ * the lanes are merged at the end. Like the scalar code, this does not
+ * branch on, or use as an address, any value derived from a or b.
+ */
+TARGET_AVX2
+static void
+zint_top_words_x8(const uint32_t *a, const uint32_t *b, size_t len,
+	uint32_t *a0, uint32_t *a1, uint32_t *b0, uint32_t *b1)
+{
+	__m256i vi, ki, ka0, ka1, kb0, kb1;
+	uint32_t ti[8], ta0[8], ta1[8], tb0[8], tb1[8];
+	uint32_t xi, xa0, xa1, xb0, xb1;
+	size_t j;
+	int k;
+
+	if (len < 2) {
+		*a0 = 0;
+		*a1 = a[0];
+		*b0 = 0;
+		*b1 = b[0];
+		return;
+	}
+
+	/*
+	 * When all words above index 0 are zero, the words at index 1
+	 * (zero) and 0 are the expected output; lanes start from there.
+	 */
+	vi = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8);
+	ki = _mm256_set1_epi32(1);
+	ka0 = _mm256_set1_epi32((int)a[1]);
+	ka1 = _mm256_set1_epi32((int)a[0]);
+	kb0 = _mm256_set1_epi32((int)b[1]);
+	kb1 = _mm256_set1_epi32((int)b[0]);
+	for (j = 1; j + 8 <= len; j += 8) {
+		__m256i wa, wb, z;
+
+		wa = _mm256_loadu_si256((const __m256i *)(a + j));
+		wb = _mm256_loadu_si256((const __m256i *)(b + j));
+		z = _mm256_cmpeq_epi32(_mm256_or_si256(wa, wb),
+			_mm256_setzero_si256());
+		ki = _mm256_blendv_epi8(vi, ki, z);
+		ka0 = _mm256_blendv_epi8(wa, ka0, z);
+		ka1 = _mm256_blendv_epi8(_mm256_loadu_si256(
+			(const __m256i *)(a + j - 1)), ka1, z);
+		kb0 = _mm256_blendv_epi8(wb, kb0, z);
+		kb1 = _mm256_blendv_epi8(_mm256_loadu_si256(
+			(const __m256i *)(b + j - 1)), kb1, z);
+		vi = _mm256_add_epi32(vi, _mm256_set1_epi32(8));
+	}
+	_mm256_storeu_si256((__m256i *)ti, ki);
+	_mm256_storeu_si256((__m256i *)ta0, ka0);
+	_mm256_storeu_si256((__m256i *)ta1, ka1);
+	_mm256_storeu_si256((__m256i *)tb0, kb0);
+	_mm256_storeu_si256((__m256i *)tb1, kb1);
+
+	/*
+	 * Merge the lanes (keep the highest index), then process the
+	 * remaining indices, which are all higher than those of the
+	 * lanes.
+	 */
+	xi = ti[0];
+	xa0 = ta0[0];
+	xa1 = ta1[0];
+	xb0 = tb0[0];
+	xb1 = tb1[0];
+	for (k = 1; k < 8; k ++) {
+		uint32_t m;
+
+		m = -((xi - ti[k]) >> 31);
+		xi ^= (xi ^ ti[k]) & m;
+		xa0 ^= (xa0 ^ ta0[k]) & m;
+		xa1 ^= (xa1 ^ ta1[k]) & m;
+		xb0 ^= (xb0 ^ tb0[k]) & m;
+		xb1 ^= (xb1 ^ tb1[k]) & m;
+	}
+	for (; j < len; j ++) {
+		uint32_t m;
+
+		m = -(((a[j] | b[j]) + 0x7FFFFFFF) >> 31);
+		xa0 ^= (xa0 ^ a[j]) & m;
+		xa1 ^= (xa1 ^ a[j - 1]) & m;
+		xb0 ^= (xb0 ^ b[j]) & m;
+		xb1 ^= (xb1 ^ b[j - 1]) & m;
+	}
+	*a0 = xa0;
+	*a1 = xa1;
+	*b0 = xb0;
+	*b1 = xb1;
+}
+
+#else  // yyyAVX2+0
+
+/*
+ * Extract the top words of a and b for zint_bezout(): if j is the
+ * highest index >= 1 such that a[j] != 0 or b[j] != 0, then *a0 and
+ * *a1 receive a[j] and a[j-1], and *b0 and *b1 receive b[j] and b[j-1];
+ * if there is no such index, then *a0 and *b0 are set to 0, and *a1
+ * and *b1 to a[0] and b[0].
+ */
+static void
+zint_top_words(const uint32_t *a, const uint32_t *b, size_t len,
+	uint32_t *a0, uint32_t *a1, uint32_t *b0, uint32_t *b1)
+{
+	uint32_t c0, c1, xa0, xa1, xb0, xb1;
+	size_t j;
+
+	c0 = (uint32_t)-1;
+	c1 = (uint32_t)-1;
+	xa0 = 0;
+	xa1 = 0;
+	xb0 = 0;
+	xb1 = 0;
+	j = len;
+	while (j -- > 0) {
+		uint32_t aw, bw;
+
+		aw = a[j];
+		bw = b[j];
+		xa0 ^= (xa0 ^ aw) & c0;
+		xa1 ^= (xa1 ^ aw) & c1;
+		xb0 ^= (xb0 ^ bw) & c0;
+		xb1 ^= (xb1 ^ bw) & c1;
+		c1 = c0;
+		c0 &= (((aw | bw) + 0x7FFFFFFF) >> 31) - (uint32_t)1;
+	}
+
+	/*
+	 * If c1 = 0, then we grabbed two words for a and b.
+	 * If c1 != 0 but c0 = 0, then we grabbed one word. It
+	 * is not possible that c1 != 0 and c0 != 0, because that
+	 * would mean that both integers are zero.
+	 */
+	*a0 = xa0 & ~c1;
+	*a1 = xa1 | (xa0 & c1);
+	*b0 = xb0 & ~c1;
+	*b1 = xb1 | (xb0 & c1);
+}
+
+#endif  // yyyAVX2-
+
 /*
  * Compute a GCD between two positive big integers x and y. The two
  * integers must be odd. Returned value is 1 if the GCD is 1, 0
@@ -1738,7 +2490,6 @@ zint_bezout(uint32_t *restrict u, uint32_t *restrict v,
 	 * reduce the total length by at least 30 bits at each iteration.
 	 */
 	for (num = 62 * (uint32_t)len + 30; num >= 30; num -= 30) {
-		uint32_t c0, c1;
 		uint32_t a0, a1, b0, b1;
 		uint64_t a_hi, b_hi;
 		uint32_t a_lo, b_lo;
@@ -1753,36 +2504,11 @@ zint_bezout(uint32_t *restrict u, uint32_t *restrict v,
 		 * If a and b are down to one word each, then we use
 		 * a[0] and b[0].
 		 */
-		c0 = (uint32_t)-1;
-		c1 = (uint32_t)-1;
-		a0 = 0;
-		a1 = 0;
-		b0 = 0;
-		b1 = 0;
-		j = len;
-		while (j -- > 0) {
-			uint32_t aw, bw;
-
-			aw = a[j];
-			bw = b[j];
-			a0 ^= (a0 ^ aw) & c0;
-			a1 ^= (a1 ^ aw) & c1;
-			b0 ^= (b0 ^ bw) & c0;
-			b1 ^= (b1 ^ bw) & c1;
-			c1 = c0;
-			c0 &= (((aw | bw) + 0x7FFFFFFF) >> 31) - (uint32_t)1;
-		}
-
-		/*
-		 * If c1 = 0, then we grabbed two words for a and b.
-		 * If c1 != 0 but c0 = 0, then we grabbed one word. It
-		 * is not possible that c1 != 0 and c0 != 0, because that
-		 * would mean that both integers are zero.
-		 */
-		a1 |= a0 & c1;
-		a0 &= ~c1;
-		b1 |= b0 & c1;
-		b0 &= ~c1;
+#if FALCON_AVX2  // yyyAVX2+1
+		zint_top_words_x8(a, b, len, &a0, &a1, &b0, &b1);
+#else  // yyyAVX2+0
+		zint_top_words(a, b, len, &a0, &a1, &b0, &b1);
+#endif  // yyyAVX2-
 		a_hi = ((uint64_t)a0 << 31) + a1;
 		b_hi = ((uint64_t)b0 << 31) + b1;
 		a_lo = a[0];
@@ -1876,8 +2602,13 @@ zint_bezout(uint32_t *restrict u, uint32_t *restrict v,
 		pb -= (pb + pb) & -(int64_t)(r & 1);
 		qa -= (qa + qa) & -(int64_t)(r >> 1);
 		qb -= (qb + qb) & -(int64_t)(r >> 1);
+#if FALCON_AVX2  // yyyAVX2+1
+		zint_co_reduce_mod_x2(u0, u1, y, y0i, v0, v1, x, x0i,
+			len, pa, pb, qa, qb);
+#else  // yyyAVX2+0
 		zint_co_reduce_mod(u0, u1, y, len, y0i, pa, pb, qa, qb);
 		zint_co_reduce_mod(v0, v1, x, len, x0i, pa, pb, qa, qb);
+#endif  // yyyAVX2-
 	}
 
 	/*
@@ -1954,6 +2685,58 @@ zint_add_scaled_mul_small(uint32_t *restrict x, size_t xlen,
 	}
 }
 
+#if FALCON_AVX2  // yyyAVX2+1
+/*
+ * Four-lane zint_add_scaled_mul_small(): add k[j]*y*2^sc to x[j], for
+ * j = 0 to 3. The four x[j] must not overlap.
+ */
+TARGET_AVX2
+static void
+zint_add_scaled_mul_small_x4(uint32_t *const *x, size_t xlen,
+	const uint32_t *restrict y, size_t ylen, const int32_t *k,
+	uint32_t sch, uint32_t scl)
+{
+	size_t u;
+	uint32_t ysign, tw;
+	__m256i vk, cc;
+
+	if (ylen == 0) {
+		return;
+	}
+
+	vk = _mm256_setr_epi64x(k[0], k[1], k[2], k[3]);
+	ysign = -(y[ylen - 1] >> 30) >> 1;
+	tw = 0;
+	cc = _mm256_setzero_si256();
+	for (u = sch; u < xlen; u ++) {
+		size_t v;
+		uint32_t wy, wys;
+		__m256i z, t;
+
+		v = u - sch;
+		wy = v < ylen ? y[v] : ysign;
+		wys = ((wy << scl) & 0x7FFFFFFF) | tw;
+		tw = wy >> (31 - scl);
+
+		/*
+		 * Same computation as in the scalar code; the carry is
+		 * the low 32 bits of z >> 31, sign-extended to 64 bits.
+		 */
+		z = _mm256_mul_epi32(_mm256_set1_epi64x(wys), vk);
+		z = _mm256_add_epi64(z, _mm256_setr_epi64x(
+			x[0][u], x[1][u], x[2][u], x[3][u]));
+		z = _mm256_add_epi64(z, cc);
+		x[0][u] = (uint32_t)_mm256_extract_epi32(z, 0) & 0x7FFFFFFF;
+		x[1][u] = (uint32_t)_mm256_extract_epi32(z, 2) & 0x7FFFFFFF;
+		x[2][u] = (uint32_t)_mm256_extract_epi32(z, 4) & 0x7FFFFFFF;
+		x[3][u] = (uint32_t)_mm256_extract_epi32(z, 6) & 0x7FFFFFFF;
+		t = _mm256_srli_epi64(z, 31);
+		cc = _mm256_blend_epi32(t, _mm256_shuffle_epi32(
+			_mm256_srai_epi32(t, 31), 0xA0), 0xAA);
+	}
+}
+#endif  // yyyAVX2-
+
 /*
  * Subtract y*2^sc from x. The result is assumed to fit in the array of
  * size xlen (truncation is applied if necessary).
@@ -2111,7 +2894,41 @@ poly_sub_scaled(uint32_t *restrict F, size_t Flen, size_t Fstride,
 	size_t n, u;
 
 	n = MKN(logn);
-	for (u = 0; u < n; u ++) {
+	u = 0;
+
+#if FALCON_AVX2  // yyyAVX2+1
+	/*
+	 * Four rows at a time: at each step, the four lanes update four
+	 * distinct coefficients of F. Since all updates are additions
+	 * modulo 2^(31*Flen), the order change does not alter the result.
+	 */
+	for (; u + 4 <= n; u += 4) {
+		int32_t kf[4];
+		uint32_t *x[4];
+		const uint32_t *y;
+		size_t v, j;
+
+		for (j = 0; j < 4; j ++) {
+			kf[j] = -k[u + j];
+			x[j] = F + (u + j) * Fstride;
+		}
+		y = f;
+		for (v = 0; v < n; v ++) {
+			zint_add_scaled_mul_small_x4(
+				x, Flen, y, flen, kf, sch, scl);
+			for (j = 0; j < 4; j ++) {
+				if (u + j + v == n - 1) {
+					x[j] = F;
+					kf[j] = -kf[j];
+				} else {
+					x[j] += Fstride;
+				}
+			}
+			y += fstride;
+		}
+	}
+#endif  // yyyAVX2-
+	for (; u < n; u ++) {
 		int32_t kf;
 		size_t v;
 		uint32_t *x;
@@ -2177,11 +2994,8 @@ poly_sub_scaled_ntt(uint32_t *restrict F, size_t Flen, size_t Fstride,
 			t1[v] = modp_set(k[v], p);
 		}
 		modp_NTT2(t1, gm, logn, p, p0i);
-		for (v = 0, y = f, x = fk + u;
-			v < n; v ++, y += fstride, x += tlen)
-		{
-			*x = zint_mod_small_signed(y, flen, p, p0i, R2, Rx);
-		}
+		zint_mod_small_signed_many(fk + u, tlen, f, fstride, flen, n,
+			p, p0i, R2, Rx);
 		modp_NTT2_ext(fk + u, tlen, gm, logn, p, p0i);
 		for (v = 0, x = fk + u; v < n; v ++, x += tlen) {
 			*x = modp_montymul(
@@ -2635,9 +3449,8 @@ make_fg_step(uint32_t *data, unsigned logn, unsigned depth,
 		R2 = modp_R2(p, p0i);
 		Rx = modp_Rx((unsigned)slen, p, p0i, R2);
 		modp_mkgm2(gm, igm, logn, primes[u].g, p, p0i);
-		for (v = 0, x = fs; v < n; v ++, x += slen) {
-			t1[v] = zint_mod_small_signed(x, slen, p, p0i, R2, Rx);
-		}
+		zint_mod_small_signed_many(t1, 1, fs, slen, slen, n,
+			p, p0i, R2, Rx);
 		modp_NTT2(t1, gm, logn, p, p0i);
 		for (v = 0, x = fd + u; v < hn; v ++, x += tlen) {
 			uint32_t w0, w1;
@@ -2647,9 +3460,8 @@ make_fg_step(uint32_t *data, unsigned logn, unsigned depth,
 			*x = modp_montymul(
 				modp_montymul(w0, w1, p, p0i), R2, p, p0i);
 		}
-		for (v = 0, x = gs; v < n; v ++, x += slen) {
-			t1[v] = zint_mod_small_signed(x, slen, p, p0i, R2, Rx);
-		}
+		zint_mod_small_signed_many(t1, 1, gs, slen, slen, n,
+			p, p0i, R2, Rx);
 		modp_NTT2(t1, gm, logn, p, p0i);
 		for (v = 0, x = gd + u; v < hn; v ++, x += tlen) {
 			uint32_t w0, w1;
@@ -2865,20 +3677,15 @@ solve_NTRU_intermediate(unsigned logn_top,
 	 */
 	for (u = 0; u < llen; u ++) {
 		uint32_t p, p0i, R2, Rx;
-		size_t v;
-		uint32_t *xs, *ys, *xd, *yd;
 
 		p = primes[u].p;
 		p0i = modp_ninv31(p);
 		R2 = modp_R2(p, p0i);
 		Rx = modp_Rx((unsigned)dlen, p, p0i, R2);
-		for (v = 0, xs = Fd, ys = Gd, xd = Ft + u, yd = Gt + u;
-			v < hn;
-			v ++, xs += dlen, ys += dlen, xd += llen, yd += llen)
-		{
-			*xd = zint_mod_small_signed(xs, dlen, p, p0i, R2, Rx);
-			*yd = zint_mod_small_signed(ys, dlen, p, p0i, R2, Rx);
-		}
+		zint_mod_small_signed_many(Ft + u, llen, Fd, dlen, dlen, hn,
+			p, p0i, R2, Rx);
+		zint_mod_small_signed_many(Gt + u, llen, Gd, dlen, dlen, hn,
+			p, p0i, R2, Rx);
 	}
 
 	/*
@@ -2929,14 +3736,10 @@ solve_NTRU_intermediate(unsigned logn_top,
 			uint32_t Rx;
 
 			Rx = modp_Rx((unsigned)slen, p, p0i, R2);
-			for (v = 0, x = ft, y = gt;
-				v < n; v ++, x += slen, y += slen)
-			{
-				fx[v] = zint_mod_small_signed(x, slen,
-					p, p0i, R2, Rx);
-				gx[v] = zint_mod_small_signed(y, slen,
-					p, p0i, R2, Rx);
-			}
+			zint_mod_small_signed_many(fx, 1, ft, slen, slen, n,
+				p, p0i, R2, Rx);
+			zint_mod_small_signed_many(gx, 1, gt, slen, slen, n,
+				p, p0i, R2, Rx);
 			modp_NTT2(fx, gm, logn, p, p0i);
 			modp_NTT2(gx, gm, logn, p, p0i);
 		}
@@ -3404,20 +4207,15 @@ solve_NTRU_binary_depth1(unsigned logn_top,
 	 */
 	for (u = 0; u < llen; u ++) {
 		uint32_t p, p0i, R2, Rx;
-		size_t v;
-		uint32_t *xs, *ys, *xd, *yd;
 
 		p = PRIMES[u].p;
 		p0i = modp_ninv31(p);
 		R2 = modp_R2(p, p0i);
 		Rx = modp_Rx((unsigned)dlen, p, p0i, R2);
-		for (v = 0, xs = Fd, ys = Gd, xd = Ft + u, yd = Gt + u;
-			v < hn;
-			v ++, xs += dlen, ys += dlen, xd += llen, yd += llen)
-		{
-			*xd = zint_mod_small_signed(xs, dlen, p, p0i, R2, Rx);
-			*yd = zint_mod_small_signed(ys, dlen, p, p0i, R2, Rx);
-		}
+		zint_mod_small_signed_many(Ft + u, llen, Fd, dlen, dlen, hn,
+			p, p0i, R2, Rx);
+		zint_mod_small_signed_many(Gt + u, llen, Gd, dlen, dlen, hn,
+			p, p0i, R2, Rx);
 	}
 
 	/*
@@ -4131,6 +4929,45 @@ poly_small_mkgauss(RNG_CONTEXT *rng, int8_t *f, unsigned logn)
 	}
 }
 
+/* see inner.h */
+void
+Zf(keygen_bench_kernel)(unsigned kernel, uint32_t *data, size_t len,
+	unsigned logn)
+{
+	size_t n, u;
+	uint32_t *x, *y;
+
+	n = MKN(logn);
+	x = data;
+	y = data + len * n;
+	switch (kernel) {
+	case FALCON_KG_BENCH_REBUILD_CRT:
+		zint_rebuild_CRT(x, len, len, n, PRIMES, 1, y);
+		break;
+	case FALCON_KG_BENCH_MOD_SMALL:
+		for (u = 0; u < len; u ++) {
+			uint32_t p, p0i, R2, Rx;
+
+			p = PRIMES[u].p;
+			p0i = modp_ninv31(p);
+			R2 = modp_R2(p, p0i);
+			Rx = modp_Rx((unsigned)len, p, p0i, R2);
+			zint_mod_small_signed_many(y + u, len, x, len, len, n,
+				p, p0i, R2, Rx);
+		}
+		break;
+	case FALCON_KG_BENCH_POLY_SUB_SCALED:
+		poly_sub_scaled(x, len, len, y, len, len,
+			(const int32_t *)(y + len * n), 0, 5, logn);
+		break;
+	case FALCON_KG_BENCH_BEZOUT:
+		x[0] |= 1;
+		y[0] |= 1;
+		(void)zint_bezout(y + len, y + 2 * len, x, y, len, y + 3 * len);
+		break;
+	}
+}
+
 /* see falcon.h */
 void
 Zf(keygen)(inner_shake256_context *rng,
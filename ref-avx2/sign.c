@@ -322,6 +322,30 @@ Zf(expand_privkey)(fpr *restrict expanded_key,
 
 typedef int (*samplerZ)(void *ctx, fpr mu, fpr sigma);
 
+/*
+ * Sample the two values of an ffSampling leaf pair, which share the
+ * same isigma. The sampler is called directly (no function pointer);
+ * with FALCON_SAMPLER_X2, both values go through Zf(sampler_x2)(),
+ * otherwise x0 is sampled before x1, as in the reference code.
+ */
+TARGET_AVX2
+static inline void
+sample_pair(void *samp_ctx, int *y0, int *y1, fpr x0, fpr x1, fpr isigma)
+{
+#if FALCON_SAMPLER_X2
+	fpr mu[2], z[2];
+
+	mu[0] = x0;
+	mu[1] = x1;
+	Zf(sampler_x2)(samp_ctx, z, mu, isigma);
+	*y0 = (int)fpr_rint(z[0]);
+	*y1 = (int)fpr_rint(z[1]);
+#else
+	*y0 = Zf(sampler)(samp_ctx, x0, isigma);
+	*y1 = Zf(sampler)(samp_ctx, x1, isigma);
+#endif
+}
+
 /*
  * Perform Fast Fourier Sampling for target vector t. The Gram matrix
  * is provided (G = [[g00, g01], [adj(g01), g11]]). The sampled vector
@@ -423,7 +447,7 @@ ffSampling_fft_dyntree(samplerZ samp, void *samp_ctx,
  */
 TARGET_AVX2
 static void
-ffSampling_fft(samplerZ samp, void *samp_ctx,
+ffSampling_fft(void *samp_ctx,
 	fpr *restrict z0, fpr *restrict z1,
 	const fpr *restrict tree,
 	const fpr *restrict t0, const fpr *restrict t1, unsigned logn,
@@ -470,8 +494,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		w3.v = _mm_cvtsd_f64(_mm_permute_pd(ww1, 1));
 		wa = ww1;
 		sigma = tree1[3];
-		si2 = samp(samp_ctx, w2, sigma);
-		si3 = samp(samp_ctx, w3, sigma);
+		sample_pair(samp_ctx, &si2, &si3, w2, w3, sigma);
 		ww1 = _mm_set_pd((double)si3, (double)si2);
 		wa = _mm_sub_pd(wa, ww1);
 		wb = _mm_loadu_pd(&tree1[0].v);
@@ -483,8 +506,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		w0.v = _mm_cvtsd_f64(ww0);
 		w1.v = _mm_cvtsd_f64(_mm_permute_pd(ww0, 1));
 		sigma = tree1[2];
-		si0 = samp(samp_ctx, w0, sigma);
-		si1 = samp(samp_ctx, w1, sigma);
+		sample_pair(samp_ctx, &si0, &si1, w0, w1, sigma);
 		ww0 = _mm_set_pd((double)si1, (double)si0);
 
 		wc = _mm_mul_pd(
@@ -524,8 +546,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		w3.v = _mm_cvtsd_f64(_mm_permute_pd(ww1, 1));
 		wa = ww1;
 		sigma = tree0[3];
-		si2 = samp(samp_ctx, w2, sigma);
-		si3 = samp(samp_ctx, w3, sigma);
+		sample_pair(samp_ctx, &si2, &si3, w2, w3, sigma);
 		ww1 = _mm_set_pd((double)si3, (double)si2);
 		wa = _mm_sub_pd(wa, ww1);
 		wb = _mm_loadu_pd(&tree0[0].v);
@@ -537,8 +558,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		w0.v = _mm_cvtsd_f64(ww0);
 		w1.v = _mm_cvtsd_f64(_mm_permute_pd(ww0, 1));
 		sigma = tree0[2];
-		si0 = samp(samp_ctx, w0, sigma);
-		si1 = samp(samp_ctx, w1, sigma);
+		sample_pair(samp_ctx, &si0, &si1, w0, w1, sigma);
 		ww0 = _mm_set_pd((double)si1, (double)si0);
 
 		wc = _mm_mul_pd(
@@ -554,6 +574,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		return;
 #else  // yyyAVX2+0
 		fpr x0, x1, y0, y1, w0, w1, w2, w3, sigma;
+		int si0, si1;
 		fpr a_re, a_im, b_re, b_im, c_re, c_im;
 
 		tree0 = tree + 4;
@@ -579,8 +600,9 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = w2;
 		x1 = w3;
 		sigma = tree1[3];
-		w2 = fpr_of(samp(samp_ctx, x0, sigma));
-		w3 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &si0, &si1, x0, x1, sigma);
+		w2 = fpr_of(si0);
+		w3 = fpr_of(si1);
 		a_re = fpr_sub(x0, w2);
 		a_im = fpr_sub(x1, w3);
 		b_re = tree1[0];
@@ -590,8 +612,9 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = fpr_add(c_re, w0);
 		x1 = fpr_add(c_im, w1);
 		sigma = tree1[2];
-		w0 = fpr_of(samp(samp_ctx, x0, sigma));
-		w1 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &si0, &si1, x0, x1, sigma);
+		w0 = fpr_of(si0);
+		w1 = fpr_of(si1);
 
 		a_re = w0;
 		a_im = w1;
@@ -649,8 +672,9 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = w2;
 		x1 = w3;
 		sigma = tree0[3];
-		w2 = y0 = fpr_of(samp(samp_ctx, x0, sigma));
-		w3 = y1 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &si0, &si1, x0, x1, sigma);
+		w2 = y0 = fpr_of(si0);
+		w3 = y1 = fpr_of(si1);
 		a_re = fpr_sub(x0, y0);
 		a_im = fpr_sub(x1, y1);
 		b_re = tree0[0];
@@ -660,8 +684,9 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = fpr_add(c_re, w0);
 		x1 = fpr_add(c_im, w1);
 		sigma = tree0[2];
-		w0 = fpr_of(samp(samp_ctx, x0, sigma));
-		w1 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &si0, &si1, x0, x1, sigma);
+		w0 = fpr_of(si0);
+		w1 = fpr_of(si1);
 
 		a_re = w0;
 		a_im = w1;
@@ -685,13 +710,15 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 	 */
 	if (logn == 1) {
 		fpr x0, x1, y0, y1, sigma;
+		int si0, si1;
 		fpr a_re, a_im, b_re, b_im, c_re, c_im;
 
 		x0 = t1[0];
 		x1 = t1[1];
 		sigma = tree[3];
-		z1[0] = y0 = fpr_of(samp(samp_ctx, x0, sigma));
-		z1[1] = y1 = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &si0, &si1, x0, x1, sigma);
+		z1[0] = y0 = fpr_of(si0);
+		z1[1] = y1 = fpr_of(si1);
 		a_re = fpr_sub(x0, y0);
 		a_im = fpr_sub(x1, y1);
 		b_re = tree[0];
@@ -701,8 +728,9 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 		x0 = fpr_add(c_re, t0[0]);
 		x1 = fpr_add(c_im, t0[1]);
 		sigma = tree[2];
-		z0[0] = fpr_of(samp(samp_ctx, x0, sigma));
-		z0[1] = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &si0, &si1, x0, x1, sigma);
+		z0[0] = fpr_of(si0);
+		z0[1] = fpr_of(si1);
 
 		return;
 	}
@@ -715,12 +743,14 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 
 	if (logn == 0) {
 		fpr x0, x1, sigma;
+		int si0, si1;
 
 		x0 = t0[0];
 		x1 = t1[0];
 		sigma = tree[0];
-		z0[0] = fpr_of(samp(samp_ctx, x0, sigma));
-		z1[0] = fpr_of(samp(samp_ctx, x1, sigma));
+		sample_pair(samp_ctx, &si0, &si1, x0, x1, sigma);
+		z0[0] = fpr_of(si0);
+		z1[0] = fpr_of(si1);
 		return;
 	}
 
@@ -741,7 +771,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 	 * merge back into z1.
 	 */
 	Zf(poly_split_fft)(z1, z1 + hn, t1, logn);
-	ffSampling_fft(samp, samp_ctx, tmp, tmp + hn,
+	ffSampling_fft(samp_ctx, tmp, tmp + hn,
 		tree1, z1, z1 + hn, logn - 1, tmp + n);
 	Zf(poly_merge_fft)(z1, tmp, tmp + hn, logn);
 
@@ -757,7 +787,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
 	 * Second recursive invocation.
 	 */
 	Zf(poly_split_fft)(z0, z0 + hn, tmp, logn);
-	ffSampling_fft(samp, samp_ctx, tmp, tmp + hn,
+	ffSampling_fft(samp_ctx, tmp, tmp + hn,
 		tree0, z0, z0 + hn, logn - 1, tmp + n);
 	Zf(poly_merge_fft)(z0, tmp, tmp + hn, logn);
 }
@@ -773,7 +803,7 @@ ffSampling_fft(samplerZ samp, void *samp_ctx,
  * tmp[] must have room for at least six polynomials.
  */
 static int
-do_sign_tree(samplerZ samp, void *samp_ctx, int16_t *s2,
+do_sign_tree(void *samp_ctx, int16_t *s2,
 	const fpr *restrict expanded_key,
 	const uint16_t *hm,
 	unsigned logn, fpr *restrict tmp)
@@ -822,7 +852,7 @@ do_sign_tree(samplerZ samp, void *samp_ctx, int16_t *s2,
 	/*
 	 * Apply sampling. Output is written back in [tx, ty].
 	 */
-	ffSampling_fft(samp, samp_ctx, tx, ty, tree, t0, t1, logn, ty + n);
+	ffSampling_fft(samp_ctx, tx, ty, tree, t0, t1, logn, ty + n);
 
 	/*
 	 * Get the lattice point corresponding to that tiny vector.
@@ -1086,16 +1116,16 @@ do_sign_dyn(samplerZ samp, void *samp_ctx, int16_t *s2,
 	return 0;
 }
 
+#if FALCON_AVX2 // yyyAVX2+1
 /*
- * Sample an integer value along a half-gaussian distribution centered
- * on zero and standard deviation 1.8205, with a precision of 72 bits.
+ * Half-Gaussian CDT lookup (AVX2): given a 72-bit random value (lo is
+ * the low 64 bits, hi the high 8 bits), return the sampled value, as
+ * Zf(gaussian0_sampler)() does with a value read from the PRNG.
  */
 TARGET_AVX2
-int
-Zf(gaussian0_sampler)(prng *p)
+static inline int
+gaussian0_cdt(uint64_t lo, unsigned hi)
 {
-#if FALCON_AVX2 // yyyAVX2+1
-
 	/*
 	 * High words.
 	 */
@@ -1129,19 +1159,15 @@ Zf(gaussian0_sampler)(prng *p)
 		}
 	};
 
-	uint64_t lo;
-	unsigned hi;
 	__m256i xhi, rhi, gthi, eqhi, eqm;
 	__m256i xlo, gtlo0, gtlo1, gtlo2, gtlo3, gtlo4;
 	__m128i t, zt;
 	int r;
 
 	/*
-	 * Get a 72-bit random value and split it into a low part
-	 * (57 bits) and a high part (15 bits)
+	 * Split the 72-bit random value into a low part (57 bits) and
+	 * a high part (15 bits).
 	 */
-	lo = prng_get_u64(p);
-	hi = prng_get_u8(p);
 	hi = (hi << 7) | (unsigned)(lo >> 57);
 	lo &= 0x1FFFFFFFFFFFFFF;
 
@@ -1226,6 +1252,25 @@ Zf(gaussian0_sampler)(prng *p)
 	r -= _mm_cvtsi128_si32(t);
 
 	return r;
+}
+#endif // yyyAVX2-
+
+/*
+ * Sample an integer value along a half-gaussian distribution centered
+ * on zero and standard deviation 1.8205, with a precision of 72 bits.
+ */
+TARGET_AVX2
+int
+Zf(gaussian0_sampler)(prng *p)
+{
+#if FALCON_AVX2 // yyyAVX2+1
+
+	uint64_t lo;
+	unsigned hi;
+
+	lo = prng_get_u64(p);
+	hi = prng_get_u8(p);
+	return gaussian0_cdt(lo, hi);
 
 #else // yyyAVX2+0
 
@@ -1438,6 +1483,203 @@ Zf(sampler)(void *ctx, fpr mu, fpr isigma)
 	}
 }
 
+#if FALCON_AVX2 // yyyAVX2+1
+/*
+ * Get a block of len bytes from the PRNG. As with prng_get_u64(), the
+ * buffer is refilled when fewer bytes remain (the last few bytes are
+ * then dropped), so that the buffer is never left empty.
+ */
+static inline const uint8_t *
+prng_get_block(prng *p, size_t len)
+{
+	size_t u;
+
+	u = p->ptr;
+	if (u + len >= sizeof p->buf.d) {
+		Zf(prng_refill)(p);
+		u = 0;
+	}
+	p->ptr = u + len;
+	return p->buf.d + u;
+}
+#endif // yyyAVX2-
+
+/*
+ * Sample two integers, centered on mu[0] and mu[1], with the same
+ * isigma (see Zf(sampler)()). This is used for the pairs of values
+ * at the ffSampling leaves when FALCON_SAMPLER_X2 is enabled.
+ *
+ * With AVX2, each loop iteration draws a 72-byte block from the PRNG
+ * and evaluates four rejection candidates at once: lanes 0-1 for mu[0],
+ * lanes 2-3 for mu[1]. Each candidate gets a 72-bit half-Gaussian input
+ * (through the same CDT comparison as Zf(gaussian0_sampler)()), a sign
+ * bit and a 64-bit Bernoulli input, which is compared in full with the
+ * scaled exp(-x) (BerExp() compares it lazily, byte by byte). For each
+ * value, the first accepted candidate is kept; since candidates are
+ * independent, this is the same distribution as Zf(sampler)(), but the
+ * PRNG is consumed differently, so signatures do not match the KAT
+ * vectors. Selection uses masks only; as with Zf(sampler)(), the
+ * number of iterations depends only on rejection events.
+ *
+ * Without AVX2, this simply calls Zf(sampler)() twice.
+ */
+TARGET_AVX2
+void
+Zf(sampler_x2)(void *ctx, fpr *restrict z, const fpr *restrict mu,
+	fpr isigma)
+{
+#if FALCON_AVX2 // yyyAVX2+1
+
+	/*
+	 * Coefficients of the exp(-x) polynomial of fpr_expm_p63().
+	 */
+	static const double C_expm[] = {
+		1.000000000000000000000000000000,
+		-0.999999999999994892974086724280,
+		0.500000000000019206858326015208,
+		-0.166666666666984014666397229121,
+		0.041666666666110491190622155955,
+		-0.008333333327800835146903501993,
+		0.001388888894063186997887560103,
+		-0.000198412739277311890541063977,
+		0.000024801566833585381209939524,
+		-0.000002755586350219122514855659,
+		0.000000275607356160477811864927,
+		-0.000000025299506379442070029551,
+		0.000000002073772366009083061987
+	};
+
+	sampler_context *spc;
+	__m256d vmu, s, r, dss, ccs, out;
+	__m256i done, sgn;
+
+	spc = ctx;
+
+	/*
+	 * mu = s + r with s an integer and 0 <= r < 1, in all lanes.
+	 * dss = 1/(2*sigma^2); ccs = (sigma_min / sigma) * 2^63.
+	 */
+	vmu = _mm256_set_pd(mu[1].v, mu[1].v, mu[0].v, mu[0].v);
+	s = _mm256_floor_pd(vmu);
+	r = _mm256_sub_pd(vmu, s);
+	dss = _mm256_set1_pd(fpr_half(fpr_sqr(isigma)).v);
+	ccs = _mm256_set1_pd(
+		fpr_mul(fpr_mul(isigma, spc->sigma_min), fpr_ptwo63).v);
+	sgn = _mm256_set1_epi64x((int64_t)((uint64_t)1 << 63));
+	out = s;
+	done = _mm256_setzero_si256();
+
+	do {
+		const uint8_t *buf;
+		uint64_t lo;
+		uint32_t bb;
+		int32_t g[4];
+		__m256d vg, vb, vz, x, y, t, th, sel;
+		__m128i e32;
+		__m256i e, w, u, ok, any;
+		int j, k;
+
+		/*
+		 * Block layout: four 64-bit low parts of the 72-bit
+		 * half-Gaussian inputs (0..31), four Bernoulli inputs
+		 * (32..63), four high bytes (64..67), four sign bytes
+		 * (68..71).
+		 */
+		buf = prng_get_block(&spc->p, 72);
+		for (j = 0; j < 4; j ++) {
+			memcpy(&lo, buf + (j << 3), sizeof lo);
+			g[j] = gaussian0_cdt(lo, buf[64 + j]);
+		}
+		memcpy(&bb, buf + 68, sizeof bb);
+		u = _mm256_loadu_si256((const __m256i *)(buf + 32));
+
+		/*
+		 * z = b + (2*b - 1)*z0 (bimodal Gaussian, as in
+		 * Zf(sampler)()).
+		 */
+		vg = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)g));
+		vb = _mm256_cvtepi32_pd(_mm_and_si128(
+			_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)bb)),
+			_mm_set1_epi32(1)));
+		vz = FMADD(_mm256_sub_pd(_mm256_add_pd(vb, vb),
+			_mm256_set1_pd(1.0)), vg, vb);
+
+		/*
+		 * x = ((z-r)^2)/(2*sigma^2) - (z0^2)/(2*sigma0^2), then
+		 * x = e*log(2) + y with 0 <= y < log(2), and e saturated
+		 * at 63 (see BerExp()).
+		 */
+		t = _mm256_sub_pd(vz, r);
+		x = _mm256_mul_pd(_mm256_mul_pd(t, t), dss);
+		x = _mm256_sub_pd(x, _mm256_mul_pd(_mm256_mul_pd(vg, vg),
+			_mm256_set1_pd(fpr_inv_2sqrsigma0.v)));
+		e32 = _mm256_cvttpd_epi32(
+			_mm256_mul_pd(x, _mm256_set1_pd(fpr_inv_log2.v)));
+		y = _mm256_sub_pd(x, _mm256_mul_pd(_mm256_cvtepi32_pd(e32),
+			_mm256_set1_pd(fpr_log2.v)));
+		e = _mm256_cvtepi32_epi64(_mm_min_epi32(e32,
+			_mm_set1_epi32(63)));
+
+		/*
+		 * ccs*exp(-y)*2^63, in all four lanes (Horner's rule).
+		 * The result is below 2^63; there is no AVX2 conversion
+		 * to 64-bit integers, so we convert the high and low
+		 * 32-bit halves separately (the low half is offset by
+		 * 2^31 to fit the signed conversion).
+		 */
+		t = _mm256_set1_pd(C_expm[12]);
+		for (k = 11; k >= 0; k --) {
+			t = FMADD(t, y, _mm256_set1_pd(C_expm[k]));
+		}
+		t = _mm256_floor_pd(_mm256_min_pd(_mm256_mul_pd(t, ccs),
+			_mm256_set1_pd(9223372036854774784.0)));
+		th = _mm256_floor_pd(
+			_mm256_mul_pd(t, _mm256_set1_pd(2.3283064365386963e-10)));
+		t = _mm256_sub_pd(t, FMADD(th,
+			_mm256_set1_pd(4294967296.0), _mm256_set1_pd(2147483648.0)));
+		w = _mm256_add_epi64(
+			_mm256_slli_epi64(_mm256_cvtepi32_epi64(
+				_mm256_cvttpd_epi32(th)), 32),
+			_mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(t)));
+		w = _mm256_add_epi64(w, _mm256_set1_epi64x(2147483648));
+
+		/*
+		 * 2^64*exp(-x) = ((w << 1) - 1) >> e; accept when the
+		 * Bernoulli input is lower (unsigned comparison).
+		 */
+		w = _mm256_sub_epi64(_mm256_slli_epi64(w, 1),
+			_mm256_set1_epi64x(1));
+		w = _mm256_srlv_epi64(w, e);
+		ok = _mm256_cmpgt_epi64(_mm256_xor_si256(w, sgn),
+			_mm256_xor_si256(u, sgn));
+
+		/*
+		 * Keep the first accepted candidate of each pair (the odd
+		 * lane only if the even lane rejected), for values that
+		 * are not done yet, then copy it to both lanes of its
+		 * pair.
+		 */
+		ok = _mm256_andnot_si256(_mm256_slli_si256(ok, 8), ok);
+		ok = _mm256_andnot_si256(done, ok);
+		sel = _mm256_and_pd(_mm256_castsi256_pd(ok),
+			_mm256_add_pd(s, vz));
+		sel = _mm256_add_pd(sel, _mm256_permute_pd(sel, 0x5));
+		any = _mm256_or_si256(ok, _mm256_shuffle_epi32(ok, 0x4E));
+		out = _mm256_blendv_pd(out, sel, _mm256_castsi256_pd(any));
+		done = _mm256_or_si256(done, any);
+	} while (_mm256_movemask_pd(_mm256_castsi256_pd(done)) != 0xF);
+
+	z[0].v = _mm_cvtsd_f64(_mm256_castpd256_pd128(out));
+	z[1].v = _mm_cvtsd_f64(_mm256_extractf128_pd(out, 1));
+
+#else // yyyAVX2+0
+
+	z[0] = fpr_of(Zf(sampler)(ctx, mu[0], isigma));
+	z[1] = fpr_of(Zf(sampler)(ctx, mu[1], isigma));
+
+#endif // yyyAVX2-
+}
+
 /* see inner.h */
 void
 Zf(sign_tree)(int16_t *sig, inner_shake256_context *rng,
@@ -1459,8 +1701,6 @@ Zf(sign_tree)(int16_t *sig, inner_shake256_context *rng,
 		 * and the public key).
 		 */
 		sampler_context spc;
-		samplerZ samp;
-		void *samp_ctx;
 
 		/*
 		 * Normal sampling. We use a fast PRNG seeded from our
@@ -1468,13 +1708,11 @@ Zf(sign_tree)(int16_t *sig, inner_shake256_context *rng,
 		 */
 		spc.sigma_min = fpr_sigma_min[logn];
 		Zf(prng_init)(&spc.p, rng);
-		samp = Zf(sampler);
-		samp_ctx = &spc;
 
 		/*
 		 * Do the actual signature.
 		 */
-		if (do_sign_tree(samp, samp_ctx, sig,
+		if (do_sign_tree(&spc, sig,
 			expanded_key, hm, logn, ftmp))
 		{
 			break;
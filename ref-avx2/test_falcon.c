@@ -42,9 +42,10 @@
  * If using ChaCha20 during keygen, then we don't generate the same
  * outputs from the same seeds, and we don't faithfully reproduce the
  * NIST test vectors (implementation is still safe, but the tests would
- * fail).
+ * fail). The same applies to the batched leaf sampler, which consumes
+ * the PRNG in a different order.
  */
-#if FALCON_KG_CHACHA20
+#if FALCON_KG_CHACHA20 || FALCON_SAMPLER_X2
 #define DO_NIST_TESTS   0
 #else
 #define DO_NIST_TESTS   1
@@ -2079,6 +2080,30 @@ test_codec_inner(unsigned logn, uint8_t *tmp, size_t tlen)
 			}
 			check_eq(s1, s2, n * sizeof *s2,
 				"comp encode/decode");
+
+			/*
+			 * Length-only mode, short output buffer, truncated
+			 * input and non-zero padding bits.
+			 */
+			if (Zf(comp_encode)(NULL, 0, s1, logn) != len1
+				|| Zf(comp_encode)(ee, len1 - 1, s1, logn) != 0
+				|| Zf(comp_decode)(s2, logn, ee, len1 - 1) != 0)
+			{
+				fprintf(stderr, "ERR comp length checks\n");
+				exit(EXIT_FAILURE);
+			}
+			len2 = 0;
+			for (u = 0; u < n; u ++) {
+				len2 += 9 + ((unsigned)abs(s1[u]) >> 7);
+			}
+			if ((len2 & 7) != 0) {
+				ee[len1 - 1] ^= 1;
+				if (Zf(comp_decode)(s2, logn, ee, len1) != 0) {
+					fprintf(stderr, "ERR comp padding\n");
+					exit(EXIT_FAILURE);
+				}
+				ee[len1 - 1] ^= 1;
+			}
 		}
 
 		b1 = (int8_t *)tmp;
@@ -2124,6 +2149,262 @@ test_codec_inner(unsigned logn, uint8_t *tmp, size_t tlen)
 	}
 }
 
+/*
+ * Non-canonical signature encodings must be rejected: "-0", and
+ * values above 2047 (16 or more zeros in the unary part).
+ */
+static void
+test_comp_strict(unsigned logn, uint8_t *tmp)
+{
+	int16_t *x;
+	uint8_t *ee;
+	size_t n, len;
+
+	n = (size_t)1 << logn;
+	x = (int16_t *)tmp;
+	ee = tmp + 2 * n;
+	memset(x, 0, n * sizeof *x);
+	x[n - 1] = -2047;
+	len = Zf(comp_encode)(ee, 4 * n, x, logn);
+	if (len == 0 || Zf(comp_decode)(x, logn, ee, len) != len
+		|| x[n - 1] != -2047)
+	{
+		fprintf(stderr, "ERR comp strict (valid)\n");
+		exit(EXIT_FAILURE);
+	}
+
+	ee[0] |= 0x80;
+	if (Zf(comp_decode)(x, logn, ee, len) != 0) {
+		fprintf(stderr, "ERR comp strict (-0)\n");
+		exit(EXIT_FAILURE);
+	}
+
+	memset(ee, 0, 4 * n);
+	ee[3] = 0x80;
+	if (Zf(comp_decode)(x, logn, ee, 4 * n) != 0) {
+		fprintf(stderr, "ERR comp strict (2048)\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Reference fixed-width decoding, bit by bit. Returned value is 0 if
+ * the forbidden -2^(bits-1) value appears, 1 otherwise.
+ */
+static int
+trim_unpack_ref(int16_t *x, const uint8_t *buf, size_t n, unsigned bits)
+{
+	size_t u;
+	unsigned j;
+	int ok;
+
+	ok = 1;
+	for (u = 0; u < n; u ++) {
+		uint32_t w;
+
+		w = 0;
+		for (j = 0; j < bits; j ++) {
+			size_t k;
+
+			k = u * bits + j;
+			w = (w << 1) | ((buf[k >> 3] >> (7 - (k & 7))) & 1);
+		}
+		if (w == ((uint32_t)1 << (bits - 1))) {
+			ok = 0;
+		}
+		w <<= 32 - bits;
+		x[u] = (int16_t)(*(int32_t *)&w >> (32 - bits));
+	}
+	return ok;
+}
+
+/*
+ * Decode valid encodings with one flipped bit, and encodings with the
+ * forbidden value at the start, middle and end, and compare with the
+ * reference decoder.
+ */
+static void
+test_trim_strict(unsigned logn, uint8_t *tmp)
+{
+	inner_shake256_context sc;
+	int16_t *s1, *s2, *s3;
+	int8_t *b2;
+	uint8_t *ee;
+	size_t n;
+	unsigned bits;
+
+	n = (size_t)1 << logn;
+	s1 = (int16_t *)tmp;
+	s2 = s1 + n;
+	s3 = s2 + n;
+	ee = (uint8_t *)(s3 + n);
+	b2 = (int8_t *)s2;
+	inner_shake256_init(&sc);
+	inner_shake256_inject(&sc, (const uint8_t *)"trim", 4);
+	tmp[0] = logn;
+	inner_shake256_inject(&sc, tmp, 1);
+	inner_shake256_flip(&sc);
+
+	for (bits = 2; bits <= 16; bits ++) {
+		size_t u, len, k;
+		int i, ok;
+		unsigned mask1, mask2;
+
+		mask1 = 1u << (bits - 1);
+		mask2 = mask1 - 1u;
+		len = ((n * bits) + 7) >> 3;
+		for (i = 0; i < 13; i ++) {
+			uint8_t tt[4];
+			size_t r1, r2;
+
+			for (u = 0; u < n; u ++) {
+				unsigned w, a;
+
+				inner_shake256_extract(&sc, tt, 2);
+				w = (unsigned)tt[0] | ((unsigned)tt[1] << 8);
+				a = w & mask2;
+				s1[u] = ((w & mask1) != 0) ? -(int)a : (int)a;
+			}
+			if (i >= 10) {
+				u = (i == 10) ? 0 : (i == 11) ? (n >> 1) : n - 1;
+				s1[u] = 0;
+			}
+			if (Zf(trim_i16_encode)(ee, len, s1, logn, bits) != len) {
+				fprintf(stderr, "ERR trim strict (encode)\n");
+				exit(EXIT_FAILURE);
+			}
+			if (i < 10) {
+				inner_shake256_extract(&sc, tt, 4);
+				k = ((size_t)tt[0] | ((size_t)tt[1] << 8)
+					| ((size_t)tt[2] << 16)) % (n * bits);
+			} else {
+				k = u * bits;
+			}
+			ee[k >> 3] ^= (uint8_t)(0x80 >> (k & 7));
+			ok = trim_unpack_ref(s3, ee, n, bits);
+			r1 = Zf(trim_i16_decode)(s2, logn, bits, ee, len);
+			if (r1 != (ok ? len : 0)) {
+				fprintf(stderr, "ERR trim_i16 strict"
+					" (bits=%u, %zu)\n", bits, r1);
+				exit(EXIT_FAILURE);
+			}
+			if (ok) {
+				check_eq(s2, s3, n * sizeof *s2,
+					"trim_i16 strict");
+			}
+			if (bits > 8) {
+				continue;
+			}
+			r2 = Zf(trim_i8_decode)(b2, logn, bits, ee, len);
+			if (r2 != r1) {
+				fprintf(stderr, "ERR trim_i8 strict"
+					" (bits=%u, %zu)\n", bits, r2);
+				exit(EXIT_FAILURE);
+			}
+			for (u = 0; ok && u < n; u ++) {
+				if (b2[u] != s3[u]) {
+					fprintf(stderr, "ERR trim_i8 strict"
+						" (bits=%u, value %zu)\n", bits, u);
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Reference 14-bit packing (no range check).
+ */
+static void
+modq_pack_ref(uint8_t *buf, const uint16_t *x, size_t n)
+{
+	size_t u, v;
+
+	memset(buf, 0, ((n * 14) + 7) >> 3);
+	for (u = 0; u < n * 14; u ++) {
+		if ((x[u / 14] >> (13 - u % 14)) & 1) {
+			v = u >> 3;
+			buf[v] |= (uint8_t)(0x80 >> (u & 7));
+		}
+	}
+}
+
+static void
+test_modq_strict(unsigned logn, uint8_t *tmp)
+{
+	uint16_t *x, *y;
+	uint8_t *ee, *ref;
+	size_t n, u, len, pos[3];
+	int i;
+
+	n = (size_t)1 << logn;
+	len = ((n * 14) + 7) >> 3;
+	x = (uint16_t *)tmp;
+	y = x + n;
+	ee = (uint8_t *)(y + n);
+	ref = ee + len;
+	for (u = 0; u < n; u ++) {
+		x[u] = (uint16_t)((u * 7919 + 12288) % 12289);
+	}
+	x[n - 1] = 12288;
+	modq_pack_ref(ref, x, n);
+	if (Zf(modq_encode)(ee, len, x, logn) != len) {
+		fprintf(stderr, "ERR modq strict (encode)\n");
+		exit(EXIT_FAILURE);
+	}
+	check_eq(ee, ref, len, "modq encode (ref)");
+	if (Zf(modq_decode)(y, logn, ee, len) != len) {
+		fprintf(stderr, "ERR modq strict (decode)\n");
+		exit(EXIT_FAILURE);
+	}
+	check_eq(x, y, n * sizeof *x, "modq decode (ref)");
+	if (Zf(modq_encode)(ee, len - 1, x, logn) != 0
+		|| Zf(modq_decode)(y, logn, ee, len - 1) != 0)
+	{
+		fprintf(stderr, "ERR modq strict (short buffer)\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Out-of-range values (12289 and 16383), both at the start, in
+	 * the middle and at the end.
+	 */
+	pos[0] = 0;
+	pos[1] = n >> 1;
+	pos[2] = n - 1;
+	for (i = 0; i < 6; i ++) {
+		uint16_t old;
+
+		u = pos[i >> 1];
+		old = x[u];
+		x[u] = (i & 1) ? 16383 : 12289;
+		if (Zf(modq_encode)(NULL, 0, x, logn) != 0
+			|| Zf(modq_encode)(ee, len, x, logn) != 0)
+		{
+			fprintf(stderr, "ERR modq strict (encode %u)\n", x[u]);
+			exit(EXIT_FAILURE);
+		}
+		modq_pack_ref(ee, x, n);
+		if (Zf(modq_decode)(y, logn, ee, len) != 0) {
+			fprintf(stderr, "ERR modq strict (decode %u)\n", x[u]);
+			exit(EXIT_FAILURE);
+		}
+		x[u] = old;
+	}
+
+	/*
+	 * Non-zero padding bits (only with n = 2: 28 bits in 4 bytes).
+	 */
+	if (logn == 1) {
+		modq_pack_ref(ee, x, n);
+		ee[len - 1] |= 0x01;
+		if (Zf(modq_decode)(y, logn, ee, len) != 0) {
+			fprintf(stderr, "ERR modq strict (padding)\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
 static void
 test_codec(void)
 {
@@ -2138,6 +2419,9 @@ test_codec(void)
 
 	for (logn = 1; logn <= 10; logn ++) {
 		test_codec_inner(logn, tmp, tlen);
+		test_comp_strict(logn, tmp);
+		test_modq_strict(logn, tmp);
+		test_trim_strict(logn, tmp);
 		printf(".");
 		fflush(stdout);
 	}
@@ -2289,6 +2573,61 @@ test_vrfy_inner(unsigned logn, const int8_t *f, const int8_t *g,
 	fflush(stdout);
 }
 
+/*
+ * mq_NTT() and mq_iNTT() may use vectorized code; they must return
+ * exactly the same values as the portable versions.
+ */
+static void
+test_mq_NTT(uint8_t *tmp)
+{
+	inner_shake256_context sc;
+	unsigned logn;
+
+	inner_shake256_init(&sc);
+	inner_shake256_inject(&sc, (const uint8_t *)"ntt", 3);
+	inner_shake256_flip(&sc);
+	for (logn = 1; logn <= 10; logn ++) {
+		size_t n, u;
+		uint16_t *a1, *a2, *a3;
+		int i;
+
+		n = (size_t)1 << logn;
+		a1 = (uint16_t *)tmp;
+		a2 = a1 + n;
+		a3 = a2 + n;
+		for (i = 0; i < 10; i ++) {
+			for (u = 0; u < n; u ++) {
+				uint8_t tt[4];
+				uint32_t w;
+
+				inner_shake256_extract(&sc, tt, sizeof tt);
+				w = (uint32_t)tt[0]
+					| ((uint32_t)tt[1] << 8)
+					| ((uint32_t)tt[2] << 16)
+					| ((uint32_t)tt[3] << 24);
+				a1[u] = w % 12289u;
+			}
+			if (i == 0) {
+				a1[0] = 0;
+				a1[n - 1] = 12288;
+			}
+			memcpy(a2, a1, n * sizeof *a1);
+			memcpy(a3, a1, n * sizeof *a1);
+			mq_NTT(a2, logn);
+			mq_NTT_scalar(a3, logn);
+			check_eq(a2, a3, n * sizeof *a1, "NTT");
+			mq_iNTT(a2, logn);
+			mq_iNTT_scalar(a3, logn);
+			check_eq(a2, a3, n * sizeof *a1, "iNTT");
+			check_eq(a1, a2, n * sizeof *a1, "NTT round-trip");
+		}
+		printf(".");
+		fflush(stdout);
+	}
+	printf(" ");
+	fflush(stdout);
+}
+
 static void
 test_vrfy(void)
 {
@@ -2300,6 +2639,7 @@ test_vrfy(void)
 	tlen = 8192;
 	tmp = xmalloc(tlen);
 
+	test_mq_NTT(tmp);
 	test_vrfy_inner(4, ntru_f_16, ntru_g_16, ntru_F_16, ntru_G_16,
 		ntru_h_16, ntru_pkey_16, KAT_SIG_16, tmp, tlen);
 	test_vrfy_inner(9, ntru_f_512, ntru_g_512, ntru_F_512, ntru_G_512,
@@ -3410,10 +3750,12 @@ approximate_exp(fpr x)
  * For given center mu, and isigma = 1/sigma (where sigma is the standard
  * deviation of the distribution for sampling), run the sampler many
  * times, and use a chi square test to compare the result with the
- * expected distribution.
+ * expected distribution. If x2 is non-zero, then values are obtained
+ * by pairs from Zf(sampler_x2)(); the second center is mu + 7, so that
+ * the two lanes are checked independently.
  */
 static void
-test_sampler_rand(sampler_context *sc, fpr mu, fpr isigma)
+test_sampler_rand(sampler_context *sc, fpr mu, fpr isigma, int x2)
 {
 #define MAX_DEV           30
 #define NUM_SAMPLES   100000
@@ -3459,14 +3801,30 @@ test_sampler_rand(sampler_context *sc, fpr mu, fpr isigma)
 	for (z = -MAX_DEV; z <= +MAX_DEV; z ++) {
 		zz[z + MAX_DEV] = 0;
 	}
-	for (ctr = 0; ctr < NUM_SAMPLES; ctr ++) {
-		z = Zf(sampler)(sc, mu, isigma);
-		z -= c;
-		if (z < -MAX_DEV || z > +MAX_DEV) {
-			fprintf(stderr, "out-of-range sampled value: %d\n", z);
-			exit(EXIT_FAILURE);
+	for (ctr = 0; ctr < NUM_SAMPLES; ctr += 2) {
+		int zp[2], j;
+
+		if (x2) {
+			fpr mp[2], fp[2];
+
+			mp[0] = mu;
+			mp[1] = fpr_add(mu, fpr_of(7));
+			Zf(sampler_x2)(sc, fp, mp, isigma);
+			zp[0] = (int)fpr_rint(fp[0]);
+			zp[1] = (int)fpr_rint(fp[1]) - 7;
+		} else {
+			zp[0] = Zf(sampler)(sc, mu, isigma);
+			zp[1] = Zf(sampler)(sc, mu, isigma);
+		}
+		for (j = 0; j < 2; j ++) {
+			z = zp[j] - c;
+			if (z < -MAX_DEV || z > +MAX_DEV) {
+				fprintf(stderr,
+					"out-of-range sampled value: %d\n", z);
+				exit(EXIT_FAILURE);
+			}
+			zz[z + MAX_DEV] ++;
 		}
-		zz[z + MAX_DEV] ++;
 	}
 
 	/*
@@ -3589,7 +3947,19 @@ test_sampler(void)
 	mu = fpr_neg(fpr_one);
 	muinc = fpr_div(fpr_one, fpr_of(10));
 	for (i = 0; i < 21; i ++) {
-		test_sampler_rand(&sc, mu, isigma);
+		test_sampler_rand(&sc, mu, isigma, 0);
+		mu = fpr_add(mu, muinc);
+
+		printf(".");
+		fflush(stdout);
+	}
+
+	/*
+	 * Same centers with the batched sampler.
+	 */
+	mu = fpr_neg(fpr_one);
+	for (i = 0; i < 21; i ++) {
+		test_sampler_rand(&sc, mu, isigma, 1);
 		mu = fpr_add(mu, muinc);
 
 		printf(".");
@@ -3637,7 +4007,11 @@ test_sign_self(const int8_t *f, const int8_t *g,
 	for (i = 0; i < 100; i ++) {
 		uint8_t msg[50];  /* nonce + plain */
 		inner_shake256_context sc, sc2;
+		inner_shake256_context scx[4], scr[4];
+		inner_shake256_context *scp[4];
+		uint16_t *xp[4];
 		size_t u;
+		int j;
 
 		inner_shake256_extract(&rng, msg, sizeof msg);
 
@@ -3645,6 +4019,7 @@ test_sign_self(const int8_t *f, const int8_t *g,
 		inner_shake256_inject(&sc, msg, sizeof msg);
 		inner_shake256_flip(&sc);
 		sc2 = sc;
+		scx[0] = sc;
 		Zf(hash_to_point_vartime)(&sc, hm, logn);
 		Zf(hash_to_point_ct)(&sc2, hm2, logn, tt);
 		for (u = 0; u < n; u ++) {
@@ -3653,6 +4028,40 @@ test_sign_self(const int8_t *f, const int8_t *g,
 				exit(EXIT_FAILURE);
 			}
 		}
+
+		/*
+		 * Four-lane hash_to_point, with messages of distinct
+		 * lengths in the other lanes; every tenth iteration, one
+		 * context is not on a block boundary (scalar fallback).
+		 */
+		scr[0] = sc;
+		for (j = 1; j < 4; j ++) {
+			inner_shake256_init(&scx[j]);
+			inner_shake256_inject(&scx[j], msg, 1 + ((i + 13 * j) % 50));
+			inner_shake256_flip(&scx[j]);
+			if (j == 3 && i % 10 == 0) {
+				inner_shake256_extract(&scx[j], (uint8_t *)buf, 1);
+			}
+			scr[j] = scx[j];
+			Zf(hash_to_point_vartime)(&scr[j],
+				(uint16_t *)tt + (j - 1) * n, logn);
+		}
+		for (j = 0; j < 4; j ++) {
+			scp[j] = &scx[j];
+			xp[j] = j == 0 ? hm2 : (uint16_t *)tt + (j + 2) * n;
+		}
+		Zf(hash_to_point_x4)(scp, xp, logn);
+		for (j = 0; j < 4; j ++) {
+			const uint16_t *ref;
+
+			ref = j == 0 ? hm : (uint16_t *)tt + (j - 1) * n;
+			if (memcmp(xp[j], ref, n * sizeof *hm) != 0
+				|| memcmp(&scx[j], &scr[j], sizeof sc) != 0)
+			{
+				fprintf(stderr, "hash_to_point_x4() mismatch\n");
+				exit(EXIT_FAILURE);
+			}
+		}
 		Zf(sign_dyn)(sig, &rng, f, g, F, G, hm, logn, tt);
 		if (!Zf(verify_raw)(hm, sig, h, logn, tt)) {
 			fprintf(stderr, "self signature (dyn) not verified\n");
@@ -4093,6 +4502,170 @@ test_external_API(void)
 	fflush(stdout);
 }
 
+#define VERIFY_BATCH_COUNT   10
+
+/*
+ * Check falcon_verify_batch() against falcon_verify() on a mix of
+ * items: a first group of four variable-time signatures (hashed
+ * together), then constant-time, padded, wrong-data, truncated and
+ * wrong-key items.
+ */
+static void
+test_verify_batch_inner(unsigned logn, shake256_context *rng)
+{
+	static const int sig_types[] = { 0, FALCON_SIG_COMPRESSED };
+	uint8_t *privkey, *pubkey, *pubkey2, *sigbuf, *tmp;
+	const void *sig[VERIFY_BATCH_COUNT], *pk[VERIFY_BATCH_COUNT];
+	const void *data[VERIFY_BATCH_COUNT];
+	size_t sig_len[VERIFY_BATCH_COUNT], pk_len[VERIFY_BATCH_COUNT];
+	size_t data_len[VERIFY_BATCH_COUNT];
+	char msg[VERIFY_BATCH_COUNT][8];
+	uint8_t results[(VERIFY_BATCH_COUNT + 7) >> 3];
+	size_t privkey_len, pubkey_len, sig_max, tmp_len;
+	int i, t, r, num;
+
+	printf("[%u]", logn);
+	fflush(stdout);
+
+	privkey_len = FALCON_PRIVKEY_SIZE(logn);
+	pubkey_len = FALCON_PUBKEY_SIZE(logn);
+	sig_max = FALCON_SIG_CT_SIZE(logn);
+	if (sig_max < FALCON_SIG_COMPRESSED_MAXSIZE(logn)) {
+		sig_max = FALCON_SIG_COMPRESSED_MAXSIZE(logn);
+	}
+	tmp_len = FALCON_TMPSIZE_KEYGEN(logn);
+	if (tmp_len < FALCON_TMPSIZE_SIGNDYN(logn)) {
+		tmp_len = FALCON_TMPSIZE_SIGNDYN(logn);
+	}
+	if (tmp_len < FALCON_TMPSIZE_VERIFY_BATCH(logn)) {
+		tmp_len = FALCON_TMPSIZE_VERIFY_BATCH(logn);
+	}
+	privkey = xmalloc(privkey_len);
+	pubkey = xmalloc(pubkey_len);
+	pubkey2 = xmalloc(pubkey_len);
+	sigbuf = xmalloc(VERIFY_BATCH_COUNT * sig_max);
+	tmp = xmalloc(tmp_len);
+
+	r = falcon_keygen_make(rng, logn, privkey, privkey_len,
+		pubkey2, pubkey_len, tmp, tmp_len);
+	if (r != 0) {
+		fprintf(stderr, "keygen failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+	r = falcon_keygen_make(rng, logn, privkey, privkey_len,
+		pubkey, pubkey_len, tmp, tmp_len);
+	if (r != 0) {
+		fprintf(stderr, "keygen failed: %d\n", r);
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < VERIFY_BATCH_COUNT; i ++) {
+		int st;
+
+		sprintf(msg[i], "batch%d", i);
+		switch (i) {
+		case 4:
+			st = FALCON_SIG_CT;
+			break;
+		case 8:
+			st = FALCON_SIG_PADDED;
+			break;
+		default:
+			st = FALCON_SIG_COMPRESSED;
+			break;
+		}
+		sig[i] = sigbuf + i * sig_max;
+		sig_len[i] = sig_max;
+		r = falcon_sign_dyn(rng, sigbuf + i * sig_max, &sig_len[i], st,
+			privkey, privkey_len, msg[i], strlen(msg[i]),
+			tmp, tmp_len);
+		if (r != 0) {
+			fprintf(stderr, "sign_dyn failed: %d\n", r);
+			exit(EXIT_FAILURE);
+		}
+		pk[i] = pubkey;
+		pk_len[i] = pubkey_len;
+		data[i] = msg[i];
+		data_len[i] = strlen(msg[i]);
+	}
+	data[6] = msg[5];
+	sig_len[7] = 40;
+	pk[9] = pubkey2;
+
+	for (t = 0; t < (int)(sizeof sig_types / sizeof sig_types[0]); t ++) {
+		memset(results, 0xFF, sizeof results);
+		num = falcon_verify_batch(logn, results, VERIFY_BATCH_COUNT,
+			sig, sig_len, sig_types[t], pk, pk_len, data, data_len,
+			tmp, FALCON_TMPSIZE_VERIFY_BATCH(logn));
+		if (num < 0) {
+			fprintf(stderr, "verify_batch failed: %d\n", num);
+			exit(EXIT_FAILURE);
+		}
+		for (i = 0; i < VERIFY_BATCH_COUNT; i ++) {
+			int ok;
+
+			ok = falcon_verify(sig[i], sig_len[i], sig_types[t],
+				pk[i], pk_len[i], data[i], data_len[i],
+				tmp, tmp_len) == 0;
+			if (ok != ((results[i >> 3] >> (i & 7)) & 1)) {
+				fprintf(stderr, "verify_batch: item %d"
+					" (type %d): wrong result\n",
+					i, sig_types[t]);
+				exit(EXIT_FAILURE);
+			}
+			num -= ok;
+		}
+		if (num != 0) {
+			fprintf(stderr, "verify_batch: wrong count\n");
+			exit(EXIT_FAILURE);
+		}
+		if ((results[0] & 0x0F) != 0x0F) {
+			fprintf(stderr, "verify_batch: first group rejected\n");
+			exit(EXIT_FAILURE);
+		}
+		printf(".");
+		fflush(stdout);
+	}
+
+	memset(results, 0xA5, sizeof results);
+	if (falcon_verify_batch(0, results, VERIFY_BATCH_COUNT,
+		sig, sig_len, 0, pk, pk_len, data, data_len, tmp, tmp_len)
+		!= FALCON_ERR_BADARG
+		|| falcon_verify_batch(logn, results, VERIFY_BATCH_COUNT,
+		sig, sig_len, FALCON_SIG_CT + 1, pk, pk_len, data, data_len,
+		tmp, tmp_len) != FALCON_ERR_BADARG
+		|| falcon_verify_batch(logn, results, VERIFY_BATCH_COUNT,
+		sig, sig_len, 0, pk, pk_len, data, data_len,
+		tmp, FALCON_TMPSIZE_VERIFY_BATCH(logn) - 1) != FALCON_ERR_SIZE
+		|| results[0] != 0xA5 || results[1] != 0xA5)
+	{
+		fprintf(stderr, "verify_batch: bad parameters accepted\n");
+		exit(EXIT_FAILURE);
+	}
+
+	xfree(privkey);
+	xfree(pubkey);
+	xfree(pubkey2);
+	xfree(sigbuf);
+	xfree(tmp);
+}
+
+static void
+test_verify_batch(void)
+{
+	shake256_context rng;
+
+	printf("Test verify batch: ");
+	fflush(stdout);
+
+	shake256_init_prng_from_seed(&rng, "verify_batch", 12);
+	test_verify_batch_inner(9, &rng);
+	test_verify_batch_inner(10, &rng);
+
+	printf(" done.\n");
+	fflush(stdout);
+}
+
 #if DO_NIST_TESTS
 
 /* ===================================================================== */
@@ -5021,6 +5594,7 @@ main(void)
 	test_sign();
 	test_keygen();
 	test_external_API();
+	test_verify_batch();
 	test_nist_KAT(9, "a57400cbaee7109358859a56c735a3cf048a9da2");
 	test_nist_KAT(10, "affdeb3aa83bf9a2039fa9c17d65fd3e3b9828e2");
 	/* test_speed(); */
@@ -498,11 +498,394 @@ mq_div_12289(uint32_t x, uint32_t y)
 	return mq_montymul(y18, x);
 }
 
+#if FALCON_AVX2 // yyyAVX2+1
+/* ===================================================================== */
+/*
+ * AVX2 implementation of the NTT over 16-bit lanes (same conventions
+ * and same outputs as the scalar functions below).
+ *
+ * Values are signed 16-bit words. Montgomery multiplication by a
+ * constant b uses b and b*q^-1 mod 2^16 (as in the NEON code): with
+ * |a| < 2q and 0 <= b < q, the result is in -q+1..q-1. Barrett
+ * reduction maps any 16-bit value to the 0..q range. Each butterfly
+ * reduces its additive operand first, so that all intermediate values
+ * stay in -q+1..2q-1; results are normalized to 0..q-1 on output.
+ *
+ * The last four NTT layers (first four iNTT layers) work on blocks of
+ * 32 coefficients (two registers) which are transposed with the
+ * mq_shuffle*_x16() functions so that each butterfly works on whole
+ * registers. Each shuffle is its own inverse, and in all layouts the
+ * twiddle factors are used in natural order.
+ */
+
+#define QINV16   (-12287)   /* 1/q mod 2^16 */
+#define QBAR     21843      /* round(2^28 / q) */
+
+TARGET_AVX2
+static inline __m256i
+mq_montymul_x16(__m256i a, __m256i b, __m256i bqinv)
+{
+	__m256i hi, lo;
+
+	hi = _mm256_mulhi_epi16(a, b);
+	lo = _mm256_mullo_epi16(a, bqinv);
+	lo = _mm256_mulhi_epi16(lo, _mm256_set1_epi16(Q));
+	return _mm256_sub_epi16(hi, lo);
+}
+
+/*
+ * Montgomery multiplication when neither operand is a constant.
+ */
+TARGET_AVX2
+static inline __m256i
+mq_montymul2_x16(__m256i a, __m256i b)
+{
+	return mq_montymul_x16(a, b,
+		_mm256_mullo_epi16(b, _mm256_set1_epi16(QINV16)));
+}
+
+TARGET_AVX2
+static inline __m256i
+mq_barrett_x16(__m256i a)
+{
+	__m256i t;
+
+	t = _mm256_mulhi_epi16(a, _mm256_set1_epi16(QBAR));
+	t = _mm256_srai_epi16(t, 12);
+	t = _mm256_mullo_epi16(t, _mm256_set1_epi16(Q));
+	return _mm256_sub_epi16(a, t);
+}
+
+/*
+ * Normalize a value in -32768..32767 to 0..q-1.
+ */
+TARGET_AVX2
+static inline __m256i
+mq_norm_x16(__m256i a)
+{
+	__m256i q;
+
+	q = _mm256_set1_epi16(Q);
+	a = _mm256_sub_epi16(mq_barrett_x16(a), q);
+	return _mm256_add_epi16(a, _mm256_and_si256(q,
+		_mm256_srai_epi16(a, 15)));
+}
+
+/*
+ * Twiddle factor vectors: tw[0..15] repeated 16/k times each, for
+ * k = 16, 8, 4 and 2 distinct values.
+ */
+TARGET_AVX2
+static inline __m256i
+mq_tw16(const uint16_t *tw)
+{
+	return _mm256_loadu_si256((const __m256i *)tw);
+}
+
+TARGET_AVX2
+static inline __m256i
+mq_tw8(const uint16_t *tw)
+{
+	__m256i w;
+
+	w = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)tw));
+	return _mm256_or_si256(w, _mm256_slli_epi32(w, 16));
+}
+
+TARGET_AVX2
+static inline __m256i
+mq_tw4(const uint16_t *tw)
+{
+	__m256i w;
+
+	w = _mm256_cvtepu16_epi64(_mm_loadl_epi64((const __m128i *)tw));
+	w = _mm256_or_si256(w, _mm256_slli_epi64(w, 16));
+	return _mm256_or_si256(w, _mm256_slli_epi64(w, 32));
+}
+
+TARGET_AVX2
+static inline __m256i
+mq_tw2(const uint16_t *tw)
+{
+	return _mm256_inserti128_si256(
+		_mm256_castsi128_si256(_mm_set1_epi16((short)tw[0])),
+		_mm_set1_epi16((short)tw[1]), 1);
+}
+
+TARGET_AVX2
+static inline void
+mq_shuffle8_x16(__m256i *a, __m256i *b)
+{
+	__m256i t;
+
+	t = _mm256_permute2x128_si256(*a, *b, 0x20);
+	*b = _mm256_permute2x128_si256(*a, *b, 0x31);
+	*a = t;
+}
+
+TARGET_AVX2
+static inline void
+mq_shuffle4_x16(__m256i *a, __m256i *b)
+{
+	__m256i t;
+
+	t = _mm256_unpacklo_epi64(*a, *b);
+	*b = _mm256_unpackhi_epi64(*a, *b);
+	*a = t;
+}
+
+TARGET_AVX2
+static inline void
+mq_shuffle2_x16(__m256i *a, __m256i *b)
+{
+	__m256i t;
+
+	t = _mm256_blend_epi32(*a, _mm256_slli_epi64(*b, 32), 0xAA);
+	*b = _mm256_blend_epi32(_mm256_srli_epi64(*a, 32), *b, 0xAA);
+	*a = t;
+}
+
+TARGET_AVX2
+static inline void
+mq_shuffle1_x16(__m256i *a, __m256i *b)
+{
+	__m256i t;
+
+	t = _mm256_blend_epi16(*a, _mm256_slli_epi32(*b, 16), 0xAA);
+	*b = _mm256_blend_epi16(_mm256_srli_epi32(*a, 16), *b, 0xAA);
+	*a = t;
+}
+
+/*
+ * Cooley-Tukey butterfly: (a, b) <- (a + w*b, a - w*b).
+ */
+TARGET_AVX2
+static inline void
+mq_ct_x16(__m256i *a, __m256i *b, __m256i w)
+{
+	__m256i u, v;
+
+	u = mq_barrett_x16(*a);
+	v = mq_montymul_x16(*b, w,
+		_mm256_mullo_epi16(w, _mm256_set1_epi16(QINV16)));
+	*a = _mm256_add_epi16(u, v);
+	*b = _mm256_sub_epi16(u, v);
+}
+
+/*
+ * Gentleman-Sande butterfly: (a, b) <- (a + b, w*(a - b)).
+ */
+TARGET_AVX2
+static inline void
+mq_gs_x16(__m256i *a, __m256i *b, __m256i w)
+{
+	__m256i u, v;
+
+	u = *a;
+	v = *b;
+	*a = mq_barrett_x16(_mm256_add_epi16(u, v));
+	*b = mq_montymul_x16(_mm256_sub_epi16(u, v), w,
+		_mm256_mullo_epi16(w, _mm256_set1_epi16(QINV16)));
+}
+
+/*
+ * NTT for logn >= 5.
+ */
+TARGET_AVX2
+static void
+mq_NTT_avx2(uint16_t *a, unsigned logn)
+{
+	size_t n, t, m, u;
+
+	n = (size_t)1 << logn;
+	t = n;
+	for (m = 1; (t >> 1) >= 16; m <<= 1) {
+		size_t ht, i, j1;
+
+		ht = t >> 1;
+		for (i = 0, j1 = 0; i < m; i ++, j1 += t) {
+			__m256i w;
+			size_t j;
+
+			w = _mm256_set1_epi16((short)GMb[m + i]);
+			for (j = j1; j < j1 + ht; j += 16) {
+				__m256i x, y;
+
+				x = _mm256_loadu_si256((__m256i *)(a + j));
+				y = _mm256_loadu_si256((__m256i *)(a + j + ht));
+				mq_ct_x16(&x, &y, w);
+				_mm256_storeu_si256((__m256i *)(a + j), x);
+				_mm256_storeu_si256((__m256i *)(a + j + ht), y);
+			}
+		}
+		t = ht;
+	}
+
+	/*
+	 * Last four layers (distances 8, 4, 2 and 1) on blocks of 32.
+	 */
+	for (u = 0; u < n; u += 32) {
+		__m256i x, y;
+
+		x = _mm256_loadu_si256((__m256i *)(a + u));
+		y = _mm256_loadu_si256((__m256i *)(a + u + 16));
+		mq_shuffle8_x16(&x, &y);
+		mq_ct_x16(&x, &y, mq_tw2(GMb + (n >> 4) + (u >> 4)));
+		mq_shuffle4_x16(&x, &y);
+		mq_ct_x16(&x, &y, mq_tw4(GMb + (n >> 3) + (u >> 3)));
+		mq_shuffle2_x16(&x, &y);
+		mq_ct_x16(&x, &y, mq_tw8(GMb + (n >> 2) + (u >> 2)));
+		mq_shuffle1_x16(&x, &y);
+		mq_ct_x16(&x, &y, mq_tw16(GMb + (n >> 1) + (u >> 1)));
+		x = mq_norm_x16(x);
+		y = mq_norm_x16(y);
+		mq_shuffle1_x16(&x, &y);
+		mq_shuffle2_x16(&x, &y);
+		mq_shuffle4_x16(&x, &y);
+		mq_shuffle8_x16(&x, &y);
+		_mm256_storeu_si256((__m256i *)(a + u), x);
+		_mm256_storeu_si256((__m256i *)(a + u + 16), y);
+	}
+}
+
+/*
+ * Inverse NTT for logn >= 5.
+ */
+TARGET_AVX2
+static void
+mq_iNTT_avx2(uint16_t *a, unsigned logn)
+{
+	size_t n, t, m, u;
+	uint32_t ni;
+	__m256i wn;
+
+	n = (size_t)1 << logn;
+
+	/*
+	 * First four layers (distances 1, 2, 4 and 8) on blocks of 32.
+	 */
+	for (u = 0; u < n; u += 32) {
+		__m256i x, y;
+
+		x = _mm256_loadu_si256((__m256i *)(a + u));
+		y = _mm256_loadu_si256((__m256i *)(a + u + 16));
+		mq_shuffle8_x16(&x, &y);
+		mq_shuffle4_x16(&x, &y);
+		mq_shuffle2_x16(&x, &y);
+		mq_shuffle1_x16(&x, &y);
+		mq_gs_x16(&x, &y, mq_tw16(iGMb + (n >> 1) + (u >> 1)));
+		mq_shuffle1_x16(&x, &y);
+		mq_gs_x16(&x, &y, mq_tw8(iGMb + (n >> 2) + (u >> 2)));
+		mq_shuffle2_x16(&x, &y);
+		mq_gs_x16(&x, &y, mq_tw4(iGMb + (n >> 3) + (u >> 3)));
+		mq_shuffle4_x16(&x, &y);
+		mq_gs_x16(&x, &y, mq_tw2(iGMb + (n >> 4) + (u >> 4)));
+		mq_shuffle8_x16(&x, &y);
+		_mm256_storeu_si256((__m256i *)(a + u), x);
+		_mm256_storeu_si256((__m256i *)(a + u + 16), y);
+	}
+
+	t = 16;
+	for (m = n >> 4; m > 1; m >>= 1) {
+		size_t hm, dt, i, j1;
+
+		hm = m >> 1;
+		dt = t << 1;
+		for (i = 0, j1 = 0; i < hm; i ++, j1 += dt) {
+			__m256i w;
+			size_t j;
+
+			w = _mm256_set1_epi16((short)iGMb[hm + i]);
+			for (j = j1; j < j1 + t; j += 16) {
+				__m256i x, y;
+
+				x = _mm256_loadu_si256((__m256i *)(a + j));
+				y = _mm256_loadu_si256((__m256i *)(a + j + t));
+				mq_gs_x16(&x, &y, w);
+				_mm256_storeu_si256((__m256i *)(a + j), x);
+				_mm256_storeu_si256((__m256i *)(a + j + t), y);
+			}
+		}
+		t = dt;
+	}
+
+	/*
+	 * Division by n (see mq_iNTT_scalar()), and normalization.
+	 */
+	ni = R;
+	for (m = n; m > 1; m >>= 1) {
+		ni = mq_rshift1(ni);
+	}
+	wn = _mm256_set1_epi16((short)ni);
+	for (u = 0; u < n; u += 16) {
+		__m256i x;
+
+		x = _mm256_loadu_si256((__m256i *)(a + u));
+		x = mq_montymul_x16(x, wn,
+			_mm256_mullo_epi16(wn, _mm256_set1_epi16(QINV16)));
+		_mm256_storeu_si256((__m256i *)(a + u), mq_norm_x16(x));
+	}
+}
+
 /*
- * Compute NTT on a ring element.
+ * Compute x/y for 16 values (as mq_div_12289(), with the same addition
+ * chain). Inputs are in -q+1..2q-1; outputs are in 0..q-1.
  */
+TARGET_AVX2
+static inline __m256i
+mq_div_12289_x16(__m256i x, __m256i y)
+{
+	__m256i r2, r2q;
+	__m256i y0, y1, y2, y3, y8, y9, y10, y13, y16, y18;
+
+	r2 = _mm256_set1_epi16(R2);
+	r2q = _mm256_mullo_epi16(r2, _mm256_set1_epi16(QINV16));
+	y0 = mq_montymul_x16(y, r2, r2q);
+	y1 = mq_montymul2_x16(y0, y0);
+	y2 = mq_montymul2_x16(y1, y0);
+	y3 = mq_montymul2_x16(y2, y1);
+	y8 = mq_montymul2_x16(y3, y3);
+	y8 = mq_montymul2_x16(y8, y8);
+	y8 = mq_montymul2_x16(y8, y8);
+	y8 = mq_montymul2_x16(y8, y8);
+	y8 = mq_montymul2_x16(y8, y8);
+	y9 = mq_montymul2_x16(y8, y2);
+	y10 = mq_montymul2_x16(y9, y8);
+	y13 = mq_montymul2_x16(y10, y10);
+	y13 = mq_montymul2_x16(y13, y13);
+	y13 = mq_montymul2_x16(y13, y9);
+	y16 = mq_montymul2_x16(y13, y13);
+	y16 = mq_montymul2_x16(y16, y16);
+	y16 = mq_montymul2_x16(y16, y10);
+	y18 = mq_montymul2_x16(y16, y16);
+	y18 = mq_montymul2_x16(y18, y0);
+	return mq_norm_x16(mq_montymul2_x16(y18, x));
+}
+
+/*
+ * Replace f[u] with f[u]/g[u] for all u, n >= 16 (both in 0..q-1).
+ */
+TARGET_AVX2
+static void
+mq_poly_div_avx2(uint16_t *f, const uint16_t *g, size_t n)
+{
+	size_t u;
+
+	for (u = 0; u < n; u += 16) {
+		__m256i x, y;
+
+		x = _mm256_loadu_si256((__m256i *)(f + u));
+		y = _mm256_loadu_si256((const __m256i *)(g + u));
+		_mm256_storeu_si256((__m256i *)(f + u),
+			mq_div_12289_x16(x, y));
+	}
+}
+
+#endif // yyyAVX2-
+
+/* see inner.h */
 void
-mq_NTT(uint16_t *a, unsigned logn)
+mq_NTT_scalar(uint16_t *a, unsigned logn)
 {
 	size_t n, t, m;
 
@@ -531,11 +914,9 @@ mq_NTT(uint16_t *a, unsigned logn)
 	}
 }
 
-/*
- * Compute the inverse NTT on a ring element, binary case.
- */
+/* see inner.h */
 void
-mq_iNTT(uint16_t *a, unsigned logn)
+mq_iNTT_scalar(uint16_t *a, unsigned logn)
 {
 	size_t n, t, m;
 	uint32_t ni;
@@ -587,15 +968,60 @@ mq_iNTT(uint16_t *a, unsigned logn)
 	}
 }
 
+/* see inner.h */
+TARGET_AVX2
+void
+mq_NTT(uint16_t *a, unsigned logn)
+{
+#if FALCON_AVX2 // yyyAVX2+1
+	if (logn >= 5) {
+		mq_NTT_avx2(a, logn);
+		return;
+	}
+#endif // yyyAVX2-
+	mq_NTT_scalar(a, logn);
+}
+
+/* see inner.h */
+TARGET_AVX2
+void
+mq_iNTT(uint16_t *a, unsigned logn)
+{
+#if FALCON_AVX2 // yyyAVX2+1
+	if (logn >= 5) {
+		mq_iNTT_avx2(a, logn);
+		return;
+	}
+#endif // yyyAVX2-
+	mq_iNTT_scalar(a, logn);
+}
+
 /*
  * Convert a polynomial (mod q) to Montgomery representation.
  */
+TARGET_AVX2
 static void
 mq_poly_tomonty(uint16_t *f, unsigned logn)
 {
 	size_t u, n;
 
 	n = (size_t)1 << logn;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (n >= 16) {
+		__m256i r2, r2q;
+
+		r2 = _mm256_set1_epi16(R2);
+		r2q = _mm256_mullo_epi16(r2, _mm256_set1_epi16(QINV16));
+		for (u = 0; u < n; u += 16) {
+			__m256i x;
+
+			x = _mm256_loadu_si256((__m256i *)(f + u));
+			x = mq_norm_x16(mq_montymul_x16(x, r2, r2q));
+			_mm256_storeu_si256((__m256i *)(f + u), x);
+		}
+		return;
+	}
+#endif // yyyAVX2-
 	for (u = 0; u < n; u ++) {
 		f[u] = (uint16_t)mq_montymul(f[u], R2);
 	}
@@ -605,12 +1031,26 @@ mq_poly_tomonty(uint16_t *f, unsigned logn)
  * Multiply two polynomials together (NTT representation, and using
  * a Montgomery multiplication). Result f*g is written over f.
  */
+TARGET_AVX2
 static void
 mq_poly_montymul_ntt(uint16_t *f, const uint16_t *g, unsigned logn)
 {
 	size_t u, n;
 
 	n = (size_t)1 << logn;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (n >= 16) {
+		for (u = 0; u < n; u += 16) {
+			__m256i x, y;
+
+			x = _mm256_loadu_si256((__m256i *)(f + u));
+			y = _mm256_loadu_si256((const __m256i *)(g + u));
+			x = mq_norm_x16(mq_montymul2_x16(x, y));
+			_mm256_storeu_si256((__m256i *)(f + u), x);
+		}
+		return;
+	}
+#endif // yyyAVX2-
 	for (u = 0; u < n; u ++) {
 		f[u] = (uint16_t)mq_montymul(f[u], g[u]);
 	}
@@ -619,17 +1059,58 @@ mq_poly_montymul_ntt(uint16_t *f, const uint16_t *g, unsigned logn)
 /*
  * Subtract polynomial g from polynomial f.
  */
+TARGET_AVX2
 static void
 mq_poly_sub(uint16_t *f, const uint16_t *g, unsigned logn)
 {
 	size_t u, n;
 
 	n = (size_t)1 << logn;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (n >= 16) {
+		__m256i q;
+
+		q = _mm256_set1_epi16(Q);
+		for (u = 0; u < n; u += 16) {
+			__m256i x;
+
+			x = _mm256_sub_epi16(
+				_mm256_loadu_si256((__m256i *)(f + u)),
+				_mm256_loadu_si256((const __m256i *)(g + u)));
+			x = _mm256_add_epi16(x, _mm256_and_si256(q,
+				_mm256_srai_epi16(x, 15)));
+			_mm256_storeu_si256((__m256i *)(f + u), x);
+		}
+		return;
+	}
+#endif // yyyAVX2-
 	for (u = 0; u < n; u ++) {
 		f[u] = (uint16_t)mq_sub(f[u], g[u]);
 	}
 }
 
+/*
+ * Replace f with f/g (NTT representation). All coefficients of g
+ * must be non-zero.
+ */
+TARGET_AVX2
+static void
+mq_poly_div_ntt(uint16_t *f, const uint16_t *g, unsigned logn)
+{
+	size_t u, n;
+
+	n = (size_t)1 << logn;
+#if FALCON_AVX2 // yyyAVX2+1
+	if (n >= 16) {
+		mq_poly_div_avx2(f, g, n);
+		return;
+	}
+#endif // yyyAVX2-
+	for (u = 0; u < n; u ++) {
+		f[u] = (uint16_t)mq_div_12289(f[u], g[u]);
+	}
+}
+
 /* ===================================================================== */
 
 /* see inner.h */
@@ -708,8 +1189,8 @@ Zf(compute_public)(uint16_t *h,
 		if (tt[u] == 0) {
 			return 0;
 		}
-		h[u] = (uint16_t)mq_div_12289(h[u], tt[u]);
 	}
+	mq_poly_div_ntt(h, tt, logn);
 	mq_iNTT(h, logn);
 	return 1;
 }
@@ -742,8 +1223,8 @@ Zf(complete_private)(int8_t *G,
 		if (t2[u] == 0) {
 			return 0;
 		}
-		t1[u] = (uint16_t)mq_div_12289(t1[u], t2[u]);
 	}
+	mq_poly_div_ntt(t1, t2, logn);
 	mq_iNTT(t1, logn);
 	for (u = 0; u < n; u ++) {
 		uint32_t w;